@@ -624,7 +624,31 @@ void ClassDB::get_method_list(StringName p_class, List<MethodInfo> *p_methods, b
 	}
 }
 
-MethodBind *ClassDB::get_method(StringName p_class, StringName p_name) {
+// Small direct-mapped cache in front of get_method(), so repeated calls skip the class lock and the
+// hash lookups up the inheritance chain. Entries are keyed by the StringName data pointers, which stay
+// valid while the entry can match: ClassDB owns the class names, and each MethodBind owns its name.
+struct MethodCacheEntry {
+	const void *class_name;
+	const void *method_name;
+	uint32_t version;
+	MethodBind *method;
+};
+
+#define METHOD_CACHE_SIZE 512
+
+static thread_local MethodCacheEntry method_cache[METHOD_CACHE_SIZE];
+
+SafeNumeric<uint32_t> ClassDB::method_cache_version(1);
+
+MethodBind *ClassDB::get_method(const StringName &p_class, const StringName &p_name) {
+	const void *class_key = p_class.data_unique_pointer();
+	const void *name_key = p_name.data_unique_pointer();
+	const uint32_t version = method_cache_version.get();
+	MethodCacheEntry &entry = method_cache[((uintptr_t)class_key >> 4 ^ (uintptr_t)name_key >> 3) & (METHOD_CACHE_SIZE - 1)];
+	if (entry.class_name == class_key && entry.method_name == name_key && entry.version == version) {
+		return entry.method;
+	}
+
 	OBJTYPE_RLOCK;
 
 	ClassInfo *type = classes.getptr(p_class);
@@ -632,6 +656,10 @@ MethodBind *ClassDB::get_method(StringName p_class, StringName p_name) {
 	while (type) {
 		MethodBind **method = type->method_map.getptr(p_name);
 		if (method && *method) {
+			entry.class_name = class_key;
+			entry.method_name = name_key;
+			entry.version = version;
+			entry.method = *method;
 			return *method;
 		}
 		type = type->inherits_ptr;
@@ -1223,6 +1251,7 @@ MethodBind *ClassDB::bind_methodfi(uint32_t p_flags, MethodBind *p_bind, const c
 #endif
 
 	type->method_map[mdname] = p_bind;
+	method_cache_version.increment();
 
 	Vector<Variant> defvals;
 
@@ -1418,6 +1447,7 @@ void ClassDB::cleanup() {
 		}
 	}
 	classes.clear();
+	method_cache_version.increment();
 	resource_base_extensions.clear();
 	compat_classes.clear();
 }
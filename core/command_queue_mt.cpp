@@ -33,12 +33,30 @@
 #include "core/os/os.h"
 #include "core/project_settings.h"
 
-void CommandQueueMT::lock() {
-	mutex.lock();
+#if !defined(NO_THREADS)
+#include <thread>
+#endif
+
+void CommandQueueMT::_wait_for_space(uint64_t p_end) {
+	int attempts = 0;
+	while (p_end - read_pos.get() > command_mem_size) {
+		// There is no more room, get the consumer to flush and wait for it.
+		// Other producers may be queued behind this reservation, so only sleep if yielding was not enough.
+		if (sync) {
+			sync->post();
+		}
+		if (attempts++ < SPACE_YIELD_COUNT) {
+			_wait_for_commit();
+		} else {
+			wait_for_flush();
+		}
+	}
 }
 
-void CommandQueueMT::unlock() {
-	mutex.unlock();
+void CommandQueueMT::_wait_for_commit() {
+#if !defined(NO_THREADS)
+	std::this_thread::yield();
+#endif
 }
 
 void CommandQueueMT::wait_for_flush() {
@@ -47,66 +65,45 @@ void CommandQueueMT::wait_for_flush() {
 }
 
 CommandQueueMT::SyncSemaphore *CommandQueueMT::_alloc_sync_sem() {
-	int idx = -1;
-
 	while (true) {
-		lock();
 		for (int i = 0; i < SYNC_SEMAPHORES; i++) {
-			if (!sync_sems[i].in_use) {
-				sync_sems[i].in_use = true;
-				idx = i;
-				break;
+			// Only the thread that takes it from zero owns it, others back off.
+			if (sync_sems[i].in_use.postincrement() == 0) {
+				sync_sems[i].state.set(0);
+				return &sync_sems[i];
 			}
+			sync_sems[i].in_use.decrement();
 		}
-		unlock();
 
-		if (idx == -1) {
-			wait_for_flush();
-		} else {
-			break;
-		}
+		wait_for_flush();
 	}
-
-	return &sync_sems[idx];
 }
 
-bool CommandQueueMT::dealloc_one() {
-tryagain:
-	if (dealloc_ptr == (write_ptr_and_epoch >> 1)) {
-		// The queue is empty
-		return false;
-	}
-
-	uint32_t size = *(uint32_t *)&command_mem[dealloc_ptr];
-
-	if (size == 0) {
-		// End of command buffer wrap down
-		dealloc_ptr = 0;
-		goto tryagain;
+void CommandQueueMT::_wait_sync_sem(SyncSemaphore *p_ss) {
+	// Most sync commands are short, spin a little before going to sleep.
+	bool done = false;
+	for (int i = 0; i < SYNC_SPIN_COUNT; i++) {
+		if (p_ss->state.get() & SYNC_DONE) {
+			done = true;
+			break;
+		}
 	}
 
-	if (size & 1) {
-		// Still used, nothing can be deallocated
-		return false;
+	if (!done && !(p_ss->state.postadd(SYNC_SLEEPING) & SYNC_DONE)) {
+		p_ss->sem.wait();
 	}
 
-	dealloc_ptr += (size >> 1) + 8;
-	return true;
+	p_ss->in_use.decrement();
 }
 
 CommandQueueMT::CommandQueueMT(bool p_sync) {
-	read_ptr_and_epoch = 0;
-	write_ptr_and_epoch = 0;
-	dealloc_ptr = 0;
-
 	command_mem_size = GLOBAL_DEF_RST("memory/limits/command_queue/multithreading_queue_size_kb", DEFAULT_COMMAND_MEM_SIZE_KB);
 	ProjectSettings::get_singleton()->set_custom_property_info("memory/limits/command_queue/multithreading_queue_size_kb", PropertyInfo(Variant::INT, "memory/limits/command_queue/multithreading_queue_size_kb", PROPERTY_HINT_RANGE, "1,4096,1,or_greater"));
 	command_mem_size *= 1024;
 	command_mem = (uint8_t *)memalloc(command_mem_size);
+	// Headers are published by turning them non-zero.
+	memset(command_mem, 0, command_mem_size);
 
-	for (int i = 0; i < SYNC_SEMAPHORES; i++) {
-		sync_sems[i].in_use = false;
-	}
 	if (p_sync) {
 		sync = memnew(Semaphore);
 	} else {
@@ -32,11 +32,13 @@
 #define COMMAND_QUEUE_MT_H
 
 #include "core/os/memory.h"
-#include "core/os/mutex.h"
 #include "core/os/semaphore.h"
+#include "core/safe_refcount.h"
 #include "core/simple_type.h"
 #include "core/typedefs.h"
 
+#include <string.h>
+
 #define COMMA(N) _COMMA_##N
 #define _COMMA_0
 #define _COMMA_1 ,
@@ -228,13 +230,11 @@
 #define DECL_PUSH(N)                                                         \
 	template <class T, class M COMMA(N) COMMA_SEP_LIST(TYPE_PARAM, N)>       \
 	void push(T *p_instance, M p_method COMMA(N) COMMA_SEP_LIST(PARAM, N)) { \
-		CMD_TYPE(N) *cmd = allocate_and_lock<CMD_TYPE(N)>();                 \
+		CMD_TYPE(N) *cmd = allocate<CMD_TYPE(N)>();                          \
 		cmd->instance = p_instance;                                          \
 		cmd->method = p_method;                                              \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                 \
-		unlock();                                                            \
-		if (sync)                                                            \
-			sync->post();                                                    \
+		commit(cmd);                                                         \
 	}
 
 #define CMD_RET_TYPE(N) CommandRet##N<T, M, COMMA_SEP_LIST(TYPE_ARG, N) COMMA(N) R>
@@ -243,17 +243,14 @@
 	template <class T, class M, COMMA_SEP_LIST(TYPE_PARAM, N) COMMA(N) class R>                \
 	void push_and_ret(T *p_instance, M p_method, COMMA_SEP_LIST(PARAM, N) COMMA(N) R *r_ret) { \
 		SyncSemaphore *ss = _alloc_sync_sem();                                                 \
-		CMD_RET_TYPE(N) *cmd = allocate_and_lock<CMD_RET_TYPE(N)>();                           \
+		CMD_RET_TYPE(N) *cmd = allocate<CMD_RET_TYPE(N)>();                                    \
 		cmd->instance = p_instance;                                                            \
 		cmd->method = p_method;                                                                \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                                   \
 		cmd->ret = r_ret;                                                                      \
 		cmd->sync_sem = ss;                                                                    \
-		unlock();                                                                              \
-		if (sync)                                                                              \
-			sync->post();                                                                      \
-		ss->sem.wait();                                                                        \
-		ss->in_use = false;                                                                    \
+		commit(cmd);                                                                           \
+		_wait_sync_sem(ss);                                                                    \
 	}
 
 #define CMD_SYNC_TYPE(N) CommandSync##N<T, M COMMA(N) COMMA_SEP_LIST(TYPE_ARG, N)>
@@ -262,24 +259,39 @@
 	template <class T, class M COMMA(N) COMMA_SEP_LIST(TYPE_PARAM, N)>                \
 	void push_and_sync(T *p_instance, M p_method COMMA(N) COMMA_SEP_LIST(PARAM, N)) { \
 		SyncSemaphore *ss = _alloc_sync_sem();                                        \
-		CMD_SYNC_TYPE(N) *cmd = allocate_and_lock<CMD_SYNC_TYPE(N)>();                \
+		CMD_SYNC_TYPE(N) *cmd = allocate<CMD_SYNC_TYPE(N)>();                         \
 		cmd->instance = p_instance;                                                   \
 		cmd->method = p_method;                                                       \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                          \
 		cmd->sync_sem = ss;                                                           \
-		unlock();                                                                     \
-		if (sync)                                                                     \
-			sync->post();                                                             \
-		ss->sem.wait();                                                               \
-		ss->in_use = false;                                                           \
+		commit(cmd);                                                                  \
+		_wait_sync_sem(ss);                                                           \
 	}
 
 #define MAX_CMD_PARAMS 13
 
+#if !defined(NO_THREADS)
+SAFE_NUMERIC_TYPE_PUN_GUARANTEES(uint32_t)
+#endif
+
+// Multiple-producer, single-consumer command ring buffer.
+// Producers reserve space with a single atomic add on the write position and publish the
+// command by setting its header, so pushing never takes a lock and never waits on other
+// producers (only on the consumer, if the buffer is full).
+// Commands must be flushed from one thread at a time: the server thread when threaded,
+// or the thread calling flush_all() otherwise.
 class CommandQueueMT {
+	// Sync commands are waited on with a futex-like protocol: the consumer only posts the
+	// semaphore if the producer went to sleep, so short commands don't pay for the wakeup.
 	struct SyncSemaphore {
 		Semaphore sem;
-		bool in_use;
+		SafeNumeric<uint32_t> in_use;
+		SafeNumeric<uint32_t> state; // SYNC_* flags.
+	};
+
+	enum {
+		SYNC_SLEEPING = 1,
+		SYNC_DONE = 2,
 	};
 
 	struct CommandBase {
@@ -292,7 +304,9 @@ class CommandQueueMT {
 		SyncSemaphore *sync_sem;
 
 		virtual void post() {
-			sync_sem->sem.post();
+			if (sync_sem->state.postadd(SYNC_DONE) & SYNC_SLEEPING) {
+				sync_sem->sem.post();
+			}
 		}
 	};
 
@@ -311,153 +325,108 @@ class CommandQueueMT {
 
 	enum {
 		DEFAULT_COMMAND_MEM_SIZE_KB = 256,
-		SYNC_SEMAPHORES = 8
+		SYNC_SEMAPHORES = 8,
+		SYNC_SPIN_COUNT = 256,
+		SPACE_YIELD_COUNT = 64,
+		HEADER_SIZE = 8,
 	};
 
+	// Every reservation starts with a header holding (payload size << 1) | is_command.
+	// Zero means the producer has not published it yet. Reservations that would straddle
+	// the end of the buffer are published as padding (is_command unset) and retried.
+	typedef SafeNumeric<uint32_t> Header;
+
 	uint8_t *command_mem;
-	uint32_t read_ptr_and_epoch;
-	uint32_t write_ptr_and_epoch;
-	uint32_t dealloc_ptr;
 	uint32_t command_mem_size;
+	// Monotonic positions, the offset in command_mem is the position modulo command_mem_size.
+	SafeNumeric<uint64_t> write_pos;
+	SafeNumeric<uint64_t> read_pos;
+	// Commands reserved but not flushed yet. The sync semaphore is only posted when this
+	// goes up from zero, as the consumer does not wait while it is non-zero.
+	SafeNumeric<uint32_t> pending;
 	SyncSemaphore sync_sems[SYNC_SEMAPHORES];
-	Mutex mutex;
 	Semaphore *sync;
 
+	_FORCE_INLINE_ Header *_get_header(uint64_t p_pos) {
+		return reinterpret_cast<Header *>(&command_mem[p_pos % command_mem_size]);
+	}
+
 	template <class T>
 	T *allocate() {
-		// alloc size is size+T+safeguard
-		uint32_t alloc_size = ((sizeof(T) + 8 - 1) & ~(8 - 1)) + 8;
+		uint32_t size = (sizeof(T) + 8 - 1) & ~(8 - 1);
+		uint32_t alloc_size = size + HEADER_SIZE;
 
 		// Assert that the buffer is big enough to hold at least two messages.
-		ERR_FAIL_COND_V(alloc_size * 2 + sizeof(uint32_t) > command_mem_size, nullptr);
-
-	tryagain:
-		uint32_t write_ptr = write_ptr_and_epoch >> 1;
-
-		if (write_ptr < dealloc_ptr) {
-			// behind dealloc_ptr, check that there is room
-			if ((dealloc_ptr - write_ptr) <= alloc_size) {
-				// There is no more room, try to deallocate something
-				if (dealloc_one()) {
-					goto tryagain;
-				}
-				return nullptr;
+		ERR_FAIL_COND_V(alloc_size * 2 > command_mem_size, nullptr);
+
+		while (true) {
+			uint64_t pos = write_pos.postadd(alloc_size);
+			_wait_for_space(pos + alloc_size);
+
+			uint32_t offset = pos % command_mem_size;
+			if (offset + alloc_size > command_mem_size) {
+				// Would not be contiguous, publish as padding and try again further on.
+				_get_header(pos)->set(size << 1);
+				continue;
 			}
-		} else {
-			// ahead of dealloc_ptr, check that there is room
-
-			if ((command_mem_size - write_ptr) < alloc_size + sizeof(uint32_t)) {
-				// no room at the end, wrap down;
-
-				if (dealloc_ptr == 0) { // don't want write_ptr to become dealloc_ptr
-
-					// There is no more room, try to deallocate something
-					if (dealloc_one()) {
-						goto tryagain;
-					}
-					return nullptr;
-				}
-
-				// if this happens, it's a bug
-				ERR_FAIL_COND_V((command_mem_size - write_ptr) < 8, nullptr);
-				// zero means, wrap to beginning
-
-				uint32_t *p = (uint32_t *)&command_mem[write_ptr];
-				*p = 1;
-				write_ptr_and_epoch = 0 | (1 & ~write_ptr_and_epoch); // Invert epoch.
-				// See if we can get the thread to run and clear up some more space while we wait.
-				// This is required if alloc_size * 2 + 4 > COMMAND_MEM_SIZE
-				if (sync) {
-					sync->post();
-				}
-				goto tryagain;
+
+			if (pending.postincrement() == 0 && sync) {
+				// Wake up the consumer for this batch. It may spin for a moment until the command is committed.
+				sync->post();
 			}
+			return memnew_placement(&command_mem[offset + HEADER_SIZE], T);
 		}
-		// Allocate the size and the 'in use' bit.
-		// First bit used to mark if command is still in use (1)
-		// or if it has been destroyed and can be deallocated (0).
-		uint32_t size = (sizeof(T) + 8 - 1) & ~(8 - 1);
-		uint32_t *p = (uint32_t *)&command_mem[write_ptr];
-		*p = (size << 1) | 1;
-		write_ptr += 8;
-		// allocate the command
-		T *cmd = memnew_placement(&command_mem[write_ptr], T);
-		write_ptr += size;
-		write_ptr_and_epoch = (write_ptr << 1) | (write_ptr_and_epoch & 1);
-		return cmd;
 	}
 
 	template <class T>
-	T *allocate_and_lock() {
-		lock();
-		T *ret;
-
-		while ((ret = allocate<T>()) == nullptr) {
-			unlock();
-			// sleep a little until fetch happened and some room is made
-			wait_for_flush();
-			lock();
-		}
-
-		return ret;
+	void commit(T *p_cmd) {
+		Header *header = reinterpret_cast<Header *>(reinterpret_cast<uint8_t *>(p_cmd) - HEADER_SIZE);
+		uint32_t size = (sizeof(T) + 8 - 1) & ~(8 - 1);
+		header->set((size << 1) | 1);
 	}
 
-	bool flush_one(bool p_lock = true) {
-		if (p_lock) {
-			lock();
-		}
-	tryagain:
-
-		// tried to read an empty queue
-		if (read_ptr_and_epoch == write_ptr_and_epoch) {
-			if (p_lock) {
-				unlock();
+	bool flush_one() {
+		while (true) {
+			uint64_t pos = read_pos.get();
+			Header *header = _get_header(pos);
+			uint32_t value = header->get();
+			if (value == 0) {
+				// Empty, or the next command is still being written.
+				return false;
 			}
-			return false;
-		}
-
-		uint32_t read_ptr = read_ptr_and_epoch >> 1;
-		uint32_t size_ptr = read_ptr;
-		uint32_t size = *(uint32_t *)&command_mem[read_ptr] >> 1;
-
-		if (size == 0) {
-			*(uint32_t *)&command_mem[read_ptr] = 0; // clear in-use bit.
-			//end of ringbuffer, wrap
-			read_ptr_and_epoch = 0 | (1 & ~read_ptr_and_epoch); // Invert epoch.
-			goto tryagain;
-		}
-
-		read_ptr += 8;
-
-		CommandBase *cmd = reinterpret_cast<CommandBase *>(&command_mem[read_ptr]);
 
-		read_ptr += size;
+			uint32_t size = value >> 1;
+			bool is_command = value & 1;
 
-		read_ptr_and_epoch = (read_ptr << 1) | (read_ptr_and_epoch & 1);
-
-		if (p_lock) {
-			unlock();
-		}
-		cmd->call();
-		if (p_lock) {
-			lock();
-		}
+			if (is_command) {
+				CommandBase *cmd = reinterpret_cast<CommandBase *>(reinterpret_cast<uint8_t *>(header) + HEADER_SIZE);
+				cmd->call();
+				cmd->post();
+				cmd->~CommandBase();
+				pending.decrement();
+			}
 
-		cmd->post();
-		cmd->~CommandBase();
-		*(uint32_t *)&command_mem[size_ptr] &= ~1;
+			// Clear the whole reservation, as any of its words may hold a header later on.
+			uint32_t offset = pos % command_mem_size;
+			uint32_t total = size + HEADER_SIZE;
+			uint32_t first = MIN(total, command_mem_size - offset);
+			memset(&command_mem[offset], 0, first);
+			if (first < total) {
+				memset(command_mem, 0, total - first);
+			}
+			read_pos.set(pos + total);
 
-		if (p_lock) {
-			unlock();
+			if (is_command) {
+				return true;
+			}
 		}
-		return true;
 	}
 
-	void lock();
-	void unlock();
+	void _wait_for_space(uint64_t p_end);
+	void _wait_for_commit();
 	void wait_for_flush();
 	SyncSemaphore *_alloc_sync_sem();
-	bool dealloc_one();
+	void _wait_sync_sem(SyncSemaphore *p_ss);
 
 public:
 	/* NORMAL PUSH COMMANDS */
@@ -474,17 +443,19 @@ public:
 
 	void wait_and_flush_one() {
 		ERR_FAIL_COND(!sync);
-		sync->wait();
-		flush_one();
+		if (pending.get() == 0) {
+			sync->wait();
+		}
+		if (!flush_one()) {
+			// A command was reserved but its producer did not commit it yet.
+			_wait_for_commit();
+		}
 	}
 
 	void flush_all() {
-		//ERR_FAIL_COND(sync);
-		lock();
-		while (flush_one(false)) {
+		while (flush_one()) {
 			;
 		}
-		unlock();
 	}
 
 	CommandQueueMT(bool p_sync);
@@ -36,6 +36,7 @@
 #include "core/path_remap.h"
 #include "core/print_string.h"
 #include "core/project_settings.h"
+#include "core/trace_profiler.h"
 #include "core/translation.h"
 #include "core/variant_parser.h"
 
@@ -323,6 +324,8 @@ void ResourceLoader::_remove_from_loading_map_and_thread(const String &p_path, T
 }
 
 RES ResourceLoader::load(const String &p_path, const String &p_type_hint, bool p_no_cache, Error *r_error) {
+	TRACE_SCOPE_DETAIL("resource", "ResourceLoader::load", p_path);
+
 	if (r_error) {
 		*r_error = ERR_CANT_OPEN;
 	}
@@ -30,6 +30,7 @@
 
 #include "aabb.h"
 
+#include "core/math/math_simd.h"
 #include "core/print_string.h"
 
 real_t AABB::get_area() const {
@@ -408,6 +409,62 @@ void AABB::get_edge(int p_edge, Vector3 &r_from, Vector3 &r_to) const {
 	}
 }
 
+int AABB::cull_convex_array(const AABB *p_aabbs, int p_count, const Plane *p_planes, int p_plane_count, const Vector3 *p_points, int p_point_count, uint32_t *r_indices) {
+	int visible = 0;
+
+#ifdef MATH_SIMD_ENABLED
+	// Test every box against four planes at once. Padding planes have a zero normal and distance, so they never cull.
+	static const int MAX_PLANE_GROUPS = 8;
+	if (p_plane_count <= MAX_PLANE_GROUPS * 4) {
+		using namespace MathSIMD;
+		const int group_count = (p_plane_count + 3) / 4;
+		float planes[MAX_PLANE_GROUPS][4][4];
+		for (int g = 0; g < group_count; g++) {
+			for (int j = 0; j < 4; j++) {
+				const int idx = g * 4 + j;
+				const Plane p = idx < p_plane_count ? p_planes[idx] : Plane(0, 0, 0, 0);
+				planes[g][0][j] = p.normal.x;
+				planes[g][1][j] = p.normal.y;
+				planes[g][2][j] = p.normal.z;
+				planes[g][3][j] = p.d;
+			}
+		}
+
+		const Float4 zero = splat(0.0f);
+		for (int i = 0; i < p_count; i++) {
+			const AABB &aabb = p_aabbs[i];
+			// Same operations as intersects_convex_shape(), so both give identical results.
+			const Vector3 half_extents = aabb.size * 0.5;
+			const Vector3 ofs = aabb.position + half_extents;
+			const Float4 hx = splat(half_extents.x), hy = splat(half_extents.y), hz = splat(half_extents.z);
+			const Float4 cx = splat(ofs.x), cy = splat(ofs.y), cz = splat(ofs.z);
+
+			int outside = 0;
+			for (int g = 0; g < group_count && !outside; g++) {
+				const Float4 nx = load(planes[g][0]), ny = load(planes[g][1]), nz = load(planes[g][2]), d = load(planes[g][3]);
+				const Float4 px = add(cx, negate_if(hx, greater(nx, zero)));
+				const Float4 py = add(cy, negate_if(hy, greater(ny, zero)));
+				const Float4 pz = add(cz, negate_if(hz, greater(nz, zero)));
+				const Float4 dist = add(add(mul(nx, px), mul(ny, py)), mul(nz, pz));
+				outside = mask_bits(greater(dist, d));
+			}
+			// Boxes that survive the planes still need the scalar point separation test.
+			if (!outside && aabb.intersects_convex_shape(nullptr, 0, p_points, p_point_count)) {
+				r_indices[visible++] = i;
+			}
+		}
+		return visible;
+	}
+#endif
+
+	for (int i = 0; i < p_count; i++) {
+		if (p_aabbs[i].intersects_convex_shape(p_planes, p_plane_count, p_points, p_point_count)) {
+			r_indices[visible++] = i;
+		}
+	}
+	return visible;
+}
+
 AABB::operator String() const {
 	return String() + position + " - " + size;
 }
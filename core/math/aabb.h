@@ -77,6 +77,9 @@ public:
 
 	_FORCE_INLINE_ bool intersects_convex_shape(const Plane *p_planes, int p_plane_count, const Vector3 *p_points, int p_point_count) const;
 	_FORCE_INLINE_ bool inside_convex_shape(const Plane *p_planes, int p_plane_count) const;
+	// Batch version of intersects_convex_shape(), testing the planes with SIMD where available. Writes the index of
+	// every box that intersects the shape to r_indices and returns how many were written.
+	static int cull_convex_array(const AABB *p_aabbs, int p_count, const Plane *p_planes, int p_plane_count, const Vector3 *p_points, int p_point_count, uint32_t *r_indices);
 	bool intersects_plane(const Plane &p_plane) const;
 
 	_FORCE_INLINE_ bool has_point(const Vector3 &p_point) const;
@@ -31,6 +31,7 @@
 #include "basis.h"
 
 #include "core/math/math_funcs.h"
+#include "core/math/math_simd.h"
 #include "core/print_string.h"
 
 #define cofac(row1, col1, row2, col2) \
@@ -1021,3 +1022,25 @@ Basis Basis::slerp(const Basis &p_to, const real_t &p_weight) const {
 
 	return b;
 }
+
+void Basis::xform_array(const Vector3 *p_src, Vector3 *r_dst, int p_count) const {
+	int i = 0;
+#ifdef MATH_SIMD_ENABLED
+	using namespace MathSIMD;
+	const Float4 m00 = splat(elements[0][0]), m01 = splat(elements[0][1]), m02 = splat(elements[0][2]);
+	const Float4 m10 = splat(elements[1][0]), m11 = splat(elements[1][1]), m12 = splat(elements[1][2]);
+	const Float4 m20 = splat(elements[2][0]), m21 = splat(elements[2][1]), m22 = splat(elements[2][2]);
+
+	for (; i + 4 <= p_count; i += 4) {
+		Float4 x, y, z;
+		load_vector3x4(&p_src[i].x, x, y, z);
+		Float4 rx = madd(m00, x, madd(m01, y, mul(m02, z)));
+		Float4 ry = madd(m10, x, madd(m11, y, mul(m12, z)));
+		Float4 rz = madd(m20, x, madd(m21, y, mul(m22, z)));
+		store_vector3x4(&r_dst[i].x, rx, ry, rz);
+	}
+#endif
+	for (; i < p_count; i++) {
+		r_dst[i] = xform(p_src[i]);
+	}
+}
@@ -152,6 +152,8 @@ public:
 
 	_FORCE_INLINE_ Vector3 xform(const Vector3 &p_vector) const;
 	_FORCE_INLINE_ Vector3 xform_inv(const Vector3 &p_vector) const;
+	// Transforms p_count vectors at once, using SIMD where available. p_src and r_dst may be the same array.
+	void xform_array(const Vector3 *p_src, Vector3 *r_dst, int p_count) const;
 	_FORCE_INLINE_ void operator*=(const Basis &p_matrix);
 	_FORCE_INLINE_ Basis operator*(const Basis &p_matrix) const;
 	_FORCE_INLINE_ void operator+=(const Basis &p_matrix);
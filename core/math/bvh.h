@@ -83,6 +83,13 @@ public:
 		tree.params_set_pairing_expansion(p_value);
 	}
 
+	// the leaf items are tested with SIMD when the build supports it,
+	// turning it off is only useful to compare both ways
+	void params_set_leaf_simd(bool p_enable) {
+		BVH_LOCKED_FUNCTION
+		tree._leaf_simd = p_enable;
+	}
+
 	void set_pair_callback(PairCallback p_callback, void *p_userdata) {
 		BVH_LOCKED_FUNCTION
 		pair_callback = p_callback;
@@ -207,6 +214,23 @@ public:
 		}
 	}
 
+	// Moves a batch of items under a single lock. Items that leave their leaf are reinserted
+	// straight away, but the branches they were added to are refit and rebalanced together
+	// at the end, so items moving through the same part of the tree don't refit it once each.
+	void move_batch(const uint32_t *p_handles, const BOUNDS *p_aabbs, uint32_t p_count) {
+		BVH_LOCKED_FUNCTION
+		for (uint32_t n = 0; n < p_count; n++) {
+			BVHHandle h;
+			h.set(p_handles[n]);
+			if (tree.item_move(h, p_aabbs[n], true)) {
+				if (USE_PAIRS) {
+					_add_changed_item(h, p_aabbs[n]);
+				}
+			}
+		}
+		tree.refit_deferred();
+	}
+
 	void recheck_pairs(BVHHandle p_handle) {
 		BVH_LOCKED_FUNCTION
 		if (USE_PAIRS) {
@@ -399,6 +423,19 @@ public:
 
 	int cull_convex(const Vector<Plane> &p_convex, T **p_result_array, int p_result_max, uint32_t p_mask = 0xFFFFFFFF) {
 		BVH_LOCKED_FUNCTION
+		return _cull_convex(p_convex, p_result_array, p_result_max, p_mask, nullptr);
+	}
+
+	// Same as cull_convex(), but only reads the tree and gathers hits in a per thread list,
+	// so any number of threads can call it at once. The caller must make sure the BVH is
+	// not modified meanwhile, this does not take the thread safety lock.
+	int cull_convex_concurrent(const Vector<Plane> &p_convex, T **p_result_array, int p_result_max, uint32_t p_mask = 0xFFFFFFFF) {
+		static thread_local LocalVector<uint32_t, uint32_t, true> hits;
+		return _cull_convex(p_convex, p_result_array, p_result_max, p_mask, &hits);
+	}
+
+private:
+	int _cull_convex(const Vector<Plane> &p_convex, T **p_result_array, int p_result_max, uint32_t p_mask, LocalVector<uint32_t, uint32_t, true> *r_hits) {
 		if (!p_convex.size()) {
 			return 0;
 		}
@@ -420,13 +457,13 @@ public:
 		params.hull.num_planes = p_convex.size();
 		params.hull.points = &convex_points[0];
 		params.hull.num_points = convex_points.size();
+		params.hits = r_hits;
 
 		tree.cull_convex(params);
 
 		return params.result_count_overall;
 	}
 
-private:
 	// do this after moving etc.
 	void _check_for_collisions(bool p_full_check = false) {
 		if (!changed_items.size()) {
@@ -43,6 +43,7 @@
 #include "core/math/aabb.h"
 #include "core/math/bvh_abb.h"
 #include "core/math/geometry.h"
+#include "core/math/math_simd.h"
 #include "core/math/vector3.h"
 #include "core/pooled_list.h"
 #include "core/print_string.h"
@@ -53,6 +54,12 @@
 // not sure if this is better yet so making optional
 #define BVH_EXPAND_LEAF_AABBS
 
+// leaf items are tested 4 at a time where the math SIMD helpers are available,
+// build with NO_MATH_SIMD to use the scalar tests everywhere
+#ifdef MATH_SIMD_ENABLED
+#define BVH_LEAF_SIMD
+#endif
+
 // never do these checks in release
 #if defined(TOOLS_ENABLED) && defined(DEBUG_ENABLED)
 //#define BVH_VERBOSE
@@ -311,7 +318,7 @@ private:
 
 		// if the aabb is not determining the corner size, then there is no need to refit!
 		// (optimization, as merging AABBs takes a lot of time)
-		const BVHABB_CLASS &old_aabb = leaf.get_aabb(ref.item_id);
+		BVHABB_CLASS old_aabb = leaf.get_aabb(ref.item_id);
 
 		// shrink a little to prevent using corner aabbs
 		// in order to miss the corners first we shrink by node_expansion
@@ -407,7 +414,7 @@ private:
 		BVH_ASSERT(ref.item_id != BVHCommon::INVALID);
 
 		// set the aabb of the new item
-		leaf.get_aabb(ref.item_id) = p_aabb;
+		leaf.set_aabb(ref.item_id, p_aabb);
 
 		// back reference on the item back to the item reference
 		leaf.get_item_ref_id(ref.item_id) = p_ref_id;
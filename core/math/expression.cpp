@@ -31,11 +31,13 @@
 #include "expression.h"
 
 #include "core/class_db.h"
+#include "core/core_string_names.h"
 #include "core/func_ref.h"
 #include "core/io/marshalls.h"
 #include "core/math/math_funcs.h"
 #include "core/os/os.h"
 #include "core/reference.h"
+#include "core/script_language.h"
 #include "core/variant_parser.h"
 
 const char *Expression::func_name[Expression::FUNC_MAX] = {
@@ -1934,235 +1936,491 @@ bool Expression::_compile_expression() {
 			memdelete(nodes);
 		}
 		nodes = nullptr;
+		_compile();
 		return true;
 	}
 
+	_compile();
 	expression_dirty = false;
 	return false;
 }
 
-bool Expression::_execute(const Array &p_inputs, Object *p_instance, Expression::ENode *p_node, Variant &r_ret, String &r_error_str) {
-	switch (p_node->type) {
-		case Expression::ENode::TYPE_INPUT: {
-			const Expression::InputNode *in = static_cast<const Expression::InputNode *>(p_node);
-			if (in->index < 0 || in->index >= p_inputs.size()) {
-				r_error_str = vformat(RTR("Invalid input %i (not passed) in expression"), in->index);
-				return true;
-			}
-			r_ret = p_inputs[in->index];
-		} break;
-		case Expression::ENode::TYPE_CONSTANT: {
-			const Expression::ConstantNode *c = static_cast<const Expression::ConstantNode *>(p_node);
-			r_ret = c->value;
-
-		} break;
-		case Expression::ENode::TYPE_SELF: {
-			if (!p_instance) {
-				r_error_str = RTR("self can't be used because instance is null (not passed)");
-				return true;
-			}
-			r_ret = p_instance;
-		} break;
-		case Expression::ENode::TYPE_OPERATOR: {
-			const Expression::OperatorNode *op = static_cast<const Expression::OperatorNode *>(p_node);
+// Builtins that always return the same result for the same arguments, and have no side effects.
+bool Expression::_is_constant_func(BuiltinFunc p_func) {
+	switch (p_func) {
+		case MATH_RANDOMIZE:
+		case MATH_RAND:
+		case MATH_RANDF:
+		case MATH_RANDOM:
+		case MATH_SEED:
+		case MATH_RANDSEED:
+		case OBJ_WEAKREF:
+		case FUNC_FUNCREF:
+		case TEXT_PRINT:
+		case TEXT_PRINTERR:
+		case TEXT_PRINTRAW:
+		case STR_TO_VAR:
+		case VAR_TO_STR:
+		case VAR_TO_BYTES:
+		case BYTES_TO_VAR:
+			return false;
+		default: {
+		}
+	}
+	return true;
+}
 
-			Variant a;
-			bool ret = _execute(p_inputs, p_instance, op->nodes[0], a, r_error_str);
-			if (ret) {
-				return true;
-			}
+// Folded values are shared by every execution, so they can't be anything a
+// caller could modify.
+static bool _is_foldable(const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::OBJECT:
+		case Variant::ARRAY:
+		case Variant::DICTIONARY:
+			return false;
+		default: {
+		}
+	}
+	return true;
+}
 
-			Variant b;
+int Expression::_add_constant(const Variant &p_value) {
+	for (uint32_t i = 0; i < constants.size(); i++) {
+		if (constants[i].get_type() == p_value.get_type() && constants[i] == p_value) {
+			return (i << ADDR_BITS) | ADDR_TYPE_CONSTANT;
+		}
+	}
+	constants.push_back(p_value);
+	return ((constants.size() - 1) << ADDR_BITS) | ADDR_TYPE_CONSTANT;
+}
 
-			if (op->nodes[1]) {
-				ret = _execute(p_inputs, p_instance, op->nodes[1], b, r_error_str);
-				if (ret) {
-					return true;
-				}
-			}
+// Compiles every argument in order, returns whether all of them are constant.
+bool Expression::_compile_arguments(const Vector<ENode *> &p_arguments, int &r_stack, LocalVector<int> &r_addresses) {
+	bool constant = true;
+	r_addresses.resize(p_arguments.size());
+	for (int i = 0; i < p_arguments.size(); i++) {
+		r_addresses[i] = _compile_node(p_arguments[i], r_stack);
+		constant = constant && _is_constant_address(r_addresses[i]);
+	}
+	max_call_args = MAX(max_call_args, p_arguments.size());
+	return constant;
+}
 
-			bool valid = true;
-			Variant::evaluate(op->op, a, b, r_ret, valid);
-			if (!valid) {
-				r_error_str = vformat(RTR("Invalid operands to operator %s, %s and %s."), Variant::get_operator_name(op->op), Variant::get_type_name(a.get_type()), Variant::get_type_name(b.get_type()));
-				return true;
-			}
+// Returns the address holding the result of p_node. Registers from r_stack up are free.
+int Expression::_compile_node(ENode *p_node, int &r_stack) {
+	switch (p_node->type) {
+		case ENode::TYPE_INPUT: {
+			const InputNode *in = static_cast<const InputNode *>(p_node);
+			used_inputs.push_back(in->index);
+			required_inputs = MAX(required_inputs, in->index + 1);
+			return (in->index << ADDR_BITS) | ADDR_TYPE_INPUT;
+		}
+		case ENode::TYPE_CONSTANT: {
+			return _add_constant(static_cast<const ConstantNode *>(p_node)->value);
+		}
+		case ENode::TYPE_SELF: {
+			uses_self = true;
+			return ADDR_TYPE_SELF;
+		}
+		default: {
+		}
+	}
 
-		} break;
-		case Expression::ENode::TYPE_INDEX: {
-			const Expression::IndexNode *index = static_cast<const Expression::IndexNode *>(p_node);
+	// The result register is taken first, so it never aliases an operand.
+	int dst = r_stack++;
+	register_count = MAX(register_count, r_stack);
+	int dst_address = (dst << ADDR_BITS) | ADDR_TYPE_REGISTER;
+	bool valid = false;
+	Variant folded;
+	LocalVector<int> arguments;
 
-			Variant base;
-			bool ret = _execute(p_inputs, p_instance, index->base, base, r_error_str);
-			if (ret) {
-				return true;
+	switch (p_node->type) {
+		case ENode::TYPE_OPERATOR: {
+			const OperatorNode *op = static_cast<const OperatorNode *>(p_node);
+			int a = _compile_node(op->nodes[0], r_stack);
+			int b = op->nodes[1] ? _compile_node(op->nodes[1], r_stack) : _add_constant(Variant());
+
+			if (_is_constant_address(a) && _is_constant_address(b)) {
+				valid = true;
+				Variant::evaluate(op->op, constants[a >> ADDR_BITS], constants[b >> ADDR_BITS], folded, valid);
+				if (valid && _is_foldable(folded)) {
+					break;
+				}
+				valid = false;
 			}
 
-			Variant idx;
-
-			ret = _execute(p_inputs, p_instance, index->index, idx, r_error_str);
-			if (ret) {
-				return true;
-			}
+			code.push_back(OPCODE_OPERATOR);
+			code.push_back(op->op);
+			code.push_back(a);
+			code.push_back(b);
+			code.push_back(dst_address);
+		} break;
+		case ENode::TYPE_INDEX: {
+			const IndexNode *index = static_cast<const IndexNode *>(p_node);
+			int base = _compile_node(index->base, r_stack);
+			int idx = _compile_node(index->index, r_stack);
 
-			bool valid;
-			r_ret = base.get(idx, &valid);
-			if (!valid) {
-				r_error_str = vformat(RTR("Invalid index of type %s for base type %s"), Variant::get_type_name(idx.get_type()), Variant::get_type_name(base.get_type()));
-				return true;
+			if (_is_constant_address(base) && _is_constant_address(idx)) {
+				folded = constants[base >> ADDR_BITS].get(constants[idx >> ADDR_BITS], &valid);
+				if (valid && _is_foldable(folded)) {
+					break;
+				}
+				valid = false;
 			}
 
+			code.push_back(OPCODE_INDEX);
+			code.push_back(base);
+			code.push_back(idx);
+			code.push_back(dst_address);
 		} break;
-		case Expression::ENode::TYPE_NAMED_INDEX: {
-			const Expression::NamedIndexNode *index = static_cast<const Expression::NamedIndexNode *>(p_node);
+		case ENode::TYPE_NAMED_INDEX: {
+			const NamedIndexNode *index = static_cast<const NamedIndexNode *>(p_node);
+			int base = _compile_node(index->base, r_stack);
 
-			Variant base;
-			bool ret = _execute(p_inputs, p_instance, index->base, base, r_error_str);
-			if (ret) {
-				return true;
+			if (_is_constant_address(base)) {
+				folded = constants[base >> ADDR_BITS].get_named(index->name, &valid);
+				if (valid && _is_foldable(folded)) {
+					break;
+				}
+				valid = false;
 			}
 
-			bool valid;
-			r_ret = base.get_named(index->name, &valid);
-			if (!valid) {
-				r_error_str = vformat(RTR("Invalid named index '%s' for base type %s"), String(index->name), Variant::get_type_name(base.get_type()));
-				return true;
+			names.push_back(index->name);
+			code.push_back(OPCODE_NAMED_INDEX);
+			code.push_back(base);
+			code.push_back(names.size() - 1);
+			code.push_back(dst_address);
+		} break;
+		case ENode::TYPE_ARRAY:
+		case ENode::TYPE_DICTIONARY: {
+			// Never folded, every execution returns a new container.
+			bool is_array = p_node->type == ENode::TYPE_ARRAY;
+			const Vector<ENode *> &elements = is_array ? static_cast<const ArrayNode *>(p_node)->array : static_cast<const DictionaryNode *>(p_node)->dict;
+			_compile_arguments(elements, r_stack, arguments);
+
+			code.push_back(is_array ? OPCODE_ARRAY : OPCODE_DICTIONARY);
+			code.push_back(arguments.size());
+			for (uint32_t i = 0; i < arguments.size(); i++) {
+				code.push_back(arguments[i]);
 			}
-
+			code.push_back(dst_address);
 		} break;
-		case Expression::ENode::TYPE_ARRAY: {
-			const Expression::ArrayNode *array = static_cast<const Expression::ArrayNode *>(p_node);
+		case ENode::TYPE_CONSTRUCTOR: {
+			const ConstructorNode *constructor = static_cast<const ConstructorNode *>(p_node);
+			bool constant = _compile_arguments(constructor->arguments, r_stack, arguments);
 
-			Array arr;
-			arr.resize(array->array.size());
-			for (int i = 0; i < array->array.size(); i++) {
-				Variant value;
-				bool ret = _execute(p_inputs, p_instance, array->array[i], value, r_error_str);
-
-				if (ret) {
-					return true;
+			if (constant) {
+				LocalVector<const Variant *> argp;
+				for (uint32_t i = 0; i < arguments.size(); i++) {
+					argp.push_back(&constants[arguments[i] >> ADDR_BITS]);
+				}
+				Variant::CallError ce;
+				folded = Variant::construct(constructor->data_type, argp.ptr(), argp.size(), ce);
+				valid = ce.error == Variant::CallError::CALL_OK && _is_foldable(folded);
+				if (valid) {
+					break;
 				}
-				arr[i] = value;
 			}
 
-			r_ret = arr;
-
+			code.push_back(OPCODE_CONSTRUCT);
+			code.push_back(constructor->data_type);
+			code.push_back(arguments.size());
+			for (uint32_t i = 0; i < arguments.size(); i++) {
+				code.push_back(arguments[i]);
+			}
+			code.push_back(dst_address);
 		} break;
-		case Expression::ENode::TYPE_DICTIONARY: {
-			const Expression::DictionaryNode *dictionary = static_cast<const Expression::DictionaryNode *>(p_node);
+		case ENode::TYPE_BUILTIN_FUNC: {
+			const BuiltinFuncNode *bifunc = static_cast<const BuiltinFuncNode *>(p_node);
+			bool constant = _compile_arguments(bifunc->arguments, r_stack, arguments);
 
-			Dictionary d;
-			for (int i = 0; i < dictionary->dict.size(); i += 2) {
-				Variant key;
-				bool ret = _execute(p_inputs, p_instance, dictionary->dict[i + 0], key, r_error_str);
-
-				if (ret) {
-					return true;
+			if (constant && _is_constant_func(bifunc->func)) {
+				LocalVector<const Variant *> argp;
+				for (uint32_t i = 0; i < arguments.size(); i++) {
+					argp.push_back(&constants[arguments[i] >> ADDR_BITS]);
 				}
-
-				Variant value;
-				ret = _execute(p_inputs, p_instance, dictionary->dict[i + 1], value, r_error_str);
-				if (ret) {
-					return true;
+				Variant::CallError ce;
+				String error_str;
+				exec_func(bifunc->func, argp.ptr(), &folded, ce, error_str);
+				valid = ce.error == Variant::CallError::CALL_OK && _is_foldable(folded);
+				if (valid) {
+					break;
 				}
-
-				d[key] = value;
 			}
 
-			r_ret = d;
+			code.push_back(OPCODE_BUILTIN_FUNC);
+			code.push_back(bifunc->func);
+			code.push_back(arguments.size());
+			for (uint32_t i = 0; i < arguments.size(); i++) {
+				code.push_back(arguments[i]);
+			}
+			code.push_back(dst_address);
+		} break;
+		case ENode::TYPE_CALL: {
+			// Calls are never folded, even on constants, as methods may modify their base.
+			const CallNode *call = static_cast<const CallNode *>(p_node);
+			int base = _compile_node(call->base, r_stack);
+			_compile_arguments(call->arguments, r_stack, arguments);
+
+			names.push_back(call->method);
+			code.push_back(OPCODE_CALL);
+			code.push_back(base);
+			code.push_back(names.size() - 1);
+			code.push_back(call_count++);
+			code.push_back(arguments.size());
+			for (uint32_t i = 0; i < arguments.size(); i++) {
+				code.push_back(arguments[i]);
+			}
+			code.push_back(dst_address);
 		} break;
-		case Expression::ENode::TYPE_CONSTRUCTOR: {
-			const Expression::ConstructorNode *constructor = static_cast<const Expression::ConstructorNode *>(p_node);
-
-			Vector<Variant> arr;
-			Vector<const Variant *> argp;
-			arr.resize(constructor->arguments.size());
-			argp.resize(constructor->arguments.size());
-
-			for (int i = 0; i < constructor->arguments.size(); i++) {
-				Variant value;
-				bool ret = _execute(p_inputs, p_instance, constructor->arguments[i], value, r_error_str);
+		default: {
+		}
+	}
 
-				if (ret) {
-					return true;
-				}
-				arr.write[i] = value;
-				argp.write[i] = &arr[i];
-			}
+	r_stack = dst + 1;
 
-			Variant::CallError ce;
-			r_ret = Variant::construct(constructor->data_type, (const Variant **)argp.ptr(), argp.size(), ce);
+	if (valid) {
+		r_stack = dst;
+		return _add_constant(folded);
+	}
+	return dst_address;
+}
 
-			if (ce.error != Variant::CallError::CALL_OK) {
-				r_error_str = vformat(RTR("Invalid arguments to construct '%s'"), Variant::get_type_name(constructor->data_type));
-				return true;
-			}
+void Expression::_compile() {
+	code.clear();
+	constants.clear();
+	names.clear();
+	used_inputs.clear();
+	state.call_caches.clear(); // Indexed by call site.
+	register_count = 0;
+	max_call_args = 0;
+	call_count = 0;
+	required_inputs = 0;
+	uses_self = false;
+
+	if (!root) {
+		return;
+	}
 
-		} break;
-		case Expression::ENode::TYPE_BUILTIN_FUNC: {
-			const Expression::BuiltinFuncNode *bifunc = static_cast<const Expression::BuiltinFuncNode *>(p_node);
+	int stack = 0;
+	int result = _compile_node(root, stack);
+	code.push_back(OPCODE_END);
+	code.push_back(result);
+}
 
-			Vector<Variant> arr;
-			Vector<const Variant *> argp;
-			arr.resize(bifunc->arguments.size());
-			argp.resize(bifunc->arguments.size());
+const Variant *Expression::_get_address(const ExecutionState &p_state, const Array &p_inputs, int p_address) const {
+	switch (p_address & ADDR_MASK) {
+		case ADDR_TYPE_REGISTER:
+			return &p_state.registers[p_address >> ADDR_BITS];
+		case ADDR_TYPE_CONSTANT:
+			return &constants[p_address >> ADDR_BITS];
+		case ADDR_TYPE_INPUT:
+			return &p_inputs[p_address >> ADDR_BITS];
+		default:
+			return &p_state.self;
+	}
+}
 
-			for (int i = 0; i < bifunc->arguments.size(); i++) {
-				Variant value;
-				bool ret = _execute(p_inputs, p_instance, bifunc->arguments[i], value, r_error_str);
-				if (ret) {
-					return true;
-				}
-				arr.write[i] = value;
-				argp.write[i] = &arr[i];
-			}
+// Calls a native method directly, skipping the ClassDB lookup when the base
+// has the same class as last time. Returns false if the regular call is needed.
+bool Expression::_call_cached(CallCache &p_cache, const Variant &p_base, const StringName &p_method, const Variant **p_args, int p_argcount, Variant &r_ret, Variant::CallError &r_error) {
+	if (p_base.get_type() != Variant::OBJECT) {
+		return false;
+	}
+	Object *obj = p_base.operator Object *();
+	if (!obj || obj->get_script_instance()) {
+		return false;
+	}
 
-			Variant::CallError ce;
-			exec_func(bifunc->func, (const Variant **)argp.ptr(), &r_ret, ce, r_error_str);
+	const StringName &class_name = obj->get_class_name();
+	uint32_t version = ClassDB::method_cache_version.get();
+	if (p_cache.native != class_name.data_unique_pointer() || p_cache.version != version) {
+		p_cache.native = class_name.data_unique_pointer();
+		p_cache.version = version;
+		p_cache.method = nullptr;
+		// free() and the classes overriding Object::call() need the regular call.
+		if (p_method != CoreStringNames::get_singleton()->_free && !Object::cast_to<Script>(obj) && !ClassDB::is_parent_class(class_name, "JavaClass") && !ClassDB::is_parent_class(class_name, "JavaObject") && !ClassDB::is_parent_class(class_name, "JNISingleton")) {
+			p_cache.method = ClassDB::get_method(class_name, p_method);
+		}
+	}
+	if (!p_cache.method) {
+		return false;
+	}
 
-			if (ce.error != Variant::CallError::CALL_OK) {
-				r_error_str = "Builtin Call Failed. " + r_error_str;
-				return true;
-			}
+#ifdef DEBUG_ENABLED
+	_ObjectDebugLock debug_lock(obj);
+#endif
+	r_error.error = Variant::CallError::CALL_OK;
+	r_ret = p_cache.method->call(obj, p_args, p_argcount, r_error);
+	return true;
+}
 
-		} break;
-		case Expression::ENode::TYPE_CALL: {
-			const Expression::CallNode *call = static_cast<const Expression::CallNode *>(p_node);
+void Expression::_prepare_state(ExecutionState &p_state, Object *p_instance) const {
+	if (p_state.registers.size() != (uint32_t)register_count) {
+		p_state.registers.resize(register_count);
+	}
+	if (p_state.args.size() != (uint32_t)max_call_args) {
+		p_state.args.resize(max_call_args);
+	}
+	if (p_state.call_caches.size() != (uint32_t)call_count) {
+		p_state.call_caches.resize(call_count);
+	}
+	if (uses_self && p_instance) {
+		p_state.self = p_instance;
+	}
+}
 
-			Variant base;
-			bool ret = _execute(p_inputs, p_instance, call->base, base, r_error_str);
+// Don't keep results alive after execution.
+void Expression::_clear_state(ExecutionState &p_state) const {
+	for (uint32_t i = 0; i < p_state.registers.size(); i++) {
+		p_state.registers[i] = Variant();
+	}
+	p_state.self = Variant();
+}
 
-			if (ret) {
+bool Expression::_run(ExecutionState &p_state, const Array &p_inputs, Variant &r_ret, String &r_error_str) {
+	if (p_inputs.size() < required_inputs) {
+		for (uint32_t i = 0; i < used_inputs.size(); i++) {
+			if (used_inputs[i] >= p_inputs.size()) {
+				r_error_str = vformat(RTR("Invalid input %i (not passed) in expression"), used_inputs[i]);
 				return true;
 			}
+		}
+	}
+	if (uses_self && p_state.self.get_type() == Variant::NIL) {
+		r_error_str = RTR("self can't be used because instance is null (not passed)");
+		return true;
+	}
 
-			Vector<Variant> arr;
-			Vector<const Variant *> argp;
-			arr.resize(call->arguments.size());
-			argp.resize(call->arguments.size());
+#define GET_VARIANT(m_address) _get_address(p_state, p_inputs, m_address)
+#define GET_REGISTER(m_address) p_state.registers[(m_address) >> ADDR_BITS]
 
-			for (int i = 0; i < call->arguments.size(); i++) {
-				Variant value;
-				ret = _execute(p_inputs, p_instance, call->arguments[i], value, r_error_str);
+	const int *ip = code.ptr();
+	const Variant **args = p_state.args.ptr();
 
-				if (ret) {
+	while (true) {
+		switch (ip[0]) {
+			case OPCODE_OPERATOR: {
+				Variant::Operator op = (Variant::Operator)ip[1];
+				const Variant *a = GET_VARIANT(ip[2]);
+				const Variant *b = GET_VARIANT(ip[3]);
+
+				bool valid = true;
+				Variant::evaluate(op, *a, *b, GET_REGISTER(ip[4]), valid);
+				if (!valid) {
+					r_error_str = vformat(RTR("Invalid operands to operator %s, %s and %s."), Variant::get_operator_name(op), Variant::get_type_name(a->get_type()), Variant::get_type_name(b->get_type()));
 					return true;
 				}
-				arr.write[i] = value;
-				argp.write[i] = &arr[i];
-			}
+				ip += 5;
+			} break;
+			case OPCODE_INDEX: {
+				const Variant *base = GET_VARIANT(ip[1]);
+				const Variant *idx = GET_VARIANT(ip[2]);
+
+				bool valid;
+				GET_REGISTER(ip[3]) = base->get(*idx, &valid);
+				if (!valid) {
+					r_error_str = vformat(RTR("Invalid index of type %s for base type %s"), Variant::get_type_name(idx->get_type()), Variant::get_type_name(base->get_type()));
+					return true;
+				}
+				ip += 4;
+			} break;
+			case OPCODE_NAMED_INDEX: {
+				const Variant *base = GET_VARIANT(ip[1]);
+				const StringName &name = names[ip[2]];
+
+				bool valid;
+				GET_REGISTER(ip[3]) = base->get_named(name, &valid);
+				if (!valid) {
+					r_error_str = vformat(RTR("Invalid named index '%s' for base type %s"), String(name), Variant::get_type_name(base->get_type()));
+					return true;
+				}
+				ip += 4;
+			} break;
+			case OPCODE_ARRAY: {
+				int argc = ip[1];
+				Array arr;
+				arr.resize(argc);
+				for (int i = 0; i < argc; i++) {
+					arr[i] = *GET_VARIANT(ip[2 + i]);
+				}
+				GET_REGISTER(ip[2 + argc]) = arr;
+				ip += 3 + argc;
+			} break;
+			case OPCODE_DICTIONARY: {
+				int argc = ip[1];
+				Dictionary d;
+				for (int i = 0; i < argc; i += 2) {
+					d[*GET_VARIANT(ip[2 + i])] = *GET_VARIANT(ip[3 + i]);
+				}
+				GET_REGISTER(ip[2 + argc]) = d;
+				ip += 3 + argc;
+			} break;
+			case OPCODE_CONSTRUCT: {
+				Variant::Type type = (Variant::Type)ip[1];
+				int argc = ip[2];
+				for (int i = 0; i < argc; i++) {
+					args[i] = GET_VARIANT(ip[3 + i]);
+				}
 
-			Variant::CallError ce;
-			r_ret = base.call(call->method, (const Variant **)argp.ptr(), argp.size(), ce);
+				Variant::CallError ce;
+				GET_REGISTER(ip[3 + argc]) = Variant::construct(type, args, argc, ce);
+				if (ce.error != Variant::CallError::CALL_OK) {
+					r_error_str = vformat(RTR("Invalid arguments to construct '%s'"), Variant::get_type_name(type));
+					return true;
+				}
+				ip += 4 + argc;
+			} break;
+			case OPCODE_BUILTIN_FUNC: {
+				BuiltinFunc func = (BuiltinFunc)ip[1];
+				int argc = ip[2];
+				for (int i = 0; i < argc; i++) {
+					args[i] = GET_VARIANT(ip[3 + i]);
+				}
 
-			if (ce.error != Variant::CallError::CALL_OK) {
-				r_error_str = vformat(RTR("On call to '%s':"), String(call->method));
-				return true;
-			}
+				Variant::CallError ce;
+				exec_func(func, args, &GET_REGISTER(ip[3 + argc]), ce, r_error_str);
+				if (ce.error != Variant::CallError::CALL_OK) {
+					r_error_str = "Builtin Call Failed. " + r_error_str;
+					return true;
+				}
+				ip += 4 + argc;
+			} break;
+			case OPCODE_CALL: {
+				const Variant *base = GET_VARIANT(ip[1]);
+				const StringName &method = names[ip[2]];
+				CallCache &cache = p_state.call_caches[ip[3]];
+				int argc = ip[4];
+				for (int i = 0; i < argc; i++) {
+					args[i] = GET_VARIANT(ip[5 + i]);
+				}
+				Variant &dst = GET_REGISTER(ip[5 + argc]);
 
-		} break;
+				Variant::CallError ce;
+				if (!_call_cached(cache, *base, method, args, argc, dst, ce)) {
+					if ((ip[1] & ADDR_MASK) == ADDR_TYPE_REGISTER || base->get_type() == Variant::OBJECT) {
+						dst = const_cast<Variant *>(base)->call(method, args, argc, ce);
+					} else {
+						// Methods may modify their base, which must not be a constant or an input.
+						dst = *base;
+						dst = dst.call(method, args, argc, ce);
+					}
+				}
+				if (ce.error != Variant::CallError::CALL_OK) {
+					r_error_str = vformat(RTR("On call to '%s':"), String(method));
+					return true;
+				}
+				ip += 6 + argc;
+			} break;
+			case OPCODE_END: {
+				r_ret = *GET_VARIANT(ip[1]);
+				return false;
+			}
+		}
 	}
-	return false;
+
+#undef GET_VARIANT
+#undef GET_REGISTER
 }
 
 Error Expression::parse(const String &p_expression, const Vector<String> &p_input_names) {
@@ -2186,9 +2444,11 @@ Error Expression::parse(const String &p_expression, const Vector<String> &p_inpu
 			memdelete(nodes);
 		}
 		nodes = nullptr;
+		_compile();
 		return ERR_INVALID_PARAMETER;
 	}
 
+	_compile();
 	return OK;
 }
 
@@ -2198,7 +2458,18 @@ Variant Expression::execute(Array p_inputs, Object *p_base, bool p_show_error) {
 	execution_error = false;
 	Variant output;
 	String error_txt;
-	bool err = _execute(p_inputs, p_base, root, output, error_txt);
+	bool err;
+	if (executing.postincrement() == 0) {
+		_prepare_state(state, p_base);
+		err = _run(state, p_inputs, output, error_txt);
+		_clear_state(state);
+	} else {
+		ExecutionState local_state;
+		_prepare_state(local_state, p_base);
+		err = _run(local_state, p_inputs, output, error_txt);
+	}
+	executing.decrement();
+
 	if (err) {
 		execution_error = true;
 		error_str = error_txt;
@@ -2208,6 +2479,39 @@ Variant Expression::execute(Array p_inputs, Object *p_base, bool p_show_error) {
 	return output;
 }
 
+Array Expression::execute_many(Array p_inputs_list, Object *p_base, bool p_show_error) {
+	Array results;
+	ERR_FAIL_COND_V_MSG(error_set, results, "There was previously a parse error: " + error_str + ".");
+
+	execution_error = false;
+	results.resize(p_inputs_list.size());
+	String error_txt;
+	int failed = -1;
+
+	ExecutionState local_state;
+	bool shared = executing.postincrement() == 0;
+	ExecutionState &run_state = shared ? state : local_state;
+	_prepare_state(run_state, p_base);
+	for (int i = 0; i < p_inputs_list.size(); i++) {
+		const Array inputs = p_inputs_list[i];
+		if (_run(run_state, inputs, results[i], error_txt)) {
+			failed = i;
+			break;
+		}
+	}
+	_clear_state(run_state);
+	executing.decrement();
+
+	if (failed >= 0) {
+		results.resize(failed);
+		execution_error = true;
+		error_str = error_txt;
+		ERR_FAIL_COND_V_MSG(p_show_error, results, error_str);
+	}
+
+	return results;
+}
+
 bool Expression::has_execute_failed() const {
 	return execution_error;
 }
@@ -2219,6 +2523,7 @@ String Expression::get_error_text() const {
 void Expression::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("parse", "expression", "input_names"), &Expression::parse, DEFVAL(Vector<String>()));
 	ClassDB::bind_method(D_METHOD("execute", "inputs", "base_instance", "show_error"), &Expression::execute, DEFVAL(Array()), DEFVAL(Variant()), DEFVAL(true));
+	ClassDB::bind_method(D_METHOD("execute_many", "inputs_list", "base_instance", "show_error"), &Expression::execute_many, DEFVAL(Array()), DEFVAL(Variant()), DEFVAL(true));
 	ClassDB::bind_method(D_METHOD("has_execute_failed"), &Expression::has_execute_failed);
 	ClassDB::bind_method(D_METHOD("get_error_text"), &Expression::get_error_text);
 }
@@ -2229,6 +2534,11 @@ Expression::Expression() :
 		error_set(true),
 		root(nullptr),
 		nodes(nullptr),
+		register_count(0),
+		max_call_args(0),
+		call_count(0),
+		required_inputs(0),
+		uses_self(false),
 		execution_error(false) {
 }
 
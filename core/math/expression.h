@@ -31,7 +31,9 @@
 #ifndef EXPRESSION_H
 #define EXPRESSION_H
 
+#include "core/local_vector.h"
 #include "core/reference.h"
+#include "core/safe_refcount.h"
 
 class Expression : public Reference {
 	GDCLASS(Expression, Reference);
@@ -338,8 +340,72 @@ private:
 
 	Vector<String> input_names;
 
+	// The parsed tree is compiled to a flat program, every node writing its
+	// result to a register. Operands are addresses into the registers, the
+	// constants, the inputs or self. Constant subexpressions are folded.
+	enum Opcode {
+		OPCODE_OPERATOR, // op, a, b, dst
+		OPCODE_INDEX, // base, index, dst
+		OPCODE_NAMED_INDEX, // base, name, dst
+		OPCODE_ARRAY, // argc, args..., dst
+		OPCODE_DICTIONARY, // argc, args..., dst
+		OPCODE_CONSTRUCT, // type, argc, args..., dst
+		OPCODE_BUILTIN_FUNC, // func, argc, args..., dst
+		OPCODE_CALL, // base, name, cache, argc, args..., dst
+		OPCODE_END, // result
+	};
+
+	enum {
+		ADDR_BITS = 2,
+		ADDR_MASK = (1 << ADDR_BITS) - 1,
+		ADDR_TYPE_REGISTER = 0,
+		ADDR_TYPE_CONSTANT = 1,
+		ADDR_TYPE_INPUT = 2,
+		ADDR_TYPE_SELF = 3,
+	};
+
+	// Method resolved by the last object class seen by a call.
+	struct CallCache {
+		const void *native = nullptr;
+		uint32_t version = 0;
+		MethodBind *method = nullptr;
+	};
+
+	// Everything an execution writes to, so concurrent executions don't share it.
+	struct ExecutionState {
+		LocalVector<Variant> registers;
+		LocalVector<const Variant *> args;
+		LocalVector<CallCache> call_caches;
+		Variant self;
+	};
+
+	LocalVector<int> code;
+	LocalVector<Variant> constants;
+	LocalVector<StringName> names;
+	LocalVector<int> used_inputs; // In evaluation order, so a missing one is reported like it used to be.
+	int register_count;
+	int max_call_args;
+	int call_count;
+	int required_inputs;
+	bool uses_self;
+
+	ExecutionState state;
+	SafeNumeric<uint32_t> executing; // A reentrant or concurrent call can't use the shared state.
+
+	static bool _is_constant_func(BuiltinFunc p_func);
+	static _FORCE_INLINE_ bool _is_constant_address(int p_address) { return (p_address & ADDR_MASK) == ADDR_TYPE_CONSTANT; }
+	int _add_constant(const Variant &p_value);
+	bool _compile_arguments(const Vector<ENode *> &p_arguments, int &r_stack, LocalVector<int> &r_addresses);
+	int _compile_node(ENode *p_node, int &r_stack);
+	void _compile();
+
+	_FORCE_INLINE_ const Variant *_get_address(const ExecutionState &p_state, const Array &p_inputs, int p_address) const;
+	static bool _call_cached(CallCache &p_cache, const Variant &p_base, const StringName &p_method, const Variant **p_args, int p_argcount, Variant &r_ret, Variant::CallError &r_error);
+	bool _run(ExecutionState &p_state, const Array &p_inputs, Variant &r_ret, String &r_error_str);
+	void _prepare_state(ExecutionState &p_state, Object *p_instance) const;
+	void _clear_state(ExecutionState &p_state) const;
+
 	bool execution_error;
-	bool _execute(const Array &p_inputs, Object *p_instance, Expression::ENode *p_node, Variant &r_ret, String &r_error_str);
 
 protected:
 	static void _bind_methods();
@@ -347,6 +413,7 @@ protected:
 public:
 	Error parse(const String &p_expression, const Vector<String> &p_input_names = Vector<String>());
 	Variant execute(Array p_inputs, Object *p_base = nullptr, bool p_show_error = true);
+	Array execute_many(Array p_inputs_list, Object *p_base = nullptr, bool p_show_error = true);
 	bool has_execute_failed() const;
 	String get_error_text() const;
 
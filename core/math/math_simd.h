@@ -0,0 +1,197 @@
+/*************************************************************************/
+/*  core/math/math_simd.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef MATH_SIMD_H
+#define MATH_SIMD_H
+
+#include "core/math/math_defs.h"
+#include "core/typedefs.h"
+
+// Four-wide float helpers used by the batch kernels (Transform::xform_array,
+// AABB::cull_convex_array, Quat::slerp_array...). Only single precision builds
+// get a vector path, everything else goes through the scalar loops.
+#if !defined(REAL_T_IS_DOUBLE) && !defined(NO_MATH_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SIMD_SSE2
+#define MATH_SIMD_ENABLED
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MATH_SIMD_NEON
+#define MATH_SIMD_ENABLED
+#include <arm_neon.h>
+#endif
+#endif
+
+#ifdef MATH_SIMD_ENABLED
+
+namespace MathSIMD {
+
+#ifdef MATH_SIMD_SSE2
+
+typedef __m128 Float4;
+
+_FORCE_INLINE_ Float4 splat(float p_value) { return _mm_set1_ps(p_value); }
+_FORCE_INLINE_ Float4 load(const float *p_src) { return _mm_loadu_ps(p_src); }
+_FORCE_INLINE_ void store(float *p_dst, Float4 p_a) { _mm_storeu_ps(p_dst, p_a); }
+_FORCE_INLINE_ Float4 add(Float4 p_a, Float4 p_b) { return _mm_add_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 sub(Float4 p_a, Float4 p_b) { return _mm_sub_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 mul(Float4 p_a, Float4 p_b) { return _mm_mul_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 div(Float4 p_a, Float4 p_b) { return _mm_div_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 madd(Float4 p_a, Float4 p_b, Float4 p_c) { return _mm_add_ps(_mm_mul_ps(p_a, p_b), p_c); }
+_FORCE_INLINE_ Float4 min(Float4 p_a, Float4 p_b) { return _mm_min_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 max(Float4 p_a, Float4 p_b) { return _mm_max_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 abs(Float4 p_a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), p_a); }
+_FORCE_INLINE_ Float4 sqrt(Float4 p_a) { return _mm_sqrt_ps(p_a); }
+_FORCE_INLINE_ Float4 negate_if(Float4 p_a, Float4 p_mask) { return _mm_xor_ps(p_a, _mm_and_ps(p_mask, _mm_set1_ps(-0.0f))); }
+_FORCE_INLINE_ Float4 greater(Float4 p_a, Float4 p_b) { return _mm_cmpgt_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 less(Float4 p_a, Float4 p_b) { return _mm_cmplt_ps(p_a, p_b); }
+_FORCE_INLINE_ Float4 select(Float4 p_mask, Float4 p_a, Float4 p_b) { return _mm_or_ps(_mm_and_ps(p_mask, p_a), _mm_andnot_ps(p_mask, p_b)); }
+// One bit per lane, lane 0 in the lowest bit.
+_FORCE_INLINE_ int mask_bits(Float4 p_mask) { return _mm_movemask_ps(p_mask); }
+
+// Loads four packed Vector3 (12 floats) and transposes them into x, y and z lanes.
+_FORCE_INLINE_ void load_vector3x4(const float *p_src, Float4 &r_x, Float4 &r_y, Float4 &r_z) {
+	Float4 a = _mm_loadu_ps(p_src); // x0 y0 z0 x1
+	Float4 b = _mm_loadu_ps(p_src + 4); // y1 z1 x2 y2
+	Float4 c = _mm_loadu_ps(p_src + 8); // z2 x3 y3 z3
+	r_x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	r_y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	r_z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+_FORCE_INLINE_ void store_vector3x4(float *p_dst, Float4 p_x, Float4 p_y, Float4 p_z) {
+	Float4 a = _mm_shuffle_ps(_mm_unpacklo_ps(p_x, p_y), _mm_shuffle_ps(p_z, p_x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+	Float4 b = _mm_shuffle_ps(_mm_shuffle_ps(p_y, p_z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(p_x, p_y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+	Float4 c = _mm_shuffle_ps(_mm_shuffle_ps(p_z, p_x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_unpackhi_ps(p_y, p_z), _MM_SHUFFLE(3, 2, 2, 0));
+	_mm_storeu_ps(p_dst, a);
+	_mm_storeu_ps(p_dst + 4, b);
+	_mm_storeu_ps(p_dst + 8, c);
+}
+
+// Loads four packed 4-float structures (16 floats) and transposes them into x, y, z and w lanes.
+_FORCE_INLINE_ void load_vector4x4(const float *p_src, Float4 &r_x, Float4 &r_y, Float4 &r_z, Float4 &r_w) {
+	r_x = _mm_loadu_ps(p_src);
+	r_y = _mm_loadu_ps(p_src + 4);
+	r_z = _mm_loadu_ps(p_src + 8);
+	r_w = _mm_loadu_ps(p_src + 12);
+	_MM_TRANSPOSE4_PS(r_x, r_y, r_z, r_w);
+}
+
+_FORCE_INLINE_ void store_vector4x4(float *p_dst, Float4 p_x, Float4 p_y, Float4 p_z, Float4 p_w) {
+	_MM_TRANSPOSE4_PS(p_x, p_y, p_z, p_w);
+	_mm_storeu_ps(p_dst, p_x);
+	_mm_storeu_ps(p_dst + 4, p_y);
+	_mm_storeu_ps(p_dst + 8, p_z);
+	_mm_storeu_ps(p_dst + 12, p_w);
+}
+
+#else // MATH_SIMD_NEON
+
+typedef float32x4_t Float4;
+
+_FORCE_INLINE_ Float4 splat(float p_value) { return vdupq_n_f32(p_value); }
+_FORCE_INLINE_ Float4 load(const float *p_src) { return vld1q_f32(p_src); }
+_FORCE_INLINE_ void store(float *p_dst, Float4 p_a) { vst1q_f32(p_dst, p_a); }
+_FORCE_INLINE_ Float4 add(Float4 p_a, Float4 p_b) { return vaddq_f32(p_a, p_b); }
+_FORCE_INLINE_ Float4 sub(Float4 p_a, Float4 p_b) { return vsubq_f32(p_a, p_b); }
+_FORCE_INLINE_ Float4 mul(Float4 p_a, Float4 p_b) { return vmulq_f32(p_a, p_b); }
+_FORCE_INLINE_ Float4 div(Float4 p_a, Float4 p_b) { return vdivq_f32(p_a, p_b); }
+_FORCE_INLINE_ Float4 madd(Float4 p_a, Float4 p_b, Float4 p_c) { return vmlaq_f32(p_c, p_a, p_b); }
+_FORCE_INLINE_ Float4 min(Float4 p_a, Float4 p_b) { return vminq_f32(p_a, p_b); }
+_FORCE_INLINE_ Float4 max(Float4 p_a, Float4 p_b) { return vmaxq_f32(p_a, p_b); }
+_FORCE_INLINE_ Float4 abs(Float4 p_a) { return vabsq_f32(p_a); }
+_FORCE_INLINE_ Float4 sqrt(Float4 p_a) { return vsqrtq_f32(p_a); }
+_FORCE_INLINE_ Float4 negate_if(Float4 p_a, Float4 p_mask) { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(p_a), vandq_u32(vreinterpretq_u32_f32(p_mask), vdupq_n_u32(0x80000000)))); }
+_FORCE_INLINE_ Float4 greater(Float4 p_a, Float4 p_b) { return vreinterpretq_f32_u32(vcgtq_f32(p_a, p_b)); }
+_FORCE_INLINE_ Float4 less(Float4 p_a, Float4 p_b) { return vreinterpretq_f32_u32(vcltq_f32(p_a, p_b)); }
+_FORCE_INLINE_ Float4 select(Float4 p_mask, Float4 p_a, Float4 p_b) { return vbslq_f32(vreinterpretq_u32_f32(p_mask), p_a, p_b); }
+_FORCE_INLINE_ int mask_bits(Float4 p_mask) {
+	static const int32_t shifts[4] = { 0, 1, 2, 3 };
+	uint32x4_t bits = vshlq_u32(vshrq_n_u32(vreinterpretq_u32_f32(p_mask), 31), vld1q_s32(shifts));
+	return (int)vaddvq_u32(bits);
+}
+
+_FORCE_INLINE_ void load_vector3x4(const float *p_src, Float4 &r_x, Float4 &r_y, Float4 &r_z) {
+	float32x4x3_t v = vld3q_f32(p_src);
+	r_x = v.val[0];
+	r_y = v.val[1];
+	r_z = v.val[2];
+}
+
+_FORCE_INLINE_ void store_vector3x4(float *p_dst, Float4 p_x, Float4 p_y, Float4 p_z) {
+	float32x4x3_t v = { { p_x, p_y, p_z } };
+	vst3q_f32(p_dst, v);
+}
+
+_FORCE_INLINE_ void load_vector4x4(const float *p_src, Float4 &r_x, Float4 &r_y, Float4 &r_z, Float4 &r_w) {
+	float32x4x4_t v = vld4q_f32(p_src);
+	r_x = v.val[0];
+	r_y = v.val[1];
+	r_z = v.val[2];
+	r_w = v.val[3];
+}
+
+_FORCE_INLINE_ void store_vector4x4(float *p_dst, Float4 p_x, Float4 p_y, Float4 p_z, Float4 p_w) {
+	float32x4x4_t v = { { p_x, p_y, p_z, p_w } };
+	vst4q_f32(p_dst, v);
+}
+
+#endif
+
+// acos() for inputs in [0, 1], Abramowitz & Stegun 4.4.46 (absolute error below 2e-8).
+_FORCE_INLINE_ Float4 acos_unit(Float4 p_x) {
+	Float4 p = splat(-0.0012624911f);
+	p = madd(p, p_x, splat(0.0066700901f));
+	p = madd(p, p_x, splat(-0.0170881256f));
+	p = madd(p, p_x, splat(0.0308918810f));
+	p = madd(p, p_x, splat(-0.0501743046f));
+	p = madd(p, p_x, splat(0.0889789874f));
+	p = madd(p, p_x, splat(-0.2145988016f));
+	p = madd(p, p_x, splat(1.5707963050f));
+	return mul(p, sqrt(max(sub(splat(1.0f), p_x), splat(0.0f))));
+}
+
+// sin() for inputs in [0, pi/2], Taylor series up to x^11 (error below 6e-8).
+_FORCE_INLINE_ Float4 sin_half_pi(Float4 p_x) {
+	Float4 x2 = mul(p_x, p_x);
+	Float4 p = splat(-1.0f / 39916800.0f);
+	p = madd(p, x2, splat(1.0f / 362880.0f));
+	p = madd(p, x2, splat(-1.0f / 5040.0f));
+	p = madd(p, x2, splat(1.0f / 120.0f));
+	p = madd(p, x2, splat(-1.0f / 6.0f));
+	p = madd(p, x2, splat(1.0f));
+	return mul(p, p_x);
+}
+
+} // namespace MathSIMD
+
+#endif // MATH_SIMD_ENABLED
+
+#endif // MATH_SIMD_H
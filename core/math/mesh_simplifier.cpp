@@ -0,0 +1,423 @@
+/*************************************************************************/
+/*  mesh_simplifier.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "mesh_simplifier.h"
+
+#include "core/hash_map.h"
+#include "core/local_vector.h"
+
+struct SimplifyPositionHasher {
+	static _FORCE_INLINE_ uint32_t hash(const Vector3 &p_vec) {
+		// adding zero folds -0.0 into 0.0, they compare equal so they must hash the same
+		uint32_t h = hash_djb2_one_float(p_vec.x + 0.0);
+		h = hash_djb2_one_float(p_vec.y + 0.0, h);
+		return hash_djb2_one_float(p_vec.z + 0.0, h);
+	}
+};
+
+// Sum of squared distances to a set of planes, weighted by triangle area. Kept
+// in doubles, the terms cancel out a lot for vertices far from the origin.
+struct SimplifyQuadric {
+	double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+	double b0 = 0, b1 = 0, b2 = 0;
+	double c = 0;
+	double weight = 0;
+
+	void add_plane(const Vector3 &p_normal, double p_d, double p_weight) {
+		double x = p_normal.x;
+		double y = p_normal.y;
+		double z = p_normal.z;
+
+		a00 += p_weight * x * x;
+		a11 += p_weight * y * y;
+		a22 += p_weight * z * z;
+		a01 += p_weight * x * y;
+		a02 += p_weight * x * z;
+		a12 += p_weight * y * z;
+		b0 += p_weight * x * p_d;
+		b1 += p_weight * y * p_d;
+		b2 += p_weight * z * p_d;
+		c += p_weight * p_d * p_d;
+		weight += p_weight;
+	}
+
+	void add(const SimplifyQuadric &p_other) {
+		a00 += p_other.a00;
+		a11 += p_other.a11;
+		a22 += p_other.a22;
+		a01 += p_other.a01;
+		a02 += p_other.a02;
+		a12 += p_other.a12;
+		b0 += p_other.b0;
+		b1 += p_other.b1;
+		b2 += p_other.b2;
+		c += p_other.c;
+		weight += p_other.weight;
+	}
+
+	// Mean squared distance from p_point to the planes.
+	double evaluate(const Vector3 &p_point) const {
+		if (weight <= 0) {
+			return 0;
+		}
+
+		double x = p_point.x;
+		double y = p_point.y;
+		double z = p_point.z;
+
+		double rx = a00 * x + a01 * y + a02 * z;
+		double ry = a01 * x + a11 * y + a12 * z;
+		double rz = a02 * x + a12 * y + a22 * z;
+
+		double r = rx * x + ry * y + rz * z + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return ABS(r) / weight;
+	}
+};
+
+struct SimplifyCollapse {
+	uint32_t source;
+	uint32_t target;
+	double cost;
+};
+
+struct SimplifyCollapseCompare {
+	_FORCE_INLINE_ bool operator()(const SimplifyCollapse &p_a, const SimplifyCollapse &p_b) const {
+		return p_a.cost < p_b.cost;
+	}
+};
+
+// Moving p_source onto p_target must not turn any of the remaining triangles
+// around it over, or fold them close to it.
+static bool _collapse_flips_triangles(const Vector3 *p_vertices, const uint32_t *p_position_of, const uint32_t *p_indices, const uint32_t *p_triangles, uint32_t p_triangle_count, uint32_t p_source, uint32_t p_target) {
+	const Vector3 &target = p_vertices[p_target];
+	uint32_t source_position = p_position_of[p_source];
+	uint32_t target_position = p_position_of[p_target];
+
+	for (uint32_t i = 0; i < p_triangle_count; i++) {
+		const uint32_t *tri = &p_indices[p_triangles[i] * 3];
+
+		Vector3 before[3];
+		Vector3 after[3];
+		bool collapses = false;
+
+		for (int k = 0; k < 3; k++) {
+			uint32_t position = p_position_of[tri[k]];
+			if (position == target_position) {
+				collapses = true;
+				break;
+			}
+			before[k] = p_vertices[tri[k]];
+			after[k] = position == source_position ? target : before[k];
+		}
+
+		if (collapses) {
+			// this one degenerates and goes away
+			continue;
+		}
+
+		Vector3 normal_before = (before[1] - before[0]).cross(before[2] - before[0]);
+		Vector3 normal_after = (after[1] - after[0]).cross(after[2] - after[0]);
+
+		if (normal_before.dot(normal_after) <= 0.25 * normal_before.length() * normal_after.length()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+PoolVector<int> MeshSimplifier::simplify(const PoolVector<Vector3> &p_vertices, const PoolVector<int> &p_indices, int p_target_index_count, real_t p_max_error, real_t *r_error) {
+	if (r_error) {
+		*r_error = 0;
+	}
+
+	ERR_FAIL_COND_V(p_indices.size() % 3 != 0, p_indices);
+
+	const uint32_t vertex_count = p_vertices.size();
+	PoolVector<Vector3>::Read vr = p_vertices.read();
+	const Vector3 *vertices = vr.ptr();
+
+	LocalVector<uint32_t> indices;
+	{
+		indices.resize(p_indices.size());
+		PoolVector<int>::Read ir = p_indices.read();
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			ERR_FAIL_UNSIGNED_INDEX_V((uint32_t)ir[i], vertex_count, p_indices);
+			indices[i] = ir[i];
+		}
+	}
+
+	// Vertices that share a position are a single point for the error metric.
+	// Only the ones the triangles use are counted, so a stray duplicate does not
+	// pin a position down.
+	LocalVector<uint32_t> position_of;
+	LocalVector<uint32_t> wedge_count;
+	{
+		position_of.resize(vertex_count);
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			position_of[i] = UINT32_MAX;
+		}
+
+		HashMap<Vector3, uint32_t, SimplifyPositionHasher> positions;
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			uint32_t v = indices[i];
+			if (position_of[v] != UINT32_MAX) {
+				continue;
+			}
+
+			const uint32_t *found = positions.getptr(vertices[v]);
+			if (found) {
+				position_of[v] = *found;
+				wedge_count[*found]++;
+			} else {
+				position_of[v] = wedge_count.size();
+				positions.set(vertices[v], position_of[v]);
+				wedge_count.push_back(1);
+			}
+		}
+	}
+
+	const uint32_t position_count = wedge_count.size();
+
+	// Drop triangles that are already degenerate, they would confuse the border
+	// detection below.
+	{
+		uint32_t write = 0;
+		for (uint32_t i = 0; i < indices.size(); i += 3) {
+			uint32_t p0 = position_of[indices[i + 0]];
+			uint32_t p1 = position_of[indices[i + 1]];
+			uint32_t p2 = position_of[indices[i + 2]];
+			if (p0 == p1 || p1 == p2 || p2 == p0) {
+				continue;
+			}
+			indices[write++] = indices[i + 0];
+			indices[write++] = indices[i + 1];
+			indices[write++] = indices[i + 2];
+		}
+		indices.resize(write);
+	}
+
+	// Seams, open borders and non-manifold edges stay where they are. An edge is
+	// only interior when it is used exactly once in each direction.
+	LocalVector<uint8_t> locked;
+	{
+		locked.resize(position_count);
+		for (uint32_t i = 0; i < position_count; i++) {
+			locked[i] = wedge_count[i] > 1;
+		}
+
+		HashMap<uint64_t, uint32_t> edge_uses;
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			uint64_t a = position_of[indices[i]];
+			uint64_t b = position_of[indices[(i % 3) == 2 ? i - 2 : i + 1]];
+			uint32_t *uses = edge_uses.getptr((a << 32) | b);
+			if (uses) {
+				(*uses)++;
+			} else {
+				edge_uses.set((a << 32) | b, 1);
+			}
+		}
+
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			uint64_t a = position_of[indices[i]];
+			uint64_t b = position_of[indices[(i % 3) == 2 ? i - 2 : i + 1]];
+			const uint32_t *reverse = edge_uses.getptr((b << 32) | a);
+			if (!reverse || *reverse != 1 || edge_uses[(a << 32) | b] != 1) {
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+
+	LocalVector<SimplifyQuadric> quadrics;
+	quadrics.resize(position_count);
+	for (uint32_t i = 0; i < indices.size(); i += 3) {
+		const Vector3 &v0 = vertices[indices[i + 0]];
+		const Vector3 &v1 = vertices[indices[i + 1]];
+		const Vector3 &v2 = vertices[indices[i + 2]];
+
+		Vector3 normal = (v1 - v0).cross(v2 - v0);
+		real_t length = normal.length();
+		if (length == 0) {
+			continue;
+		}
+		normal /= length;
+
+		double d = -normal.dot(v0);
+		for (int k = 0; k < 3; k++) {
+			quadrics[position_of[indices[i + k]]].add_plane(normal, d, length * 0.5);
+		}
+	}
+
+	const uint32_t target_index_count = MAX(p_target_index_count, 0);
+	const double max_error_squared = double(p_max_error) * double(p_max_error);
+	double error_squared = 0;
+
+	LocalVector<SimplifyCollapse> collapses;
+	LocalVector<uint32_t> remap;
+	LocalVector<uint8_t> touched;
+	LocalVector<uint32_t> triangle_offsets;
+	LocalVector<uint32_t> triangles;
+
+	remap.resize(vertex_count);
+	touched.resize(position_count);
+	triangle_offsets.resize(position_count + 1);
+
+	// Each pass collapses the cheapest edges that don't touch each other, then
+	// rebuilds the triangle list and starts over with the new costs.
+	while (indices.size() > target_index_count) {
+		collapses.clear();
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			uint32_t a = indices[i];
+			uint32_t b = indices[(i % 3) == 2 ? i - 2 : i + 1];
+
+			if (!locked[position_of[a]]) {
+				SimplifyCollapse collapse = { a, b, quadrics[position_of[a]].evaluate(vertices[b]) };
+				collapses.push_back(collapse);
+			}
+			if (!locked[position_of[b]]) {
+				SimplifyCollapse collapse = { b, a, quadrics[position_of[b]].evaluate(vertices[a]) };
+				collapses.push_back(collapse);
+			}
+		}
+
+		if (collapses.empty()) {
+			break;
+		}
+
+		collapses.sort_custom<SimplifyCollapseCompare>();
+
+		// triangles around each position
+		for (uint32_t i = 0; i <= position_count; i++) {
+			triangle_offsets[i] = 0;
+		}
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			triangle_offsets[position_of[indices[i]] + 1]++;
+		}
+		for (uint32_t i = 0; i < position_count; i++) {
+			triangle_offsets[i + 1] += triangle_offsets[i];
+		}
+		triangles.resize(indices.size());
+		for (uint32_t i = 0; i < position_count; i++) {
+			touched[i] = 0;
+		}
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			uint32_t position = position_of[indices[i]];
+			triangles[triangle_offsets[position] + touched[position]++] = i / 3;
+		}
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			remap[i] = i;
+		}
+		for (uint32_t i = 0; i < position_count; i++) {
+			touched[i] = 0;
+		}
+
+		uint32_t triangles_to_remove = (indices.size() - target_index_count) / 3;
+		uint32_t triangles_removed = 0;
+
+		for (uint32_t i = 0; i < collapses.size() && triangles_removed < triangles_to_remove; i++) {
+			const SimplifyCollapse &collapse = collapses[i];
+			if (collapse.cost > max_error_squared) {
+				break;
+			}
+
+			uint32_t source_position = position_of[collapse.source];
+			uint32_t target_position = position_of[collapse.target];
+			if (touched[source_position] || touched[target_position]) {
+				continue;
+			}
+
+			const uint32_t *around = &triangles[triangle_offsets[source_position]];
+			uint32_t around_count = triangle_offsets[source_position + 1] - triangle_offsets[source_position];
+
+			if (_collapse_flips_triangles(vertices, position_of.ptr(), indices.ptr(), around, around_count, collapse.source, collapse.target)) {
+				continue;
+			}
+
+			remap[collapse.source] = collapse.target;
+			quadrics[target_position].add(quadrics[source_position]);
+			error_squared = MAX(error_squared, collapse.cost);
+
+			// Nothing in the one ring may move again this pass, the flip test
+			// above relies on the positions around the source.
+			for (uint32_t j = 0; j < around_count; j++) {
+				const uint32_t *tri = &indices[around[j] * 3];
+				bool collapses_away = false;
+				for (int k = 0; k < 3; k++) {
+					uint32_t position = position_of[tri[k]];
+					touched[position] = 1;
+					collapses_away = collapses_away || position == target_position;
+				}
+				if (collapses_away) {
+					triangles_removed++;
+				}
+			}
+		}
+
+		if (!triangles_removed) {
+			break;
+		}
+
+		uint32_t write = 0;
+		for (uint32_t i = 0; i < indices.size(); i += 3) {
+			uint32_t v0 = remap[indices[i + 0]];
+			uint32_t v1 = remap[indices[i + 1]];
+			uint32_t v2 = remap[indices[i + 2]];
+
+			uint32_t p0 = position_of[v0];
+			uint32_t p1 = position_of[v1];
+			uint32_t p2 = position_of[v2];
+			if (p0 == p1 || p1 == p2 || p2 == p0) {
+				continue;
+			}
+
+			indices[write++] = v0;
+			indices[write++] = v1;
+			indices[write++] = v2;
+		}
+		indices.resize(write);
+	}
+
+	if (r_error) {
+		*r_error = Math::sqrt(error_squared);
+	}
+
+	PoolVector<int> result;
+	result.resize(indices.size());
+	{
+		PoolVector<int>::Write w = result.write();
+		for (uint32_t i = 0; i < indices.size(); i++) {
+			w[i] = indices[i];
+		}
+	}
+
+	return result;
+}
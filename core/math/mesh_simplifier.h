@@ -0,0 +1,52 @@
+/*************************************************************************/
+/*  mesh_simplifier.h                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "core/math/vector3.h"
+#include "core/pool_vector.h"
+
+// Quadric error edge collapse (Garland & Heckbert) on indexed triangle lists.
+//
+// Collapses only ever move a vertex onto one of its neighbors, so the result is
+// a new index list over the original vertex array and can be drawn with the
+// same vertex buffer. Vertices on open borders and on attribute seams (several
+// vertices sharing a position) are kept in place so no cracks open up.
+class MeshSimplifier {
+public:
+	// Simplifies until the index count reaches p_target_index_count, or until the
+	// next collapse would move the surface further than p_max_error from the
+	// original. The error reached, as a distance in the same units as the
+	// vertices, is returned in r_error.
+	static PoolVector<int> simplify(const PoolVector<Vector3> &p_vertices, const PoolVector<int> &p_indices, int p_target_index_count, real_t p_max_error, real_t *r_error = nullptr);
+};
+
+#endif // MESH_SIMPLIFIER_H
@@ -31,6 +31,7 @@
 #include "quat.h"
 
 #include "core/math/basis.h"
+#include "core/math/math_simd.h"
 #include "core/print_string.h"
 
 real_t Quat::angle_to(const Quat &p_to) const {
@@ -198,6 +199,51 @@ Quat Quat::slerp(const Quat &p_to, const real_t &p_weight) const {
 			scale0 * w + scale1 * to1.w);
 }
 
+void Quat::slerp_array(const Quat *p_from, const Quat *p_to, real_t p_weight, Quat *r_dst, int p_count) {
+	int i = 0;
+#ifdef MATH_SIMD_ENABLED
+	// The polynomial sin() is only accurate in [0, pi/2], extrapolation goes through the scalar path.
+	if (p_weight >= 0 && p_weight <= 1) {
+		using namespace MathSIMD;
+		const Float4 zero = splat(0.0f);
+		const Float4 one = splat(1.0f);
+		const Float4 epsilon = splat(CMP_EPSILON);
+		const Float4 weight = splat(p_weight);
+		const Float4 inv_weight = splat(1.0f - p_weight);
+
+		for (; i + 4 <= p_count; i += 4) {
+			Float4 fx, fy, fz, fw, tx, ty, tz, tw;
+			load_vector4x4(&p_from[i].x, fx, fy, fz, fw);
+			load_vector4x4(&p_to[i].x, tx, ty, tz, tw);
+
+			Float4 cosom = add(add(mul(fx, tx), mul(fy, ty)), add(mul(fz, tz), mul(fw, tw)));
+			const Float4 flip = less(cosom, zero);
+			tx = negate_if(tx, flip);
+			ty = negate_if(ty, flip);
+			tz = negate_if(tz, flip);
+			tw = negate_if(tw, flip);
+			cosom = min(abs(cosom), one);
+
+			const Float4 omega = acos_unit(cosom);
+			const Float4 sinom = sin_half_pi(omega);
+			// Lanes where the quaternions are very close fall back to linear interpolation.
+			const Float4 use_slerp = greater(sub(one, cosom), epsilon);
+			const Float4 scale0 = select(use_slerp, div(sin_half_pi(mul(inv_weight, omega)), sinom), inv_weight);
+			const Float4 scale1 = select(use_slerp, div(sin_half_pi(mul(weight, omega)), sinom), weight);
+
+			store_vector4x4(&r_dst[i].x,
+					madd(scale0, fx, mul(scale1, tx)),
+					madd(scale0, fy, mul(scale1, ty)),
+					madd(scale0, fz, mul(scale1, tz)),
+					madd(scale0, fw, mul(scale1, tw)));
+		}
+	}
+#endif
+	for (; i < p_count; i++) {
+		r_dst[i] = p_from[i].slerp(p_to[i], p_weight);
+	}
+}
+
 Quat Quat::slerpni(const Quat &p_to, const real_t &p_weight) const {
 #ifdef MATH_CHECKS
 	ERR_FAIL_COND_V_MSG(!is_normalized(), Quat(), "The start quaternion must be normalized.");
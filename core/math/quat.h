@@ -61,6 +61,9 @@ public:
 	Quat slerp(const Quat &p_to, const real_t &p_weight) const;
 	Quat slerpni(const Quat &p_to, const real_t &p_weight) const;
 	Quat cubic_slerp(const Quat &p_b, const Quat &p_pre_a, const Quat &p_post_b, const real_t &p_weight) const;
+	// Interpolates p_count pairs with the same weight, using SIMD where available. The vector path approximates
+	// acos and sin with polynomials, so results may differ from slerp() in the last few bits.
+	static void slerp_array(const Quat *p_from, const Quat *p_to, real_t p_weight, Quat *r_dst, int p_count);
 
 	void set_axis_angle(const Vector3 &axis, const real_t &angle);
 	_FORCE_INLINE_ void get_axis_angle(Vector3 &r_axis, real_t &r_angle) const {
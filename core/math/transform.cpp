@@ -31,6 +31,7 @@
 #include "transform.h"
 
 #include "core/math/math_funcs.h"
+#include "core/math/math_simd.h"
 #include "core/print_string.h"
 
 void Transform::affine_invert() {
@@ -188,6 +189,29 @@ Transform Transform::operator*(const Transform &p_transform) const {
 	return t;
 }
 
+void Transform::xform_array(const Vector3 *p_src, Vector3 *r_dst, int p_count) const {
+	int i = 0;
+#ifdef MATH_SIMD_ENABLED
+	using namespace MathSIMD;
+	const Float4 m00 = splat(basis.elements[0][0]), m01 = splat(basis.elements[0][1]), m02 = splat(basis.elements[0][2]);
+	const Float4 m10 = splat(basis.elements[1][0]), m11 = splat(basis.elements[1][1]), m12 = splat(basis.elements[1][2]);
+	const Float4 m20 = splat(basis.elements[2][0]), m21 = splat(basis.elements[2][1]), m22 = splat(basis.elements[2][2]);
+	const Float4 ox = splat(origin.x), oy = splat(origin.y), oz = splat(origin.z);
+
+	for (; i + 4 <= p_count; i += 4) {
+		Float4 x, y, z;
+		load_vector3x4(&p_src[i].x, x, y, z);
+		Float4 rx = madd(m00, x, madd(m01, y, madd(m02, z, ox)));
+		Float4 ry = madd(m10, x, madd(m11, y, madd(m12, z, oy)));
+		Float4 rz = madd(m20, x, madd(m21, y, madd(m22, z, oz)));
+		store_vector3x4(&r_dst[i].x, rx, ry, rz);
+	}
+#endif
+	for (; i < p_count; i++) {
+		r_dst[i] = xform(p_src[i]);
+	}
+}
+
 Transform::operator String() const {
 	return basis.operator String() + " - " + origin.operator String();
 }
@@ -79,6 +79,9 @@ public:
 	_FORCE_INLINE_ AABB xform(const AABB &p_aabb) const;
 	_FORCE_INLINE_ PoolVector<Vector3> xform(const PoolVector<Vector3> &p_array) const;
 
+	// Transforms p_count points at once, using SIMD where available. p_src and r_dst may be the same array.
+	void xform_array(const Vector3 *p_src, Vector3 *r_dst, int p_count) const;
+
 	// NOTE: These are UNSAFE with non-uniform scaling, and will produce incorrect results.
 	// They use the transpose.
 	// For safe inverse transforms, xform by the affine_inverse.
@@ -208,9 +211,7 @@ PoolVector<Vector3> Transform::xform(const PoolVector<Vector3> &p_array) const {
 	PoolVector<Vector3>::Read r = p_array.read();
 	PoolVector<Vector3>::Write w = array.write();
 
-	for (int i = 0; i < p_array.size(); ++i) {
-		w[i] = xform(r[i]);
-	}
+	xform_array(r.ptr(), w.ptr(), p_array.size());
 	return array;
 }
 
@@ -30,8 +30,55 @@
 
 #include "message_queue.h"
 
+#include "core/engine.h"
+#include "core/os/os.h"
 #include "core/project_settings.h"
 #include "core/script_language.h"
+#include "core/trace_profiler.h"
+
+#include <atomic>
+
+struct MessageQueue::Page {
+	std::atomic<Page *> next;
+	SafeNumeric<uint32_t> end; // Published by the writer after each message.
+	uint32_t size;
+
+	_FORCE_INLINE_ uint8_t *get_data() { return (uint8_t *)this + HEADER_SIZE; }
+
+	enum {
+		HEADER_SIZE = 32
+	};
+};
+
+struct MessageQueue::ThreadBuffer {
+	ThreadBuffer *next = nullptr;
+
+	// Only touched by the thread owning the buffer.
+	Page *write_page = nullptr;
+	uint32_t write_pos = 0;
+
+	// Only touched by the thread flushing the queue.
+	Page *read_page = nullptr;
+	uint32_t read_pos = 0;
+
+	SafeFlag exited;
+};
+
+struct MessageQueueThreadData {
+	MessageQueue::ThreadBuffer *buffer = nullptr;
+	uint64_t queue_id = 0;
+
+	~MessageQueueThreadData() {
+		// The thread is gone, the queue can free its buffer once it has been flushed.
+		MessageQueue *mq = MessageQueue::get_singleton();
+		if (buffer && mq && mq->queue_id == queue_id) {
+			buffer->exited.set();
+		}
+	}
+};
+
+static thread_local MessageQueueThreadData thread_data;
+static SafeNumeric<uint64_t> last_queue_id;
 
 MessageQueue *MessageQueue::singleton = nullptr;
 
@@ -39,22 +86,147 @@ MessageQueue *MessageQueue::get_singleton() {
 	return singleton;
 }
 
-Error MessageQueue::push_call(ObjectID p_id, const StringName &p_method, const Variant **p_args, int p_argcount, bool p_show_error) {
-	_THREAD_SAFE_METHOD_
+MessageQueue::Page *MessageQueue::_alloc_page(uint32_t p_min_size) {
+	Page *page = nullptr;
+	if (p_min_size <= PAGE_SIZE) {
+		free_pages_lock.lock();
+		page = free_pages;
+		if (page) {
+			free_pages = page->next.load(std::memory_order_relaxed);
+			free_pages_size -= page->size;
+		}
+		free_pages_lock.unlock();
+	}
 
-	int room_needed = sizeof(Message) + sizeof(Variant) * p_argcount;
+	if (!page) {
+		uint32_t size = MAX((uint32_t)PAGE_SIZE, p_min_size);
+		page = (Page *)memalloc(Page::HEADER_SIZE + size);
+		CRASH_COND_MSG(!page, "Out of memory");
+		memnew_placement(page, Page);
+		page->size = size;
+	}
 
-	if ((buffer_end + room_needed) >= buffer_size) {
-		String type;
-		if (ObjectDB::get_instance(p_id)) {
-			type = ObjectDB::get_instance(p_id)->get_class();
+	page->next.store(nullptr, std::memory_order_relaxed);
+	page->end.set(0);
+	return page;
+}
+
+void MessageQueue::_free_page(Page *p_page) {
+	if (p_page->size == PAGE_SIZE) {
+		free_pages_lock.lock();
+		// Keep enough pages around for the usual load, give the rest back after a burst.
+		if (free_pages_size < max_free_pages_size) {
+			p_page->next.store(free_pages, std::memory_order_relaxed);
+			free_pages = p_page;
+			free_pages_size += p_page->size;
+			p_page = nullptr;
 		}
-		print_line("Failed method: " + type + ":" + p_method + " target ID: " + itos(p_id));
-		statistics();
-		ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_kb' in project settings.");
+		free_pages_lock.unlock();
+	}
+
+	if (p_page) {
+		p_page->~Page();
+		memfree(p_page);
 	}
+}
+
+MessageQueue::ThreadBuffer *MessageQueue::_get_thread_buffer() {
+	if (likely(thread_data.queue_id == queue_id)) {
+		return thread_data.buffer;
+	}
+
+	ThreadBuffer *buffer = memnew(ThreadBuffer);
+	buffer->write_page = _alloc_page(PAGE_SIZE);
+	buffer->read_page = buffer->write_page;
+
+	thread_buffers_mutex.lock();
+	buffer->next = thread_buffers;
+	thread_buffers = buffer;
+	thread_buffers_mutex.unlock();
+
+	thread_data.buffer = buffer;
+	thread_data.queue_id = queue_id;
+	return buffer;
+}
 
-	Message *msg = memnew_placement(&buffer[buffer_end], Message);
+uint8_t *MessageQueue::_alloc_message(ThreadBuffer *p_buffer, uint32_t p_size) {
+	if (unlikely(p_buffer->write_pos + p_size > p_buffer->write_page->size)) {
+		// Never fail, chain a new page instead. The flushing thread frees the old one
+		// once it's done with it.
+		Page *page = _alloc_page(p_size);
+		p_buffer->write_page->next.store(page, std::memory_order_release);
+		p_buffer->write_page = page;
+		p_buffer->write_pos = 0;
+	}
+
+	return p_buffer->write_page->get_data() + p_buffer->write_pos;
+}
+
+void MessageQueue::_commit_message(ThreadBuffer *p_buffer, uint32_t p_size) {
+	p_buffer->write_pos += p_size;
+	p_buffer->write_page->end.set(p_buffer->write_pos);
+	pending_bytes.add(p_size);
+}
+
+MessageQueue::Message *MessageQueue::_peek(ThreadBuffer *p_buffer) {
+	while (true) {
+		Page *page = p_buffer->read_page;
+		if (p_buffer->read_pos < page->end.get()) {
+			return (Message *)(page->get_data() + p_buffer->read_pos);
+		}
+
+		Page *next = page->next.load(std::memory_order_acquire);
+		if (!next) {
+			return nullptr;
+		}
+
+		// The page is complete once the next one is linked, but more messages may have
+		// been committed to it right before.
+		if (p_buffer->read_pos < page->end.get()) {
+			continue;
+		}
+
+		p_buffer->read_page = next;
+		p_buffer->read_pos = 0;
+		_free_page(page);
+	}
+}
+
+uint32_t MessageQueue::_get_message_size(const Message *p_message) {
+	uint32_t size = sizeof(Message);
+	if ((p_message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
+		size += sizeof(Variant) * p_message->args;
+	}
+	return size;
+}
+
+void MessageQueue::_free_thread_buffer(ThreadBuffer *p_buffer, bool p_destroy_messages) {
+	if (p_destroy_messages) {
+		Message *message = _peek(p_buffer);
+		while (message) {
+			p_buffer->read_pos += _get_message_size(message);
+			if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
+				Variant *args = (Variant *)(message + 1);
+				for (int i = 0; i < message->args; i++) {
+					args[i].~Variant();
+				}
+			}
+			message->~Message();
+			message = _peek(p_buffer);
+		}
+	}
+
+	_free_page(p_buffer->read_page);
+	memdelete(p_buffer);
+}
+
+Error MessageQueue::push_call(ObjectID p_id, const StringName &p_method, const Variant **p_args, int p_argcount, bool p_show_error) {
+	uint32_t room_needed = sizeof(Message) + sizeof(Variant) * p_argcount;
+
+	ThreadBuffer *buffer = _get_thread_buffer();
+	uint8_t *mem = _alloc_message(buffer, room_needed);
+
+	Message *msg = memnew_placement(mem, Message);
 	msg->args = p_argcount;
 	msg->instance_id = p_id;
 	msg->target = p_method;
@@ -62,15 +234,15 @@ Error MessageQueue::push_call(ObjectID p_id, const StringName &p_method, const V
 	if (p_show_error) {
 		msg->type |= FLAG_SHOW_ERROR;
 	}
+	msg->order = order.postincrement();
 
-	buffer_end += sizeof(Message);
-
+	Variant *args = (Variant *)(msg + 1);
 	for (int i = 0; i < p_argcount; i++) {
-		Variant *v = memnew_placement(&buffer[buffer_end], Variant);
-		buffer_end += sizeof(Variant);
-		*v = *p_args[i];
+		memnew_placement(&args[i], Variant(*p_args[i]));
 	}
 
+	_commit_message(buffer, room_needed);
+
 	return OK;
 }
 
@@ -90,56 +262,42 @@ Error MessageQueue::push_call(ObjectID p_id, const StringName &p_method, VARIANT
 }
 
 Error MessageQueue::push_set(ObjectID p_id, const StringName &p_prop, const Variant &p_value) {
-	_THREAD_SAFE_METHOD_
-
-	uint8_t room_needed = sizeof(Message) + sizeof(Variant);
+	uint32_t room_needed = sizeof(Message) + sizeof(Variant);
 
-	if ((buffer_end + room_needed) >= buffer_size) {
-		String type;
-		if (ObjectDB::get_instance(p_id)) {
-			type = ObjectDB::get_instance(p_id)->get_class();
-		}
-		print_line("Failed set: " + type + ":" + p_prop + " target ID: " + itos(p_id));
-		statistics();
-		ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_kb' in project settings.");
-	}
+	ThreadBuffer *buffer = _get_thread_buffer();
+	uint8_t *mem = _alloc_message(buffer, room_needed);
 
-	Message *msg = memnew_placement(&buffer[buffer_end], Message);
+	Message *msg = memnew_placement(mem, Message);
 	msg->args = 1;
 	msg->instance_id = p_id;
 	msg->target = p_prop;
 	msg->type = TYPE_SET;
+	msg->order = order.postincrement();
 
-	buffer_end += sizeof(Message);
+	memnew_placement(msg + 1, Variant(p_value));
 
-	Variant *v = memnew_placement(&buffer[buffer_end], Variant);
-	buffer_end += sizeof(Variant);
-	*v = p_value;
+	_commit_message(buffer, room_needed);
 
 	return OK;
 }
 
 Error MessageQueue::push_notification(ObjectID p_id, int p_notification) {
-	_THREAD_SAFE_METHOD_
-
 	ERR_FAIL_COND_V(p_notification < 0, ERR_INVALID_PARAMETER);
 
-	uint8_t room_needed = sizeof(Message);
+	uint32_t room_needed = sizeof(Message);
 
-	if ((buffer_end + room_needed) >= buffer_size) {
-		print_line("Failed notification: " + itos(p_notification) + " target ID: " + itos(p_id));
-		statistics();
-		ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_kb' in project settings.");
-	}
+	ThreadBuffer *buffer = _get_thread_buffer();
+	uint8_t *mem = _alloc_message(buffer, room_needed);
 
-	Message *msg = memnew_placement(&buffer[buffer_end], Message);
+	Message *msg = memnew_placement(mem, Message);
 
 	msg->type = TYPE_NOTIFICATION;
 	msg->instance_id = p_id;
 	//msg->target;
 	msg->notification = p_notification;
+	msg->order = order.postincrement();
 
-	buffer_end += sizeof(Message);
+	_commit_message(buffer, room_needed);
 
 	return OK;
 }
@@ -161,54 +319,65 @@ void MessageQueue::statistics() {
 	Map<StringName, int> call_count;
 	int null_count = 0;
 
-	uint32_t read_pos = 0;
-	while (read_pos < buffer_end) {
-		Message *message = (Message *)&buffer[read_pos];
+	thread_buffers_mutex.lock();
+	ThreadBuffer *buffers = thread_buffers;
+	thread_buffers_mutex.unlock();
 
-		Object *target = ObjectDB::get_instance(message->instance_id);
+	for (ThreadBuffer *buffer = buffers; buffer; buffer = buffer->next) {
+		// Walk the messages without consuming them.
+		Page *page = buffer->read_page;
+		uint32_t read_pos = buffer->read_pos;
+		while (page) {
+			uint32_t end = page->end.get();
+			while (read_pos < end) {
+				Message *message = (Message *)(page->get_data() + read_pos);
 
-		if (target != nullptr) {
-			switch (message->type & FLAG_MASK) {
-				case TYPE_CALL: {
-					if (!call_count.has(message->target)) {
-						call_count[message->target] = 0;
-					}
+				Object *target = ObjectDB::get_instance(message->instance_id);
 
-					call_count[message->target]++;
+				if (target != nullptr) {
+					switch (message->type & FLAG_MASK) {
+						case TYPE_CALL: {
+							if (!call_count.has(message->target)) {
+								call_count[message->target] = 0;
+							}
 
-				} break;
-				case TYPE_NOTIFICATION: {
-					if (!notify_count.has(message->notification)) {
-						notify_count[message->notification] = 0;
-					}
+							call_count[message->target]++;
 
-					notify_count[message->notification]++;
+						} break;
+						case TYPE_NOTIFICATION: {
+							if (!notify_count.has(message->notification)) {
+								notify_count[message->notification] = 0;
+							}
 
-				} break;
-				case TYPE_SET: {
-					if (!set_count.has(message->target)) {
-						set_count[message->target] = 0;
-					}
+							notify_count[message->notification]++;
 
-					set_count[message->target]++;
+						} break;
+						case TYPE_SET: {
+							if (!set_count.has(message->target)) {
+								set_count[message->target] = 0;
+							}
 
-				} break;
-			}
+							set_count[message->target]++;
 
-		} else {
-			//object was deleted
-			print_line("Object was deleted while awaiting a callback");
+						} break;
+					}
 
-			null_count++;
-		}
+				} else {
+					//object was deleted
+					print_line("Object was deleted while awaiting a callback");
 
-		read_pos += sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			read_pos += sizeof(Variant) * message->args;
+					null_count++;
+				}
+
+				read_pos += _get_message_size(message);
+			}
+
+			page = page->next.load(std::memory_order_acquire);
+			read_pos = 0;
 		}
 	}
 
-	print_line("TOTAL BYTES: " + itos(buffer_end));
+	print_line("TOTAL BYTES: " + itos(pending_bytes.get()));
 	print_line("NULL count: " + itos(null_count));
 
 	for (Map<StringName, int>::Element *E = set_count.front(); E; E = E->next()) {
@@ -245,32 +414,52 @@ void MessageQueue::_call_function(Object *p_target, const StringName &p_func, co
 }
 
 void MessageQueue::flush() {
-	if (buffer_end > buffer_max_used) {
-		buffer_max_used = buffer_end;
-	}
-
-	uint32_t read_pos = 0;
-
-	//using reverse locking strategy
-	_THREAD_SAFE_LOCK_
+	TRACE_SCOPE("core", "MessageQueue::flush");
 
 	ERR_FAIL_COND(flushing); //already flushing, you did something odd
 	flushing = true;
 
-	while (read_pos < buffer_end) {
-		//lock on each iteration, so a call can re-add itself to the message queue
+	uint64_t pending = pending_bytes.get();
+	if (pending > buffer_max_used) {
+		buffer_max_used = pending;
+	}
 
-		Message *message = (Message *)&buffer[read_pos];
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	uint32_t messages = 0;
+	uint64_t bytes = 0;
+
+	thread_buffers_mutex.lock();
+	ThreadBuffer *buffers = thread_buffers;
+	thread_buffers_mutex.unlock();
+
+	while (true) {
+		// Merge the thread buffers, oldest message first. Messages pushed from the
+		// calls below are picked up by this same loop.
+		ThreadBuffer *buffer = nullptr;
+		Message *message = nullptr;
+		for (ThreadBuffer *b = buffers; b; b = b->next) {
+			Message *m = _peek(b);
+			if (m && (!message || (int32_t)(m->order - message->order) < 0)) {
+				buffer = b;
+				message = m;
+			}
+		}
 
-		uint32_t advance = sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			advance += sizeof(Variant) * message->args;
+		if (!message) {
+			// Threads that pushed for the first time meanwhile add new buffers.
+			thread_buffers_mutex.lock();
+			bool new_buffers = thread_buffers != buffers;
+			buffers = thread_buffers;
+			thread_buffers_mutex.unlock();
+			if (new_buffers) {
+				continue;
+			}
+			break;
 		}
 
 		//pre-advance so this function is reentrant
-		read_pos += advance;
-
-		_THREAD_SAFE_UNLOCK_
+		uint32_t advance = _get_message_size(message);
+		buffer->read_pos += advance;
 
 		Object *target = ObjectDB::get_instance(message->instance_id);
 
@@ -307,12 +496,40 @@ void MessageQueue::flush() {
 
 		message->~Message();
 
-		_THREAD_SAFE_LOCK_
+		pending_bytes.sub(advance);
+		messages++;
+		bytes += advance;
+	}
+
+	// Release the buffers of threads that finished.
+	thread_buffers_mutex.lock();
+	ThreadBuffer **prev = &thread_buffers;
+	while (*prev) {
+		ThreadBuffer *b = *prev;
+		if (b->exited.is_set() && !_peek(b)) {
+			*prev = b->next;
+			_free_thread_buffer(b, false);
+		} else {
+			prev = &b->next;
+		}
 	}
+	thread_buffers_mutex.unlock();
+
+	uint64_t frame = Engine::get_singleton() ? Engine::get_singleton()->get_idle_frames() : 0;
+	if (frame != stats_frame) {
+		last_frame_messages = frame_messages;
+		last_frame_bytes = frame_bytes;
+		last_frame_usec = frame_usec;
+		frame_messages = 0;
+		frame_bytes = 0;
+		frame_usec = 0;
+		stats_frame = frame;
+	}
+	frame_messages += messages;
+	frame_bytes += bytes;
+	frame_usec += OS::get_singleton()->get_ticks_usec() - begin;
 
-	buffer_end = 0; // reset buffer
 	flushing = false;
-	_THREAD_SAFE_UNLOCK_
 }
 
 bool MessageQueue::is_flushing() const {
@@ -324,34 +541,39 @@ MessageQueue::MessageQueue() {
 	singleton = this;
 	flushing = false;
 
-	buffer_end = 0;
+	thread_buffers = nullptr;
+	free_pages = nullptr;
+	free_pages_size = 0;
+	queue_id = last_queue_id.increment();
+
 	buffer_max_used = 0;
-	buffer_size = GLOBAL_DEF_RST("memory/limits/message_queue/max_size_kb", DEFAULT_QUEUE_SIZE_KB);
+
+	stats_frame = 0;
+	frame_messages = 0;
+	frame_bytes = 0;
+	frame_usec = 0;
+	last_frame_messages = 0;
+	last_frame_bytes = 0;
+	last_frame_usec = 0;
+
+	max_free_pages_size = GLOBAL_DEF_RST("memory/limits/message_queue/max_size_kb", DEFAULT_QUEUE_SIZE_KB);
 	ProjectSettings::get_singleton()->set_custom_property_info("memory/limits/message_queue/max_size_kb", PropertyInfo(Variant::INT, "memory/limits/message_queue/max_size_kb", PROPERTY_HINT_RANGE, "1024,4096,1,or_greater"));
-	buffer_size *= 1024;
-	buffer = memnew_arr(uint8_t, buffer_size);
+	max_free_pages_size *= 1024;
 }
 
 MessageQueue::~MessageQueue() {
-	uint32_t read_pos = 0;
-
-	while (read_pos < buffer_end) {
-		Message *message = (Message *)&buffer[read_pos];
-		Variant *args = (Variant *)(message + 1);
-		int argc = message->args;
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			for (int i = 0; i < argc; i++) {
-				args[i].~Variant();
-			}
-		}
-		message->~Message();
+	while (thread_buffers) {
+		ThreadBuffer *b = thread_buffers;
+		thread_buffers = b->next;
+		_free_thread_buffer(b, true);
+	}
 
-		read_pos += sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			read_pos += sizeof(Variant) * message->args;
-		}
+	while (free_pages) {
+		Page *page = free_pages;
+		free_pages = page->next.load(std::memory_order_relaxed);
+		page->~Page();
+		memfree(page);
 	}
 
 	singleton = nullptr;
-	memdelete_arr(buffer);
 }
@@ -32,13 +32,15 @@
 #define MESSAGE_QUEUE_H
 
 #include "core/object.h"
+#include "core/os/mutex.h"
+#include "core/os/spin_lock.h"
 #include "core/os/thread_safe.h"
+#include "core/safe_refcount.h"
 
 class MessageQueue {
-	_THREAD_SAFE_CLASS_
-
 	enum {
-		DEFAULT_QUEUE_SIZE_KB = 4096
+		DEFAULT_QUEUE_SIZE_KB = 4096,
+		PAGE_SIZE = 64 * 1024
 	};
 
 	enum {
@@ -58,12 +60,44 @@ class MessageQueue {
 			int16_t notification;
 			int16_t args;
 		};
+		uint32_t order;
 	};
 
-	uint8_t *buffer;
-	uint32_t buffer_end;
+	// Each thread pushing messages appends to its own list of pages, so pushing never
+	// takes a lock. The buffers are merged in push order when flushing.
+	struct Page;
+	struct ThreadBuffer;
+
+	ThreadBuffer *thread_buffers;
+	Mutex thread_buffers_mutex;
+
+	Page *free_pages;
+	uint64_t free_pages_size;
+	uint64_t max_free_pages_size;
+	SpinLock free_pages_lock;
+
+	SafeNumeric<uint32_t> order;
+	SafeNumeric<uint64_t> pending_bytes;
+	uint64_t queue_id;
+
 	uint32_t buffer_max_used;
-	uint32_t buffer_size;
+
+	uint64_t stats_frame;
+	uint32_t frame_messages;
+	uint64_t frame_bytes;
+	uint64_t frame_usec;
+	uint32_t last_frame_messages;
+	uint64_t last_frame_bytes;
+	uint64_t last_frame_usec;
+
+	Page *_alloc_page(uint32_t p_min_size);
+	void _free_page(Page *p_page);
+	ThreadBuffer *_get_thread_buffer();
+	uint8_t *_alloc_message(ThreadBuffer *p_buffer, uint32_t p_size);
+	void _commit_message(ThreadBuffer *p_buffer, uint32_t p_size);
+	Message *_peek(ThreadBuffer *p_buffer);
+	static uint32_t _get_message_size(const Message *p_message);
+	void _free_thread_buffer(ThreadBuffer *p_buffer, bool p_destroy_messages);
 
 	void _call_function(Object *p_target, const StringName &p_func, const Variant *p_args, int p_argcount, bool p_show_error);
 
@@ -71,6 +105,8 @@ class MessageQueue {
 
 	bool flushing;
 
+	friend struct MessageQueueThreadData;
+
 public:
 	static MessageQueue *get_singleton();
 
@@ -90,6 +126,11 @@ public:
 
 	int get_max_buffer_usage() const;
 
+	// Totals of all the flushes of the last frame.
+	int get_messages_in_frame() const { return last_frame_messages; }
+	uint64_t get_bytes_in_frame() const { return last_frame_bytes; }
+	uint64_t get_flush_usec_in_frame() const { return last_frame_usec; }
+
 	MessageQueue();
 	~MessageQueue();
 };
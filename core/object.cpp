@@ -32,6 +32,7 @@
 
 #include "core/class_db.h"
 #include "core/core_string_names.h"
+#include "core/local_vector.h"
 #include "core/message_queue.h"
 #include "core/object_rc.h"
 #include "core/os/os.h"
@@ -42,18 +43,6 @@
 
 #ifdef DEBUG_ENABLED
 
-struct _ObjectDebugLock {
-	Object *obj;
-
-	_ObjectDebugLock(Object *p_obj) {
-		obj = p_obj;
-		obj->_lock_index.ref();
-	}
-	~_ObjectDebugLock() {
-		obj->_lock_index.unref();
-	}
-};
-
 #define OBJ_DEBUG_LOCK _ObjectDebugLock _debug_lock(this);
 
 #else
@@ -1125,12 +1114,6 @@ bool Object::_has_user_signal(const StringName &p_name) const {
 	return signal_map[p_name].user.name.length() > 0;
 }
 
-struct _ObjectSignalDisconnectData {
-	StringName signal;
-	Object *target;
-	StringName method;
-};
-
 Variant Object::_emit_signal(const Variant **p_args, int p_argcount, Variant::CallError &r_error) {
 	r_error.error = Variant::CallError::CALL_ERROR_TOO_FEW_ARGUMENTS;
 
@@ -1174,7 +1157,8 @@ Error Object::emit_signal(const StringName &p_name, const Variant **p_args, int
 		return ERR_UNAVAILABLE;
 	}
 
-	List<_ObjectSignalDisconnectData> disconnect_data;
+	// One-shot connections to remove once all targets were called, in slot map order.
+	LocalVector<Signal::Target> disconnect_targets;
 
 	//copy on write will ensure that disconnecting the signal or even deleting the object will not affect the signal calling.
 	//this happens automatically and will not change the performance of calling.
@@ -1247,18 +1231,64 @@ Error Object::emit_signal(const StringName &p_name, const Variant **p_args, int
 		}
 #endif
 		if (disconnect) {
-			_ObjectSignalDisconnectData dd;
-			dd.signal = p_name;
-			dd.target = target;
-			dd.method = c.method;
-			disconnect_data.push_back(dd);
+			disconnect_targets.push_back(slot_map.getk(i));
 		}
 	}
 
-	while (!disconnect_data.empty()) {
-		const _ObjectSignalDisconnectData &dd = disconnect_data.front()->get();
-		disconnect(dd.signal, dd.target, dd.method);
-		disconnect_data.pop_front();
+	if (disconnect_targets.empty()) {
+		return err;
+	}
+
+	// Release the copy, otherwise the first removal copies the whole slot map again.
+	slot_map = VMap<Signal::Target, Signal::Slot>();
+
+	if (disconnect_targets.size() == 1) {
+		Object *target = ObjectDB::get_instance(disconnect_targets[0]._id);
+		if (target) {
+			disconnect(p_name, target, disconnect_targets[0].method);
+		}
+		return err;
+	}
+
+	// Many one-shot connections firing together (e.g. coroutines yielding on the same signal):
+	// erasing them one by one shifts the rest of the slot map every time, rebuild it once instead.
+	// Callbacks may have changed the signal map, so look the signal up again.
+	s = signal_map.getptr(p_name);
+	if (!s) {
+		return err;
+	}
+
+	const VMap<Signal::Target, Signal::Slot> &slots = s->slot_map;
+	VMap<Signal::Target, Signal::Slot> remaining;
+	uint32_t next = 0;
+	for (int i = 0; i < slots.size(); i++) {
+		const Signal::Target &key = slots.getk(i);
+		// Both are sorted, targets disconnected by the callbacks are skipped.
+		while (next < disconnect_targets.size() && disconnect_targets[next] < key) {
+			next++;
+		}
+		if (next < disconnect_targets.size() && !(key < disconnect_targets[next])) {
+			next++;
+			// Same as _disconnect().
+			Signal::Slot slot = slots.getv(i);
+			slot.reference_count--;
+			if (slot.reference_count > 0) {
+				remaining.insert(key, slot);
+				continue;
+			}
+			Object *target = ObjectDB::get_instance(key._id);
+			if (target) {
+				target->connections.erase(slot.cE);
+			}
+			continue;
+		}
+		remaining.insert(key, slots.getv(i));
+	}
+	s->slot_map = remaining;
+
+	if (s->slot_map.empty() && ClassDB::has_signal(get_class_name(), p_name)) {
+		//not user signal, delete
+		signal_map.erase(p_name);
 	}
 
 	return err;
@@ -0,0 +1,585 @@
+/*************************************************************************/
+/*  ordered_oa_hash_map.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef ORDERED_OA_HASH_MAP_H
+#define ORDERED_OA_HASH_MAP_H
+
+#include "core/hashfuncs.h"
+#include "core/os/memory.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ORDERED_OA_HASH_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <string.h>
+
+/**
+ * An insertion-ordered hash map using open addressing.
+ *
+ * Entries are stored contiguously in insertion order, and a separate index table maps
+ * hashes to entry indices. For every slot of the index table, a control byte holds
+ * 7 bits of the hash (or an empty/deleted marker), so a whole group of slots can be
+ * matched against a hash at once, with SSE2 where available.
+ *
+ * Erased entries leave a hole in the entry array, which is compacted away once the
+ * array needs to grow or the index table is rebuilt.
+ *
+ * Unlike OrderedHashMap, inserting may move entries in memory, so pointers to keys or
+ * values are only valid until the map is modified.
+ */
+template <class TKey, class TValue,
+		class Hasher = HashMapHasherDefault,
+		class Comparator = HashMapComparatorDefault<TKey>>
+class OrderedOAHashMap {
+	struct Entry {
+		TKey key;
+		TValue value;
+
+		Entry(const TKey &p_key, const TValue &p_value) :
+				key(p_key),
+				value(p_value) {}
+	};
+
+	enum : uint8_t {
+		CTRL_EMPTY = 0x80,
+		CTRL_DELETED = 0xFE,
+	};
+
+	static const uint32_t EMPTY_HASH = 0;
+	static const uint32_t NOT_FOUND = 0xFFFFFFFF;
+	static const uint32_t MIN_CAPACITY = 16;
+
+	struct Group {
+#ifdef ORDERED_OA_HASH_MAP_SSE2
+		typedef uint32_t Mask;
+		static const uint32_t WIDTH = 16;
+
+		__m128i ctrl;
+
+		_FORCE_INLINE_ explicit Group(const uint8_t *p_ctrl) {
+			ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_ctrl));
+		}
+		_FORCE_INLINE_ Mask match(uint8_t p_h2) const {
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)p_h2), ctrl));
+		}
+		_FORCE_INLINE_ Mask match_empty() const {
+			return match(CTRL_EMPTY);
+		}
+		_FORCE_INLINE_ Mask match_empty_or_deleted() const {
+			// Both markers have the high bit set, full slots don't.
+			return _mm_movemask_epi8(ctrl);
+		}
+		static _FORCE_INLINE_ uint32_t lowest(Mask p_mask) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, p_mask);
+			return index;
+#else
+			return __builtin_ctz(p_mask);
+#endif
+		}
+#else
+		// Portable version, handling 8 control bytes in a 64-bit word.
+		// The mask has the high bit of each matching byte set.
+		typedef uint64_t Mask;
+		static const uint32_t WIDTH = 8;
+		static const uint64_t LSBS = 0x0101010101010101ULL;
+		static const uint64_t MSBS = 0x8080808080808080ULL;
+
+		uint64_t ctrl;
+
+		_FORCE_INLINE_ explicit Group(const uint8_t *p_ctrl) {
+			memcpy(&ctrl, p_ctrl, sizeof(ctrl));
+#ifdef BIG_ENDIAN_ENABLED
+			ctrl = BSWAP64(ctrl);
+#endif
+		}
+		_FORCE_INLINE_ Mask match(uint8_t p_h2) const {
+			// May report false positives, which are filtered out by checking the control byte.
+			uint64_t x = ctrl ^ (LSBS * p_h2);
+			return (x - LSBS) & ~x & MSBS;
+		}
+		_FORCE_INLINE_ Mask match_empty() const {
+			return (ctrl & (~ctrl << 6)) & MSBS;
+		}
+		_FORCE_INLINE_ Mask match_empty_or_deleted() const {
+			return (ctrl & (~ctrl << 7)) & MSBS;
+		}
+		static _FORCE_INLINE_ uint32_t lowest(Mask p_mask) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, p_mask);
+			return index >> 3;
+#else
+			return __builtin_ctzll(p_mask) >> 3;
+#endif
+		}
+#endif
+	};
+
+	Entry *entries = nullptr;
+	uint32_t *hashes = nullptr; // Per entry, EMPTY_HASH for erased entries.
+	uint32_t entry_count = 0; // Including erased entries.
+	uint32_t entry_capacity = 0;
+	uint32_t num_elements = 0;
+
+	uint8_t *ctrl = nullptr;
+	uint32_t *slots = nullptr; // Entry index of every full slot.
+	uint32_t capacity = 0;
+	uint32_t num_deleted = 0;
+
+	static _FORCE_INLINE_ uint32_t _hash(const TKey &p_key) {
+		// Some hashers return the key itself (e.g. for integers), so mix the bits,
+		// as both the low bits (control byte) and the high bits (group) are used.
+		uint32_t h = Hasher::hash(p_key);
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h == EMPTY_HASH ? EMPTY_HASH + 1 : h;
+	}
+
+	static _FORCE_INLINE_ uint8_t _h2(uint32_t p_hash) {
+		return p_hash & 0x7F;
+	}
+
+	_FORCE_INLINE_ uint32_t _group_mask() const {
+		return capacity / Group::WIDTH - 1;
+	}
+
+	uint32_t _find_slot(const TKey &p_key, uint32_t p_hash) const {
+		if (unlikely(num_elements == 0)) {
+			return NOT_FOUND;
+		}
+
+		const uint8_t h2 = _h2(p_hash);
+		const uint32_t group_mask = _group_mask();
+		uint32_t group = (p_hash >> 7) & group_mask;
+
+		// Triangular probing visits every group, as the group count is a power of two.
+		for (uint32_t step = 1;; step++) {
+			const uint32_t base = group * Group::WIDTH;
+			Group g(&ctrl[base]);
+			for (typename Group::Mask m = g.match(h2); m; m &= m - 1) {
+				uint32_t pos = base + Group::lowest(m);
+				if (ctrl[pos] != h2) {
+					continue;
+				}
+				uint32_t e = slots[pos];
+				if (hashes[e] == p_hash && Comparator::compare(entries[e].key, p_key)) {
+					return pos;
+				}
+			}
+			if (g.match_empty()) {
+				return NOT_FOUND;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	uint32_t _find_free_slot(uint32_t p_hash) const {
+		const uint32_t group_mask = _group_mask();
+		uint32_t group = (p_hash >> 7) & group_mask;
+
+		for (uint32_t step = 1;; step++) {
+			const uint32_t base = group * Group::WIDTH;
+			typename Group::Mask m = Group(&ctrl[base]).match_empty_or_deleted();
+			if (m) {
+				return base + Group::lowest(m);
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	void _insert_slot(uint32_t p_hash, uint32_t p_entry) {
+		uint32_t pos = _find_free_slot(p_hash);
+		if (ctrl[pos] == CTRL_DELETED) {
+			num_deleted--;
+		}
+		ctrl[pos] = _h2(p_hash);
+		slots[pos] = p_entry;
+	}
+
+	// Removes erased entries, keeping the insertion order.
+	void _compact_entries() {
+		if (num_elements == entry_count) {
+			return;
+		}
+		uint32_t dst = 0;
+		for (uint32_t i = 0; i < entry_count; i++) {
+			if (hashes[i] == EMPTY_HASH) {
+				continue;
+			}
+			if (i != dst) {
+				// Relocate without copying, as CowData and LocalVector do.
+				memcpy((void *)&entries[dst], (void *)&entries[i], sizeof(Entry));
+				hashes[dst] = hashes[i];
+			}
+			dst++;
+		}
+		entry_count = dst;
+	}
+
+	// Compacts the entries and rebuilds the index table with the given capacity.
+	void _rehash(uint32_t p_capacity) {
+		_compact_entries();
+
+		if (p_capacity != capacity) {
+			if (ctrl) {
+				memfree(ctrl);
+				memfree(slots);
+			}
+			capacity = p_capacity;
+			ctrl = (uint8_t *)memalloc(capacity);
+			slots = (uint32_t *)memalloc(capacity * sizeof(uint32_t));
+		}
+		memset(ctrl, CTRL_EMPTY, capacity);
+		num_deleted = 0;
+
+		for (uint32_t i = 0; i < entry_count; i++) {
+			_insert_slot(hashes[i], i);
+		}
+	}
+
+	void _reserve_slot() {
+		// Keep the load factor (counting deleted slots) under 7/8, so probing always finds an empty slot.
+		if ((num_elements + num_deleted + 1) * 8 <= capacity * 7) {
+			return;
+		}
+		uint32_t new_capacity = MAX(capacity, MIN_CAPACITY);
+		// Only grow if the table would still be over half full after dropping the deleted slots.
+		while ((num_elements + 1) * 2 > new_capacity) {
+			new_capacity *= 2;
+		}
+		_rehash(new_capacity);
+	}
+
+	uint32_t _append_entry(uint32_t p_hash, const TKey &p_key, const TValue &p_value) {
+		if (entry_count == entry_capacity) {
+			if (entry_count - num_elements > entry_count / 4) {
+				// Plenty of erased entries, reclaim them instead of growing.
+				_rehash(capacity);
+			} else {
+				entry_capacity = MAX(entry_capacity * 2, 8u);
+				entries = (Entry *)memrealloc(entries, entry_capacity * sizeof(Entry));
+				hashes = (uint32_t *)memrealloc(hashes, entry_capacity * sizeof(uint32_t));
+			}
+		}
+
+		uint32_t e = entry_count++;
+		memnew_placement(&entries[e], Entry(p_key, p_value));
+		hashes[e] = p_hash;
+		num_elements++;
+		return e;
+	}
+
+	uint32_t _insert(const TKey &p_key, const TValue &p_value, bool p_overwrite) {
+		uint32_t hash = _hash(p_key);
+		uint32_t pos = _find_slot(p_key, hash);
+		if (pos != NOT_FOUND) {
+			uint32_t e = slots[pos];
+			if (p_overwrite) {
+				entries[e].value = p_value;
+			}
+			return e;
+		}
+
+		_reserve_slot();
+		uint32_t e = _append_entry(hash, p_key, p_value);
+		_insert_slot(hash, e);
+		return e;
+	}
+
+	_FORCE_INLINE_ uint32_t _next_valid(uint32_t p_index) const {
+		while (p_index < entry_count && hashes[p_index] == EMPTY_HASH) {
+			p_index++;
+		}
+		return p_index;
+	}
+
+	void _copy_from(const OrderedOAHashMap &p_other) {
+		for (uint32_t i = 0; i < p_other.entry_count; i++) {
+			if (p_other.hashes[i] != EMPTY_HASH) {
+				insert(p_other.entries[i].key, p_other.entries[i].value);
+			}
+		}
+	}
+
+public:
+	class ConstElement;
+
+	class Element {
+		friend class OrderedOAHashMap;
+		friend class ConstElement;
+
+		OrderedOAHashMap *map = nullptr;
+		uint32_t index = 0;
+
+		Element(OrderedOAHashMap *p_map, uint32_t p_index) :
+				map(p_map),
+				index(p_index) {}
+
+	public:
+		Element() {}
+
+		_FORCE_INLINE_ operator bool() const { return map != nullptr; }
+
+		Element next() const {
+			uint32_t n = map->_next_valid(index + 1);
+			return n < map->entry_count ? Element(map, n) : Element();
+		}
+
+		Element prev() const {
+			for (uint32_t i = index; i > 0; i--) {
+				if (map->hashes[i - 1] != EMPTY_HASH) {
+					return Element(map, i - 1);
+				}
+			}
+			return Element();
+		}
+
+		_FORCE_INLINE_ const TKey &key() const { return map->entries[index].key; }
+		_FORCE_INLINE_ TValue &value() { return map->entries[index].value; }
+		_FORCE_INLINE_ const TValue &value() const { return map->entries[index].value; }
+		_FORCE_INLINE_ TValue &get() { return map->entries[index].value; }
+		_FORCE_INLINE_ const TValue &get() const { return map->entries[index].value; }
+	};
+
+	class ConstElement {
+		friend class OrderedOAHashMap;
+
+		const OrderedOAHashMap *map = nullptr;
+		uint32_t index = 0;
+
+		ConstElement(const OrderedOAHashMap *p_map, uint32_t p_index) :
+				map(p_map),
+				index(p_index) {}
+
+	public:
+		ConstElement() {}
+		ConstElement(const Element &p_element) :
+				map(p_element.map),
+				index(p_element.index) {}
+
+		_FORCE_INLINE_ operator bool() const { return map != nullptr; }
+
+		ConstElement next() const {
+			uint32_t n = map->_next_valid(index + 1);
+			return n < map->entry_count ? ConstElement(map, n) : ConstElement();
+		}
+
+		_FORCE_INLINE_ const TKey &key() const { return map->entries[index].key; }
+		_FORCE_INLINE_ const TValue &value() const { return map->entries[index].value; }
+		_FORCE_INLINE_ const TValue &get() const { return map->entries[index].value; }
+	};
+
+	ConstElement find(const TKey &p_key) const {
+		uint32_t pos = _find_slot(p_key, _hash(p_key));
+		return pos == NOT_FOUND ? ConstElement() : ConstElement(this, slots[pos]);
+	}
+
+	Element find(const TKey &p_key) {
+		uint32_t pos = _find_slot(p_key, _hash(p_key));
+		return pos == NOT_FOUND ? Element() : Element(this, slots[pos]);
+	}
+
+	const TValue *getptr(const TKey &p_key) const {
+		uint32_t pos = _find_slot(p_key, _hash(p_key));
+		return pos == NOT_FOUND ? nullptr : &entries[slots[pos]].value;
+	}
+
+	TValue *getptr(const TKey &p_key) {
+		uint32_t pos = _find_slot(p_key, _hash(p_key));
+		return pos == NOT_FOUND ? nullptr : &entries[slots[pos]].value;
+	}
+
+	Element insert(const TKey &p_key, const TValue &p_value) {
+		return Element(this, _insert(p_key, p_value, true));
+	}
+
+	bool has(const TKey &p_key) const {
+		return _find_slot(p_key, _hash(p_key)) != NOT_FOUND;
+	}
+
+	bool erase(const TKey &p_key) {
+		uint32_t pos = _find_slot(p_key, _hash(p_key));
+		if (pos == NOT_FOUND) {
+			return false;
+		}
+
+		uint32_t e = slots[pos];
+		ctrl[pos] = CTRL_DELETED;
+		num_deleted++;
+
+		entries[e].~Entry();
+		hashes[e] = EMPTY_HASH;
+		num_elements--;
+
+		// Erasing the last entries (stack-like use) doesn't leave holes.
+		while (entry_count > 0 && hashes[entry_count - 1] == EMPTY_HASH) {
+			entry_count--;
+		}
+		if (num_elements == 0) {
+			memset(ctrl, CTRL_EMPTY, capacity);
+			num_deleted = 0;
+		}
+		return true;
+	}
+
+	void erase(Element &p_element) {
+		erase(p_element.key());
+		p_element = Element();
+	}
+
+	const TValue &operator[](const TKey &p_key) const {
+		const TValue *v = getptr(p_key);
+		CRASH_COND(!v);
+		return *v;
+	}
+
+	TValue &operator[](const TKey &p_key) {
+		// Consistent with Map behaviour. The insertion may reallocate the entries.
+		uint32_t e = _insert(p_key, TValue(), false);
+		return entries[e].value;
+	}
+
+	// Returns the element at the given position in insertion order.
+	Element get_element_at(int p_index) {
+		ERR_FAIL_INDEX_V(p_index, (int)num_elements, Element());
+		if (num_elements == entry_count) {
+			return Element(this, p_index);
+		}
+		Element E = front();
+		for (int i = 0; i < p_index; i++) {
+			E = E.next();
+		}
+		return E;
+	}
+
+	_FORCE_INLINE_ Element front() {
+		uint32_t n = _next_valid(0);
+		return n < entry_count ? Element(this, n) : Element();
+	}
+
+	_FORCE_INLINE_ ConstElement front() const {
+		uint32_t n = _next_valid(0);
+		return n < entry_count ? ConstElement(this, n) : ConstElement();
+	}
+
+	Element back() {
+		return Element(this, entry_count).prev();
+	}
+
+	// Returns the element whose key is stored at p_key, or an invalid element if p_key
+	// does not point inside the map. Avoids looking up the key again when iterating.
+	Element get_element_from_key_ptr(const TKey *p_key) {
+		const uint8_t *ptr = reinterpret_cast<const uint8_t *>(p_key);
+		const uint8_t *begin = reinterpret_cast<const uint8_t *>(entries);
+		if (!entries || ptr < begin || ptr >= begin + entry_count * sizeof(Entry)) {
+			return Element();
+		}
+		uint32_t index = (ptr - begin) / sizeof(Entry);
+		if (&entries[index].key != p_key || hashes[index] == EMPTY_HASH) {
+			return Element();
+		}
+		return Element(this, index);
+	}
+
+	_FORCE_INLINE_ int size() const { return num_elements; }
+	_FORCE_INLINE_ bool empty() const { return num_elements == 0; }
+
+	void clear() {
+		for (uint32_t i = 0; i < entry_count; i++) {
+			if (hashes[i] != EMPTY_HASH) {
+				entries[i].~Entry();
+			}
+		}
+		entry_count = 0;
+		num_elements = 0;
+		num_deleted = 0;
+		if (ctrl) {
+			memset(ctrl, CTRL_EMPTY, capacity);
+		}
+	}
+
+	void reserve(uint32_t p_elements) {
+		if (p_elements == 0) {
+			return;
+		}
+		if (p_elements > entry_capacity) {
+			entry_capacity = p_elements;
+			entries = (Entry *)memrealloc(entries, entry_capacity * sizeof(Entry));
+			hashes = (uint32_t *)memrealloc(hashes, entry_capacity * sizeof(uint32_t));
+		}
+		uint32_t new_capacity = MAX(capacity, MIN_CAPACITY);
+		while (p_elements * 8 > new_capacity * 7) {
+			new_capacity *= 2;
+		}
+		if (new_capacity != capacity) {
+			_rehash(new_capacity);
+		}
+	}
+
+	void operator=(const OrderedOAHashMap &p_other) {
+		if (this == &p_other) {
+			return;
+		}
+		clear();
+		reserve(p_other.num_elements);
+		_copy_from(p_other);
+	}
+
+	OrderedOAHashMap(const OrderedOAHashMap &p_other) {
+		reserve(p_other.num_elements);
+		_copy_from(p_other);
+	}
+
+	OrderedOAHashMap() {}
+
+	~OrderedOAHashMap() {
+		clear();
+		if (entries) {
+			memfree(entries);
+			memfree(hashes);
+		}
+		if (ctrl) {
+			memfree(ctrl);
+			memfree(slots);
+		}
+	}
+};
+
+#endif // ORDERED_OA_HASH_MAP_H
@@ -35,6 +35,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void *operator new(size_t p_size, const char *p_description) {
 	return Memory::alloc_static(p_size, false);
@@ -64,6 +65,10 @@ SafeNumeric<uint64_t> Memory::max_usage;
 #endif
 
 SafeNumeric<uint64_t> Memory::alloc_count;
+#ifdef DEBUG_ENABLED
+SafeNumeric<uint64_t> Memory::alloc_total;
+#endif
+SafeNumeric<uint64_t> Memory::paged_usage;
 
 void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
 #ifdef DEBUG_ENABLED
@@ -77,6 +82,9 @@ void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
 	ERR_FAIL_COND_V(!mem, nullptr);
 
 	alloc_count.increment();
+#ifdef DEBUG_ENABLED
+	alloc_total.increment();
+#endif
 
 	if (prepad) {
 		uint64_t *s = (uint64_t *)mem;
@@ -191,6 +199,156 @@ uint64_t Memory::get_mem_max_usage() {
 #endif
 }
 
+uint64_t Memory::get_alloc_count() {
+	return alloc_count.get();
+}
+
+uint64_t Memory::get_alloc_total() {
+#ifdef DEBUG_ENABLED
+	return alloc_total.get();
+#else
+	return 0;
+#endif
+}
+
+uint64_t Memory::get_paged_usage() {
+	return paged_usage.get();
+}
+
+void MemoryArena::_add_chunk(size_t p_min_size) {
+	size_t size = MAX(p_min_size, chunk_size);
+	Chunk *c = (Chunk *)Memory::alloc_static(CHUNK_HEADER + size);
+	CRASH_COND_MSG(!c, "Out of memory");
+	c->prev = chunk;
+	c->size = size;
+	chunk = c;
+	chunk_used = 0;
+	capacity += size;
+}
+
+void MemoryArena::_free_chunks() {
+	while (chunk) {
+		Chunk *prev = chunk->prev;
+		Memory::free_static(chunk);
+		chunk = prev;
+	}
+	chunk_used = 0;
+	capacity = 0;
+}
+
+void MemoryArena::reset() {
+	if (chunk && chunk->prev) {
+		// Merge everything into one chunk for the next round.
+		size_t size = capacity;
+		_free_chunks();
+		_add_chunk(size);
+	}
+	chunk_used = 0;
+	used = 0;
+}
+
+MemoryArena::MemoryArena(size_t p_chunk_size) {
+	chunk_size = p_chunk_size;
+}
+
+MemoryArena::~MemoryArena() {
+	_free_chunks();
+}
+
+SafeNumeric<uint64_t> FrameAllocator::frame;
+SafeNumeric<uint64_t> FrameAllocator::frame_usage;
+SafeNumeric<uint64_t> FrameAllocator::capacity;
+uint64_t FrameAllocator::last_frame_usage = 0;
+uint64_t FrameAllocator::last_frame_heap_allocs = 0;
+uint64_t FrameAllocator::heap_allocs_at_frame_start = 0;
+
+struct FrameArenaThreadData {
+	MemoryArena arena;
+	uint64_t frame = 0;
+	size_t capacity = 0;
+	uint32_t scope_depth = 0;
+
+	_FORCE_INLINE_ void check_frame() {
+		uint64_t current_frame = FrameAllocator::frame.get();
+		if (unlikely(frame != current_frame)) {
+			arena.reset();
+			frame = current_frame;
+		}
+	}
+
+	_FORCE_INLINE_ void *alloc(size_t p_bytes) {
+		if (scope_depth == 0) {
+			check_frame();
+		}
+
+		void *ptr = arena.alloc(p_bytes);
+
+		if (unlikely(arena.get_capacity() != capacity)) {
+			FrameAllocator::capacity.add(arena.get_capacity());
+			FrameAllocator::capacity.sub(capacity);
+			capacity = arena.get_capacity();
+		}
+		FrameAllocator::frame_usage.add(p_bytes);
+		return ptr;
+	}
+
+	~FrameArenaThreadData() {
+		FrameAllocator::capacity.sub(capacity);
+	}
+};
+
+static thread_local FrameArenaThreadData frame_arena;
+
+FrameAllocator::Scope::Scope() {
+	if (frame_arena.scope_depth == 0) {
+		frame_arena.check_frame();
+	}
+	frame_arena.scope_depth++;
+}
+
+FrameAllocator::Scope::~Scope() {
+	frame_arena.scope_depth--;
+}
+
+// Every allocation stores its size first, so it can be grown.
+#define FRAME_ALLOC_HEADER 16
+
+void *FrameAllocator::alloc(size_t p_bytes) {
+	uint8_t *mem = (uint8_t *)frame_arena.alloc(p_bytes + FRAME_ALLOC_HEADER);
+	*(uint64_t *)mem = p_bytes;
+	return mem + FRAME_ALLOC_HEADER;
+}
+
+void *FrameAllocator::realloc(void *p_ptr, size_t p_bytes) {
+	if (!p_ptr) {
+		return p_bytes ? alloc(p_bytes) : nullptr;
+	}
+	if (p_bytes == 0) {
+		return nullptr;
+	}
+
+	uint64_t old_size = *(uint64_t *)((uint8_t *)p_ptr - FRAME_ALLOC_HEADER);
+	if (p_bytes <= old_size) {
+		return p_ptr;
+	}
+
+	void *mem = alloc(p_bytes);
+	memcpy(mem, p_ptr, old_size);
+	return mem;
+}
+
+void FrameAllocator::next_frame() {
+	uint64_t usage = frame_usage.get();
+	frame_usage.sub(usage);
+	last_frame_usage = usage;
+
+	uint64_t heap_allocs = Memory::get_alloc_total();
+	last_frame_heap_allocs = heap_allocs - heap_allocs_at_frame_start;
+	heap_allocs_at_frame_start = heap_allocs;
+
+	frame.increment();
+}
+
 _GlobalNil::_GlobalNil() {
 	color = 1;
 	left = this;
@@ -48,6 +48,13 @@ class Memory {
 #endif
 
 	static SafeNumeric<uint64_t> alloc_count;
+#ifdef DEBUG_ENABLED
+	static SafeNumeric<uint64_t> alloc_total;
+#endif
+	static SafeNumeric<uint64_t> paged_usage;
+
+	template <class T, bool thread_safe>
+	friend class PagedAllocator;
 
 public:
 	static void *alloc_static(size_t p_bytes, bool p_pad_align = false);
@@ -57,14 +64,110 @@ public:
 	static uint64_t get_mem_available();
 	static uint64_t get_mem_usage();
 	static uint64_t get_mem_max_usage();
+	static uint64_t get_alloc_count();
+	static uint64_t get_alloc_total(); // Only counted in debug builds.
+	static uint64_t get_paged_usage();
 };
 
 class DefaultAllocator {
 public:
 	_FORCE_INLINE_ static void *alloc(size_t p_memory) { return Memory::alloc_static(p_memory, false); }
+	_FORCE_INLINE_ static void *realloc(void *p_ptr, size_t p_memory) { return Memory::realloc_static(p_ptr, p_memory, false); }
 	_FORCE_INLINE_ static void free(void *p_ptr) { Memory::free_static(p_ptr, false); }
 };
 
+/**
+ * Bump allocator. Allocations are carved out of large chunks and can't be freed
+ * individually, all of them are released at once by reset(). Not thread safe.
+ */
+class MemoryArena {
+	struct Chunk {
+		Chunk *prev;
+		size_t size;
+	};
+
+	enum {
+		ALIGN = 16,
+		CHUNK_HEADER = (sizeof(Chunk) + ALIGN - 1) & ~(ALIGN - 1),
+	};
+
+	Chunk *chunk = nullptr;
+	size_t chunk_used = 0;
+	size_t used = 0;
+	size_t capacity = 0;
+	size_t chunk_size;
+
+	void _add_chunk(size_t p_min_size);
+	void _free_chunks();
+
+public:
+	enum {
+		DEFAULT_CHUNK_SIZE = 64 * 1024
+	};
+
+	_FORCE_INLINE_ void *alloc(size_t p_bytes) {
+		p_bytes = (p_bytes + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+		if (unlikely(!chunk || chunk_used + p_bytes > chunk->size)) {
+			_add_chunk(p_bytes);
+		}
+		void *ptr = (uint8_t *)chunk + CHUNK_HEADER + chunk_used;
+		chunk_used += p_bytes;
+		used += p_bytes;
+		return ptr;
+	}
+
+	// Releases every allocation. Memory is kept in a single chunk big enough for
+	// everything that was allocated, so a steady workload stops hitting the heap.
+	void reset();
+
+	size_t get_used() const { return used; }
+	size_t get_capacity() const { return capacity; }
+
+	MemoryArena(size_t p_chunk_size = DEFAULT_CHUNK_SIZE);
+	~MemoryArena();
+};
+
+/**
+ * Per-thread frame arena, for temporaries that don't outlive the current frame.
+ * Each thread allocates from its own MemoryArena, which is reset the first time the
+ * thread allocates after the main loop called next_frame(). free() is a no-op.
+ * It can be used as the allocator of LocalVector or Map, as long as the container
+ * doesn't survive the frame.
+ *
+ * Threads that don't run in step with the main loop (the render thread) must
+ * allocate inside a FrameAllocator::Scope, otherwise a next_frame() in the middle
+ * of their work would reset memory they still use.
+ */
+class FrameAllocator {
+	static SafeNumeric<uint64_t> frame;
+	static SafeNumeric<uint64_t> frame_usage;
+	static SafeNumeric<uint64_t> capacity;
+	static uint64_t last_frame_usage;
+	static uint64_t last_frame_heap_allocs;
+	static uint64_t heap_allocs_at_frame_start;
+
+	friend struct FrameArenaThreadData;
+
+public:
+	// The arena of the calling thread is not reset while a scope is alive. Scopes
+	// nest, the reset happens when the outermost one is entered.
+	struct Scope {
+		Scope();
+		~Scope();
+	};
+
+	static void *alloc(size_t p_bytes);
+	static void *realloc(void *p_ptr, size_t p_bytes);
+	_FORCE_INLINE_ static void free(void *p_ptr) {}
+
+	// Called by the main loop once per frame.
+	static void next_frame();
+
+	static uint64_t get_last_frame_usage() { return last_frame_usage; }
+	static uint64_t get_last_frame_heap_allocs() { return last_frame_heap_allocs; }
+	static uint64_t get_capacity() { return capacity.get(); }
+};
+
 void *operator new(size_t p_size, const char *p_description); ///< operator new that takes a description and uses MemoryStaticPool
 void *operator new(size_t p_size, void *(*p_allocfunc)(size_t p_size)); ///< operator new that takes a description and uses MemoryStaticPool
 
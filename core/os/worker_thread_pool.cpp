@@ -0,0 +1,457 @@
+/*************************************************************************/
+/*  worker_thread_pool.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "worker_thread_pool.h"
+
+#include "core/os/os.h"
+
+#if !defined(NO_THREADS)
+#include <thread>
+#endif
+
+WorkerThreadPool *WorkerThreadPool::singleton = nullptr;
+
+static thread_local WorkerThreadPool *current_pool = nullptr;
+static thread_local uint32_t current_thread_index = 0;
+static thread_local Semaphore wait_semaphore;
+
+// How many times wait() yields without finding a job before it goes to sleep.
+static const int WAIT_SPIN_COUNT = 64;
+
+void WorkerThreadPool::JobQueue::push(const Job &p_job) {
+	lock.lock();
+	jobs.push_back(p_job);
+	lock.unlock();
+}
+
+bool WorkerThreadPool::JobQueue::pop_back(Job &r_job) {
+	lock.lock();
+	if (head == jobs.size()) {
+		lock.unlock();
+		return false;
+	}
+	r_job = jobs[jobs.size() - 1];
+	jobs.resize(jobs.size() - 1);
+	if (head == jobs.size()) {
+		jobs.clear();
+		head = 0;
+	}
+	lock.unlock();
+	return true;
+}
+
+bool WorkerThreadPool::JobQueue::pop_front(Job &r_job) {
+	lock.lock();
+	if (head == jobs.size()) {
+		lock.unlock();
+		return false;
+	}
+	r_job = jobs[head++];
+	if (head == jobs.size()) {
+		jobs.clear();
+		head = 0;
+	}
+	lock.unlock();
+	return true;
+}
+
+void WorkerThreadPool::_thread_func(void *p_user) {
+	ThreadData *td = (ThreadData *)p_user;
+	WorkerThreadPool *pool = td->pool;
+	current_pool = pool;
+	current_thread_index = td->index;
+
+	while (true) {
+		Job job;
+		if (pool->_pop_job(job)) {
+			pool->_execute_job(job);
+			continue;
+		}
+
+		// Announce we are going to sleep before checking the queues one last time,
+		// so a job pushed in between is guaranteed to post the semaphore.
+		pool->sleeping_threads.increment();
+		if (pool->_pop_job(job)) {
+			pool->sleeping_threads.decrement();
+			pool->_execute_job(job);
+			continue;
+		}
+		if (pool->exit_threads.is_set()) {
+			pool->sleeping_threads.decrement();
+			break;
+		}
+		pool->wake_semaphore.wait();
+		pool->sleeping_threads.decrement();
+	}
+}
+
+void WorkerThreadPool::_push_job(const Job &p_job) {
+	if (thread_count == 0) {
+		_execute_job(p_job);
+		return;
+	}
+
+	if (current_pool == this) {
+		queues[current_thread_index].push(p_job);
+	} else {
+		queues[thread_count].push(p_job);
+	}
+
+	// Pairs with the increments in _thread_func() and _wait_for_job(): either the
+	// sleeper sees the job, or this sees the sleeper.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (sleeping_threads.get() > 0) {
+		wake_semaphore.post();
+	}
+	_wake_waiters();
+}
+
+bool WorkerThreadPool::_pop_job(Job &r_job) {
+	uint32_t start = thread_count;
+	if (current_pool == this) {
+		// Own jobs first, most recent first, as their data is likely still in cache.
+		if (queues[current_thread_index].pop_back(r_job)) {
+			return true;
+		}
+		start = current_thread_index;
+	}
+
+	if (queues[thread_count].pop_front(r_job)) {
+		return true;
+	}
+
+	// Steal the oldest job from another worker.
+	for (uint32_t i = 1; i <= thread_count; i++) {
+		uint32_t victim = (start + i) % thread_count;
+		if (current_pool == this && victim == current_thread_index) {
+			continue;
+		}
+		if (queues[victim].pop_front(r_job)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void WorkerThreadPool::_execute_job(const Job &p_job) {
+	p_job.func(p_job.userdata);
+	if (p_job.counter) {
+		_counter_job_done(p_job.counter);
+	}
+}
+
+void WorkerThreadPool::_counter_job_done(Counter *p_counter) {
+	// The counter must not be touched after the lock is released once it reaches zero,
+	// as its owner may destroy it right away. The jobs depending on it are moved out first.
+	LocalVector<Job> released;
+	p_counter->lock.lock();
+	bool done = p_counter->pending.decrement() == 0;
+	if (done && p_counter->dependents.size()) {
+		released = p_counter->dependents;
+		p_counter->dependents.clear();
+	}
+	p_counter->lock.unlock();
+
+	for (uint32_t i = 0; i < released.size(); i++) {
+		_push_job(released[i]);
+	}
+
+	if (done) {
+		_wake_waiters();
+	}
+}
+
+void WorkerThreadPool::_wake_waiters() {
+	if (waiter_count.get() == 0) {
+		return;
+	}
+
+	MutexLock lock(waiters_mutex);
+	for (uint32_t i = 0; i < waiters.size(); i++) {
+		waiters[i]->post();
+	}
+}
+
+bool WorkerThreadPool::_wait_for_job(Counter *p_counter, Job &r_job) {
+	waiters_mutex.lock();
+	waiters.push_back(&wait_semaphore);
+	waiters_mutex.unlock();
+	waiter_count.increment();
+
+	// Anything queued or completed from now on posts the semaphore, check once more before sleeping.
+	bool found = _pop_job(r_job);
+	if (!found && p_counter->pending.get() != 0) {
+		wait_semaphore.wait();
+	}
+
+	waiter_count.decrement();
+	waiters_mutex.lock();
+	waiters.erase(&wait_semaphore);
+	waiters_mutex.unlock();
+
+	// Drop the wakeups posted while leaving, so the next wait doesn't return right away.
+	while (wait_semaphore.try_wait()) {
+		;
+	}
+	return found;
+}
+
+void WorkerThreadPool::push_job(JobFunc p_func, void *p_userdata, Counter *p_counter, Counter *p_depends_on) {
+	ERR_FAIL_NULL(p_func);
+
+	Job job;
+	job.func = p_func;
+	job.userdata = p_userdata;
+	job.counter = p_counter;
+
+	if (p_counter) {
+		p_counter->pending.increment();
+	}
+
+	if (p_depends_on) {
+		p_depends_on->lock.lock();
+		if (p_depends_on->pending.get() != 0) {
+			p_depends_on->dependents.push_back(job);
+			p_depends_on->lock.unlock();
+			return;
+		}
+		p_depends_on->lock.unlock();
+	}
+
+	_push_job(job);
+}
+
+void WorkerThreadPool::wait(Counter *p_counter) {
+	ERR_FAIL_NULL(p_counter);
+
+	int idle = 0;
+	while (p_counter->pending.get() != 0) {
+		Job job;
+		if (_pop_job(job)) {
+			_execute_job(job);
+			idle = 0;
+		} else if (idle < WAIT_SPIN_COUNT) {
+			// Jobs are often short, so the counter may be about to reach zero.
+#if !defined(NO_THREADS)
+			std::this_thread::yield();
+#endif
+			idle++;
+		} else if (_wait_for_job(p_counter, job)) {
+			_execute_job(job);
+			idle = 0;
+		}
+	}
+
+	// Make sure the thread that completed the last job is done with the counter.
+	p_counter->lock.lock();
+	p_counter->lock.unlock();
+}
+
+int WorkerThreadPool::get_thread_index() const {
+	return current_pool == this ? (int)current_thread_index : -1;
+}
+
+void WorkerThreadPool::_script_task_func(void *p_userdata) {
+	ScriptTask *task = (ScriptTask *)p_userdata;
+
+	while (true) {
+		uint32_t index = 0;
+		if (task->elements) {
+			index = task->index.postincrement();
+			if (index >= task->elements) {
+				break;
+			}
+		}
+
+		Object *instance = ObjectDB::get_instance(task->instance);
+		ERR_FAIL_COND_MSG(!instance, vformat("Could not call function '%s' on previously freed instance from a worker thread task.", task->method));
+
+		Variant index_arg = index;
+		const Variant *args[2];
+		int argc = 0;
+		if (task->elements) {
+			args[argc++] = &index_arg;
+		}
+		if (task->userdata.get_type() != Variant::NIL) {
+			args[argc++] = &task->userdata;
+		}
+
+		Variant::CallError ce;
+		instance->call(task->method, args, argc, ce);
+		if (ce.error != Variant::CallError::CALL_OK) {
+			ERR_FAIL_MSG("Could not call function '" + String(task->method) + "' from a worker thread task: " + Variant::get_call_error_text(instance, task->method, args, argc, ce) + ".");
+		}
+
+		if (!task->elements) {
+			break;
+		}
+	}
+}
+
+WorkerThreadPool::TaskID WorkerThreadPool::_add_script_task(ScriptTask *p_task, uint32_t p_jobs) {
+	p_task->counter = memnew(Counter);
+
+	script_task_mutex.lock();
+	TaskID id = ++last_script_task_id;
+	script_tasks[id] = p_task;
+	script_task_mutex.unlock();
+
+	for (uint32_t i = 0; i < p_jobs; i++) {
+		push_job(&_script_task_func, p_task, p_task->counter);
+	}
+
+	return id;
+}
+
+WorkerThreadPool::TaskID WorkerThreadPool::add_task(Object *p_instance, const StringName &p_method, const Variant &p_userdata) {
+	ERR_FAIL_NULL_V(p_instance, -1);
+	ERR_FAIL_COND_V(p_method == StringName(), -1);
+
+	ScriptTask *task = memnew(ScriptTask);
+	task->instance = p_instance->get_instance_id();
+	task->method = p_method;
+	task->userdata = p_userdata;
+
+	return _add_script_task(task, 1);
+}
+
+WorkerThreadPool::TaskID WorkerThreadPool::add_group_task(Object *p_instance, const StringName &p_method, int p_elements, const Variant &p_userdata) {
+	ERR_FAIL_NULL_V(p_instance, -1);
+	ERR_FAIL_COND_V(p_method == StringName(), -1);
+	ERR_FAIL_COND_V(p_elements <= 0, -1);
+
+	ScriptTask *task = memnew(ScriptTask);
+	task->instance = p_instance->get_instance_id();
+	task->method = p_method;
+	task->userdata = p_userdata;
+	task->elements = p_elements;
+
+	return _add_script_task(task, MIN((uint32_t)p_elements, MAX(thread_count, 1u)));
+}
+
+bool WorkerThreadPool::is_task_completed(TaskID p_task_id) {
+	MutexLock lock(script_task_mutex);
+	Map<TaskID, ScriptTask *>::Element *E = script_tasks.find(p_task_id);
+	ERR_FAIL_COND_V_MSG(!E, false, "Invalid task ID: " + itos(p_task_id) + ".");
+	return E->get()->counter->is_done();
+}
+
+void WorkerThreadPool::wait_for_task_completion(TaskID p_task_id) {
+	script_task_mutex.lock();
+	Map<TaskID, ScriptTask *>::Element *E = script_tasks.find(p_task_id);
+	if (!E) {
+		script_task_mutex.unlock();
+		ERR_FAIL_MSG("Invalid task ID: " + itos(p_task_id) + ".");
+	}
+	ScriptTask *task = E->get();
+	script_tasks.erase(E);
+	script_task_mutex.unlock();
+
+	wait(task->counter);
+	memdelete(task->counter);
+	memdelete(task);
+}
+
+void WorkerThreadPool::init(int p_thread_count) {
+	ERR_FAIL_COND_MSG(queues, "WorkerThreadPool was already initialized.");
+
+#if !defined(NO_THREADS)
+	if (p_thread_count < 0) {
+		// Leave one core to the thread that submits the work, as it takes part in processing.
+		p_thread_count = MAX(1, OS::get_singleton()->get_processor_count() - 1);
+	}
+#else
+	p_thread_count = 0;
+#endif
+
+	thread_count = p_thread_count;
+	queues = memnew_arr(JobQueue, thread_count + 1);
+	exit_threads.clear();
+
+	if (thread_count) {
+		threads = memnew_arr(ThreadData, thread_count);
+		for (uint32_t i = 0; i < thread_count; i++) {
+			threads[i].pool = this;
+			threads[i].index = i;
+			threads[i].thread.start(&WorkerThreadPool::_thread_func, &threads[i]);
+		}
+	}
+
+	print_verbose("WorkerThreadPool: Started " + itos(thread_count) + " worker threads.");
+}
+
+void WorkerThreadPool::finish() {
+	if (!queues) {
+		return;
+	}
+
+	exit_threads.set();
+	for (uint32_t i = 0; i < thread_count; i++) {
+		wake_semaphore.post();
+	}
+	for (uint32_t i = 0; i < thread_count; i++) {
+		threads[i].thread.wait_to_finish();
+	}
+
+	// Workers only exit once the queues are empty, so every job has run by now.
+	// Release the script tasks nobody waited for.
+	for (Map<TaskID, ScriptTask *>::Element *E = script_tasks.front(); E; E = E->next()) {
+		memdelete(E->get()->counter);
+		memdelete(E->get());
+	}
+	script_tasks.clear();
+
+	if (threads) {
+		memdelete_arr(threads);
+		threads = nullptr;
+	}
+	memdelete_arr(queues);
+	queues = nullptr;
+	thread_count = 0;
+}
+
+void WorkerThreadPool::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_task", "instance", "method", "userdata"), &WorkerThreadPool::add_task, DEFVAL(Variant()));
+	ClassDB::bind_method(D_METHOD("add_group_task", "instance", "method", "elements", "userdata"), &WorkerThreadPool::add_group_task, DEFVAL(Variant()));
+	ClassDB::bind_method(D_METHOD("is_task_completed", "task_id"), &WorkerThreadPool::is_task_completed);
+	ClassDB::bind_method(D_METHOD("wait_for_task_completion", "task_id"), &WorkerThreadPool::wait_for_task_completion);
+	ClassDB::bind_method(D_METHOD("get_thread_count"), &WorkerThreadPool::get_thread_count);
+}
+
+WorkerThreadPool::WorkerThreadPool() {
+	singleton = this;
+}
+
+WorkerThreadPool::~WorkerThreadPool() {
+	finish();
+	singleton = nullptr;
+}
@@ -0,0 +1,212 @@
+/*************************************************************************/
+/*  worker_thread_pool.h                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef WORKER_THREAD_POOL_H
+#define WORKER_THREAD_POOL_H
+
+#include "core/local_vector.h"
+#include "core/map.h"
+#include "core/object.h"
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/spin_lock.h"
+#include "core/os/thread.h"
+#include "core/safe_refcount.h"
+
+// Persistent pool of worker threads shared by the whole engine.
+// Every worker owns a deque of jobs: it pushes and pops its own jobs from the back,
+// while idle workers steal from the front of other deques. Jobs submitted from
+// threads outside the pool go into a shared queue.
+// Completion is tracked with counters, which can also be used as dependencies:
+// a job that depends on a counter is only queued once that counter reaches zero.
+// Waiting on a counter never blocks the pool, as the waiting thread runs pending jobs meanwhile.
+class WorkerThreadPool : public Object {
+	GDCLASS(WorkerThreadPool, Object);
+
+public:
+	typedef void (*JobFunc)(void *p_userdata);
+	typedef int64_t TaskID;
+
+	class Counter;
+
+private:
+	struct Job {
+		JobFunc func = nullptr;
+		void *userdata = nullptr;
+		Counter *counter = nullptr;
+	};
+
+	struct JobQueue {
+		SpinLock lock;
+		LocalVector<Job> jobs;
+		uint32_t head = 0;
+
+		void push(const Job &p_job);
+		bool pop_back(Job &r_job);
+		bool pop_front(Job &r_job);
+	};
+
+	struct ThreadData {
+		WorkerThreadPool *pool = nullptr;
+		uint32_t index = 0;
+		Thread thread;
+	};
+
+	struct ScriptTask {
+		ObjectID instance;
+		StringName method;
+		Variant userdata;
+		uint32_t elements = 0; // Zero for single tasks, otherwise the amount of group elements.
+		SafeNumeric<uint32_t> index;
+		Counter *counter = nullptr;
+	};
+
+	static WorkerThreadPool *singleton;
+
+	ThreadData *threads = nullptr;
+	uint32_t thread_count = 0;
+	// One queue per worker, plus a shared one (the last) for external threads.
+	JobQueue *queues = nullptr;
+
+	Semaphore wake_semaphore;
+	SafeNumeric<uint32_t> sleeping_threads;
+	SafeFlag exit_threads;
+
+	// Threads that found nothing to run in wait() and went to sleep. Each has its
+	// own semaphore, posted whenever a job is queued or a counter reaches zero.
+	Mutex waiters_mutex;
+	LocalVector<Semaphore *> waiters;
+	SafeNumeric<uint32_t> waiter_count;
+
+	Mutex script_task_mutex;
+	Map<TaskID, ScriptTask *> script_tasks;
+	TaskID last_script_task_id = 0;
+
+	static void _thread_func(void *p_user);
+
+	void _push_job(const Job &p_job);
+	bool _pop_job(Job &r_job);
+	void _execute_job(const Job &p_job);
+	void _counter_job_done(Counter *p_counter);
+	void _wake_waiters();
+	bool _wait_for_job(Counter *p_counter, Job &r_job);
+
+	static void _script_task_func(void *p_userdata);
+	TaskID _add_script_task(ScriptTask *p_task, uint32_t p_jobs);
+
+	template <class C, class M, class U>
+	struct ParallelForData {
+		C *instance;
+		M method;
+		U userdata;
+		uint32_t elements;
+		SafeNumeric<uint32_t> index;
+
+		static void process(void *p_data) {
+			ParallelForData *data = (ParallelForData *)p_data;
+			while (true) {
+				uint32_t i = data->index.postincrement();
+				if (i >= data->elements) {
+					break;
+				}
+				(data->instance->*data->method)(i, data->userdata);
+			}
+		}
+	};
+
+protected:
+	static void _bind_methods();
+
+public:
+	class Counter {
+		friend class WorkerThreadPool;
+
+		SafeNumeric<uint32_t> pending;
+		SpinLock lock;
+		LocalVector<Job> dependents;
+
+	public:
+		_FORCE_INLINE_ bool is_done() const { return pending.get() == 0; }
+	};
+
+	_FORCE_INLINE_ static WorkerThreadPool *get_singleton() { return singleton; }
+
+	// Queues a job. If p_counter is set, it is incremented now and decremented once the job has run.
+	// If p_depends_on is set, the job is held back until that counter reaches zero.
+	void push_job(JobFunc p_func, void *p_userdata, Counter *p_counter = nullptr, Counter *p_depends_on = nullptr);
+	// Blocks until p_counter reaches zero, running queued jobs from the calling thread meanwhile.
+	// Once there is nothing left to run, it sleeps instead of spinning.
+	void wait(Counter *p_counter);
+
+	// Calls (p_instance->*p_method)(index, p_userdata) for every index in [0, p_elements), spread over
+	// at most p_max_jobs jobs (zero or negative uses all the workers) and returns once all have completed.
+	// The calling thread takes part in the processing.
+	template <class C, class M, class U>
+	void parallel_for(uint32_t p_elements, C *p_instance, M p_method, U p_userdata, int p_max_jobs = 0) {
+		if (p_elements == 0) {
+			return;
+		}
+
+		ParallelForData<C, M, U> data;
+		data.instance = p_instance;
+		data.method = p_method;
+		data.userdata = p_userdata;
+		data.elements = p_elements;
+		data.index.set(0);
+
+		uint32_t jobs = p_max_jobs > 0 ? MIN((uint32_t)p_max_jobs, thread_count + 1) : thread_count + 1;
+		jobs = MIN(jobs, p_elements);
+
+		Counter counter;
+		for (uint32_t i = 1; i < jobs; i++) {
+			push_job(&ParallelForData<C, M, U>::process, &data, &counter);
+		}
+		ParallelForData<C, M, U>::process(&data);
+		wait(&counter);
+	}
+
+	uint32_t get_thread_count() const { return thread_count; }
+	// Returns the index of the calling worker thread, or -1 if it does not belong to the pool.
+	int get_thread_index() const;
+
+	// Script API.
+	TaskID add_task(Object *p_instance, const StringName &p_method, const Variant &p_userdata = Variant());
+	TaskID add_group_task(Object *p_instance, const StringName &p_method, int p_elements, const Variant &p_userdata = Variant());
+	bool is_task_completed(TaskID p_task_id);
+	void wait_for_task_completion(TaskID p_task_id);
+
+	void init(int p_thread_count = -1);
+	void finish();
+
+	WorkerThreadPool();
+	~WorkerThreadPool();
+};
+
+#endif // WORKER_THREAD_POOL_H
@@ -63,6 +63,7 @@ public:
 
 			page_pool[pages_used] = (T *)memalloc(sizeof(T) * page_size);
 			available_pool[pages_used] = (T **)memalloc(sizeof(T *) * page_size);
+			Memory::paged_usage.add((sizeof(T) + sizeof(T *)) * page_size);
 
 			for (uint32_t i = 0; i < page_size; i++) {
 				available_pool[0][i] = &page_pool[pages_used][i];
@@ -85,10 +86,10 @@ public:
 		}
 		p_mem->~T();
 		available_pool[allocs_available >> page_shift][allocs_available & page_mask] = p_mem;
+		allocs_available++;
 		if (thread_safe) {
 			spin_lock.unlock();
 		}
-		allocs_available++;
 	}
 
 	void reset(bool p_allow_unfreed = false) {
@@ -102,6 +103,7 @@ public:
 			}
 			memfree(page_pool);
 			memfree(available_pool);
+			Memory::paged_usage.sub((sizeof(T) + sizeof(T *)) * page_size * pages_allocated);
 			page_pool = nullptr;
 			available_pool = nullptr;
 			pages_allocated = 0;
@@ -30,7 +30,57 @@
 
 #include "pool_vector.h"
 
-Mutex pool_vector_lock;
+SafeNumeric<uint32_t> MemoryPool::allocs_used;
+SafeNumeric<uint64_t> MemoryPool::total_memory;
+SafeNumeric<uint64_t> MemoryPool::max_memory;
+
+static _FORCE_INLINE_ void _account_resize(size_t p_old_size, size_t p_new_size) {
+#ifdef DEBUG_ENABLED
+	if (p_new_size > p_old_size) {
+		MemoryPool::max_memory.exchange_if_greater(MemoryPool::total_memory.add(p_new_size - p_old_size));
+	} else {
+		MemoryPool::total_memory.sub(p_old_size - p_new_size);
+	}
+#endif
+}
+
+#ifdef POOL_VECTOR_COW_ENABLED
+
+MemoryPool::Alloc *MemoryPool::alloc_create() {
+	Alloc *alloc = (Alloc *)memalloc(ALLOC_HEADER_SIZE);
+	ERR_FAIL_COND_V(!alloc, nullptr);
+	memnew_placement(alloc, Alloc);
+	alloc->refcount.init();
+	allocs_used.increment();
+	return alloc;
+}
+
+MemoryPool::Alloc *MemoryPool::alloc_resize(Alloc *p_alloc, size_t p_size) {
+	_account_resize(p_alloc->size, p_size);
+
+	Alloc *alloc = (Alloc *)memrealloc(p_alloc, ALLOC_HEADER_SIZE + p_size);
+	CRASH_COND_MSG(!alloc, "Out of memory");
+	alloc->size = p_size;
+	alloc->mem = p_size ? (uint8_t *)alloc + ALLOC_HEADER_SIZE : nullptr;
+	return alloc;
+}
+
+void MemoryPool::alloc_destroy(Alloc *p_alloc) {
+	_account_resize(p_alloc->size, 0);
+
+	p_alloc->~Alloc();
+	memfree(p_alloc);
+	allocs_used.decrement();
+}
+
+void MemoryPool::setup(uint32_t p_max_allocs) {
+}
+
+void MemoryPool::cleanup() {
+	ERR_FAIL_COND_MSG(allocs_used.get() > 0, "There are still MemoryPool allocs in use at exit!");
+}
+
+#else
 
 PoolAllocator *MemoryPool::memory_pool = nullptr;
 uint8_t *MemoryPool::pool_memory = nullptr;
@@ -39,16 +89,63 @@ size_t *MemoryPool::pool_size = nullptr;
 MemoryPool::Alloc *MemoryPool::allocs = nullptr;
 MemoryPool::Alloc *MemoryPool::free_list = nullptr;
 uint32_t MemoryPool::alloc_count = 0;
-uint32_t MemoryPool::allocs_used = 0;
 Mutex MemoryPool::alloc_mutex;
 
-size_t MemoryPool::total_memory = 0;
-size_t MemoryPool::max_memory = 0;
+MemoryPool::Alloc *MemoryPool::alloc_create() {
+	alloc_mutex.lock();
+	if (allocs_used.get() == alloc_count) {
+		alloc_mutex.unlock();
+		return nullptr;
+	}
+
+	//take one from the free list
+	Alloc *alloc = free_list;
+	free_list = alloc->free_list;
+	//increment the used counter
+	allocs_used.increment();
+
+	//cleanup the alloc
+	alloc->size = 0;
+	alloc->mem = nullptr;
+	alloc->refcount.init();
+	alloc->pool_id = POOL_ALLOCATOR_INVALID_ID;
+	alloc->lock.set(0);
+	alloc_mutex.unlock();
+
+	return alloc;
+}
+
+MemoryPool::Alloc *MemoryPool::alloc_resize(Alloc *p_alloc, size_t p_size) {
+	_account_resize(p_alloc->size, p_size);
+
+	if (p_size == 0) {
+		if (p_alloc->mem) {
+			memfree(p_alloc->mem);
+		}
+		p_alloc->mem = nullptr;
+	} else if (p_alloc->mem) {
+		p_alloc->mem = memrealloc(p_alloc->mem, p_size);
+	} else {
+		p_alloc->mem = memalloc(p_size);
+	}
+	p_alloc->size = p_size;
+	return p_alloc;
+}
+
+void MemoryPool::alloc_destroy(Alloc *p_alloc) {
+	alloc_resize(p_alloc, 0);
+
+	alloc_mutex.lock();
+	p_alloc->free_list = free_list;
+	free_list = p_alloc;
+	allocs_used.decrement();
+	alloc_mutex.unlock();
+}
 
 void MemoryPool::setup(uint32_t p_max_allocs) {
 	allocs = memnew_arr(Alloc, p_max_allocs);
 	alloc_count = p_max_allocs;
-	allocs_used = 0;
+	allocs_used.set(0);
 
 	for (uint32_t i = 0; i < alloc_count - 1; i++) {
 		allocs[i].free_list = &allocs[i + 1];
@@ -60,5 +157,7 @@ void MemoryPool::setup(uint32_t p_max_allocs) {
 void MemoryPool::cleanup() {
 	memdelete_arr(allocs);
 
-	ERR_FAIL_COND_MSG(allocs_used > 0, "There are still MemoryPool allocs in use at exit!");
+	ERR_FAIL_COND_MSG(allocs_used.get() > 0, "There are still MemoryPool allocs in use at exit!");
 }
+
+#endif
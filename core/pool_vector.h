@@ -38,38 +38,62 @@
 #include "core/safe_refcount.h"
 #include "core/ustring.h"
 
+// With POOL_VECTOR_COW_ENABLED, every array is a single heap block holding its header
+// and elements, like CowData, instead of an entry of the global allocation table
+// guarded by a mutex. Read and Write access is counted in both modes, resizing would
+// move the block under a live Read or Write.
+
 struct MemoryPool {
 	//avoid accessing these directly, must be public for template access
 
-	static PoolAllocator *memory_pool;
-	static uint8_t *pool_memory;
-	static size_t *pool_size;
-
 	struct Alloc {
 		SafeRefCount refcount;
 		SafeNumeric<uint32_t> lock;
 		void *mem;
-		PoolAllocator::ID pool_id;
 		size_t size;
+#ifndef POOL_VECTOR_COW_ENABLED
+		PoolAllocator::ID pool_id;
 
 		Alloc *free_list;
+#endif
 
 		Alloc() :
 				lock(0),
 				mem(nullptr),
+				size(0)
+#ifndef POOL_VECTOR_COW_ENABLED
+				,
 				pool_id(POOL_ALLOCATOR_INVALID_ID),
-				size(0),
-				free_list(nullptr) {
+				free_list(nullptr)
+#endif
+		{
 		}
 	};
 
+#ifdef POOL_VECTOR_COW_ENABLED
+	enum {
+		ALLOC_HEADER_SIZE = (sizeof(Alloc) + 15) & ~15
+	};
+#else
+	static PoolAllocator *memory_pool;
+	static uint8_t *pool_memory;
+	static size_t *pool_size;
+
 	static Alloc *allocs;
 	static Alloc *free_list;
 	static uint32_t alloc_count;
-	static uint32_t allocs_used;
 	static Mutex alloc_mutex;
-	static size_t total_memory;
-	static size_t max_memory;
+#endif
+
+	static SafeNumeric<uint32_t> allocs_used;
+	static SafeNumeric<uint64_t> total_memory;
+	static SafeNumeric<uint64_t> max_memory;
+
+	// Returns an empty alloc with a reference, or null if none is left.
+	static Alloc *alloc_create();
+	// Resizes the memory of an unshared alloc, elements are moved bitwise. The alloc may move.
+	static Alloc *alloc_resize(Alloc *p_alloc, size_t p_size);
+	static void alloc_destroy(Alloc *p_alloc);
 
 	static void setup(uint32_t p_max_allocs = (1 << 16));
 	static void cleanup();
@@ -93,49 +117,16 @@ class PoolVector {
 
 		//must allocate something
 
-		MemoryPool::alloc_mutex.lock();
-		if (MemoryPool::allocs_used == MemoryPool::alloc_count) {
-			MemoryPool::alloc_mutex.unlock();
-			ERR_FAIL_MSG("All memory pool allocations are in use, can't COW.");
-		}
+		MemoryPool::Alloc *new_alloc = MemoryPool::alloc_create();
+		ERR_FAIL_COND_MSG(!new_alloc, "All memory pool allocations are in use, can't COW.");
 
 		MemoryPool::Alloc *old_alloc = alloc;
-
-		//take one from the free list
-		alloc = MemoryPool::free_list;
-		MemoryPool::free_list = alloc->free_list;
-		//increment the used counter
-		MemoryPool::allocs_used++;
-
-		//copy the alloc data
-		alloc->size = old_alloc->size;
-		alloc->refcount.init();
-		alloc->pool_id = POOL_ALLOCATOR_INVALID_ID;
-		alloc->lock.set(0);
-
-#ifdef DEBUG_ENABLED
-		MemoryPool::total_memory += alloc->size;
-		if (MemoryPool::total_memory > MemoryPool::max_memory) {
-			MemoryPool::max_memory = MemoryPool::total_memory;
-		}
-#endif
-
-		MemoryPool::alloc_mutex.unlock();
-
-		if (MemoryPool::memory_pool) {
-		} else {
-			alloc->mem = memalloc(alloc->size);
-		}
+		alloc = MemoryPool::alloc_resize(new_alloc, old_alloc->size);
 
 		{
-			Write w;
-			w._ref(alloc);
-			Read r;
-			r._ref(old_alloc);
-
 			int cur_elements = alloc->size / sizeof(T);
-			T *dst = (T *)w.ptr();
-			const T *src = (const T *)r.ptr();
+			T *dst = (T *)alloc->mem;
+			const T *src = (const T *)old_alloc->mem;
 			for (int i = 0; i < cur_elements; i++) {
 				memnew_placement(&dst[i], T(src[i]));
 			}
@@ -144,38 +135,13 @@ class PoolVector {
 		if (old_alloc->refcount.unref()) {
 			//this should never happen but..
 
-#ifdef DEBUG_ENABLED
-			MemoryPool::alloc_mutex.lock();
-			MemoryPool::total_memory -= old_alloc->size;
-			MemoryPool::alloc_mutex.unlock();
-#endif
-
-			{
-				Write w;
-				w._ref(old_alloc);
-
-				int cur_elements = old_alloc->size / sizeof(T);
-				T *elems = (T *)w.ptr();
-				for (int i = 0; i < cur_elements; i++) {
-					elems[i].~T();
-				}
+			int cur_elements = old_alloc->size / sizeof(T);
+			T *elems = (T *)old_alloc->mem;
+			for (int i = 0; i < cur_elements; i++) {
+				elems[i].~T();
 			}
 
-			if (MemoryPool::memory_pool) {
-				//resize memory pool
-				//if none, create
-				//if some resize
-			} else {
-				memfree(old_alloc->mem);
-				old_alloc->mem = nullptr;
-				old_alloc->size = 0;
-
-				MemoryPool::alloc_mutex.lock();
-				old_alloc->free_list = MemoryPool::free_list;
-				MemoryPool::free_list = old_alloc;
-				MemoryPool::allocs_used--;
-				MemoryPool::alloc_mutex.unlock();
-			}
+			MemoryPool::alloc_destroy(old_alloc);
 		}
 	}
 
@@ -208,41 +174,17 @@ class PoolVector {
 		//must be disposed!
 
 		{
-			int cur_elements = alloc->size / sizeof(T);
-
 			// Don't use write() here because it could otherwise provoke COW,
 			// which is not desirable here because we are destroying the last reference anyways
-			Write w;
-			// Reference to still prevent other threads from touching the alloc
-			w._ref(alloc);
+			int cur_elements = alloc->size / sizeof(T);
+			T *elems = (T *)alloc->mem;
 
 			for (int i = 0; i < cur_elements; i++) {
-				w[i].~T();
+				elems[i].~T();
 			}
 		}
 
-#ifdef DEBUG_ENABLED
-		MemoryPool::alloc_mutex.lock();
-		MemoryPool::total_memory -= alloc->size;
-		MemoryPool::alloc_mutex.unlock();
-#endif
-
-		if (MemoryPool::memory_pool) {
-			//resize memory pool
-			//if none, create
-			//if some resize
-		} else {
-			memfree(alloc->mem);
-			alloc->mem = nullptr;
-			alloc->size = 0;
-
-			MemoryPool::alloc_mutex.lock();
-			alloc->free_list = MemoryPool::free_list;
-			MemoryPool::free_list = alloc;
-			MemoryPool::allocs_used--;
-			MemoryPool::alloc_mutex.unlock();
-		}
-
+		MemoryPool::alloc_destroy(alloc);
 		alloc = nullptr;
 	}
 
@@ -257,24 +199,14 @@ public:
 		_FORCE_INLINE_ void _ref(MemoryPool::Alloc *p_alloc) {
 			alloc = p_alloc;
 			if (alloc) {
-				if (alloc->lock.increment() == 1) {
-					if (MemoryPool::memory_pool) {
-						//lock it and get mem
-					}
-				}
-
+				alloc->lock.increment();
 				mem = (T *)alloc->mem;
 			}
 		}
 
 		_FORCE_INLINE_ void _unref() {
 			if (alloc) {
-				if (alloc->lock.decrement() == 0) {
-					if (MemoryPool::memory_pool) {
-						//put mem back
-					}
-				}
-
+				alloc->lock.decrement();
 				mem = nullptr;
 				alloc = nullptr;
 			}
@@ -286,7 +218,7 @@ public:
 		}
 
 	public:
-		virtual ~Access() {
+		~Access() {
 			_unref();
 		}
 
@@ -506,23 +438,8 @@ Error PoolVector<T>::resize(int p_size) {
 		}
 
 		//must allocate something
-		MemoryPool::alloc_mutex.lock();
-		if (MemoryPool::allocs_used == MemoryPool::alloc_count) {
-			MemoryPool::alloc_mutex.unlock();
-			ERR_FAIL_V_MSG(ERR_OUT_OF_MEMORY, "All memory pool allocations are in use.");
-		}
-
-		//take one from the free list
-		alloc = MemoryPool::free_list;
-		MemoryPool::free_list = alloc->free_list;
-		//increment the used counter
-		MemoryPool::allocs_used++;
-
-		//cleanup the alloc
-		alloc->size = 0;
-		alloc->refcount.init();
-		alloc->pool_id = POOL_ALLOCATOR_INVALID_ID;
-		MemoryPool::alloc_mutex.unlock();
+		alloc = MemoryPool::alloc_create();
+		ERR_FAIL_COND_V_MSG(!alloc, ERR_OUT_OF_MEMORY, "All memory pool allocations are in use.");
 
 	} else {
 		ERR_FAIL_COND_V_MSG(alloc->lock.get() > 0, ERR_LOCKED, "Can't resize PoolVector if locked."); //can't resize if locked!
@@ -540,69 +457,25 @@ Error PoolVector<T>::resize(int p_size) {
 	}
 
 	_copy_on_write(); // make it unique
-
-#ifdef DEBUG_ENABLED
-	MemoryPool::alloc_mutex.lock();
-	MemoryPool::total_memory -= alloc->size;
-	MemoryPool::total_memory += new_size;
-	if (MemoryPool::total_memory > MemoryPool::max_memory) {
-		MemoryPool::max_memory = MemoryPool::total_memory;
-	}
-	MemoryPool::alloc_mutex.unlock();
-#endif
+	ERR_FAIL_COND_V(alloc->refcount.get() > 1, ERR_OUT_OF_MEMORY);
 
 	int cur_elements = alloc->size / sizeof(T);
 
 	if (p_size > cur_elements) {
-		if (MemoryPool::memory_pool) {
-			//resize memory pool
-			//if none, create
-			//if some resize
-		} else {
-			if (alloc->size == 0) {
-				alloc->mem = memalloc(new_size);
-			} else {
-				alloc->mem = memrealloc(alloc->mem, new_size);
-			}
-		}
-
-		alloc->size = new_size;
-
-		Write w = write();
+		alloc = MemoryPool::alloc_resize(alloc, new_size);
 
+		T *elems = (T *)alloc->mem;
 		for (int i = cur_elements; i < p_size; i++) {
-			memnew_placement(&w[i], T);
+			memnew_placement(&elems[i], T);
 		}
 
 	} else {
-		{
-			Write w = write();
-			for (int i = p_size; i < cur_elements; i++) {
-				w[i].~T();
-			}
+		T *elems = (T *)alloc->mem;
+		for (int i = p_size; i < cur_elements; i++) {
+			elems[i].~T();
 		}
 
-		if (MemoryPool::memory_pool) {
-			//resize memory pool
-			//if none, create
-			//if some resize
-		} else {
-			if (new_size == 0) {
-				memfree(alloc->mem);
-				alloc->mem = nullptr;
-				alloc->size = 0;
-
-				MemoryPool::alloc_mutex.lock();
-				alloc->free_list = MemoryPool::free_list;
-				MemoryPool::free_list = alloc;
-				MemoryPool::allocs_used--;
-				MemoryPool::alloc_mutex.unlock();
-
-			} else {
-				alloc->mem = memrealloc(alloc->mem, new_size);
-				alloc->size = new_size;
-			}
-		}
+		alloc = MemoryPool::alloc_resize(alloc, new_size);
 	}
 
 	return OK;
@@ -31,82 +31,272 @@
 #include "string_name.h"
 
 #include "core/os/os.h"
+#include "core/os/rw_lock.h"
 #include "core/print_string.h"
 
+#include <string.h>
+
 StaticCString StaticCString::create(const char *p_ptr) {
 	StaticCString scs;
 	scs.ptr = p_ptr;
 	return scs;
 }
 
-StringName::_Data *StringName::_table[STRING_TABLE_LEN];
+// The table is split in shards, each with its own lock and its own set of buckets,
+// so threads creating different names rarely contend. Lookups of existing names
+// only take the read lock of their shard. Shards get a cache line each, so locking
+// one doesn't slow down threads using its neighbors.
+struct alignas(64) StringName::_Shard {
+	RWLock lock;
+	_Data **buckets = nullptr;
+	uint32_t mask = 0;
+	uint32_t count = 0;
+	uint32_t used_buckets = 0;
+#ifdef DEBUG_ENABLED
+	// every lookup writes these, too costly for release builds
+	SafeNumeric<uint64_t> hits;
+	SafeNumeric<uint64_t> misses;
+#endif
+};
+
+StringName::_Shard StringName::_table[STRING_TABLE_SHARDS];
 
 StringName _scs_create(const char *p_chr) {
 	return (p_chr[0] ? StringName(StaticCString::create(p_chr)) : StringName());
 }
 
 bool StringName::configured = false;
-Mutex StringName::lock;
+
+static _FORCE_INLINE_ bool _name_equals(const char *p_cname, const String &p_name, const char *p_other) {
+	return p_cname ? strcmp(p_cname, p_other) == 0 : p_name == p_other;
+}
+
+static _FORCE_INLINE_ bool _name_equals(const char *p_cname, const String &p_name, const CharType *p_other) {
+	return p_cname ? String(p_cname) == p_other : p_name == p_other;
+}
+
+static _FORCE_INLINE_ bool _name_equals(const char *p_cname, const String &p_name, const String &p_other) {
+	return p_cname ? p_other == p_cname : p_name == p_other;
+}
+
+StringName::_Shard &StringName::_get_shard(uint32_t p_hash) {
+	// The low bits of the hash pick the bucket, so mix all of them into the shard index.
+	return _table[(p_hash * 0x9E3779B1) >> (32 - STRING_TABLE_SHARD_BITS)];
+}
 
 void StringName::setup() {
 	ERR_FAIL_COND(configured);
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
-		_table[i] = nullptr;
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+		_Shard &shard = _table[i];
+		shard.buckets = (_Data **)memalloc(sizeof(_Data *) * STRING_TABLE_SHARD_MIN_BUCKETS);
+		memset(shard.buckets, 0, sizeof(_Data *) * STRING_TABLE_SHARD_MIN_BUCKETS);
+		shard.mask = STRING_TABLE_SHARD_MIN_BUCKETS - 1;
+		shard.count = 0;
+		shard.used_buckets = 0;
 	}
 	configured = true;
 }
 
 void StringName::cleanup() {
-	lock.lock();
-
 	int lost_strings = 0;
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
-		while (_table[i]) {
-			_Data *d = _table[i];
-			lost_strings++;
-			if (OS::get_singleton()->is_stdout_verbose()) {
-				if (d->cname) {
-					print_line("Orphan StringName: " + String(d->cname));
-				} else {
-					print_line("Orphan StringName: " + String(d->name));
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+		_Shard &shard = _table[i];
+		shard.lock.write_lock();
+
+		for (uint32_t j = 0; j <= shard.mask; j++) {
+			while (shard.buckets[j]) {
+				_Data *d = shard.buckets[j];
+				lost_strings++;
+				if (OS::get_singleton()->is_stdout_verbose()) {
+					if (d->cname) {
+						print_line("Orphan StringName: " + String(d->cname));
+					} else {
+						print_line("Orphan StringName: " + String(d->name));
+					}
 				}
-			}
 
-			_table[i] = _table[i]->next;
-			memdelete(d);
+				shard.buckets[j] = d->next;
+				memdelete(d);
+			}
 		}
+
+		memfree(shard.buckets);
+		shard.buckets = nullptr;
+		shard.mask = 0;
+		shard.count = 0;
+		shard.used_buckets = 0;
+
+		shard.lock.write_unlock();
 	}
 	if (lost_strings) {
 		print_verbose("StringName: " + itos(lost_strings) + " unclaimed string names at exit.");
 	}
-	lock.unlock();
+	configured = false;
 }
 
 void StringName::unref() {
-	ERR_FAIL_COND(!configured);
+	if (!configured) {
+		// Orphans are freed together with the table, nothing left to release.
+		_data = nullptr;
+		return;
+	}
 
 	if (_data && _data->refcount.unref()) {
-		lock.lock();
+		_Shard &shard = _get_shard(_data->hash);
+		shard.lock.write_lock();
 
+		uint32_t idx = _data->hash & shard.mask;
 		if (_data->prev) {
 			_data->prev->next = _data->next;
 		} else {
-			if (_table[_data->idx] != _data) {
+			if (shard.buckets[idx] != _data) {
 				ERR_PRINT("BUG!");
 			}
-			_table[_data->idx] = _data->next;
+			shard.buckets[idx] = _data->next;
+			if (!_data->next) {
+				shard.used_buckets--;
+			}
 		}
 
 		if (_data->next) {
 			_data->next->prev = _data->prev;
 		}
+		shard.count--;
 		memdelete(_data);
-		lock.unlock();
+
+		shard.lock.write_unlock();
 	}
 
 	_data = nullptr;
 }
 
+template <class T>
+StringName::_Data *StringName::_find_and_ref(_Shard &p_shard, const T &p_name, uint32_t p_hash) {
+	_Data *d = p_shard.buckets[p_hash & p_shard.mask];
+
+	while (d) {
+		// Compare hash first. A name whose last reference is being released can still be
+		// in the table, so keep looking if it can't be referenced anymore.
+		if (d->hash == p_hash && _name_equals(d->cname, d->name, p_name) && d->refcount.ref()) {
+			return d;
+		}
+		d = d->next;
+	}
+
+	return nullptr;
+}
+
+void StringName::_insert(_Shard &p_shard, _Data *p_data) {
+	if (p_shard.count > p_shard.mask) {
+		// Keep chains short by doubling the buckets of this shard.
+		uint32_t new_size = (p_shard.mask + 1) * 2;
+		_Data **new_buckets = (_Data **)memalloc(sizeof(_Data *) * new_size);
+		memset(new_buckets, 0, sizeof(_Data *) * new_size);
+		p_shard.used_buckets = 0;
+
+		for (uint32_t i = 0; i <= p_shard.mask; i++) {
+			_Data *d = p_shard.buckets[i];
+			while (d) {
+				_Data *next = d->next;
+				uint32_t idx = d->hash & (new_size - 1);
+				d->prev = nullptr;
+				d->next = new_buckets[idx];
+				if (d->next) {
+					d->next->prev = d;
+				} else {
+					p_shard.used_buckets++;
+				}
+				new_buckets[idx] = d;
+				d = next;
+			}
+		}
+
+		memfree(p_shard.buckets);
+		p_shard.buckets = new_buckets;
+		p_shard.mask = new_size - 1;
+	}
+
+	uint32_t idx = p_data->hash & p_shard.mask;
+	p_data->prev = nullptr;
+	p_data->next = p_shard.buckets[idx];
+	if (p_data->next) {
+		p_data->next->prev = p_data;
+	} else {
+		p_shard.used_buckets++;
+	}
+	p_shard.buckets[idx] = p_data;
+	p_shard.count++;
+}
+
+template <class T>
+StringName::_Data *StringName::_lookup(const T &p_name, uint32_t p_hash, const char *p_static_cname, bool p_create) {
+	_Shard &shard = _get_shard(p_hash);
+
+	shard.lock.read_lock();
+	_Data *d = _find_and_ref(shard, p_name, p_hash);
+	shard.lock.read_unlock();
+
+	if (d || !p_create) {
+#ifdef DEBUG_ENABLED
+		if (d) {
+			shard.hits.increment();
+		} else {
+			shard.misses.increment();
+		}
+#endif
+		return d;
+	}
+
+	shard.lock.write_lock();
+
+	// Another thread may have added it while the lock was released.
+	d = _find_and_ref(shard, p_name, p_hash);
+	if (d) {
+		shard.lock.write_unlock();
+#ifdef DEBUG_ENABLED
+		shard.hits.increment();
+#endif
+		return d;
+	}
+
+	d = memnew(_Data);
+	d->refcount.init();
+	d->hash = p_hash;
+	if (p_static_cname) {
+		d->cname = p_static_cname;
+	} else {
+		d->name = p_name;
+	}
+	_insert(shard, d);
+
+	shard.lock.write_unlock();
+#ifdef DEBUG_ENABLED
+	shard.misses.increment();
+#endif
+	return d;
+}
+
+StringName::TableStats StringName::get_table_stats() {
+	TableStats stats;
+	if (!configured) {
+		return stats;
+	}
+
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+		_Shard &shard = _table[i];
+		shard.lock.read_lock();
+		stats.names += shard.count;
+		stats.buckets += shard.mask + 1;
+		stats.collisions += shard.count - shard.used_buckets;
+		shard.lock.read_unlock();
+#ifdef DEBUG_ENABLED
+		stats.hits += shard.hits.get();
+		stats.misses += shard.misses.get();
+#endif
+	}
+	return stats;
+}
+
 bool StringName::operator==(const String &p_name) const {
 	if (!_data) {
 		return (p_name.length() == 0);
@@ -164,44 +354,7 @@ StringName::StringName(const char *p_name) {
 		return; //empty, ignore
 	}
 
-	lock.lock();
-
-	uint32_t hash = String::hash(p_name);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			lock.unlock();
-			return;
-		}
-	}
-
-	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
-
-	lock.unlock();
+	_data = _lookup(p_name, String::hash(p_name), nullptr, true);
 }
 
 StringName::StringName(const StaticCString &p_static_string) {
@@ -211,44 +364,7 @@ StringName::StringName(const StaticCString &p_static_string) {
 
 	ERR_FAIL_COND(!p_static_string.ptr || !p_static_string.ptr[0]);
 
-	lock.lock();
-
-	uint32_t hash = String::hash(p_static_string.ptr);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_static_string.ptr) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			lock.unlock();
-			return;
-		}
-	}
-
-	_data = memnew(_Data);
-
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = p_static_string.ptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
-
-	lock.unlock();
+	_data = _lookup(p_static_string.ptr, String::hash(p_static_string.ptr), p_static_string.ptr, true);
 }
 
 StringName::StringName(const String &p_name) {
@@ -260,43 +376,7 @@ StringName::StringName(const String &p_name) {
 		return;
 	}
 
-	lock.lock();
-
-	uint32_t hash = p_name.hash();
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_data = _table[idx];
-
-	while (_data) {
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data) {
-		if (_data->refcount.ref()) {
-			// exists
-			lock.unlock();
-			return;
-		}
-	}
-
-	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
-
-	lock.unlock();
+	_data = _lookup(p_name, p_name.hash(), nullptr, true);
 }
 
 StringName StringName::search(const char *p_name) {
@@ -307,30 +387,8 @@ StringName StringName::search(const char *p_name) {
 		return StringName();
 	}
 
-	lock.lock();
-
-	uint32_t hash = String::hash(p_name);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		lock.unlock();
-
-		return StringName(_data);
-	}
-
-	lock.unlock();
-	return StringName(); //does not exist
+	_Data *d = _lookup(p_name, String::hash(p_name), nullptr, false);
+	return d ? StringName(d) : StringName(); //does not exist if null
 }
 
 StringName StringName::search(const CharType *p_name) {
@@ -341,56 +399,15 @@ StringName StringName::search(const CharType *p_name) {
 		return StringName();
 	}
 
-	lock.lock();
-
-	uint32_t hash = String::hash(p_name);
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		lock.unlock();
-		return StringName(_data);
-	}
-
-	lock.unlock();
-	return StringName(); //does not exist
+	_Data *d = _lookup(p_name, String::hash(p_name), nullptr, false);
+	return d ? StringName(d) : StringName(); //does not exist if null
 }
+
 StringName StringName::search(const String &p_name) {
 	ERR_FAIL_COND_V(p_name == "", StringName());
 
-	lock.lock();
-
-	uint32_t hash = p_name.hash();
-
-	uint32_t idx = hash & STRING_TABLE_MASK;
-
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && p_name == _data->get_name()) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		lock.unlock();
-		return StringName(_data);
-	}
-
-	lock.unlock();
-	return StringName(); //does not exist
+	_Data *d = _lookup(p_name, p_name.hash(), nullptr, false);
+	return d ? StringName(d) : StringName(); //does not exist if null
 }
 
 StringName::StringName() {
@@ -43,9 +43,9 @@ struct StaticCString {
 class StringName {
 	enum {
 
-		STRING_TABLE_BITS = 12,
-		STRING_TABLE_LEN = 1 << STRING_TABLE_BITS,
-		STRING_TABLE_MASK = STRING_TABLE_LEN - 1
+		STRING_TABLE_SHARD_BITS = 6,
+		STRING_TABLE_SHARDS = 1 << STRING_TABLE_SHARD_BITS,
+		STRING_TABLE_SHARD_MIN_BUCKETS = 64,
 	};
 
 	struct _Data {
@@ -54,19 +54,18 @@ class StringName {
 		String name;
 
 		String get_name() const { return cname ? String(cname) : name; }
-		int idx;
 		uint32_t hash;
 		_Data *prev;
 		_Data *next;
 		_Data() {
 			cname = nullptr;
 			next = prev = nullptr;
-			idx = 0;
 			hash = 0;
 		}
 	};
 
-	static _Data *_table[STRING_TABLE_LEN];
+	struct _Shard;
+	static _Shard _table[STRING_TABLE_SHARDS];
 
 	_Data *_data;
 
@@ -79,7 +78,13 @@ class StringName {
 	friend void register_core_types();
 	friend void unregister_core_types();
 
-	static Mutex lock;
+	static _Shard &_get_shard(uint32_t p_hash);
+	template <class T>
+	static _Data *_find_and_ref(_Shard &p_shard, const T &p_name, uint32_t p_hash);
+	template <class T>
+	static _Data *_lookup(const T &p_name, uint32_t p_hash, const char *p_static_cname, bool p_create);
+	static void _insert(_Shard &p_shard, _Data *p_data);
+
 	static void setup();
 	static void cleanup();
 	static bool configured;
@@ -128,6 +133,16 @@ public:
 	static StringName search(const CharType *p_name);
 	static StringName search(const String &p_name);
 
+	struct TableStats {
+		uint32_t names = 0;
+		uint32_t buckets = 0;
+		uint32_t collisions = 0; // Names that share their bucket with a previous one.
+		uint64_t hits = 0; // Only counted in debug builds.
+		uint64_t misses = 0;
+	};
+
+	static TableStats get_table_stats();
+
 	struct AlphCompare {
 		_FORCE_INLINE_ bool operator()(const StringName &l, const StringName &r) const {
 			const char *l_cname = l._data ? l._data->cname : "";
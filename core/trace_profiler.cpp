@@ -0,0 +1,248 @@
+/*************************************************************************/
+/*  core/trace_profiler.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "trace_profiler.h"
+
+#include "core/os/file_access.h"
+#include "core/os/memory.h"
+#include "core/os/thread.h"
+
+struct TraceProfiler::Chunk {
+	Event events[EVENTS_PER_CHUNK];
+	Chunk *next = nullptr;
+};
+
+// Only the owning thread writes to its buffer. Events are published by storing the new
+// count, so the buffer can be read from another thread up to the count it observes.
+// The buffer lives as long as its thread, freeing it is left to cleanup() once the
+// thread is gone, so a thread never sees its buffer disappear.
+struct TraceProfiler::ThreadBuffer {
+	int tid = 0;
+	String thread_name;
+	Chunk *first = nullptr;
+	Chunk *last = nullptr;
+	SafeNumeric<uint32_t> event_count;
+	SafeNumeric<uint64_t> dropped;
+	// Set by the owning thread while it is inside record(), clear() waits for it.
+	SafeNumeric<uint32_t> writing;
+	bool thread_alive = true; // guarded by thread_buffers_mutex
+	ThreadBuffer *next = nullptr;
+
+	void free_chunks() {
+		while (first) {
+			Chunk *next_chunk = first->next;
+			memdelete(first);
+			first = next_chunk;
+		}
+		last = nullptr;
+		event_count.set(0);
+		dropped.set(0);
+	}
+};
+
+struct TraceProfiler::ThreadBufferOwner {
+	ThreadBuffer *buffer = nullptr;
+
+	~ThreadBufferOwner() {
+		if (buffer) {
+			// keep the events around until they are saved or cleaned up
+			MutexLock lock(thread_buffers_mutex);
+			buffer->thread_alive = false;
+		}
+	}
+};
+
+SafeFlag TraceProfiler::capturing;
+SafeNumeric<uint32_t> TraceProfiler::max_events_per_thread(1 << 20);
+TraceProfiler::ThreadBuffer *TraceProfiler::thread_buffers = nullptr;
+Mutex TraceProfiler::thread_buffers_mutex;
+thread_local TraceProfiler::ThreadBufferOwner TraceProfiler::thread_buffer_owner;
+
+TraceProfiler::ThreadBuffer *TraceProfiler::_create_thread_buffer() {
+	ThreadBuffer *buffer = memnew(ThreadBuffer);
+
+	MutexLock lock(thread_buffers_mutex);
+	buffer->tid = thread_buffers ? thread_buffers->tid + 1 : 1;
+	buffer->thread_name = Thread::get_caller_id() == Thread::get_main_id() ? String("Main Thread") : "Thread " + itos(buffer->tid);
+	buffer->next = thread_buffers;
+	thread_buffers = buffer;
+	return buffer;
+}
+
+void TraceProfiler::_wait_for_writer(ThreadBuffer *p_buffer) {
+	// Pairs with the fence in record(): either the writer sees the capture stopped,
+	// or we see it writing. Writes are a handful of stores, so just spin.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while (p_buffer->writing.get() > 0) {
+	}
+}
+
+void TraceProfiler::begin_capture() {
+	capturing.set();
+}
+
+void TraceProfiler::end_capture() {
+	capturing.clear();
+}
+
+void TraceProfiler::clear() {
+	ERR_FAIL_COND_MSG(is_capturing(), "Can't clear the trace profiler while capturing.");
+
+	MutexLock lock(thread_buffers_mutex);
+	for (ThreadBuffer *buffer = thread_buffers; buffer; buffer = buffer->next) {
+		_wait_for_writer(buffer);
+		buffer->free_chunks();
+	}
+}
+
+uint64_t TraceProfiler::get_event_count() {
+	MutexLock lock(thread_buffers_mutex);
+	uint64_t count = 0;
+	for (ThreadBuffer *buffer = thread_buffers; buffer; buffer = buffer->next) {
+		count += buffer->event_count.get();
+	}
+	return count;
+}
+
+uint64_t TraceProfiler::get_dropped_event_count() {
+	MutexLock lock(thread_buffers_mutex);
+	uint64_t count = 0;
+	for (ThreadBuffer *buffer = thread_buffers; buffer; buffer = buffer->next) {
+		count += buffer->dropped.get();
+	}
+	return count;
+}
+
+void TraceProfiler::record(const char *p_category, const char *p_name, uint64_t p_start, uint64_t p_end, const String &p_detail) {
+	ThreadBuffer *buffer = thread_buffer_owner.buffer;
+	if (unlikely(!buffer)) {
+		buffer = _create_thread_buffer();
+		thread_buffer_owner.buffer = buffer;
+	}
+
+	buffer->writing.increment();
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// The scope started while capturing, but clear() may have started since.
+	if (unlikely(!capturing.is_set())) {
+		buffer->writing.decrement();
+		return;
+	}
+
+	const uint32_t count = buffer->event_count.get();
+	if (unlikely(count >= max_events_per_thread.get())) {
+		buffer->dropped.increment();
+		buffer->writing.decrement();
+		return;
+	}
+
+	const uint32_t index = count % EVENTS_PER_CHUNK;
+	if (index == 0) {
+		Chunk *chunk = memnew(Chunk);
+		if (buffer->last) {
+			buffer->last->next = chunk;
+		} else {
+			buffer->first = chunk;
+		}
+		buffer->last = chunk;
+	}
+
+	Event &event = buffer->last->events[index];
+	event.category = p_category;
+	event.name = p_name;
+	event.detail = p_detail;
+	event.start = p_start;
+	event.duration = p_end - p_start;
+	buffer->event_count.set(count + 1);
+
+	buffer->writing.decrement();
+}
+
+Error TraceProfiler::save_chrome_trace(const String &p_path) {
+	Error err;
+	FileAccess *f = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(!f, err, "Can't open trace file for writing: " + p_path + ".");
+
+	f->store_string("{\"traceEvents\":[\n");
+	bool first_event = true;
+	char line[512];
+
+	MutexLock lock(thread_buffers_mutex);
+	for (ThreadBuffer *buffer = thread_buffers; buffer; buffer = buffer->next) {
+		snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first_event ? "" : ",\n", buffer->tid, buffer->thread_name.utf8().get_data());
+		f->store_buffer((const uint8_t *)line, strlen(line));
+		first_event = false;
+
+		const uint32_t count = buffer->event_count.get();
+		const Chunk *chunk = buffer->first;
+		for (uint32_t i = 0; i < count; i++) {
+			if (i > 0 && i % EVENTS_PER_CHUNK == 0) {
+				chunk = chunk->next;
+			}
+			const Event &event = chunk->events[i % EVENTS_PER_CHUNK];
+			int len = snprintf(line, sizeof(line), ",\n{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%d", event.category, event.name, (unsigned long long)event.start, (unsigned long long)event.duration, buffer->tid);
+			f->store_buffer((const uint8_t *)line, len);
+			if (!event.detail.empty()) {
+				f->store_string(",\"args\":{\"detail\":\"" + event.detail.json_escape() + "\"}");
+			}
+			f->store_8('}');
+		}
+
+		if (buffer->dropped.get() > 0) {
+			WARN_PRINT(vformat("%s dropped %d trace events after reaching the limit of %d events.", buffer->thread_name, buffer->dropped.get(), max_events_per_thread.get()));
+		}
+	}
+
+	f->store_string("\n],\"displayTimeUnit\":\"ms\"}\n");
+	f->close();
+	memdelete(f);
+	return OK;
+}
+
+void TraceProfiler::cleanup() {
+	end_capture();
+
+	MutexLock lock(thread_buffers_mutex);
+	ThreadBuffer **prev_next = &thread_buffers;
+	while (*prev_next) {
+		ThreadBuffer *buffer = *prev_next;
+		_wait_for_writer(buffer);
+		buffer->free_chunks();
+
+		// buffers of other running threads stay, their thread still points to them
+		if (buffer->thread_alive && buffer != thread_buffer_owner.buffer) {
+			prev_next = &buffer->next;
+		} else {
+			*prev_next = buffer->next;
+			memdelete(buffer);
+		}
+	}
+	thread_buffer_owner.buffer = nullptr;
+}
@@ -0,0 +1,135 @@
+/*************************************************************************/
+/*  core/trace_profiler.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef TRACE_PROFILER_H
+#define TRACE_PROFILER_H
+
+#include "core/os/mutex.h"
+#include "core/os/os.h"
+#include "core/safe_refcount.h"
+#include "core/ustring.h"
+
+// Records timed scopes of engine hot paths while a capture is running, and writes them
+// as a Chrome trace (JSON, also readable by Perfetto). Each thread records into its own
+// buffer, so recording never takes a lock. When no capture is running, a scope costs
+// a single flag check.
+class TraceProfiler {
+public:
+	struct Event {
+		const char *category;
+		const char *name;
+		String detail;
+		uint64_t start;
+		uint64_t duration;
+	};
+
+private:
+	enum {
+		EVENTS_PER_CHUNK = 4096,
+	};
+
+	struct Chunk;
+	struct ThreadBuffer;
+	struct ThreadBufferOwner;
+
+	static SafeFlag capturing;
+	static SafeNumeric<uint32_t> max_events_per_thread;
+	static ThreadBuffer *thread_buffers;
+	static Mutex thread_buffers_mutex;
+	static thread_local ThreadBufferOwner thread_buffer_owner;
+
+	static ThreadBuffer *_create_thread_buffer();
+	static void _wait_for_writer(ThreadBuffer *p_buffer);
+
+public:
+	_FORCE_INLINE_ static bool is_capturing() { return capturing.is_set(); }
+
+	static void begin_capture();
+	static void end_capture();
+	// Drops everything recorded so far. Other threads may still be inside record(),
+	// this waits for them.
+	static void clear();
+
+	// Threads stop recording once their buffer holds this many events, dropped events are counted.
+	static void set_max_events_per_thread(uint32_t p_max_events) { max_events_per_thread.set(p_max_events); }
+	static uint32_t get_max_events_per_thread() { return max_events_per_thread.get(); }
+	static uint64_t get_event_count();
+	static uint64_t get_dropped_event_count();
+
+	static void record(const char *p_category, const char *p_name, uint64_t p_start, uint64_t p_end, const String &p_detail = String());
+	static Error save_chrome_trace(const String &p_path);
+
+	static void cleanup();
+};
+
+class TraceProfilerScope {
+	const char *category;
+	const char *name;
+	String detail;
+	uint64_t start;
+
+public:
+	_FORCE_INLINE_ TraceProfilerScope(const char *p_category, const char *p_name) {
+		if (unlikely(TraceProfiler::is_capturing())) {
+			category = p_category;
+			name = p_name;
+			start = OS::get_singleton()->get_ticks_usec();
+		} else {
+			name = nullptr;
+		}
+	}
+
+	_FORCE_INLINE_ TraceProfilerScope(const char *p_category, const char *p_name, const String &p_detail) {
+		if (unlikely(TraceProfiler::is_capturing())) {
+			category = p_category;
+			name = p_name;
+			detail = p_detail;
+			start = OS::get_singleton()->get_ticks_usec();
+		} else {
+			name = nullptr;
+		}
+	}
+
+	_FORCE_INLINE_ ~TraceProfilerScope() {
+		if (unlikely(name != nullptr)) {
+			TraceProfiler::record(category, name, start, OS::get_singleton()->get_ticks_usec(), detail);
+		}
+	}
+};
+
+#define _TRACE_SCOPE_VAR_2(m_line) _trace_scope_##m_line
+#define _TRACE_SCOPE_VAR(m_line) _TRACE_SCOPE_VAR_2(m_line)
+
+// Times the rest of the enclosing block. Category and name must be string literals.
+#define TRACE_SCOPE(m_category, m_name) TraceProfilerScope _TRACE_SCOPE_VAR(__LINE__)(m_category, m_name)
+// Same, with a string (like a resource path) attached to the event. The detail is only evaluated while capturing.
+#define TRACE_SCOPE_DETAIL(m_category, m_name, m_detail) TraceProfilerScope _TRACE_SCOPE_VAR(__LINE__)(m_category, m_name, TraceProfiler::is_capturing() ? String(m_detail) : String())
+
+#endif // TRACE_PROFILER_H
@@ -140,6 +140,7 @@ public:
 		AABB aabb;
 		Vector<PoolVector<uint8_t>> blend_shapes;
 		Vector<AABB> bone_aabbs;
+		Vector<VS::SurfaceLOD> lods;
 	};
 
 	struct DummyMesh : public RID_Data {
@@ -411,6 +412,21 @@ public:
 		return m->surfaces[p_surface].bone_aabbs;
 	}
 
+	void mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<VS::SurfaceLOD> &p_lods) {
+		DummyMesh *m = mesh_owner.getornull(p_mesh);
+		ERR_FAIL_COND(!m);
+		ERR_FAIL_INDEX(p_surface, m->surfaces.size());
+
+		m->surfaces.write[p_surface].lods = p_lods;
+	}
+	Vector<VS::SurfaceLOD> mesh_surface_get_lods(RID p_mesh, int p_surface) const {
+		DummyMesh *m = mesh_owner.getornull(p_mesh);
+		ERR_FAIL_COND_V(!m, Vector<VS::SurfaceLOD>());
+		ERR_FAIL_INDEX_V(p_surface, m->surfaces.size(), Vector<VS::SurfaceLOD>());
+
+		return m->surfaces[p_surface].lods;
+	}
+
 	void mesh_remove_surface(RID p_mesh, int p_index) {
 		DummyMesh *m = mesh_owner.getornull(p_mesh);
 		ERR_FAIL_COND(!m);
@@ -1624,8 +1624,10 @@ void RasterizerSceneGLES2::_render_geometry(RenderList::Element *p_element) {
 			// drawing
 
 			if (s->index_array_len > 0) {
-				glDrawElements(gl_primitive[s->primitive], s->index_array_len, (s->array_len >= (1 << 16)) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, nullptr);
-				storage->info.render.vertices_count += s->index_array_len;
+				const RasterizerStorageGLES2::Surface::LOD *lod = s->find_lod(p_element->instance->lod_max_error);
+				int index_count = lod ? lod->index_count : s->index_array_len;
+				glDrawElements(gl_primitive[s->primitive], index_count, (s->array_len >= (1 << 16)) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, lod ? CAST_INT_TO_UCHAR_PTR(lod->index_offset) : nullptr);
+				storage->info.render.vertices_count += index_count;
 			} else {
 				glDrawArrays(gl_primitive[s->primitive], 0, s->array_len);
 				storage->info.render.vertices_count += s->array_len;
@@ -2752,6 +2752,64 @@ Vector<AABB> RasterizerStorageGLES2::mesh_surface_get_skeleton_aabb(RID p_mesh,
 	return mesh->surfaces[p_surface]->skeleton_bone_aabb;
 }
 
+void RasterizerStorageGLES2::mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<VS::SurfaceLOD> &p_lods) {
+	Mesh *mesh = mesh_owner.getornull(p_mesh);
+	ERR_FAIL_COND(!mesh);
+	ERR_FAIL_INDEX(p_surface, mesh->surfaces.size());
+
+	Surface *surface = mesh->surfaces[p_surface];
+	ERR_FAIL_COND_MSG(!surface->index_id, "Only surfaces with an index array can have LODs.");
+
+	int index_size = surface->array_len >= (1 << 16) ? 4 : 2;
+	int lods_byte_size = 0;
+	for (int i = 0; i < p_lods.size(); i++) {
+		ERR_FAIL_COND(p_lods[i].index_array.size() != p_lods[i].index_count * index_size);
+		lods_byte_size += p_lods[i].index_array.size();
+	}
+
+	int old_lods_byte_size = 0;
+	for (int i = 0; i < surface->lod_data.size(); i++) {
+		old_lods_byte_size += surface->lod_data[i].index_array.size();
+	}
+
+	surface->lod_data = p_lods;
+	surface->lods.clear();
+
+	// the LODs are appended to the surface indices, drawing one only changes the range
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surface->index_id);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, surface->index_array_byte_size + lods_byte_size, nullptr, GL_STATIC_DRAW);
+	{
+		PoolVector<uint8_t>::Read ir = surface->index_data.read();
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, surface->index_array_byte_size, ir.ptr());
+	}
+
+	int offset = surface->index_array_byte_size;
+	for (int i = 0; i < p_lods.size(); i++) {
+		PoolVector<uint8_t>::Read ir = p_lods[i].index_array.read();
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, p_lods[i].index_array.size(), ir.ptr());
+
+		Surface::LOD lod;
+		lod.error = p_lods[i].error;
+		lod.index_count = p_lods[i].index_count;
+		lod.index_offset = offset;
+		surface->lods.push_back(lod);
+
+		offset += p_lods[i].index_array.size();
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	surface->total_data_size += lods_byte_size - old_lods_byte_size;
+	info.vertex_mem += lods_byte_size - old_lods_byte_size;
+}
+
+Vector<VS::SurfaceLOD> RasterizerStorageGLES2::mesh_surface_get_lods(RID p_mesh, int p_surface) const {
+	const Mesh *mesh = mesh_owner.getornull(p_mesh);
+	ERR_FAIL_COND_V(!mesh, Vector<VS::SurfaceLOD>());
+	ERR_FAIL_INDEX_V(p_surface, mesh->surfaces.size(), Vector<VS::SurfaceLOD>());
+
+	return mesh->surfaces[p_surface]->lod_data;
+}
+
 void RasterizerStorageGLES2::mesh_remove_surface(RID p_mesh, int p_surface) {
 	Mesh *mesh = mesh_owner.getornull(p_mesh);
 	ERR_FAIL_COND(!mesh);
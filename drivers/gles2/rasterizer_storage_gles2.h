@@ -658,6 +658,28 @@ public:
 		PoolVector<uint8_t> data;
 		PoolVector<uint8_t> index_data;
 
+		// LOD indices live in index_id after the surface's own ones
+		struct LOD {
+			float error;
+			int index_count;
+			int index_offset;
+		};
+
+		Vector<LOD> lods;
+		Vector<VS::SurfaceLOD> lod_data;
+
+		// the most simplified LOD within p_max_error, or nullptr for full detail
+		_FORCE_INLINE_ const LOD *find_lod(float p_max_error) const {
+			const LOD *lod = nullptr;
+			for (int i = 0; i < lods.size(); i++) {
+				if (lods[i].error > p_max_error) {
+					break;
+				}
+				lod = &lods[i];
+			}
+			return lod;
+		}
+
 		Vector<PoolVector<uint8_t>> blend_shape_data;
 
 		GLuint blend_shape_buffer_id;
@@ -747,6 +769,9 @@ public:
 	virtual Vector<PoolVector<uint8_t>> mesh_surface_get_blend_shapes(RID p_mesh, int p_surface) const;
 	virtual Vector<AABB> mesh_surface_get_skeleton_aabb(RID p_mesh, int p_surface) const;
 
+	virtual void mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<VS::SurfaceLOD> &p_lods);
+	virtual Vector<VS::SurfaceLOD> mesh_surface_get_lods(RID p_mesh, int p_surface) const;
+
 	virtual void mesh_remove_surface(RID p_mesh, int p_surface);
 	virtual int mesh_get_surface_count(RID p_mesh) const;
 
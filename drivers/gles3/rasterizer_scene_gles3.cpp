@@ -1470,10 +1470,12 @@ void RasterizerSceneGLES3::_render_geometry(RenderList::Element *e) {
 			} else
 #endif
 					if (s->index_array_len > 0) {
+				const RasterizerStorageGLES3::Surface::LOD *lod = s->find_lod(e->instance->lod_max_error);
+				int index_count = lod ? lod->index_count : s->index_array_len;
 
-				glDrawElements(gl_primitive[s->primitive], s->index_array_len, (s->array_len >= (1 << 16)) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, nullptr);
+				glDrawElements(gl_primitive[s->primitive], index_count, (s->array_len >= (1 << 16)) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, lod ? CAST_INT_TO_UCHAR_PTR(lod->index_offset) : nullptr);
 
-				storage->info.render.vertices_count += s->index_array_len;
+				storage->info.render.vertices_count += index_count;
 
 			} else {
 				glDrawArrays(gl_primitive[s->primitive], 0, s->array_len);
@@ -1867,6 +1869,118 @@ void RasterizerSceneGLES3::_setup_light(RenderList::Element *e, const Transform
 	}
 }
 
+static _FORCE_INLINE_ bool _rid_lists_equal(const Vector<RID> &p_a, const Vector<RID> &p_b) {
+	if (p_a.size() != p_b.size()) {
+		return false;
+	}
+	for (int i = 0; i < p_a.size(); i++) {
+		if (p_a[i] != p_b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RasterizerSceneGLES3::_can_auto_instance(const RenderList::Element *p_first, const RenderList::Element *p_element, bool p_lighting) const {
+	// everything set up per draw must match, only the transform can differ
+	if (p_element->instance->base_type != VS::INSTANCE_MESH || p_element->geometry != p_first->geometry || p_element->material != p_first->material || p_element->sort_key != p_first->sort_key) {
+		return false;
+	}
+
+	// these see the identity transform the merged draw is made with, or a different instance index
+	const RasterizerStorageGLES3::Shader *shader = p_first->material->shader;
+	if (shader->spatial.uses_world_matrix || shader->spatial.uses_instance_id) {
+		return false;
+	}
+
+	const InstanceBase *first = p_first->instance;
+	const InstanceBase *instance = p_element->instance;
+
+	if (instance->skeleton.is_valid() || instance->layer_mask != first->layer_mask || instance->baked_light != first->baked_light) {
+		return false;
+	}
+
+	const RasterizerStorageGLES3::Surface *s = static_cast<const RasterizerStorageGLES3::Surface *>(p_element->geometry);
+	if (s->blend_shapes.size() && instance->blend_values.size()) {
+		return false;
+	}
+	if (s->find_lod(instance->lod_max_error) != s->find_lod(first->lod_max_error)) {
+		return false;
+	}
+
+	if (p_lighting) {
+		if (instance->lightmap.is_valid() || !instance->lightmap_capture_data.empty()) {
+			return false;
+		}
+		if (!_rid_lists_equal(instance->light_instances, first->light_instances) || !_rid_lists_equal(instance->reflection_probe_instances, first->reflection_probe_instances) || !_rid_lists_equal(instance->gi_probe_instances, first->gi_probe_instances)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RasterizerSceneGLES3::_setup_auto_instancing(RenderList::Element **p_elements, int p_amount) {
+	RasterizerStorageGLES3::Surface *s = static_cast<RasterizerStorageGLES3::Surface *>(p_elements[0]->geometry);
+
+	glBindVertexArray(s->instancing_array_id);
+	glBindBuffer(GL_ARRAY_BUFFER, state.auto_instancing_buffer);
+
+	uint32_t size = p_amount * 12 * sizeof(float);
+	if (state.auto_instancing_buffer_offset + size > state.auto_instancing_buffer_size) {
+		// orphan, draws already issued keep reading the old storage
+		glBufferData(GL_ARRAY_BUFFER, state.auto_instancing_buffer_size, nullptr, GL_DYNAMIC_DRAW);
+		state.auto_instancing_buffer_offset = 0;
+	}
+
+	// same layout as a 3D multimesh transform
+	float *data = state.auto_instancing_tmp;
+	for (int i = 0; i < p_amount; i++) {
+		const Transform &xform = p_elements[i]->instance->transform;
+		for (int j = 0; j < 3; j++) {
+			data[0] = xform.basis.elements[j][0];
+			data[1] = xform.basis.elements[j][1];
+			data[2] = xform.basis.elements[j][2];
+			data[3] = xform.origin[j];
+			data += 4;
+		}
+	}
+
+	uint32_t offset = state.auto_instancing_buffer_offset;
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, state.auto_instancing_tmp);
+	state.auto_instancing_buffer_offset += size;
+
+	int stride = 12 * sizeof(float);
+	for (int i = 0; i < 3; i++) {
+		glEnableVertexAttribArray(8 + i);
+		glVertexAttribPointer(8 + i, 4, GL_FLOAT, GL_FALSE, stride, CAST_INT_TO_UCHAR_PTR(offset + i * 4 * sizeof(float)));
+		glVertexAttribDivisor(8 + i, 1);
+	}
+
+	glDisableVertexAttribArray(11);
+	glVertexAttrib4f(11, 1, 1, 1, 1);
+	glDisableVertexAttribArray(12);
+	glVertexAttrib4f(12, 0, 0, 0, 0);
+}
+
+void RasterizerSceneGLES3::_render_auto_instanced(RenderList::Element *e, int p_amount) {
+	RasterizerStorageGLES3::Surface *s = static_cast<RasterizerStorageGLES3::Surface *>(e->geometry);
+
+	if (s->index_array_len > 0) {
+		const RasterizerStorageGLES3::Surface::LOD *lod = s->find_lod(e->instance->lod_max_error);
+		int index_count = lod ? lod->index_count : s->index_array_len;
+
+		glDrawElementsInstanced(gl_primitive[s->primitive], index_count, (s->array_len >= (1 << 16)) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, lod ? CAST_INT_TO_UCHAR_PTR(lod->index_offset) : nullptr, p_amount);
+
+		storage->info.render.vertices_count += index_count * p_amount;
+
+	} else {
+		glDrawArraysInstanced(gl_primitive[s->primitive], 0, s->array_len, p_amount);
+
+		storage->info.render.vertices_count += s->array_len * p_amount;
+	}
+}
+
 void RasterizerSceneGLES3::_set_cull(bool p_front, bool p_disabled, bool p_reverse_cull) {
 	bool front = p_front;
 	if (p_reverse_cull) {
@@ -2093,7 +2207,18 @@ void RasterizerSceneGLES3::_render_list(RenderList::Element **p_elements, int p_
 			rebind = true;
 		}
 
-		bool use_instancing = e->instance->base_type == VS::INSTANCE_MULTIMESH || e->instance->base_type == VS::INSTANCE_PARTICLES;
+		bool use_lighting = !(e->sort_key & SORT_KEY_UNSHADED_FLAG) && !p_directional_add && !p_shadow;
+
+		// merge following elements that only differ by transform into one instanced draw
+		int auto_instance_count = 1;
+		if (state.use_auto_instancing && state.debug_draw != VS::VIEWPORT_DEBUG_DRAW_WIREFRAME && _can_auto_instance(e, e, use_lighting)) {
+			int max_count = MIN(p_element_count - i, state.auto_instancing_max_amount);
+			while (auto_instance_count < max_count && _can_auto_instance(e, p_elements[i + auto_instance_count], use_lighting)) {
+				auto_instance_count++;
+			}
+		}
+
+		bool use_instancing = e->instance->base_type == VS::INSTANCE_MULTIMESH || e->instance->base_type == VS::INSTANCE_PARTICLES || auto_instance_count > 1;
 
 		if (use_instancing != prev_use_instancing) {
 			state.scene_shader.set_conditional(SceneShaderGLES3::USE_INSTANCING, use_instancing);
@@ -2132,23 +2257,36 @@ void RasterizerSceneGLES3::_render_list(RenderList::Element **p_elements, int p_
 			}
 		}
 
-		if (!(e->sort_key & SORT_KEY_UNSHADED_FLAG) && !p_directional_add && !p_shadow) {
+		if (use_lighting) {
 			_setup_light(e, p_view_transform);
 		}
 
-		if (e->owner != prev_owner || prev_base_type != e->instance->base_type || prev_geometry != e->geometry) {
+		if (auto_instance_count > 1) {
+			_setup_auto_instancing(&p_elements[i], auto_instance_count);
+			storage->info.render.surface_switch_count++;
+		} else if (e->owner != prev_owner || prev_base_type != e->instance->base_type || prev_geometry != e->geometry) {
 			_setup_geometry(e, p_view_transform);
 			storage->info.render.surface_switch_count++;
 		}
 
 		_set_cull(e->sort_key & RenderList::SORT_KEY_MIRROR_FLAG, e->sort_key & RenderList::SORT_KEY_CULL_DISABLED_FLAG, p_reverse_cull);
 
-		state.scene_shader.set_uniform(SceneShaderGLES3::WORLD_TRANSFORM, e->instance->transform);
+		if (auto_instance_count > 1) {
+			state.scene_shader.set_uniform(SceneShaderGLES3::WORLD_TRANSFORM, Transform());
+
+			_render_auto_instanced(e, auto_instance_count);
+
+			storage->info.render.draw_call_count -= auto_instance_count - 1;
+			i += auto_instance_count - 1;
+		} else {
+			state.scene_shader.set_uniform(SceneShaderGLES3::WORLD_TRANSFORM, e->instance->transform);
 
-		_render_geometry(e);
+			_render_geometry(e);
+		}
 
 		prev_material = material;
-		prev_base_type = e->instance->base_type;
+		// the instancing vertex array is left bound, so the next element sets up its geometry again
+		prev_base_type = auto_instance_count > 1 ? VS::INSTANCE_MAX : e->instance->base_type;
 		prev_geometry = e->geometry;
 		prev_owner = e->owner;
 		prev_shading = shading;
@@ -5183,6 +5321,23 @@ void RasterizerSceneGLES3::initialize() {
 		glGenVertexArrays(1, &state.immediate_array);
 	}
 
+	{
+		state.use_auto_instancing = GLOBAL_DEF("rendering/quality/instancing/use_auto_instancing", true);
+
+		uint32_t auto_instancing_buffer_size = GLOBAL_DEF("rendering/limits/buffers/auto_instancing_buffer_size_kb", 256);
+		ProjectSettings::get_singleton()->set_custom_property_info("rendering/limits/buffers/auto_instancing_buffer_size_kb", PropertyInfo(Variant::INT, "rendering/limits/buffers/auto_instancing_buffer_size_kb", PROPERTY_HINT_RANGE, "16,4096,1,or_greater"));
+
+		state.auto_instancing_buffer_size = MAX(auto_instancing_buffer_size, 16u) * 1024;
+		state.auto_instancing_buffer_offset = 0;
+		state.auto_instancing_max_amount = state.auto_instancing_buffer_size / (12 * sizeof(float));
+		state.auto_instancing_tmp = (float *)memalloc(state.auto_instancing_buffer_size);
+
+		glGenBuffers(1, &state.auto_instancing_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, state.auto_instancing_buffer);
+		glBufferData(GL_ARRAY_BUFFER, state.auto_instancing_buffer_size, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
 #ifdef GLES_OVER_GL
 	//"desktop" opengl needs this.
 	glEnable(GL_PROGRAM_POINT_SIZE);
@@ -5293,4 +5448,5 @@ RasterizerSceneGLES3::~RasterizerSceneGLES3() {
 	memfree(state.spot_array_tmp);
 	memfree(state.omni_array_tmp);
 	memfree(state.reflection_array_tmp);
+	memfree(state.auto_instancing_tmp);
 }
@@ -185,6 +185,15 @@ public:
 		GLuint immediate_buffer;
 		GLuint immediate_array;
 
+		// transforms of mesh instances merged into one instanced draw, filled
+		// front to back and orphaned once full
+		bool use_auto_instancing;
+		GLuint auto_instancing_buffer;
+		uint32_t auto_instancing_buffer_size;
+		uint32_t auto_instancing_buffer_offset;
+		int auto_instancing_max_amount;
+		float *auto_instancing_tmp;
+
 		uint32_t ubo_light_size;
 		uint8_t *spot_array_tmp;
 		uint8_t *omni_array_tmp;
@@ -827,6 +836,10 @@ public:
 	_FORCE_INLINE_ void _render_geometry(RenderList::Element *e);
 	void _setup_light(RenderList::Element *e, const Transform &p_view_transform);
 
+	_FORCE_INLINE_ bool _can_auto_instance(const RenderList::Element *p_first, const RenderList::Element *p_element, bool p_lighting) const;
+	void _setup_auto_instancing(RenderList::Element **p_elements, int p_amount);
+	void _render_auto_instanced(RenderList::Element *e, int p_amount);
+
 	void _render_list(RenderList::Element **p_elements, int p_element_count, const Transform &p_view_transform, const CameraMatrix &p_projection, RasterizerStorageGLES3::Sky *p_sky, bool p_reverse_cull, bool p_alpha_pass, bool p_shadow, bool p_directional_add, bool p_directional_shadows);
 
 	_FORCE_INLINE_ void _add_geometry(RasterizerStorageGLES3::Geometry *p_geometry, InstanceBase *p_instance, RasterizerStorageGLES3::GeometryOwner *p_owner, int p_material, bool p_depth_pass, bool p_shadow_pass);
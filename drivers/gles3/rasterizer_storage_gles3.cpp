@@ -2222,6 +2222,8 @@ void RasterizerStorageGLES3::_update_shader(Shader *p_shader) const {
 			p_shader->spatial.uses_ensure_correct_normals = false;
 			p_shader->spatial.writes_modelview_or_projection = false;
 			p_shader->spatial.uses_world_coordinates = false;
+			p_shader->spatial.uses_world_matrix = false;
+			p_shader->spatial.uses_instance_id = false;
 
 			shaders.actions_scene.render_mode_values["blend_add"] = Pair<int *, int>(&p_shader->spatial.blend_mode, Shader::Spatial::BLEND_MODE_ADD);
 			shaders.actions_scene.render_mode_values["blend_mix"] = Pair<int *, int>(&p_shader->spatial.blend_mode, Shader::Spatial::BLEND_MODE_MIX);
@@ -2255,6 +2257,10 @@ void RasterizerStorageGLES3::_update_shader(Shader *p_shader) const {
 			shaders.actions_scene.usage_flag_pointers["DEPTH_TEXTURE"] = &p_shader->spatial.uses_depth_texture;
 			shaders.actions_scene.usage_flag_pointers["TIME"] = &p_shader->spatial.uses_time;
 
+			// Automatic instancing draws with an identity world transform and changes the instance index.
+			shaders.actions_scene.usage_flag_pointers["WORLD_MATRIX"] = &p_shader->spatial.uses_world_matrix;
+			shaders.actions_scene.usage_flag_pointers["INSTANCE_ID"] = &p_shader->spatial.uses_instance_id;
+
 			// Use of any of these BUILTINS indicate the need for transformed tangents.
 			// This is needed to know when to transform tangents in software skinning.
 			shaders.actions_scene.usage_flag_pointers["TANGENT"] = &p_shader->spatial.uses_tangent;
@@ -4046,6 +4052,114 @@ Vector<AABB> RasterizerStorageGLES3::mesh_surface_get_skeleton_aabb(RID p_mesh,
 	return mesh->surfaces[p_surface]->skeleton_bone_aabb;
 }
 
+void RasterizerStorageGLES3::mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<VS::SurfaceLOD> &p_lods) {
+	Mesh *mesh = mesh_owner.getornull(p_mesh);
+	ERR_FAIL_COND(!mesh);
+	ERR_FAIL_INDEX(p_surface, mesh->surfaces.size());
+
+	Surface *surface = mesh->surfaces[p_surface];
+	ERR_FAIL_COND_MSG(!surface->index_id, "Only surfaces with an index array can have LODs.");
+
+	int index_size = surface->array_len >= (1 << 16) ? 4 : 2;
+	int lods_byte_size = 0;
+	for (int i = 0; i < p_lods.size(); i++) {
+		ERR_FAIL_COND(p_lods[i].index_array.size() != p_lods[i].index_count * index_size);
+		lods_byte_size += p_lods[i].index_array.size();
+	}
+
+	int old_lods_byte_size = 0;
+	for (int i = 0; i < surface->lods.size(); i++) {
+		old_lods_byte_size += surface->lods[i].index_count * index_size;
+	}
+
+	// The LODs are appended to the surface indices in one buffer, so the vertex
+	// arrays stay as they are and a LOD only changes the range that is drawn.
+	GLuint index_id;
+	glGenBuffers(1, &index_id);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, index_id);
+	glBufferData(GL_COPY_WRITE_BUFFER, surface->index_array_byte_size + lods_byte_size, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, surface->index_id);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, surface->index_array_byte_size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	surface->lods.clear();
+
+	int offset = surface->index_array_byte_size;
+	for (int i = 0; i < p_lods.size(); i++) {
+		PoolVector<uint8_t>::Read ir = p_lods[i].index_array.read();
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, p_lods[i].index_array.size(), ir.ptr());
+
+		Surface::LOD lod;
+		lod.error = p_lods[i].error;
+		lod.index_count = p_lods[i].index_count;
+		lod.index_offset = offset;
+		surface->lods.push_back(lod);
+
+		offset += p_lods[i].index_array.size();
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glBindVertexArray(surface->array_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_id);
+	glBindVertexArray(surface->instancing_array_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_id);
+	glBindVertexArray(0);
+
+	glDeleteBuffers(1, &surface->index_id);
+	surface->index_id = index_id;
+
+	surface->total_data_size += lods_byte_size - old_lods_byte_size;
+	info.vertex_mem += lods_byte_size - old_lods_byte_size;
+}
+
+Vector<VS::SurfaceLOD> RasterizerStorageGLES3::mesh_surface_get_lods(RID p_mesh, int p_surface) const {
+	const Mesh *mesh = mesh_owner.getornull(p_mesh);
+	ERR_FAIL_COND_V(!mesh, Vector<VS::SurfaceLOD>());
+	ERR_FAIL_INDEX_V(p_surface, mesh->surfaces.size(), Vector<VS::SurfaceLOD>());
+
+	Surface *surface = mesh->surfaces[p_surface];
+	int index_size = surface->array_len >= (1 << 16) ? 4 : 2;
+
+	Vector<VS::SurfaceLOD> lods;
+
+	if (surface->lods.size()) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surface->index_id);
+	}
+
+	for (int i = 0; i < surface->lods.size(); i++) {
+		const Surface::LOD &lod = surface->lods[i];
+		int byte_size = lod.index_count * index_size;
+
+		VS::SurfaceLOD ret;
+		ret.error = lod.error;
+		ret.index_count = lod.index_count;
+		ret.index_array.resize(byte_size);
+
+#if defined(GLES_OVER_GL) || defined(__EMSCRIPTEN__)
+		{
+			PoolVector<uint8_t>::Write w = ret.index_array.write();
+			glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, lod.index_offset, byte_size, w.ptr());
+		}
+#else
+		void *data = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, lod.index_offset, byte_size, GL_MAP_READ_BIT);
+		ERR_FAIL_NULL_V(data, Vector<VS::SurfaceLOD>());
+		{
+			PoolVector<uint8_t>::Write w = ret.index_array.write();
+			memcpy(w.ptr(), data, byte_size);
+		}
+		glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+#endif
+
+		lods.push_back(ret);
+	}
+
+	if (surface->lods.size()) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	return lods;
+}
+
 void RasterizerStorageGLES3::mesh_remove_surface(RID p_mesh, int p_surface) {
 	Mesh *mesh = mesh_owner.getornull(p_mesh);
 	ERR_FAIL_COND(!mesh);
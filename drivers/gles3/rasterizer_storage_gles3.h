@@ -505,6 +505,8 @@ public:
 			bool writes_modelview_or_projection;
 			bool uses_vertex_lighting;
 			bool uses_world_coordinates;
+			bool uses_world_matrix;
+			bool uses_instance_id;
 
 		} spatial;
 
@@ -669,6 +671,27 @@ public:
 		int array_byte_size;
 		int index_array_byte_size;
 
+		// LOD indices live in index_id after the surface's own ones
+		struct LOD {
+			float error;
+			int index_count;
+			int index_offset;
+		};
+
+		Vector<LOD> lods;
+
+		// the most simplified LOD within p_max_error, or nullptr for full detail
+		_FORCE_INLINE_ const LOD *find_lod(float p_max_error) const {
+			const LOD *lod = nullptr;
+			for (int i = 0; i < lods.size(); i++) {
+				if (lods[i].error > p_max_error) {
+					break;
+				}
+				lod = &lods[i];
+			}
+			return lod;
+		}
+
 		VS::PrimitiveType primitive;
 
 		bool active;
@@ -764,6 +787,9 @@ public:
 	virtual Vector<PoolVector<uint8_t>> mesh_surface_get_blend_shapes(RID p_mesh, int p_surface) const;
 	virtual Vector<AABB> mesh_surface_get_skeleton_aabb(RID p_mesh, int p_surface) const;
 
+	virtual void mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<VS::SurfaceLOD> &p_lods);
+	virtual Vector<VS::SurfaceLOD> mesh_surface_get_lods(RID p_mesh, int p_surface) const;
+
 	virtual void mesh_remove_surface(RID p_mesh, int p_surface);
 	virtual int mesh_get_surface_count(RID p_mesh) const;
 
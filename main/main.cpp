@@ -41,10 +41,12 @@
 #include "core/message_queue.h"
 #include "core/os/dir_access.h"
 #include "core/os/os.h"
+#include "core/os/worker_thread_pool.h"
 #include "core/project_settings.h"
 #include "core/register_core_types.h"
 #include "core/script_debugger_local.h"
 #include "core/script_language.h"
+#include "core/trace_profiler.h"
 #include "core/translation.h"
 #include "core/version.h"
 #include "core/version_hash.gen.h"
@@ -100,6 +102,7 @@ static ZipArchive *zip_packed_data = nullptr;
 static FileAccessNetworkClient *file_access_network_client = nullptr;
 static ScriptDebugger *script_debugger = nullptr;
 static MessageQueue *message_queue = nullptr;
+static WorkerThreadPool *worker_thread_pool = nullptr;
 
 // Initialized in setup2()
 static AudioServer *audio_server = nullptr;
@@ -153,6 +156,7 @@ static int frame_delay = 0;
 static bool disable_render_loop = false;
 static int fixed_fps = -1;
 static bool print_fps = false;
+static String profile_trace_path;
 
 /* Helper methods */
 
@@ -305,6 +309,8 @@ void Main::print_help(const char *p_binary) {
 	OS::get_singleton()->print("  --disable-crash-handler          Disable crash handler when supported by the platform code.\n");
 	OS::get_singleton()->print("  --fixed-fps <fps>                Force a fixed number of frames per second. This setting disables real-time synchronization.\n");
 	OS::get_singleton()->print("  --print-fps                      Print the frames per second to the stdout.\n");
+	OS::get_singleton()->print("  --profile-trace <file>           Record timings of the engine main loop, servers and resource loading, and write them to <file> on exit as a Chrome trace (JSON, also readable by Perfetto).\n");
+	OS::get_singleton()->print("  --profile-gdscript <file>        Sample the GDScript call stack while running and write it to <file> on exit as folded stacks (readable by flame graph tools).\n");
 	OS::get_singleton()->print("\n");
 
 	OS::get_singleton()->print("Standalone tools:\n");
@@ -846,6 +852,15 @@ Error Main::setup(const char *execpath, int argc, char *argv[], bool p_second_ph
 			}
 		} else if (I->get() == "--print-fps") {
 			print_fps = true;
+		} else if (I->get() == "--profile-trace") {
+			if (I->next()) {
+				profile_trace_path = I->next()->get();
+				TraceProfiler::begin_capture();
+				N = I->next()->next();
+			} else {
+				OS::get_singleton()->print("Missing profile trace file argument, aborting.\n");
+				goto error;
+			}
 		} else if (I->get() == "--disable-crash-handler") {
 			OS::get_singleton()->disable_crash_handler();
 		} else if (I->get() == "--skip-breakpoints") {
@@ -1224,6 +1239,11 @@ Error Main::setup(const char *execpath, int argc, char *argv[], bool p_second_ph
 
 	Engine::get_singleton()->set_frame_delay(frame_delay);
 
+	GLOBAL_DEF("threading/worker_pool/max_threads", -1);
+	ProjectSettings::get_singleton()->set_custom_property_info("threading/worker_pool/max_threads", PropertyInfo(Variant::INT, "threading/worker_pool/max_threads", PROPERTY_HINT_RANGE, "-1,256,1,or_greater"));
+	worker_thread_pool = memnew(WorkerThreadPool);
+	worker_thread_pool->init(GLOBAL_GET("threading/worker_pool/max_threads"));
+
 	message_queue = memnew(MessageQueue);
 
 	if (p_second_phase) {
@@ -1246,6 +1266,9 @@ error:
 		print_help(execpath);
 	}
 
+	if (worker_thread_pool) {
+		memdelete(worker_thread_pool);
+	}
 	if (performance) {
 		memdelete(performance);
 	}
@@ -1569,6 +1592,8 @@ bool Main::start() {
 				script = args[i + 1];
 			} else if (args[i] == "--test") {
 				test = args[i + 1];
+			} else if (args[i] == "--profile-gdscript") {
+				// Handled by the GDScript module, skip the output path so it isn't taken as a positional argument.
 #ifdef TOOLS_ENABLED
 			} else if (args[i] == "--doctool") {
 				doc_tool_path = args[i + 1];
@@ -2101,11 +2126,16 @@ static uint64_t frame_delta_sync_time = 0;
 #endif
 
 bool Main::iteration() {
+	TRACE_SCOPE("main", "Main::iteration");
+
 	//for now do not error on this
 	//ERR_FAIL_COND_V(iterating, false);
 
 	iterating++;
 
+	// Temporaries from the previous frame can be released.
+	FrameAllocator::next_frame();
+
 	// ticks may become modified later on, and we want to store the raw measured
 	// value for profiling.
 	uint64_t raw_ticks_at_start = OS::get_singleton()->get_ticks_usec();
@@ -2321,6 +2351,14 @@ void Main::cleanup(bool p_force) {
 	// Flush before uninitializing the scene, but delete the MessageQueue as late as possible.
 	message_queue->flush();
 
+	if (profile_trace_path != String()) {
+		TraceProfiler::end_capture();
+		Error err = TraceProfiler::save_chrome_trace(profile_trace_path);
+		if (err == OK) {
+			print_line(vformat("Saved %d trace events to: %s", TraceProfiler::get_event_count(), profile_trace_path));
+		}
+	}
+
 	if (script_debugger) {
 		if (use_debug_profiler) {
 			script_debugger->profiling_end();
@@ -2378,6 +2416,9 @@ void Main::cleanup(bool p_force) {
 	if (file_access_network_client) {
 		memdelete(file_access_network_client);
 	}
+	if (worker_thread_pool) {
+		memdelete(worker_thread_pool);
+	}
 	if (performance) {
 		memdelete(performance);
 	}
@@ -2411,6 +2452,8 @@ void Main::cleanup(bool p_force) {
 		memdelete(visual_server_callbacks);
 	}
 
+	TraceProfiler::cleanup();
+
 	unregister_core_driver_types();
 	unregister_core_types();
 
@@ -75,6 +75,18 @@ void Performance::_bind_methods() {
 	BIND_ENUM_CONSTANT(PHYSICS_3D_COLLISION_PAIRS);
 	BIND_ENUM_CONSTANT(PHYSICS_3D_ISLAND_COUNT);
 	BIND_ENUM_CONSTANT(AUDIO_OUTPUT_LATENCY);
+	BIND_ENUM_CONSTANT(STRING_NAME_COUNT);
+	BIND_ENUM_CONSTANT(STRING_NAME_TABLE_SIZE);
+	BIND_ENUM_CONSTANT(STRING_NAME_COLLISIONS);
+	BIND_ENUM_CONSTANT(STRING_NAME_HITS);
+	BIND_ENUM_CONSTANT(STRING_NAME_MISSES);
+	BIND_ENUM_CONSTANT(MEMORY_FRAME_ARENA_USAGE);
+	BIND_ENUM_CONSTANT(MEMORY_FRAME_ARENA_CAPACITY);
+	BIND_ENUM_CONSTANT(MEMORY_PAGED_ALLOCATOR_USAGE);
+	BIND_ENUM_CONSTANT(MEMORY_ALLOCATIONS_IN_FRAME);
+	BIND_ENUM_CONSTANT(MESSAGE_QUEUE_MESSAGES_IN_FRAME);
+	BIND_ENUM_CONSTANT(MESSAGE_QUEUE_BYTES_IN_FRAME);
+	BIND_ENUM_CONSTANT(MESSAGE_QUEUE_FLUSH_TIME);
 
 	BIND_ENUM_CONSTANT(MONITOR_MAX);
 }
@@ -123,6 +135,18 @@ String Performance::get_monitor_name(Monitor p_monitor) const {
 		"physics_3d/collision_pairs",
 		"physics_3d/islands",
 		"audio/output_latency",
+		"string_name/names",
+		"string_name/table_size",
+		"string_name/collisions",
+		"string_name/hits",
+		"string_name/misses",
+		"memory/frame_arena",
+		"memory/frame_arena_reserved",
+		"memory/paged_allocators",
+		"memory/allocations_in_frame",
+		"message_queue/messages",
+		"message_queue/bytes",
+		"message_queue/flush_time",
 
 	};
 
@@ -140,11 +164,11 @@ float Performance::get_monitor(Monitor p_monitor) const {
 		case MEMORY_STATIC:
 			return Memory::get_mem_usage();
 		case MEMORY_DYNAMIC:
-			return MemoryPool::total_memory;
+			return MemoryPool::total_memory.get();
 		case MEMORY_STATIC_MAX:
 			return Memory::get_mem_max_usage();
 		case MEMORY_DYNAMIC_MAX:
-			return MemoryPool::max_memory;
+			return MemoryPool::max_memory.get();
 		case MEMORY_MESSAGE_BUFFER_MAX:
 			return MessageQueue::get_singleton()->get_max_buffer_usage();
 		case OBJECT_COUNT:
@@ -193,6 +217,30 @@ float Performance::get_monitor(Monitor p_monitor) const {
 			return PhysicsServer::get_singleton()->get_process_info(PhysicsServer::INFO_ISLAND_COUNT);
 		case AUDIO_OUTPUT_LATENCY:
 			return AudioServer::get_singleton()->get_output_latency();
+		case STRING_NAME_COUNT:
+			return StringName::get_table_stats().names;
+		case STRING_NAME_TABLE_SIZE:
+			return StringName::get_table_stats().buckets;
+		case STRING_NAME_COLLISIONS:
+			return StringName::get_table_stats().collisions;
+		case STRING_NAME_HITS:
+			return StringName::get_table_stats().hits;
+		case STRING_NAME_MISSES:
+			return StringName::get_table_stats().misses;
+		case MEMORY_FRAME_ARENA_USAGE:
+			return FrameAllocator::get_last_frame_usage();
+		case MEMORY_FRAME_ARENA_CAPACITY:
+			return FrameAllocator::get_capacity();
+		case MEMORY_PAGED_ALLOCATOR_USAGE:
+			return Memory::get_paged_usage();
+		case MEMORY_ALLOCATIONS_IN_FRAME:
+			return FrameAllocator::get_last_frame_heap_allocs();
+		case MESSAGE_QUEUE_MESSAGES_IN_FRAME:
+			return MessageQueue::get_singleton()->get_messages_in_frame();
+		case MESSAGE_QUEUE_BYTES_IN_FRAME:
+			return MessageQueue::get_singleton()->get_bytes_in_frame();
+		case MESSAGE_QUEUE_FLUSH_TIME:
+			return USEC_TO_SEC(MessageQueue::get_singleton()->get_flush_usec_in_frame());
 
 		default: {
 		}
@@ -237,6 +285,18 @@ Performance::MonitorType Performance::get_monitor_type(Monitor p_monitor) const
 		MONITOR_TYPE_QUANTITY,
 		MONITOR_TYPE_QUANTITY,
 		MONITOR_TYPE_TIME,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_MEMORY,
+		MONITOR_TYPE_MEMORY,
+		MONITOR_TYPE_MEMORY,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_MEMORY,
+		MONITOR_TYPE_TIME,
 
 	};
 
@@ -82,6 +82,18 @@ public:
 		PHYSICS_3D_ISLAND_COUNT,
 		//physics
 		AUDIO_OUTPUT_LATENCY,
+		STRING_NAME_COUNT,
+		STRING_NAME_TABLE_SIZE,
+		STRING_NAME_COLLISIONS,
+		STRING_NAME_HITS,
+		STRING_NAME_MISSES,
+		MEMORY_FRAME_ARENA_USAGE,
+		MEMORY_FRAME_ARENA_CAPACITY,
+		MEMORY_PAGED_ALLOCATOR_USAGE,
+		MEMORY_ALLOCATIONS_IN_FRAME,
+		MESSAGE_QUEUE_MESSAGES_IN_FRAME,
+		MESSAGE_QUEUE_BYTES_IN_FRAME,
+		MESSAGE_QUEUE_FLUSH_TIME,
 		MONITOR_MAX
 	};
 
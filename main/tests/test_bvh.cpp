@@ -0,0 +1,208 @@
+/*************************************************************************/
+/*  test_bvh.cpp                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_bvh.h"
+
+#include "core/math/bvh.h"
+#include "core/math/camera_matrix.h"
+#include "core/math/random_pcg.h"
+#include "core/os/os.h"
+
+namespace TestBVH {
+
+enum {
+	ITEM_COUNT = 20000,
+	QUERY_COUNT = 2000,
+	WORLD_SIZE = 500,
+};
+
+struct Item {
+	int id;
+};
+
+// Same leaf size as the VisualServer scene tree, which is where convex culls
+// spend most of their time.
+typedef BVH_Manager<Item, true, 256> Tree;
+
+enum QueryType {
+	QUERY_CONVEX,
+	QUERY_AABB,
+	QUERY_SEGMENT,
+	QUERY_POINT,
+	QUERY_MAX,
+};
+
+static const char *query_names[QUERY_MAX] = {
+	"convex",
+	"aabb",
+	"segment",
+	"point",
+};
+
+struct Query {
+	Vector<Plane> planes;
+	AABB aabb;
+	Vector3 from;
+	Vector3 to;
+	Vector3 point;
+};
+
+static int run_query(Tree &p_tree, QueryType p_type, const Query &p_query, Item **r_result) {
+	switch (p_type) {
+		case QUERY_CONVEX:
+			return p_tree.cull_convex(p_query.planes, r_result, ITEM_COUNT);
+		case QUERY_AABB:
+			return p_tree.cull_aabb(p_query.aabb, r_result, ITEM_COUNT);
+		case QUERY_SEGMENT:
+			return p_tree.cull_segment(p_query.from, p_query.to, r_result, ITEM_COUNT);
+		case QUERY_POINT:
+			return p_tree.cull_point(p_query.point, r_result, ITEM_COUNT);
+		default:
+			return 0;
+	}
+}
+
+// Runs every query with the given leaf test and returns the time taken, along
+// with a checksum of the results so the two leaf tests can be compared.
+static uint64_t run_queries(Tree &p_tree, QueryType p_type, const Vector<Query> &p_queries, bool p_simd, uint64_t &r_checksum, int &r_hits) {
+	OS *os = OS::get_singleton();
+	Item **result = memnew_arr(Item *, ITEM_COUNT);
+	p_tree.params_set_leaf_simd(p_simd);
+
+	r_checksum = 0;
+	r_hits = 0;
+	uint64_t t = os->get_ticks_usec();
+	for (int i = 0; i < p_queries.size(); i++) {
+		int count = run_query(p_tree, p_type, p_queries[i], result);
+		// Order sensitive on purpose, both leaf tests must visit items in the
+		// same order.
+		r_checksum = r_checksum * 31 + count;
+		r_hits += count;
+		for (int n = 0; n < count; n++) {
+			r_checksum = r_checksum * 31 + result[n]->id;
+		}
+	}
+	uint64_t time = os->get_ticks_usec() - t;
+
+	memdelete_arr(result);
+	return time;
+}
+
+MainLoop *test() {
+	OS *os = OS::get_singleton();
+	RandomPCG rng(1);
+
+	Item *items = memnew_arr(Item, ITEM_COUNT);
+	Vector<AABB> item_aabbs;
+	item_aabbs.resize(ITEM_COUNT);
+	Tree tree;
+	for (int i = 0; i < ITEM_COUNT; i++) {
+		items[i].id = i;
+		Vector3 pos(rng.random(-WORLD_SIZE, WORLD_SIZE), rng.random(-WORLD_SIZE, WORLD_SIZE), rng.random(-WORLD_SIZE, WORLD_SIZE));
+		Vector3 size(rng.random(0.5f, 10.0f), rng.random(0.5f, 10.0f), rng.random(0.5f, 10.0f));
+		item_aabbs.write[i] = AABB(pos, size);
+		// A non zero pairable type, culls skip items that don't match their mask.
+		tree.create(&items[i], true, item_aabbs[i], 0, false, 1, 0);
+	}
+	tree.update();
+
+	Vector<Query> queries;
+	queries.resize(QUERY_COUNT);
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		Query &q = queries.write[i];
+
+		Transform camera;
+		camera.origin = Vector3(rng.random(-WORLD_SIZE, WORLD_SIZE), rng.random(-WORLD_SIZE, WORLD_SIZE), rng.random(-WORLD_SIZE, WORLD_SIZE));
+		camera.basis = Basis(Vector3(0, 1, 0), rng.random(0.0f, (float)Math_TAU));
+		CameraMatrix projection;
+		projection.set_perspective(70, 16.0 / 9.0, 0.05, rng.random(50, 300));
+		q.planes = projection.get_projection_planes(camera);
+
+		q.aabb = AABB(camera.origin, Vector3(rng.random(5, 80), rng.random(5, 80), rng.random(5, 80)));
+
+		// Points and segments start inside or near an item, random ones would
+		// almost never hit anything.
+		const AABB &item_aabb = item_aabbs[rng.rand() % ITEM_COUNT];
+		for (int axis = 0; axis < 3; axis++) {
+			switch (i % 4) {
+				case 0:
+					// Exactly on the item's faces and edges.
+					q.point[axis] = rng.rand() % 2 ? item_aabb.position[axis] : item_aabb.position[axis] + item_aabb.size[axis];
+					break;
+				case 1:
+					// Close to the item, inside or outside.
+					q.point[axis] = item_aabb.position[axis] + item_aabb.size[axis] * rng.random(-0.25f, 1.25f);
+					break;
+				default:
+					q.point[axis] = item_aabb.position[axis] + item_aabb.size[axis] * rng.random(0.0f, 1.0f);
+					break;
+			}
+		}
+
+		q.from = q.point;
+		q.to = q.from + camera.basis.get_axis(2) * -rng.random(50, 500);
+		// Half of the segments are parallel to one or two axes, where the leaf
+		// tests divide by zero.
+		if (i % 2) {
+			int axis = rng.rand() % 3;
+			q.to[axis] = q.from[axis];
+			if (i % 6 == 1) {
+				q.to[(axis + 1) % 3] = q.from[(axis + 1) % 3];
+			}
+		}
+	}
+
+	os->print("\nBVH with %d items, %d queries of each type:\n", ITEM_COUNT, QUERY_COUNT);
+
+	bool ok = true;
+	for (int type = 0; type < QUERY_MAX; type++) {
+		uint64_t scalar_checksum;
+		uint64_t simd_checksum;
+		int scalar_hits;
+		int simd_hits;
+		uint64_t scalar_time = run_queries(tree, (QueryType)type, queries, false, scalar_checksum, scalar_hits);
+		uint64_t simd_time = run_queries(tree, (QueryType)type, queries, true, simd_checksum, simd_hits);
+		bool match = scalar_checksum == simd_checksum && scalar_hits == simd_hits;
+		ok = ok && match;
+
+		os->print("\t%-8s scalar %7d us, simd %7d us, %7d hits %s\n", query_names[type], (int)scalar_time, (int)simd_time, scalar_hits, match ? "" : "(MISMATCH)");
+	}
+
+#ifndef BVH_LEAF_SIMD
+	os->print("\tSIMD leaf tests are not available in this build, both runs are scalar.\n");
+#endif
+
+	os->print("\n%s\n", ok ? "PASS" : "FAILED");
+
+	memdelete_arr(items);
+	return nullptr;
+}
+
+} // namespace TestBVH
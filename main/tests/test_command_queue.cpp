@@ -0,0 +1,283 @@
+/*************************************************************************/
+/*  test_command_queue.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_command_queue.h"
+
+#include "core/command_queue_mt.h"
+#include "core/math/transform.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/project_settings.h"
+
+namespace TestCommandQueue {
+
+enum {
+	PRODUCERS = 4,
+	COMMANDS_PER_PRODUCER = 100000,
+	SINGLE_THREAD_COMMANDS = 10000,
+};
+
+static const char *QUEUE_SIZE_SETTING = "memory/limits/command_queue/multithreading_queue_size_kb";
+
+// Commands run on the consumer thread, so only it touches the sequence numbers.
+struct Receiver {
+	uint32_t next[PRODUCERS];
+	uint32_t errors = 0;
+	uint32_t executed = 0;
+	bool exit = false;
+
+	void _check(uint32_t p_producer, uint32_t p_seq) {
+		if (p_producer >= PRODUCERS || p_seq != next[p_producer]) {
+			if (errors < 10) {
+				OS::get_singleton()->print("\tProducer %i: got command %i, expected %i\n", p_producer, p_seq, p_producer < PRODUCERS ? next[p_producer] : 0);
+			}
+			errors++;
+			return;
+		}
+		next[p_producer]++;
+		executed++;
+	}
+
+	void small(uint32_t p_producer, uint32_t p_seq) {
+		_check(p_producer, p_seq);
+	}
+
+	// Bigger than the other commands, so reservations don't line up with the end of the buffer.
+	void large(uint32_t p_producer, uint32_t p_seq, Transform p_xform) {
+		if (p_xform.origin.x != p_seq || p_xform.basis[1][1] != p_producer) {
+			errors++;
+		}
+		_check(p_producer, p_seq);
+	}
+
+	void sync(uint32_t p_producer, uint32_t p_seq) {
+		_check(p_producer, p_seq);
+	}
+
+	uint32_t ret(uint32_t p_producer, uint32_t p_seq) {
+		_check(p_producer, p_seq);
+		return p_seq * PRODUCERS + p_producer;
+	}
+
+	void stop() {
+		exit = true;
+	}
+
+	bool check(uint32_t p_commands) const {
+		for (int i = 0; i < PRODUCERS; i++) {
+			if (next[i] != p_commands) {
+				OS::get_singleton()->print("\tProducer %i: %i of %i commands ran\n", i, next[i], p_commands);
+				return false;
+			}
+		}
+		return errors == 0;
+	}
+
+	Receiver() {
+		for (int i = 0; i < PRODUCERS; i++) {
+			next[i] = 0;
+		}
+	}
+};
+
+struct ProducerData {
+	CommandQueueMT *queue = nullptr;
+	Receiver *receiver = nullptr;
+	uint32_t index = 0;
+	uint32_t bad_returns = 0;
+};
+
+void push_commands(ProducerData *p_data, uint32_t p_commands) {
+	for (uint32_t seq = 0; seq < p_commands; seq++) {
+		switch (seq % 16) {
+			case 10:
+			case 11:
+			case 12:
+			case 13: {
+				Transform xform;
+				xform.origin.x = seq;
+				xform.basis[1][1] = p_data->index;
+				p_data->queue->push(p_data->receiver, &Receiver::large, p_data->index, seq, xform);
+			} break;
+			case 14: {
+				p_data->queue->push_and_sync(p_data->receiver, &Receiver::sync, p_data->index, seq);
+			} break;
+			case 15: {
+				uint32_t ret = 0;
+				p_data->queue->push_and_ret(p_data->receiver, &Receiver::ret, p_data->index, seq, &ret);
+				if (ret != seq * PRODUCERS + p_data->index) {
+					p_data->bad_returns++;
+				}
+			} break;
+			default: {
+				p_data->queue->push(p_data->receiver, &Receiver::small, p_data->index, seq);
+			} break;
+		}
+	}
+}
+
+void producer_func(void *p_userdata) {
+	push_commands((ProducerData *)p_userdata, COMMANDS_PER_PRODUCER);
+}
+
+void consumer_func(void *p_userdata) {
+	ProducerData *data = (ProducerData *)p_userdata;
+	while (!data->receiver->exit) {
+		data->queue->wait_and_flush_one();
+	}
+}
+
+bool run_producers(int p_queue_size_kb) {
+	// The queue reads its size from the project settings when created.
+	Variant prev_size = ProjectSettings::get_singleton()->get(QUEUE_SIZE_SETTING);
+	ProjectSettings::get_singleton()->set(QUEUE_SIZE_SETTING, p_queue_size_kb);
+	CommandQueueMT queue(true);
+	ProjectSettings::get_singleton()->set(QUEUE_SIZE_SETTING, prev_size);
+
+	Receiver receiver;
+	ProducerData consumer_data;
+	consumer_data.queue = &queue;
+	consumer_data.receiver = &receiver;
+	ProducerData producer_data[PRODUCERS];
+	Thread producers[PRODUCERS];
+	Thread consumer;
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	consumer.start(consumer_func, &consumer_data);
+	for (int i = 0; i < PRODUCERS; i++) {
+		producer_data[i].queue = &queue;
+		producer_data[i].receiver = &receiver;
+		producer_data[i].index = i;
+		producers[i].start(producer_func, &producer_data[i]);
+	}
+	for (int i = 0; i < PRODUCERS; i++) {
+		producers[i].wait_to_finish();
+	}
+	queue.push(&receiver, &Receiver::stop);
+	consumer.wait_to_finish();
+	uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - begin;
+
+	OS::get_singleton()->print("\t%i commands from %i producers in %i ms\n", receiver.executed, PRODUCERS, int(elapsed / 1000));
+
+	bool pass = receiver.check(COMMANDS_PER_PRODUCER);
+	for (int i = 0; i < PRODUCERS; i++) {
+		if (producer_data[i].bad_returns) {
+			OS::get_singleton()->print("\tProducer %i: %i wrong return values\n", i, producer_data[i].bad_returns);
+			pass = false;
+		}
+	}
+	return pass;
+}
+
+bool test_default_buffer() {
+	OS::get_singleton()->print("\n\nTest 1: Several producers, default buffer\n");
+	return run_producers(256);
+}
+
+bool test_tiny_buffer() {
+	// Only fits a handful of commands, so producers keep waiting on the consumer and every lap wraps around.
+	OS::get_singleton()->print("\n\nTest 2: Several producers, 1 KiB buffer\n");
+	return run_producers(1);
+}
+
+bool test_flush_all() {
+	OS::get_singleton()->print("\n\nTest 3: Flushing from the producer thread\n");
+
+	Variant prev_size = ProjectSettings::get_singleton()->get(QUEUE_SIZE_SETTING);
+	ProjectSettings::get_singleton()->set(QUEUE_SIZE_SETTING, 1);
+	CommandQueueMT queue(false);
+	ProjectSettings::get_singleton()->set(QUEUE_SIZE_SETTING, prev_size);
+
+	Receiver receiver;
+	Transform xform;
+	bool pass = true;
+	for (uint32_t round = 0; round < 2; round++) {
+		// A few commands at a time, so the buffer wraps around without a consumer thread.
+		for (uint32_t seq = 0; seq < SINGLE_THREAD_COMMANDS; seq++) {
+			if (seq % 3 == 0) {
+				xform.origin.x = seq;
+				xform.basis[1][1] = 0;
+				queue.push(&receiver, &Receiver::large, 0u, seq, xform);
+			} else {
+				queue.push(&receiver, &Receiver::small, 0u, seq);
+			}
+			if (seq % 5 == 4) {
+				queue.flush_all();
+			}
+		}
+		queue.flush_all();
+
+		if (receiver.next[0] != SINGLE_THREAD_COMMANDS || receiver.errors) {
+			OS::get_singleton()->print("\t%i of %i commands ran, %i errors\n", receiver.next[0], SINGLE_THREAD_COMMANDS, receiver.errors);
+			pass = false;
+		}
+		receiver.next[0] = 0;
+	}
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_default_buffer,
+	test_tiny_buffer,
+	test_flush_all,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestCommandQueue
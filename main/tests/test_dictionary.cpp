@@ -0,0 +1,285 @@
+/*************************************************************************/
+/*  test_dictionary.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_dictionary.h"
+
+#include "core/dictionary.h"
+#include "core/ordered_hash_map.h"
+#include "core/ordered_oa_hash_map.h"
+#include "core/os/os.h"
+#include "core/variant.h"
+
+namespace TestDictionary {
+
+bool test_insert_and_lookup() {
+	Dictionary d;
+	d[42] = 84;
+	d["key"] = "value";
+	d[Vector2(1, 2)] = 3;
+
+	return d.size() == 3 && d[42] == Variant(84) && d["key"] == Variant("value") && d[Vector2(1, 2)] == Variant(3) && d.has(42) && !d.has(43) && !d.getptr(43);
+}
+
+bool test_overwrite() {
+	Dictionary d;
+	d[42] = 84;
+	d[42] = 1234;
+
+	return d.size() == 1 && d[42] == Variant(1234);
+}
+
+bool test_erase() {
+	Dictionary d;
+	for (int i = 0; i < 100; i++) {
+		d[i] = i * 2;
+	}
+	for (int i = 0; i < 100; i += 2) {
+		if (!d.erase(i)) {
+			return false;
+		}
+	}
+	if (d.erase(0) || d.size() != 50) {
+		return false;
+	}
+	for (int i = 0; i < 100; i++) {
+		if (d.has(i) != (i % 2 == 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_insertion_order() {
+	Dictionary d;
+	for (int i = 0; i < 1000; i++) {
+		d[i * 7919 % 1000] = i;
+	}
+	// Erase some and re-add them, they must go to the end.
+	for (int i = 0; i < 1000; i += 3) {
+		d.erase(i * 7919 % 1000);
+	}
+	for (int i = 0; i < 1000; i += 3) {
+		d[i * 7919 % 1000] = -i;
+	}
+
+	Array keys = d.keys();
+	int idx = 0;
+	for (int i = 0; i < 1000; i++) {
+		if (i % 3 != 0 && keys[idx++] != Variant(i * 7919 % 1000)) {
+			return false;
+		}
+	}
+	for (int i = 0; i < 1000; i += 3) {
+		if (keys[idx++] != Variant(i * 7919 % 1000)) {
+			return false;
+		}
+	}
+	return idx == d.size() && d.get_key_at_index(0) == keys[0] && d.get_value_at_index(d.size() - 1) == Variant(-999);
+}
+
+bool test_next() {
+	Dictionary d;
+	for (int i = 0; i < 100; i++) {
+		d[String::num(i)] = i;
+	}
+	d.erase("50");
+
+	// Iterate the way Variant::iter_next does, with both inner and outer keys.
+	int count = 0;
+	Variant key = *d.next(nullptr);
+	while (true) {
+		count++;
+		const Variant *next = d.next(&key);
+		if (!next) {
+			break;
+		}
+		key = *next;
+	}
+	int count_inner = 0;
+	for (const Variant *k = d.next(); k; k = d.next(k)) {
+		count_inner++;
+	}
+	return count == 99 && count_inner == 99;
+}
+
+bool test_churn() {
+	// Many insertions and deletions must not grow the dictionary without bounds, nor lose elements.
+	Dictionary d;
+	for (int i = 0; i < 100000; i++) {
+		d[i] = i;
+		if (i >= 10) {
+			d.erase(i - 10);
+		}
+	}
+	if (d.size() != 10) {
+		return false;
+	}
+	for (int i = 0; i < 10; i++) {
+		if (d.get_key_at_index(i) != Variant(100000 - 10 + i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_duplicate() {
+	Dictionary d;
+	Dictionary inner;
+	inner["a"] = 1;
+	d["inner"] = inner;
+	d[1] = 2;
+
+	Dictionary shallow = d.duplicate();
+	Dictionary deep = d.duplicate(true);
+	inner["a"] = 2;
+
+	return shallow.size() == 2 && Dictionary(shallow["inner"])["a"] == Variant(2) && Dictionary(deep["inner"])["a"] == Variant(1) && deep.hash() != d.hash();
+}
+
+typedef OrderedHashMap<Variant, Variant, VariantHasher, VariantComparator> ListMap;
+typedef OrderedOAHashMap<Variant, Variant, VariantHasher, VariantComparator> OAMap;
+
+template <class M>
+void benchmark_map(const char *p_name, const Vector<Variant> &p_keys, const Vector<Variant> &p_missing) {
+	OS *os = OS::get_singleton();
+	const int passes = 10;
+	int found = 0;
+
+	uint64_t t = os->get_ticks_usec();
+	M *maps = memnew_arr(M, passes);
+	for (int p = 0; p < passes; p++) {
+		for (int i = 0; i < p_keys.size(); i++) {
+			maps[p][p_keys[i]] = i;
+		}
+	}
+	uint64_t insert_time = os->get_ticks_usec() - t;
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		for (int i = 0; i < p_keys.size(); i++) {
+			found += maps[p].find(p_keys[i]) ? 1 : 0;
+		}
+	}
+	uint64_t hit_time = os->get_ticks_usec() - t;
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		for (int i = 0; i < p_missing.size(); i++) {
+			found += maps[p].find(p_missing[i]) ? 1 : 0;
+		}
+	}
+	uint64_t miss_time = os->get_ticks_usec() - t;
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		for (typename M::Element E = maps[p].front(); E; E = E.next()) {
+			found += E.value().get_type() == Variant::INT ? 1 : 0;
+		}
+	}
+	uint64_t iterate_time = os->get_ticks_usec() - t;
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		for (int i = 0; i < p_keys.size(); i++) {
+			maps[p].erase(p_keys[i]);
+		}
+	}
+	uint64_t erase_time = os->get_ticks_usec() - t;
+	memdelete_arr(maps);
+
+	OS::get_singleton()->print("\t%-16s insert %6d us, hit %6d us, miss %6d us, iterate %6d us, erase %6d us (%d)\n", p_name, (int)insert_time, (int)hit_time, (int)miss_time, (int)iterate_time, (int)erase_time, found);
+}
+
+void benchmark() {
+	const int count = 100000;
+	Vector<Variant> int_keys;
+	Vector<Variant> int_missing;
+	Vector<Variant> string_keys;
+	Vector<Variant> string_missing;
+	for (int i = 0; i < count; i++) {
+		int_keys.push_back(i * 3);
+		int_missing.push_back(i * 3 + 1);
+		string_keys.push_back("key_" + itos(i));
+		string_missing.push_back("missing_" + itos(i));
+	}
+
+	OS::get_singleton()->print("\n%d int keys, 10 passes:\n", count);
+	benchmark_map<ListMap>("OrderedHashMap", int_keys, int_missing);
+	benchmark_map<OAMap>("OrderedOAHashMap", int_keys, int_missing);
+
+	OS::get_singleton()->print("\n%d String keys, 10 passes:\n", count);
+	benchmark_map<ListMap>("OrderedHashMap", string_keys, string_missing);
+	benchmark_map<OAMap>("OrderedOAHashMap", string_keys, string_missing);
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_insert_and_lookup,
+	test_overwrite,
+	test_erase,
+	test_insertion_order,
+	test_next,
+	test_churn,
+	test_duplicate,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	benchmark();
+
+	return nullptr;
+}
+} // namespace TestDictionary
@@ -0,0 +1,284 @@
+/*************************************************************************/
+/*  main/tests/test_expression.cpp                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_expression.h"
+
+#include "core/math/expression.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/safe_refcount.h"
+
+namespace TestExpression {
+
+Variant evaluate(const String &p_expression, const Array &p_inputs = Array(), Object *p_base = nullptr, bool *r_failed = nullptr) {
+	Vector<String> names;
+	names.push_back("x");
+	names.push_back("y");
+
+	Ref<Expression> expression;
+	expression.instance();
+	if (expression->parse(p_expression, names) != OK) {
+		if (r_failed) {
+			*r_failed = true;
+		}
+		return Variant();
+	}
+	Variant ret = expression->execute(p_inputs, p_base, false);
+	if (r_failed) {
+		*r_failed = expression->has_execute_failed();
+	}
+	return ret;
+}
+
+bool check(const String &p_expression, const Variant &p_expected, const Array &p_inputs = Array(), Object *p_base = nullptr) {
+	bool failed = false;
+	Variant ret = evaluate(p_expression, p_inputs, p_base, &failed);
+	if (failed || ret.get_type() != p_expected.get_type() || ret != p_expected) {
+		OS::get_singleton()->print("\t%s returned %s instead of %s\n", p_expression.utf8().get_data(), String(ret).utf8().get_data(), String(p_expected).utf8().get_data());
+		return false;
+	}
+	return true;
+}
+
+Array inputs(const Variant &p_x, const Variant &p_y = Variant()) {
+	Array arr;
+	arr.push_back(p_x);
+	arr.push_back(p_y);
+	return arr;
+}
+
+bool test_constants() {
+	bool ok = check("1 + 2 * 3", 7);
+	ok = check("sqrt(pow(3, 2) + pow(4, 2))", 5.0) && ok;
+	ok = check("Vector2(1, 2).x + Vector2(3, 4)[1]", 5.0) && ok;
+	ok = check("\"abc\" + str(1)", "abc1") && ok;
+	ok = check("-(2 - 5) % 2", 1) && ok;
+	ok = check("PI > 3 and not false", true) && ok;
+	return ok;
+}
+
+bool test_inputs() {
+	bool ok = check("x * x + y", 11, inputs(3, 2));
+	ok = check("x.length() + y", 6.0, inputs(Vector2(3, 4), 1)) && ok;
+	ok = check("clamp(x, 0, 1) + y * 2", 3.0, inputs(1.5, 1.0)) && ok;
+	ok = check("x[1] + x.size()", 4, inputs(inputs(1, 2))) && ok;
+
+	// Containers are created anew on every execution.
+	Ref<Expression> expression;
+	expression.instance();
+	expression->parse("[1, {\"a\": 2}]");
+	Array first = expression->execute(Array());
+	first.push_back(3);
+	Array second = expression->execute(Array());
+	ok = ok && second.size() == 2;
+
+	bool failed = false;
+	evaluate("x + y", inputs(1), nullptr, &failed);
+	ok = ok && failed;
+	evaluate("x + 1", Array(), nullptr, &failed);
+	ok = ok && failed;
+	evaluate("\"a\" - 1", Array(), nullptr, &failed);
+	ok = ok && failed;
+	return ok;
+}
+
+bool test_calls() {
+	Object *obj = memnew(Object);
+	obj->set_meta("value", 5);
+	bool ok = check("self.get_meta(\"value\") + x", 7, inputs(2), obj);
+	ok = check("get_meta(\"value\") * 2", 10, Array(), obj) && ok;
+	ok = check("self.get_class()", "Object", Array(), obj) && ok;
+
+	bool failed = false;
+	evaluate("self.not_a_method()", Array(), obj, &failed);
+	ok = ok && failed;
+	evaluate("self.get_class()", Array(), nullptr, &failed);
+	ok = ok && failed;
+	memdelete(obj);
+
+	// The cached method is per class, another class must not reuse it.
+	Vector<String> names;
+	names.push_back("x");
+
+	Ref<Expression> expression;
+	expression.instance();
+	expression->parse("x.get_class()", names);
+	Object *a = memnew(Object);
+	Ref<Reference> b;
+	b.instance();
+	ok = ok && expression->execute(inputs(a)) == Variant("Object");
+	ok = ok && expression->execute(inputs(b)) == Variant("Reference");
+	ok = ok && expression->execute(inputs(a)) == Variant("Object");
+	memdelete(a);
+	return ok;
+}
+
+struct ConcurrentCalls {
+	Ref<Expression> expression;
+	SafeNumeric<uint32_t> mismatches;
+	SafeNumeric<uint32_t> started;
+};
+
+// Every thread calls the same expression with another class, so a call site
+// cache shared between them would call the wrong method.
+static void _concurrent_calls_thread(void *p_userdata) {
+	ConcurrentCalls *calls = (ConcurrentCalls *)p_userdata;
+	bool reference = calls->started.postincrement() % 2;
+
+	Object *obj = reference ? memnew(Reference) : memnew(Object);
+	const Variant expected = reference ? "Reference" : "Object";
+	Array args = inputs(obj);
+	for (int i = 0; i < 10000; i++) {
+		if (calls->expression->execute(args) != expected) {
+			calls->mismatches.increment();
+		}
+	}
+	args.clear();
+	memdelete(obj);
+}
+
+bool test_concurrent_calls() {
+	Vector<String> names;
+	names.push_back("x");
+
+	ConcurrentCalls calls;
+	calls.expression.instance();
+	calls.expression->parse("x.get_class()", names);
+
+	Thread threads[4];
+	for (int i = 0; i < 4; i++) {
+		threads[i].start(_concurrent_calls_thread, &calls);
+	}
+	for (int i = 0; i < 4; i++) {
+		threads[i].wait_to_finish();
+	}
+	return calls.mismatches.get() == 0;
+}
+
+bool test_execute_many() {
+	Vector<String> names;
+	names.push_back("x");
+	names.push_back("y");
+
+	Ref<Expression> expression;
+	expression.instance();
+	expression->parse("x * x + y", names);
+
+	Array list;
+	for (int i = 0; i < 100; i++) {
+		list.push_back(inputs(i, i));
+	}
+	Array results = expression->execute_many(list);
+	bool ok = results.size() == 100 && !expression->has_execute_failed();
+	for (int i = 0; ok && i < results.size(); i++) {
+		ok = results[i] == Variant(i * i + i);
+	}
+
+	// Stops at the first failure.
+	list[50] = inputs("a", 1);
+	results = expression->execute_many(list, nullptr, false);
+	ok = ok && results.size() == 50 && expression->has_execute_failed();
+	return ok;
+}
+
+void benchmark() {
+	OS *os = OS::get_singleton();
+	const int count = 100000;
+
+	Vector<String> names;
+	names.push_back("x");
+	names.push_back("y");
+
+	Ref<Expression> expression;
+	expression.instance();
+	expression->parse("clamp(x * 0.5 + y * y - sqrt(16.0) * 2.0, 0.0, 100.0) + abs(sin(x)) * (1.0 + 2.0)", names);
+
+	Array list;
+	for (int i = 0; i < count; i++) {
+		list.push_back(inputs(i * 0.01, i * 0.02));
+	}
+
+	uint64_t t = os->get_ticks_usec();
+	double sum = 0.0;
+	for (int i = 0; i < count; i++) {
+		sum += (double)expression->execute(list[i]);
+	}
+	uint64_t execute_time = os->get_ticks_usec() - t;
+
+	t = os->get_ticks_usec();
+	Array results = expression->execute_many(list);
+	uint64_t execute_many_time = os->get_ticks_usec() - t;
+
+	os->print("\nEvaluating a formula %d times:\n", count);
+	os->print("\texecute %6d us, execute_many %6d us (%f, %d)\n", (int)execute_time, (int)execute_many_time, sum, results.size());
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_constants,
+	test_inputs,
+	test_calls,
+	test_concurrent_calls,
+	test_execute_many,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	benchmark();
+
+	return nullptr;
+}
+} // namespace TestExpression
@@ -30,15 +30,21 @@
 
 #include "test_gdscript.h"
 
+#include "core/io/resource_loader.h"
+#include "core/os/dir_access.h"
 #include "core/os/file_access.h"
 #include "core/os/main_loop.h"
 #include "core/os/os.h"
+#include "core/project_settings.h"
+#include "scene/main/scene_tree.h"
 
 #include "modules/modules_enabled.gen.h" // For gdscript.
 #ifdef MODULE_GDSCRIPT_ENABLED
 
 #include "modules/gdscript/gdscript.h"
+#include "modules/gdscript/gdscript_bytecode.h"
 #include "modules/gdscript/gdscript_compiler.h"
+#include "modules/gdscript/gdscript_load_graph.h"
 #include "modules/gdscript/gdscript_parser.h"
 #include "modules/gdscript/gdscript_tokenizer.h"
 
@@ -530,9 +536,28 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 			String txt = itos(ip) + " ";
 
 			switch (code[ip]) {
-				case GDScriptFunction::OPCODE_OPERATOR: {
+				case GDScriptFunction::OPCODE_OPERATOR:
+				case GDScriptFunction::OPCODE_OPERATOR_INT:
+				case GDScriptFunction::OPCODE_OPERATOR_REAL:
+				case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+				case GDScriptFunction::OPCODE_OPERATOR_VECTOR3: {
 					int op = code[ip + 1];
-					txt += " op ";
+					switch (code[ip]) {
+						case GDScriptFunction::OPCODE_OPERATOR_INT:
+							txt += " op(int) ";
+							break;
+						case GDScriptFunction::OPCODE_OPERATOR_REAL:
+							txt += " op(float) ";
+							break;
+						case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+							txt += " op(Vector2) ";
+							break;
+						case GDScriptFunction::OPCODE_OPERATOR_VECTOR3:
+							txt += " op(Vector3) ";
+							break;
+						default:
+							txt += " op ";
+					}
 
 					String opname = Variant::get_operator_name(Variant::Operator(op));
 
@@ -564,26 +589,70 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 					txt += "]";
 					incr += 4;
 
+				} break;
+				case GDScriptFunction::OPCODE_SET_ARRAY_INDEX: {
+					txt += " set_index ";
+					txt += DADDR(1);
+					txt += "[";
+					txt += DADDR(2);
+					txt += "]=";
+					txt += DADDR(3);
+					incr += 4;
+
+				} break;
+				case GDScriptFunction::OPCODE_GET_ARRAY_INDEX: {
+					txt += " get_index ";
+					txt += DADDR(3);
+					txt += "=";
+					txt += DADDR(1);
+					txt += "[";
+					txt += DADDR(2);
+					txt += "]";
+					incr += 4;
+
 				} break;
 				case GDScriptFunction::OPCODE_SET_NAMED: {
 					txt += " set_named ";
-					txt += DADDR(1);
+					txt += DADDR(2);
 					txt += "[\"";
-					txt += func.get_global_name(code[ip + 2]);
+					txt += func.get_global_name(code[ip + 3]);
 					txt += "\"]=";
-					txt += DADDR(3);
-					incr += 4;
+					txt += DADDR(4);
+					txt += " #" + itos(code[ip + 1]);
+					incr += 5;
 
 				} break;
 				case GDScriptFunction::OPCODE_GET_NAMED: {
 					txt += " get_named ";
-					txt += DADDR(3);
+					txt += DADDR(4);
 					txt += "=";
-					txt += DADDR(1);
+					txt += DADDR(2);
 					txt += "[\"";
-					txt += func.get_global_name(code[ip + 2]);
+					txt += func.get_global_name(code[ip + 3]);
 					txt += "\"]";
-					incr += 4;
+					txt += " #" + itos(code[ip + 1]);
+					incr += 5;
+
+				} break;
+				case GDScriptFunction::OPCODE_SET_VECTOR_COMPONENT: {
+					txt += " set_component ";
+					txt += DADDR(2);
+					txt += "[\"";
+					txt += func.get_global_name(code[ip + 3]);
+					txt += "\"]=";
+					txt += DADDR(4);
+					incr += 5;
+
+				} break;
+				case GDScriptFunction::OPCODE_GET_VECTOR_COMPONENT: {
+					txt += " get_component ";
+					txt += DADDR(4);
+					txt += "=";
+					txt += DADDR(2);
+					txt += "[\"";
+					txt += func.get_global_name(code[ip + 3]);
+					txt += "\"]";
+					incr += 5;
 
 				} break;
 				case GDScriptFunction::OPCODE_SET_MEMBER: {
@@ -729,24 +798,25 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 						txt += " call ";
 					}
 
-					int argc = code[ip + 1];
+					int argc = code[ip + 2];
 					if (ret) {
-						txt += DADDR(4 + argc) + "=";
+						txt += DADDR(5 + argc) + "=";
 					}
 
-					txt += DADDR(2) + ".";
-					txt += String(func.get_global_name(code[ip + 3]));
+					txt += DADDR(3) + ".";
+					txt += String(func.get_global_name(code[ip + 4]));
 					txt += "(";
 
 					for (int i = 0; i < argc; i++) {
 						if (i > 0) {
 							txt += ", ";
 						}
-						txt += DADDR(4 + i);
+						txt += DADDR(5 + i);
 					}
 					txt += ")";
+					txt += " #" + itos(code[ip + 1]);
 
-					incr = 5 + argc;
+					incr = 6 + argc;
 
 				} break;
 				case GDScriptFunction::OPCODE_CALL_BUILT_IN: {
@@ -849,6 +919,26 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 					txt += " for-loop " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
 					incr += 5;
 
+				} break;
+				case GDScriptFunction::OPCODE_ITERATE_ARRAY_BEGIN: {
+					txt += " for-array-init " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
+					incr += 5;
+
+				} break;
+				case GDScriptFunction::OPCODE_ITERATE_ARRAY: {
+					txt += " for-array-loop " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
+					incr += 5;
+
+				} break;
+				case GDScriptFunction::OPCODE_ITERATE_RANGE_BEGIN: {
+					txt += " for-range-init " + DADDR(5) + " from " + DADDR(1) + " to " + DADDR(2) + " step " + DADDR(3) + " end " + itos(code[ip + 4]);
+					incr += 6;
+
+				} break;
+				case GDScriptFunction::OPCODE_ITERATE_RANGE: {
+					txt += " for-range-loop " + DADDR(5) + " counter " + DADDR(1) + " to " + DADDR(2) + " step " + DADDR(3) + " end " + itos(code[ip + 4]);
+					incr += 6;
+
 				} break;
 				case GDScriptFunction::OPCODE_LINE: {
 					int line = code[ip + 1] - 1;
@@ -883,6 +973,366 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 	}
 }
 
+static Ref<GDScript> _compile_script(const String &p_code, const String &p_path, bool p_typed_opcodes, bool p_release = false, bool p_optimize = false) {
+	GDScriptParser parser;
+	Error err = parser.parse(p_code, p_path.get_base_dir(), false, p_path);
+	if (err) {
+		print_line("Parse Error:\n" + itos(parser.get_error_line()) + ":" + itos(parser.get_error_column()) + ":" + parser.get_error());
+		return Ref<GDScript>();
+	}
+
+	Ref<GDScript> gds;
+	gds.instance();
+
+	GDScriptCompiler gdc;
+	gdc.set_typed_opcodes_enabled(p_typed_opcodes);
+	gdc.set_debug_opcodes_enabled(!p_release);
+	gdc.set_optimizations_enabled(p_optimize);
+	err = gdc.compile(&parser, gds.ptr());
+	if (err) {
+		print_line("Compile Error:\n" + itos(gdc.get_error_line()) + ":" + itos(gdc.get_error_column()) + ":" + gdc.get_error());
+		return Ref<GDScript>();
+	}
+
+	return gds;
+}
+
+static int _get_code_size(const Ref<GDScript> &p_class) {
+	int size = 0;
+	const Map<StringName, GDScriptFunction *> &mf = p_class->debug_get_member_functions();
+	for (const Map<StringName, GDScriptFunction *>::Element *E = mf.front(); E; E = E->next()) {
+		size += E->get()->get_code_size();
+	}
+	return size;
+}
+
+// Runs every bench_*() function of the script twice, compiled with the
+// generic Variant opcodes and with the typed ones, and compares the results.
+static void _run_benchmarks(const String &p_code, const String &p_path) {
+	Ref<GDScript> scripts[2] = { _compile_script(p_code, p_path, false), _compile_script(p_code, p_path, true) };
+	if (scripts[0].is_null() || scripts[1].is_null()) {
+		return;
+	}
+
+	Object *instances[2];
+	Ref<Reference> refs[2];
+	for (int i = 0; i < 2; i++) {
+		instances[i] = ClassDB::instance(scripts[i]->get_instance_base_type());
+		ERR_FAIL_COND_MSG(!instances[i], "Could not create an instance of the benchmark script base type.");
+		refs[i] = Ref<Reference>(Object::cast_to<Reference>(instances[i]));
+		instances[i]->set_script(scripts[i].get_ref_ptr());
+	}
+
+	List<MethodInfo> methods;
+	scripts[1]->get_script_method_list(&methods);
+
+	for (List<MethodInfo>::Element *E = methods.front(); E; E = E->next()) {
+		const StringName &name = E->get().name;
+		if (!String(name).begins_with("bench_")) {
+			continue;
+		}
+
+		uint64_t usec[2];
+		Variant results[2];
+		for (int i = 0; i < 2; i++) {
+			GDScriptLanguage::get_singleton()->inline_cache_reset_stats();
+			uint64_t from = OS::get_singleton()->get_ticks_usec();
+			results[i] = instances[i]->call(name);
+			usec[i] = OS::get_singleton()->get_ticks_usec() - from;
+		}
+
+		String line = vformat("%s: generic %.1f ms, typed %.1f ms, %.2fx", name, usec[0] / 1000.0, usec[1] / 1000.0, usec[0] / (double)MAX(usec[1], (uint64_t)1));
+		uint64_t hits, misses;
+		GDScriptLanguage::get_singleton()->inline_cache_get_stats(hits, misses);
+		if (hits + misses > 0) {
+			line += vformat(", inline cache hits %.2f%%", hits * 100.0 / (hits + misses));
+		}
+		print_line(line);
+		if (results[0] != results[1]) {
+			print_line("\tresult mismatch: " + results[0].get_construct_string() + " != " + results[1].get_construct_string());
+		}
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (refs[i].is_null()) {
+			memdelete(instances[i]);
+		}
+	}
+}
+
+// Runs every function of the script starting with p_prefix, compiled with and
+// without optimizations, and compares the results. Returns the number of mismatches.
+static int _compare_optimized(const Ref<GDScript> &p_plain, const Ref<GDScript> &p_optimized, const String &p_prefix) {
+	Ref<GDScript> scripts[2] = { p_plain, p_optimized };
+	Object *instances[2];
+	Ref<Reference> refs[2];
+	for (int i = 0; i < 2; i++) {
+		instances[i] = ClassDB::instance(scripts[i]->get_instance_base_type());
+		ERR_FAIL_COND_V_MSG(!instances[i], 1, "Could not create an instance of the script base type.");
+		refs[i] = Ref<Reference>(Object::cast_to<Reference>(instances[i]));
+		instances[i]->set_script(scripts[i].get_ref_ptr());
+	}
+
+	List<MethodInfo> methods;
+	scripts[1]->get_script_method_list(&methods);
+
+	int mismatches = 0;
+	for (List<MethodInfo>::Element *E = methods.front(); E; E = E->next()) {
+		const StringName &name = E->get().name;
+		if (!String(name).begins_with(p_prefix) || E->get().arguments.size() > 0) {
+			continue;
+		}
+
+		Variant results[2];
+		for (int i = 0; i < 2; i++) {
+			results[i] = instances[i]->call(name);
+		}
+		if (results[0] != results[1]) {
+			print_line(vformat("%s: result mismatch: %s != %s", name, results[0].get_construct_string(), results[1].get_construct_string()));
+			mismatches++;
+		}
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (refs[i].is_null()) {
+			memdelete(instances[i]);
+		}
+	}
+	return mismatches;
+}
+
+// Covers what the optimizer rewrites: folded branches, constants copied to the
+// local table, and destinations reused as operands. The inner class resolves
+// NOTIFICATION_READY to Node's constant, not to the outer class one.
+static const char *optimizer_code =
+		"extends Reference\n"
+		"\n"
+		"const LIMIT = 10\n"
+		"const ENABLED = true\n"
+		"const NAMES = [\"a\", \"b\"]\n"
+		"const NOTIFICATION_READY = 0\n"
+		"\n"
+		"class Inner extends Node:\n"
+		"\tfunc check():\n"
+		"\t\tif not NOTIFICATION_READY:\n"
+		"\t\t\treturn \"outer\"\n"
+		"\t\treturn \"native\"\n"
+		"\n"
+		"func test_native_constant():\n"
+		"\tvar inner = Inner.new()\n"
+		"\tvar result = inner.check()\n"
+		"\tinner.free()\n"
+		"\treturn result\n"
+		"\n"
+		"func test_folded_branches():\n"
+		"\tvar result = []\n"
+		"\tif ENABLED:\n"
+		"\t\tresult.append(1)\n"
+		"\telse:\n"
+		"\t\tresult.append(2)\n"
+		"\tif not ENABLED:\n"
+		"\t\tresult.append(3)\n"
+		"\twhile not ENABLED:\n"
+		"\t\tresult.append(4)\n"
+		"\tvar count = 0\n"
+		"\twhile ENABLED:\n"
+		"\t\tcount += 1\n"
+		"\t\tif count == LIMIT:\n"
+		"\t\t\tbreak\n"
+		"\tresult.append(count)\n"
+		"\treturn result\n"
+		"\n"
+		"func test_constants():\n"
+		"\tvar sum = 0\n"
+		"\tfor i in range(LIMIT):\n"
+		"\t\tsum += i\n"
+		"\treturn [sum, NAMES, LIMIT * 2, NAMES.size()]\n"
+		"\n"
+		"func test_retarget():\n"
+		"\tvar a = [1, [2, 3]]\n"
+		"\ta = a[1]\n"
+		"\tvar v = Vector2(1, 2)\n"
+		"\tv = v * 2 + v\n"
+		"\tvar s = \"x\"\n"
+		"\ts = s + str(s)\n"
+		"\tvar n = 5\n"
+		"\tn = -n\n"
+		"\tn = max(n, n * 2)\n"
+		"\treturn [a, v, s, n]\n";
+
+MainLoop *test_optimizer() {
+	Ref<GDScript> plain = _compile_script(optimizer_code, "res://optimizer.gd", true, true, false);
+	Ref<GDScript> optimized = _compile_script(optimizer_code, "res://optimizer.gd", true, true, true);
+	ERR_FAIL_COND_V(plain.is_null() || optimized.is_null(), nullptr);
+
+	int mismatches = _compare_optimized(plain, optimized, "test_");
+
+	Ref<Reference> instance;
+	instance.instance();
+	instance->set_script(optimized.get_ref_ptr());
+	String native = instance->call("test_native_constant");
+
+	if (mismatches) {
+		print_line(vformat("FAILED: %d functions returned different results once optimized.", mismatches));
+	} else if (native != "native") {
+		print_line("FAILED: the inner class resolved NOTIFICATION_READY to the outer class constant.");
+	} else {
+		print_line("PASS");
+	}
+	return nullptr;
+}
+
+static void _write_file(const String &p_path, const String &p_text) {
+	FileAccess *f = FileAccess::open(p_path, FileAccess::WRITE);
+	ERR_FAIL_COND_MSG(!f, "Could not write file: " + p_path);
+	f->store_string(p_text);
+	memdelete(f);
+}
+
+// Loads a script preloading many scripts that all extend the same autoload, so
+// their parallel compilation races to load it. They must all share one base.
+MainLoop *test_load_graph() {
+	const String dir = "res://.gd_load_graph_test";
+	const String base_path = dir.plus_file("base.gd");
+	const String main_path = dir.plus_file("main.gd");
+	const int child_count = 16;
+
+	DirAccessRef da = DirAccess::create(DirAccess::ACCESS_RESOURCES);
+	ERR_FAIL_COND_V_MSG(da->make_dir_recursive(dir) != OK, nullptr, "Could not create the test directory: " + dir);
+
+	_write_file(base_path, "extends Node\nfunc get_value():\n\treturn 1\n");
+	String main_code = "extends Reference\n";
+	for (int i = 0; i < child_count; i++) {
+		_write_file(dir.plus_file(vformat("child_%d.gd", i)), "extends LoadGraphTestBase\nfunc get_value():\n\treturn .get_value() + 1\n");
+		main_code += vformat("const Child%d = preload(\"child_%d.gd\")\n", i, i);
+	}
+	_write_file(main_path, main_code);
+
+	ProjectSettings::get_singleton()->set("autoload/LoadGraphTestBase", "*" + base_path);
+	const bool was_enabled = GDScriptLoadGraph::is_enabled();
+	GDScriptLoadGraph::set_enabled(true);
+
+	int failed = 0;
+	for (int round = 0; round < 8; round++) {
+		Ref<GDScript> main_script = ResourceLoader::load(main_path);
+		Ref<GDScript> base = Ref<Resource>(ResourceCache::get(base_path));
+		if (main_script.is_null() || base.is_null()) {
+			print_line("Could not load the test scripts.");
+			failed++;
+			break;
+		}
+
+		for (int i = 0; i < child_count; i++) {
+			Ref<GDScript> child = Ref<Resource>(ResourceCache::get(dir.plus_file(vformat("child_%d.gd", i))));
+			if (child.is_null() || child->get_base() != base) {
+				failed++;
+			}
+		}
+	}
+
+	GDScriptLoadGraph::set_enabled(was_enabled);
+	ProjectSettings::get_singleton()->set("autoload/LoadGraphTestBase", Variant());
+	for (int i = 0; i < child_count; i++) {
+		da->remove(dir.plus_file(vformat("child_%d.gd", i)));
+	}
+	da->remove(base_path);
+	da->remove(main_path);
+	da->remove(dir);
+
+	if (failed) {
+		print_line(vformat("FAILED: %d scripts were compiled against a copy of their autoload base class.", failed));
+	} else {
+		print_line("PASS");
+	}
+	return nullptr;
+}
+
+// yield(timer, "timeout") is a one-shot connection like any other, so coroutines
+// resume along with the timer's other connections, and emitting the signal by hand
+// resumes them too. Coroutines yielding on the same signal again during the emission
+// are only resumed by the next one, and regular connections stay.
+static const char *yield_order_code =
+		"extends Reference\n"
+		"\n"
+		"var order = []\n"
+		"\n"
+		"class Handler:\n"
+		"\tvar order\n"
+		"\tfunc on_timeout():\n"
+		"\t\torder.append(\"handler\")\n"
+		"\n"
+		"class Emitter:\n"
+		"\tsignal tick\n"
+		"\n"
+		"func _wait(timer, name):\n"
+		"\tyield(timer, \"timeout\")\n"
+		"\torder.append(name)\n"
+		"\n"
+		"func _loop(emitter, name, rounds):\n"
+		"\tfor i in range(rounds):\n"
+		"\t\tyield(emitter, \"tick\")\n"
+		"\t\torder.append(name + str(i))\n"
+		"\n"
+		"func run(tree):\n"
+		"\tvar timer = tree.create_timer(0.0)\n"
+		"\t_wait(timer, \"first\")\n"
+		"\tvar handler = Handler.new()\n"
+		"\thandler.order = order\n"
+		"\ttimer.connect(\"timeout\", handler, \"on_timeout\")\n"
+		"\t_wait(timer, \"second\")\n"
+		"\ttree.idle(0.016)\n"
+		"\n"
+		"\tvar manual = tree.create_timer(100.0)\n"
+		"\t_wait(manual, \"manual\")\n"
+		"\tmanual.emit_signal(\"timeout\")\n"
+		"\n"
+		"\tvar emitter = Emitter.new()\n"
+		"\t_loop(emitter, \"a\", 2)\n"
+		"\tvar ticker = Handler.new()\n"
+		"\tticker.order = order\n"
+		"\temitter.connect(\"tick\", ticker, \"on_timeout\")\n"
+		"\t_loop(emitter, \"b\", 1)\n"
+		"\tfor i in range(3):\n"
+		"\t\temitter.emit_signal(\"tick\")\n"
+		"\torder.append(emitter.get_signal_connection_list(\"tick\").size())\n"
+		"\treturn order\n";
+
+MainLoop *test_yield_order() {
+	Ref<GDScript> script = _compile_script(yield_order_code, "res://yield_order.gd", true);
+	ERR_FAIL_COND_V(script.is_null(), nullptr);
+
+	Ref<Reference> instance;
+	instance.instance();
+	instance->set_script(script.get_ref_ptr());
+
+	SceneTree *tree = memnew(SceneTree);
+	tree->init();
+	Array order = instance->call("run", tree);
+	tree->finish();
+	memdelete(tree);
+
+	// Signals call their targets in the order they were created.
+	Array expected;
+	expected.push_back("first");
+	expected.push_back("handler");
+	expected.push_back("second");
+	expected.push_back("manual");
+	expected.push_back("a0");
+	expected.push_back("handler");
+	expected.push_back("b0");
+	expected.push_back("handler");
+	expected.push_back("a1");
+	expected.push_back("handler");
+	expected.push_back(1);
+
+	if (Variant(order) == Variant(expected)) {
+		print_line("PASS");
+	} else {
+		print_line("FAILED: coroutines resumed in this order: " + Variant(order).get_construct_string());
+	}
+	return nullptr;
+}
+
 MainLoop *test(TestType p_type) {
 	List<String> cmdlargs = OS::get_singleton()->get_cmdline_args();
 
@@ -1006,8 +1456,69 @@ MainLoop *test(TestType p_type) {
 			current = current->get_base();
 		}
 
+	} else if (p_type == TEST_OPTIMIZER) {
+		// Compile the way release exports do and dump the result, to check what the optimizer did.
+		Ref<GDScript> plain = _compile_script(code, test, true, true, false);
+		Ref<GDScript> optimized = _compile_script(code, test, true, true, true);
+		if (plain.is_null() || optimized.is_null()) {
+			memdelete(fa);
+			return nullptr;
+		}
+
+		Ref<GDScript> current = optimized;
+		while (current.is_valid()) {
+			print_line("** CLASS **");
+			_disassemble_class(current, lines);
+
+			current = current->get_base();
+		}
+
+		print_line(vformat("Code size: %d words, %d without optimizations.", _get_code_size(optimized), _get_code_size(plain)));
+
+		// Functions named test_*() without arguments must return the same either way.
+		int mismatches = _compare_optimized(plain, optimized, "test_");
+		if (mismatches) {
+			print_line(vformat("%d functions returned different results once optimized.", mismatches));
+		}
+
+	} else if (p_type == TEST_BENCHMARK) {
+		_run_benchmarks(code, test);
+
 	} else if (p_type == TEST_BYTECODE) {
 		Vector<uint8_t> buf2 = GDScriptTokenizerBuffer::parse_code_string(code);
+
+		// Precompile the same way exports do, and check the result loads back.
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		Ref<GDScript> gds = _compile_script(code, test, true);
+		uint64_t compile_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+		Vector<uint8_t> compiled;
+		if (gds.is_valid() && GDScriptBytecode::serialize(gds.ptr(), test, compiled) == OK) {
+			Ref<GDScript> loaded;
+			loaded.instance();
+
+			from = OS::get_singleton()->get_ticks_usec();
+			Error err = GDScriptBytecode::deserialize(loaded.ptr(), compiled);
+			uint64_t load_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+			if (err) {
+				print_line("Could not load the precompiled code back, error " + itos(err) + ".");
+			} else {
+				const Map<StringName, GDScriptFunction *> &functions = gds->get_member_functions();
+				for (const Map<StringName, GDScriptFunction *>::Element *E = functions.front(); E; E = E->next()) {
+					const GDScriptFunction *loaded_func = loaded->get_member_functions().has(E->key()) ? loaded->get_member_functions()[E->key()] : nullptr;
+					if (!loaded_func || loaded_func->get_code_size() != E->get()->get_code_size() || memcmp(loaded_func->get_code(), E->get()->get_code(), E->get()->get_code_size() * sizeof(int)) != 0) {
+						print_line("Function '" + String(E->key()) + "' doesn't match after loading.");
+					}
+				}
+
+				print_line(vformat("Compiled in %.2f ms, loaded precompiled code (%d bytes) in %.2f ms.", compile_usec / 1000.0, compiled.size(), load_usec / 1000.0));
+				buf2 = GDScriptBytecode::make_container(buf2, compiled);
+			}
+		} else {
+			print_line("Could not precompile, only saving tokens.");
+		}
+
 		String dst = test.get_basename() + ".gdc";
 		FileAccess *fw = FileAccess::open(dst, FileAccess::WRITE);
 		fw->store_buffer(buf2.ptr(), buf2.size());
@@ -1028,6 +1539,21 @@ MainLoop *test(TestType p_type) {
 	ERR_PRINT("The GDScript module is disabled, therefore GDScript tests cannot be used.");
 	return NULL;
 }
+
+MainLoop *test_optimizer() {
+	ERR_PRINT("The GDScript module is disabled, therefore GDScript tests cannot be used.");
+	return NULL;
+}
+
+MainLoop *test_load_graph() {
+	ERR_PRINT("The GDScript module is disabled, therefore GDScript tests cannot be used.");
+	return NULL;
+}
+
+MainLoop *test_yield_order() {
+	ERR_PRINT("The GDScript module is disabled, therefore GDScript tests cannot be used.");
+	return NULL;
+}
 } // namespace TestGDScript
 
 #endif
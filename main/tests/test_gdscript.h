@@ -40,9 +40,14 @@ enum TestType {
 	TEST_PARSER,
 	TEST_COMPILER,
 	TEST_BYTECODE,
+	TEST_OPTIMIZER,
+	TEST_BENCHMARK,
 };
 
 MainLoop *test(TestType p_type);
+MainLoop *test_load_graph();
+MainLoop *test_optimizer();
+MainLoop *test_yield_order();
 } // namespace TestGDScript
 
 #endif // TEST_GDSCRIPT_H
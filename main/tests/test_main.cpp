@@ -36,18 +36,29 @@
 
 #include "test_astar.h"
 #include "test_basis.h"
+#include "test_bvh.h"
+#include "test_command_queue.h"
 #include "test_crypto.h"
+#include "test_dictionary.h"
+#include "test_expression.h"
 #include "test_gdscript.h"
 #include "test_gui.h"
 #include "test_math.h"
+#include "test_memory.h"
+#include "test_mesh_simplifier.h"
+#include "test_method_call.h"
 #include "test_oa_hash_map.h"
 #include "test_ordered_hash_map.h"
 #include "test_physics.h"
 #include "test_physics_2d.h"
+#include "test_pool_vector.h"
 #include "test_render.h"
 #include "test_shader_lang.h"
 #include "test_string.h"
+#include "test_trace_profiler.h"
 #include "test_transform.h"
+#include "test_visual_script.h"
+#include "test_worker_thread_pool.h"
 #include "test_xml_parser.h"
 
 const char **tests_get_names() {
@@ -59,6 +70,9 @@ const char **tests_get_names() {
 		"physics",
 		"physics_2d",
 		"render",
+		"render_instances",
+		"bvh",
+		"mesh_simplifier",
 		"oa_hash_map",
 		"gui",
 		"shaderlang",
@@ -66,7 +80,21 @@ const char **tests_get_names() {
 		"gd_parser",
 		"gd_compiler",
 		"gd_bytecode",
+		"gd_optimizer",
+		"gd_benchmark",
+		"gd_optimizer_results",
+		"gd_load_graph",
+		"gd_yield_order",
 		"ordered_hash_map",
+		"dictionary",
+		"pool_vector",
+		"memory",
+		"command_queue",
+		"trace_profiler",
+		"worker_thread_pool",
+		"method_call",
+		"expression",
+		"visual_script",
 		"astar",
 		"xml_parser",
 		nullptr
@@ -104,6 +132,18 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestRender::test();
 	}
 
+	if (p_test == "render_instances") {
+		return TestRender::test_instance_update();
+	}
+
+	if (p_test == "bvh") {
+		return TestBVH::test();
+	}
+
+	if (p_test == "mesh_simplifier") {
+		return TestMeshSimplifier::test();
+	}
+
 	if (p_test == "oa_hash_map") {
 		return TestOAHashMap::test();
 	}
@@ -138,10 +178,66 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestGDScript::test(TestGDScript::TEST_BYTECODE);
 	}
 
+	if (p_test == "gd_optimizer") {
+		return TestGDScript::test(TestGDScript::TEST_OPTIMIZER);
+	}
+
+	if (p_test == "gd_benchmark") {
+		return TestGDScript::test(TestGDScript::TEST_BENCHMARK);
+	}
+
+	if (p_test == "gd_optimizer_results") {
+		return TestGDScript::test_optimizer();
+	}
+
+	if (p_test == "gd_load_graph") {
+		return TestGDScript::test_load_graph();
+	}
+
+	if (p_test == "gd_yield_order") {
+		return TestGDScript::test_yield_order();
+	}
+
 	if (p_test == "ordered_hash_map") {
 		return TestOrderedHashMap::test();
 	}
 
+	if (p_test == "dictionary") {
+		return TestDictionary::test();
+	}
+
+	if (p_test == "pool_vector") {
+		return TestPoolVector::test();
+	}
+
+	if (p_test == "memory") {
+		return TestMemory::test();
+	}
+
+	if (p_test == "command_queue") {
+		return TestCommandQueue::test();
+	}
+
+	if (p_test == "trace_profiler") {
+		return TestTraceProfiler::test();
+	}
+
+	if (p_test == "worker_thread_pool") {
+		return TestWorkerThreadPool::test();
+	}
+
+	if (p_test == "method_call") {
+		return TestMethodCall::test();
+	}
+
+	if (p_test == "expression") {
+		return TestExpression::test();
+	}
+
+	if (p_test == "visual_script") {
+		return TestVisualScript::test();
+	}
+
 	if (p_test == "astar") {
 		return TestAStar::test();
 	}
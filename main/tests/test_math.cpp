@@ -393,6 +393,104 @@ uint32_t ihash3(uint32_t a) {
 	return a;
 }
 
+// Compares the batch kernels against the per-element functions they replace.
+void benchmark_batch_kernels() {
+	OS *os = OS::get_singleton();
+	const int count = 1000000;
+	const int passes = 10;
+
+	Vector<Vector3> points;
+	Vector<AABB> boxes;
+	Vector<Quat> quats_from;
+	Vector<Quat> quats_to;
+	points.resize(count);
+	boxes.resize(count);
+	quats_from.resize(count);
+	quats_to.resize(count);
+	for (int i = 0; i < count; i++) {
+		const Vector3 v(Math::randf() - 0.5, Math::randf() - 0.5, Math::randf() - 0.5);
+		points.write[i] = v * 200.0;
+		boxes.write[i] = AABB(v * 200.0, Vector3(Math::randf(), Math::randf(), Math::randf()) * 4.0);
+		quats_from.write[i] = Quat(v.normalized(), Math::randf() * Math_PI);
+		quats_to.write[i] = Quat(Vector3(v.z, v.x, v.y).normalized(), Math::randf() * Math_PI);
+	}
+
+	Transform xform(Basis(Vector3(1, 2, 3).normalized(), 0.7).scaled(Vector3(1, 2, 1)), Vector3(4, 5, 6));
+	Vector<Vector3> xformed;
+	xformed.resize(count);
+
+	uint64_t t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		const Vector3 *src = points.ptr();
+		Vector3 *dst = xformed.ptrw();
+		for (int i = 0; i < count; i++) {
+			dst[i] = xform.xform(src[i]);
+		}
+	}
+	uint64_t scalar_time = os->get_ticks_usec() - t;
+	const Vector3 check = xformed[count - 1];
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		xform.xform_array(points.ptr(), xformed.ptrw(), count);
+	}
+	uint64_t batch_time = os->get_ticks_usec() - t;
+	os->print("Transform::xform: %d us, xform_array: %d us, match: %s\n", (int)scalar_time, (int)batch_time, check.is_equal_approx(xformed[count - 1]) ? "yes" : "NO");
+
+	CameraMatrix cm;
+	cm.set_perspective(70, 1.6, 0.05, 100);
+	const Transform camera(Basis(), Vector3(0, 0, 50));
+	Vector<Plane> planes = cm.get_projection_planes(camera);
+	Vector3 endpoints[8];
+	cm.get_endpoints(camera, endpoints);
+	Vector<uint32_t> visible;
+	visible.resize(count);
+
+	int scalar_visible = 0;
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		const AABB *src = boxes.ptr();
+		uint32_t *dst = visible.ptrw();
+		scalar_visible = 0;
+		for (int i = 0; i < count; i++) {
+			if (src[i].intersects_convex_shape(planes.ptr(), planes.size(), endpoints, 8)) {
+				dst[scalar_visible++] = i;
+			}
+		}
+	}
+	scalar_time = os->get_ticks_usec() - t;
+
+	int batch_visible = 0;
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		batch_visible = AABB::cull_convex_array(boxes.ptr(), count, planes.ptr(), planes.size(), endpoints, 8, visible.ptrw());
+	}
+	batch_time = os->get_ticks_usec() - t;
+	os->print("AABB::intersects_convex_shape: %d us, cull_convex_array: %d us, visible: %d/%d\n", (int)scalar_time, (int)batch_time, scalar_visible, batch_visible);
+
+	Vector<Quat> slerped;
+	slerped.resize(count);
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		const Quat *from = quats_from.ptr();
+		const Quat *to = quats_to.ptr();
+		Quat *dst = slerped.ptrw();
+		for (int i = 0; i < count; i++) {
+			dst[i] = from[i].slerp(to[i], 0.3);
+		}
+	}
+	scalar_time = os->get_ticks_usec() - t;
+	const Quat check_quat = slerped[count - 1];
+
+	t = os->get_ticks_usec();
+	for (int p = 0; p < passes; p++) {
+		Quat::slerp_array(quats_from.ptr(), quats_to.ptr(), 0.3, slerped.ptrw(), count);
+	}
+	batch_time = os->get_ticks_usec() - t;
+	os->print("Quat::slerp: %d us, slerp_array: %d us, match: %s\n", (int)scalar_time, (int)batch_time, check_quat.is_equal_approx(slerped[count - 1]) ? "yes" : "NO");
+}
+
 MainLoop *test() {
 	{
 		float r = 1;
@@ -441,9 +539,9 @@ MainLoop *test() {
 		print_line("RGBE: " + Color(rd, gd, bd));
 	}
 
-	print_line("Dvectors: " + itos(MemoryPool::allocs_used));
-	print_line("Mem used: " + itos(MemoryPool::total_memory));
-	print_line("MAx mem used: " + itos(MemoryPool::max_memory));
+	print_line("Dvectors: " + itos(MemoryPool::allocs_used.get()));
+	print_line("Mem used: " + itos(MemoryPool::total_memory.get()));
+	print_line("MAx mem used: " + itos(MemoryPool::max_memory.get()));
 
 	PoolVector<int> ints;
 	ints.resize(20);
@@ -465,9 +563,9 @@ MainLoop *test() {
 		}
 	}
 
-	print_line("later Dvectors: " + itos(MemoryPool::allocs_used));
-	print_line("later Mem used: " + itos(MemoryPool::total_memory));
-	print_line("Mlater Ax mem used: " + itos(MemoryPool::max_memory));
+	print_line("later Dvectors: " + itos(MemoryPool::allocs_used.get()));
+	print_line("later Mem used: " + itos(MemoryPool::total_memory.get()));
+	print_line("Mlater Ax mem used: " + itos(MemoryPool::max_memory.get()));
 
 	List<String> cmdlargs = OS::get_singleton()->get_cmdline_args();
 
@@ -480,6 +578,7 @@ MainLoop *test() {
 	if (test == "math") {
 		// Not a file name but the test name, abort.
 		// FIXME: This test is ugly as heck, needs fixing :)
+		benchmark_batch_kernels();
 		return nullptr;
 	}
 
@@ -0,0 +1,198 @@
+/*************************************************************************/
+/*  test_memory.cpp                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_memory.h"
+
+#include "core/local_vector.h"
+#include "core/map.h"
+#include "core/os/memory.h"
+#include "core/os/os.h"
+
+namespace TestMemory {
+
+bool test_arena_alignment() {
+	MemoryArena arena(1024);
+	uint8_t *prev = nullptr;
+	for (int i = 1; i < 100; i++) {
+		uint8_t *ptr = (uint8_t *)arena.alloc(i);
+		if (((uintptr_t)ptr) % 16 != 0 || ptr == prev) {
+			return false;
+		}
+		// must not overlap the previous allocation
+		if (prev && ptr > prev && ptr < prev + (i - 1)) {
+			return false;
+		}
+		memset(ptr, i, i);
+		prev = ptr;
+	}
+	return arena.get_used() > 0 && arena.get_capacity() >= arena.get_used();
+}
+
+bool test_arena_reset_and_reuse() {
+	MemoryArena arena(1024);
+
+	// several chunks the first time around
+	for (int i = 0; i < 100; i++) {
+		arena.alloc(100);
+	}
+	size_t capacity = arena.get_capacity();
+	arena.reset();
+	if (arena.get_used() != 0 || arena.get_capacity() != capacity) {
+		return false;
+	}
+
+	// after the reset everything fits in one chunk, so the same workload reuses it
+	void *first = arena.alloc(100);
+	for (int i = 1; i < 100; i++) {
+		arena.alloc(100);
+	}
+	if (arena.get_capacity() != capacity) {
+		return false;
+	}
+	arena.reset();
+	return arena.alloc(100) == first && arena.get_capacity() == capacity;
+}
+
+bool test_frame_reset_and_reuse() {
+	// settle the arena into a single chunk
+	FrameAllocator::next_frame();
+	FrameAllocator::alloc(4096);
+	FrameAllocator::next_frame();
+
+	void *a = FrameAllocator::alloc(256);
+	FrameAllocator::next_frame();
+	void *b = FrameAllocator::alloc(256);
+	if (a != b) {
+		return false;
+	}
+
+	// same frame, new memory
+	void *c = FrameAllocator::alloc(256);
+	return c != b && FrameAllocator::get_capacity() > 0;
+}
+
+bool test_frame_scope() {
+	FrameAllocator::Scope scope;
+
+	uint8_t *a = (uint8_t *)FrameAllocator::alloc(64);
+	memset(a, 0xAB, 64);
+
+	// a frame ends while the scope is still using its memory
+	FrameAllocator::next_frame();
+	uint8_t *b = (uint8_t *)FrameAllocator::alloc(64);
+	memset(b, 0xCD, 64);
+
+	if (b == a) {
+		return false;
+	}
+	for (int i = 0; i < 64; i++) {
+		if (a[i] != 0xAB) {
+			return false;
+		}
+	}
+
+	{
+		// nested scopes don't reset either
+		FrameAllocator::Scope nested;
+		FrameAllocator::next_frame();
+		uint8_t *c = (uint8_t *)FrameAllocator::alloc(64);
+		if (c == a || c == b || a[0] != 0xAB || b[0] != 0xCD) {
+			return false;
+		}
+	}
+	return a[63] == 0xAB && b[63] == 0xCD;
+}
+
+bool test_frame_containers() {
+	FrameAllocator::Scope scope;
+
+	LocalVector<int, uint32_t, false, FrameAllocator> values;
+	for (int i = 0; i < 10000; i++) {
+		values.push_back(i);
+	}
+	for (int i = 0; i < 10000; i++) {
+		if (values[i] != i) {
+			return false;
+		}
+	}
+
+	Map<int, int, Comparator<int>, FrameAllocator> map;
+	for (int i = 0; i < 1000; i++) {
+		map[(i * 7919) % 1000] = i;
+	}
+	int expected = 0;
+	for (Map<int, int, Comparator<int>, FrameAllocator>::Element *E = map.front(); E; E = E->next()) {
+		if (E->key() != expected++) {
+			return false;
+		}
+	}
+	return expected == 1000;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_arena_alignment,
+	test_arena_reset_and_reuse,
+	test_frame_reset_and_reuse,
+	test_frame_scope,
+	test_frame_containers,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestMemory
@@ -0,0 +1,323 @@
+/*************************************************************************/
+/*  test_mesh_simplifier.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_mesh_simplifier.h"
+
+#include "core/math/mesh_simplifier.h"
+#include "core/os/os.h"
+#include "scene/resources/mesh.h"
+
+namespace TestMeshSimplifier {
+
+enum {
+	GRID_SIZE = 32,
+};
+
+// A bumpy square made of two halves that don't share vertices, like a UV seam
+// down the middle.
+static void _make_grid(PoolVector<Vector3> &r_vertices, PoolVector<int> &r_indices) {
+	const int half = GRID_SIZE / 2;
+	r_vertices.resize(0);
+	r_indices.resize(0);
+
+	for (int side = 0; side < 2; side++) {
+		int base = r_vertices.size();
+		for (int y = 0; y <= GRID_SIZE; y++) {
+			for (int x = 0; x <= half; x++) {
+				real_t fx = real_t(side * half + x) / GRID_SIZE;
+				real_t fy = real_t(y) / GRID_SIZE;
+				r_vertices.push_back(Vector3(fx, 0.05 * Math::sin(fx * 6.0) * Math::cos(fy * 5.0), fy));
+			}
+		}
+
+		for (int y = 0; y < GRID_SIZE; y++) {
+			for (int x = 0; x < half; x++) {
+				int i = base + y * (half + 1) + x;
+				r_indices.push_back(i);
+				r_indices.push_back(i + half + 1);
+				r_indices.push_back(i + 1);
+				r_indices.push_back(i + 1);
+				r_indices.push_back(i + half + 1);
+				r_indices.push_back(i + half + 2);
+			}
+		}
+	}
+}
+
+// Vertices on an open edge, or sharing their position with another vertex.
+static Vector<bool> _find_locked(const PoolVector<Vector3> &p_vertices, const PoolVector<int> &p_indices) {
+	Vector<bool> locked;
+	locked.resize(p_vertices.size());
+	for (int i = 0; i < p_vertices.size(); i++) {
+		locked.write[i] = false;
+		for (int j = 0; j < p_vertices.size(); j++) {
+			if (i != j && p_vertices[i] == p_vertices[j]) {
+				locked.write[i] = true;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < p_indices.size(); i++) {
+		int a = p_indices[i];
+		int b = p_indices[(i % 3) == 2 ? i - 2 : i + 1];
+		bool reverse = false;
+		for (int j = 0; j < p_indices.size() && !reverse; j++) {
+			reverse = p_indices[j] == b && p_indices[(j % 3) == 2 ? j - 2 : j + 1] == a;
+		}
+		if (!reverse) {
+			locked.write[a] = true;
+			locked.write[b] = true;
+		}
+	}
+	return locked;
+}
+
+static bool _check_triangles(const PoolVector<Vector3> &p_vertices, const PoolVector<int> &p_indices) {
+	if (p_indices.size() % 3 != 0) {
+		OS::get_singleton()->print("\tindex count is not a multiple of 3\n");
+		return false;
+	}
+
+	for (int i = 0; i < p_indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			if (p_indices[i + k] < 0 || p_indices[i + k] >= p_vertices.size()) {
+				OS::get_singleton()->print("\tindex %d out of range\n", p_indices[i + k]);
+				return false;
+			}
+		}
+
+		const Vector3 &v0 = p_vertices[p_indices[i + 0]];
+		const Vector3 &v1 = p_vertices[p_indices[i + 1]];
+		const Vector3 &v2 = p_vertices[p_indices[i + 2]];
+		if (v0 == v1 || v1 == v2 || v2 == v0) {
+			OS::get_singleton()->print("\tdegenerate triangle %d\n", i / 3);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_reduce_to_target() {
+	PoolVector<Vector3> vertices;
+	PoolVector<int> indices;
+	_make_grid(vertices, indices);
+
+	bool pass = true;
+	for (int divisor = 2; divisor <= 8; divisor *= 2) {
+		int target = indices.size() / divisor;
+		PoolVector<int> result = MeshSimplifier::simplify(vertices, indices, target, 1.0);
+		pass = pass && _check_triangles(vertices, result);
+
+		// stops as soon as it gets there, a pass never removes more than it needs to
+		if (result.size() > target || result.size() < target - 6) {
+			OS::get_singleton()->print("\t%d indices for a target of %d\n", result.size(), target);
+			pass = false;
+		}
+	}
+	return pass;
+}
+
+bool test_locked_vertices() {
+	PoolVector<Vector3> vertices;
+	PoolVector<int> indices;
+	_make_grid(vertices, indices);
+	Vector<bool> locked = _find_locked(vertices, indices);
+
+	PoolVector<int> result = MeshSimplifier::simplify(vertices, indices, 0, 1.0);
+	if (!_check_triangles(vertices, result)) {
+		return false;
+	}
+	if (result.size() >= indices.size()) {
+		OS::get_singleton()->print("\tnothing was simplified\n");
+		return false;
+	}
+
+	Vector<bool> used;
+	used.resize(vertices.size());
+	for (int i = 0; i < used.size(); i++) {
+		used.write[i] = false;
+	}
+	for (int i = 0; i < result.size(); i++) {
+		used.write[result[i]] = true;
+	}
+
+	// collapsing a locked vertex away would move the border or open the seam
+	for (int i = 0; i < vertices.size(); i++) {
+		if (locked[i] && !used[i]) {
+			OS::get_singleton()->print("\tlocked vertex %d was collapsed\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_error_limit() {
+	PoolVector<Vector3> vertices;
+	PoolVector<int> indices;
+	_make_grid(vertices, indices);
+
+	bool pass = true;
+	int last_size = 0;
+	const real_t limits[] = { 0.0001, 0.001, 0.01 };
+	for (int i = 0; i < 3; i++) {
+		real_t error = -1;
+		PoolVector<int> result = MeshSimplifier::simplify(vertices, indices, 0, limits[i], &error);
+		pass = pass && _check_triangles(vertices, result);
+
+		if (error < 0 || error > limits[i]) {
+			OS::get_singleton()->print("\terror %f over the limit %f\n", error, limits[i]);
+			pass = false;
+		}
+		// a looser limit never gives a finer result
+		if (i > 0 && result.size() > last_size) {
+			OS::get_singleton()->print("\t%d indices with limit %f, %d with a tighter one\n", result.size(), limits[i], last_size);
+			pass = false;
+		}
+		last_size = result.size();
+	}
+	return pass;
+}
+
+bool test_array_mesh_lods() {
+	PoolVector<Vector3> vertices;
+	PoolVector<int> indices;
+	_make_grid(vertices, indices);
+
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = vertices;
+	arrays[Mesh::ARRAY_INDEX] = indices;
+
+	Ref<ArrayMesh> mesh;
+	mesh.instance();
+	mesh->add_surface_from_arrays(Mesh::PRIMITIVE_TRIANGLES, arrays);
+	mesh->generate_lods();
+
+	Vector<VS::SurfaceLOD> lods = VS::get_singleton()->mesh_surface_get_lods(mesh->get_rid(), 0);
+	if (lods.size() == 0 || mesh->surface_get_lod_count(0) != lods.size()) {
+		OS::get_singleton()->print("\tno LODs were generated\n");
+		return false;
+	}
+
+	bool pass = true;
+	int last_count = indices.size();
+	for (int i = 0; i < lods.size(); i++) {
+		// fewer than 65536 vertices, so 16 bit indices
+		const VS::SurfaceLOD &lod = lods[i];
+		if (lod.index_count >= last_count || lod.index_array.size() != lod.index_count * 2) {
+			OS::get_singleton()->print("\tLOD %d has %d indices in %d bytes\n", i, lod.index_count, lod.index_array.size());
+			pass = false;
+			continue;
+		}
+		last_count = lod.index_count;
+
+		PoolVector<int> lod_indices;
+		lod_indices.resize(lod.index_count);
+		{
+			PoolVector<uint8_t>::Read r = lod.index_array.read();
+			PoolVector<int>::Write w = lod_indices.write();
+			for (int j = 0; j < lod.index_count; j++) {
+				w[j] = r[j * 2] | (r[j * 2 + 1] << 8);
+			}
+		}
+		pass = pass && _check_triangles(vertices, lod_indices);
+	}
+
+	// LODs are saved with the surface
+	Ref<ArrayMesh> loaded;
+	loaded.instance();
+	loaded->set("surfaces/0", mesh->get("surfaces/0"));
+
+	Vector<VS::SurfaceLOD> loaded_lods = VS::get_singleton()->mesh_surface_get_lods(loaded->get_rid(), 0);
+	if (loaded_lods.size() != lods.size()) {
+		OS::get_singleton()->print("\t%d LODs saved, %d loaded\n", lods.size(), loaded_lods.size());
+		return false;
+	}
+	for (int i = 0; i < lods.size(); i++) {
+		const VS::SurfaceLOD &a = lods[i];
+		const VS::SurfaceLOD &b = loaded_lods[i];
+		bool same = a.error == b.error && a.index_count == b.index_count && a.index_array.size() == b.index_array.size();
+		for (int j = 0; same && j < a.index_array.size(); j++) {
+			same = a.index_array[j] == b.index_array[j];
+		}
+		if (!same) {
+			OS::get_singleton()->print("\tLOD %d changed after loading\n", i);
+			pass = false;
+		}
+	}
+
+	mesh->clear_lods();
+	if (mesh->surface_get_lod_count(0) != 0) {
+		OS::get_singleton()->print("\tLODs left after clear_lods()\n");
+		pass = false;
+	}
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_reduce_to_target,
+	test_locked_vertices,
+	test_error_limit,
+	test_array_mesh_lods,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestMeshSimplifier
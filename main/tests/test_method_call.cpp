@@ -0,0 +1,227 @@
+/*************************************************************************/
+/*  main/tests/test_method_call.cpp                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_method_call.h"
+
+#include "core/class_db.h"
+#include "core/method_bind.h"
+#include "core/os/os.h"
+
+namespace TestMethodCall {
+
+class MethodCallTarget : public Object {
+	GDCLASS(MethodCallTarget, Object);
+
+protected:
+	static void _bind_methods() {
+		ClassDB::bind_method(D_METHOD("noop"), &MethodCallTarget::noop);
+		ClassDB::bind_method(D_METHOD("add", "a", "b"), &MethodCallTarget::add);
+		ClassDB::bind_method(D_METHOD("scale", "vector", "factor"), &MethodCallTarget::scale);
+	}
+
+public:
+	int64_t total = 0;
+
+	void noop() {}
+	int64_t add(int64_t p_a, int64_t p_b) {
+		total += p_a;
+		return p_a + p_b;
+	}
+	Vector3 scale(const Vector3 &p_vector, real_t p_factor) const { return p_vector * p_factor; }
+};
+
+class MethodCallTargetDerived : public MethodCallTarget {
+	GDCLASS(MethodCallTargetDerived, MethodCallTarget);
+
+protected:
+	static void _bind_methods() {
+		ClassDB::bind_method(D_METHOD("derived_only"), &MethodCallTargetDerived::derived_only);
+	}
+
+public:
+	int derived_only() { return 42; }
+};
+
+// What get_method() did before it had a cache, used as the reference and the baseline.
+MethodBind *get_method_uncached(const StringName &p_class, const StringName &p_name) {
+	RWLockRead read_lock(ClassDB::lock);
+	ClassDB::ClassInfo *type = ClassDB::classes.getptr(p_class);
+	while (type) {
+		MethodBind **method = type->method_map.getptr(p_name);
+		if (method && *method) {
+			return *method;
+		}
+		type = type->inherits_ptr;
+	}
+	return nullptr;
+}
+
+bool test_lookup() {
+	const char *classes[] = { "MethodCallTarget", "MethodCallTargetDerived", "Object", "Node", "Spatial", "NotAClass" };
+	const char *methods[] = { "noop", "add", "derived_only", "get_class", "add_child", "set_translation", "not_a_method" };
+	// Twice, so the second pass hits the cache.
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < 6; i++) {
+			for (int j = 0; j < 7; j++) {
+				if (ClassDB::get_method(classes[i], methods[j]) != get_method_uncached(classes[i], methods[j])) {
+					OS::get_singleton()->print("\tMismatch for %s::%s\n", classes[i], methods[j]);
+					return false;
+				}
+			}
+		}
+	}
+	return ClassDB::get_method("MethodCallTargetDerived", "add") == ClassDB::get_method("MethodCallTarget", "add");
+}
+
+bool test_call() {
+	MethodCallTargetDerived *obj = memnew(MethodCallTargetDerived);
+	Variant::CallError ce;
+	Variant v = obj;
+	bool ok = obj->call("add", 2, 3) == Variant(5);
+	ok = ok && v.call("add", 4, 5) == Variant(9);
+	ok = ok && obj->call("derived_only") == Variant(42);
+	ok = ok && obj->call("scale", Vector3(1, 2, 3), 2) == Variant(Vector3(2, 4, 6));
+	obj->call("not_a_method", nullptr, 0, ce);
+	ok = ok && ce.error == Variant::CallError::CALL_ERROR_INVALID_METHOD && obj->total == 6;
+	memdelete(obj);
+	return ok;
+}
+
+void benchmark() {
+	OS *os = OS::get_singleton();
+	const int count = 1000000;
+	MethodCallTargetDerived *obj = memnew(MethodCallTargetDerived);
+	const StringName class_name = obj->get_class_name();
+	const StringName add = "add";
+	const StringName get_class = "get_class";
+	const Variant a = 1;
+	const Variant b = 2;
+	const Variant *args[2] = { &a, &b };
+	Variant::CallError ce;
+	int found = 0;
+
+	uint64_t t = os->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		found += get_method_uncached(class_name, get_class) ? 1 : 0;
+	}
+	uint64_t uncached_time = os->get_ticks_usec() - t;
+
+	t = os->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		found += ClassDB::get_method(class_name, get_class) ? 1 : 0;
+	}
+	uint64_t cached_time = os->get_ticks_usec() - t;
+	os->print("\nMethod lookup through 3 classes, %d times:\n", count);
+	os->print("\tuncached %6d us, cached %6d us (%d)\n", (int)uncached_time, (int)cached_time, found);
+
+	MethodBind *method = ClassDB::get_method(class_name, add);
+	t = os->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		method->call(obj, args, 2, ce);
+	}
+	uint64_t bind_time = os->get_ticks_usec() - t;
+
+#ifdef PTRCALL_ENABLED
+	int64_t pa = 1;
+	int64_t pb = 2;
+	int64_t ret = 0;
+	const void *ptr_args[2] = { &pa, &pb };
+	t = os->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		method->ptrcall(obj, ptr_args, &ret);
+	}
+	uint64_t ptrcall_time = os->get_ticks_usec() - t;
+#endif
+
+	t = os->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		obj->call(add, args, 2, ce);
+	}
+	uint64_t object_time = os->get_ticks_usec() - t;
+
+	// The path GDScript call sites take.
+	Variant v = obj;
+	t = os->get_ticks_usec();
+	for (int i = 0; i < count; i++) {
+		v.call(add, args, 2, ce);
+	}
+	uint64_t variant_time = os->get_ticks_usec() - t;
+
+	os->print("\nCalling add(1, 2) %d times:\n", count);
+	os->print("\tMethodBind::call %6d us, Object::call %6d us, Variant::call %6d us\n", (int)bind_time, (int)object_time, (int)variant_time);
+#ifdef PTRCALL_ENABLED
+	os->print("\tMethodBind::ptrcall %6d us\n", (int)ptrcall_time);
+#endif
+
+	memdelete(obj);
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_lookup,
+	test_call,
+	nullptr
+
+};
+
+MainLoop *test() {
+	ClassDB::register_class<MethodCallTarget>();
+	ClassDB::register_class<MethodCallTargetDerived>();
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	benchmark();
+
+	return nullptr;
+}
+} // namespace TestMethodCall
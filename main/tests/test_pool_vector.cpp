@@ -0,0 +1,299 @@
+/*************************************************************************/
+/*  main/tests/test_pool_vector.cpp                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_pool_vector.h"
+
+#include "core/math/vector3.h"
+#include "core/os/os.h"
+#include "core/pool_vector.h"
+
+namespace TestPoolVector {
+
+bool test_resize_and_access() {
+	PoolVector<int> v;
+	if (v.size() != 0 || v.resize(1000) != OK || v.size() != 1000) {
+		return false;
+	}
+	{
+		PoolVector<int>::Write w = v.write();
+		for (int i = 0; i < 1000; i++) {
+			w[i] = i;
+		}
+	}
+	v.resize(2000);
+	for (int i = 1000; i < 2000; i++) {
+		v.set(i, i);
+	}
+	v.resize(1500);
+	PoolVector<int>::Read r = v.read();
+	for (int i = 0; i < 1500; i++) {
+		if (r[i] != i) {
+			return false;
+		}
+	}
+	return v[1499] == 1499;
+}
+
+bool test_copy_on_write() {
+	PoolVector<int> a;
+	for (int i = 0; i < 100; i++) {
+		a.push_back(i);
+	}
+	PoolVector<int> b = a;
+	PoolVector<int> c = a;
+	// All three share the same storage until one of them is written to.
+	if (a.read().ptr() != b.read().ptr() || a.read().ptr() != c.read().ptr()) {
+		return false;
+	}
+	b.set(0, -1);
+	c.resize(10);
+	if (a.read().ptr() == b.read().ptr() || a[0] != 0 || b[0] != -1 || c.size() != 10 || a.size() != 100) {
+		return false;
+	}
+	// Once it is the only owner, a write must not copy.
+	b = PoolVector<int>();
+	c = PoolVector<int>();
+	const int *before = a.read().ptr();
+	a.write()[5] = 55;
+	return a.read().ptr() == before && a[5] == 55;
+}
+
+bool test_insert_remove() {
+	PoolVector<int> v;
+	for (int i = 0; i < 10; i++) {
+		v.push_back(i);
+	}
+	v.insert(0, -1);
+	v.insert(v.size(), 10);
+	v.remove(5);
+	if (v.size() != 11 || v[0] != -1 || v[4] != 3 || v[5] != 5 || v[10] != 10) {
+		return false;
+	}
+	PoolVector<int> other;
+	other.push_back(100);
+	v.append_array(other);
+	v.invert();
+	return v.size() == 12 && v[0] == 100 && v[11] == -1;
+}
+
+bool test_subarray_and_strings() {
+	PoolVector<String> v;
+	for (int i = 0; i < 20; i++) {
+		v.push_back(itos(i));
+	}
+	PoolVector<String> copy = v;
+	PoolVector<String> sub = v.subarray(5, 9);
+	copy.set(5, "changed");
+	v.resize(3);
+	return sub.size() == 5 && sub[0] == "5" && sub[4] == "9" && v.size() == 3 && v[2] == "2" && copy[5] == "changed" && copy[19] == "19";
+}
+
+bool test_resize_while_locked() {
+	PoolVector<int> v;
+	v.resize(10);
+	{
+		PoolVector<int>::Read r = v.read();
+		const int *ptr = r.ptr();
+		// would move the memory under the Read, in every build and backend
+		if (!v.is_locked() || v.resize(100000) != ERR_LOCKED || v.size() != 10 || v.read().ptr() != ptr) {
+			return false;
+		}
+	}
+	return !v.is_locked() && v.resize(100000) == OK && v.size() == 100000;
+}
+
+#ifdef POOL_VECTOR_COW_ENABLED
+bool test_many_arrays() {
+	// Far more live arrays than the allocation table holds by default.
+	const int count = 100000;
+	PoolVector<uint8_t> *arrays = memnew_arr(PoolVector<uint8_t>, count);
+	for (int i = 0; i < count; i++) {
+		arrays[i].resize(4);
+		arrays[i].set(0, i & 0xFF);
+	}
+	bool ok = true;
+	for (int i = 0; i < count; i++) {
+		ok = ok && arrays[i].size() == 4 && arrays[i][0] == (i & 0xFF);
+	}
+	memdelete_arr(arrays);
+	return ok;
+}
+#endif
+
+void benchmark_mesh() {
+	OS *os = OS::get_singleton();
+	const int count = 1000000;
+	PoolVector3Array vertices;
+	vertices.resize(count);
+
+	uint64_t t = os->get_ticks_usec();
+	{
+		PoolVector3Array::Write w = vertices.write();
+		for (int i = 0; i < count; i++) {
+			w[i] = Vector3(i, i * 2, i * 3);
+		}
+	}
+	uint64_t fill_time = os->get_ticks_usec() - t;
+
+	// Per-element access opens a Read window for every call, which is what
+	// most scripts and importers end up doing.
+	t = os->get_ticks_usec();
+	Vector3 sum;
+	for (int i = 0; i < count; i++) {
+		sum += vertices[i];
+	}
+	uint64_t index_time = os->get_ticks_usec() - t;
+
+	// Short lived windows, like surface tools and mesh data tools reading triangles.
+	t = os->get_ticks_usec();
+	for (int i = 0; i < count; i += 3) {
+		PoolVector3Array::Read r = vertices.read();
+		sum += (r[i + 1] - r[i]).cross(r[i + 2] - r[i]);
+	}
+	uint64_t window_time = os->get_ticks_usec() - t;
+
+	// Duplicating a mesh array and modifying the copy.
+	t = os->get_ticks_usec();
+	for (int p = 0; p < 10; p++) {
+		PoolVector3Array copy = vertices;
+		copy.write()[p] = Vector3();
+	}
+	uint64_t cow_time = os->get_ticks_usec() - t;
+
+	// Creating and destroying many small arrays, like per-surface temporaries.
+	t = os->get_ticks_usec();
+	for (int i = 0; i < 100000; i++) {
+		PoolVector3Array small;
+		small.resize(8);
+		small.write()[0] = sum;
+	}
+	uint64_t small_time = os->get_ticks_usec() - t;
+
+	os->print("\nMesh workload, %d vertices:\n", count);
+	os->print("\tfill %6d us, operator[] %6d us, read windows %6d us, 10 copy-on-writes %6d us, 100000 small arrays %6d us (%f)\n", (int)fill_time, (int)index_time, (int)window_time, (int)cow_time, (int)small_time, sum.x);
+}
+
+void benchmark_image() {
+	OS *os = OS::get_singleton();
+	const int width = 2048;
+	const int height = 2048;
+	PoolByteArray src;
+	src.resize(width * height * 4);
+
+	// One write window per row, like Image::set_pixel based loops and format conversions.
+	uint64_t t = os->get_ticks_usec();
+	for (int y = 0; y < height; y++) {
+		PoolByteArray::Write w = src.write();
+		uint8_t *row = &w[y * width * 4];
+		for (int x = 0; x < width * 4; x++) {
+			row[x] = (x + y) & 0xFF;
+		}
+	}
+	uint64_t fill_time = os->get_ticks_usec() - t;
+
+	// Blit into a copy, which has to be detached from the source first.
+	t = os->get_ticks_usec();
+	PoolByteArray dst = src;
+	{
+		PoolByteArray::Read r = src.read();
+		PoolByteArray::Write w = dst.write();
+		for (int i = 0; i < width * height * 4; i += 4) {
+			w[i] = r[i + 2];
+			w[i + 2] = r[i];
+		}
+	}
+	uint64_t blit_time = os->get_ticks_usec() - t;
+
+	// Mipmap style halving, resizing the array in place.
+	t = os->get_ticks_usec();
+	int w_size = width;
+	int h_size = height;
+	while (w_size > 1 && h_size > 1) {
+		w_size /= 2;
+		h_size /= 2;
+		dst.resize(w_size * h_size * 4);
+	}
+	uint64_t resize_time = os->get_ticks_usec() - t;
+
+	os->print("\nImage workload, %dx%d RGBA8:\n", width, height);
+	os->print("\trow writes %6d us, blit %6d us, mipmap resizes %6d us (%d)\n", (int)fill_time, (int)blit_time, (int)resize_time, dst[0]);
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_resize_and_access,
+	test_copy_on_write,
+	test_insert_remove,
+	test_subarray_and_strings,
+	test_resize_while_locked,
+#ifdef POOL_VECTOR_COW_ENABLED
+	test_many_arrays,
+#endif
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+#ifdef POOL_VECTOR_COW_ENABLED
+	OS::get_singleton()->print("\nPoolVector backend: copy-on-write\n");
+#else
+	OS::get_singleton()->print("\nPoolVector backend: allocation table\n");
+#endif
+	benchmark_mesh();
+	benchmark_image();
+
+	return nullptr;
+}
+} // namespace TestPoolVector
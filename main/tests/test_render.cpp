@@ -36,6 +36,9 @@
 #include "core/os/main_loop.h"
 #include "core/os/os.h"
 #include "core/print_string.h"
+#include "core/project_settings.h"
+#include "servers/visual/visual_server_globals.h"
+#include "servers/visual/visual_server_scene.h"
 #include "servers/visual_server.h"
 
 #define OBJECT_COUNT 50
@@ -232,7 +235,248 @@ public:
 	}
 };
 
+// Moves every instance each frame and times update_dirty_instances(). Two scenarios hold the
+// same instances, one updated with the batched dirty instance update and the other one by one,
+// and their cull results are compared. Every few instances are skinned, with animated bones.
+// Run with: godot --test render_instances [instance count]
+class TestInstanceUpdateLoop : public MainLoop {
+	enum {
+		DEFAULT_INSTANCE_COUNT = 10000,
+		SKINNED_EVERY = 4,
+		SKELETON_BONES = 4,
+		REPORT_FRAMES = 100,
+		CHECK_FRAMES = 10,
+		ROUNDS = 8,
+	};
+
+	RID mesh;
+	RID skinned_mesh;
+	RID scenarios[2];
+	Vector<RID> instances[2];
+	Vector<RID> skeletons[2];
+	Vector<Transform> bases;
+
+	int frame;
+	uint64_t usec[2];
+	int cull_checks;
+	int cull_mismatches;
+	bool quit;
+
+	// Vertices of a cube, each one following one of the bones.
+	RID _create_skinned_cube() {
+		static const int faces[6][4] = {
+			{ 0, 2, 6, 4 },
+			{ 1, 5, 7, 3 },
+			{ 0, 4, 5, 1 },
+			{ 2, 3, 7, 6 },
+			{ 0, 1, 3, 2 },
+			{ 4, 6, 7, 5 },
+		};
+
+		PoolVector3Array vertices;
+		PoolIntArray bones;
+		PoolRealArray weights;
+		for (int i = 0; i < 8; i++) {
+			vertices.push_back(Vector3(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1));
+			for (int j = 0; j < 4; j++) {
+				bones.push_back(j == 0 ? i % SKELETON_BONES : 0);
+				weights.push_back(j == 0 ? 1.0 : 0.0);
+			}
+		}
+
+		PoolIntArray indices;
+		for (int i = 0; i < 6; i++) {
+			const int *f = faces[i];
+			indices.push_back(f[0]);
+			indices.push_back(f[1]);
+			indices.push_back(f[2]);
+			indices.push_back(f[0]);
+			indices.push_back(f[2]);
+			indices.push_back(f[3]);
+		}
+
+		Array arrays;
+		arrays.resize(VS::ARRAY_MAX);
+		arrays[VS::ARRAY_VERTEX] = vertices;
+		arrays[VS::ARRAY_BONES] = bones;
+		arrays[VS::ARRAY_WEIGHTS] = weights;
+		arrays[VS::ARRAY_INDEX] = indices;
+
+		VisualServer *vs = VisualServer::get_singleton();
+		RID cube = vs->mesh_create();
+		vs->mesh_add_surface_from_arrays(cube, VS::PRIMITIVE_TRIANGLES, arrays);
+		return cube;
+	}
+
+	void _move_instances(int p_scenario) {
+		VisualServer *vs = VisualServer::get_singleton();
+
+		// far enough to leave their leaves in the BVH now and then
+		Vector3 offset = Vector3(Math::sin(frame * 0.05), 0, Math::cos(frame * 0.05)) * 4.0;
+		for (int i = 0; i < bases.size(); i++) {
+			Transform xform = bases[i];
+			xform.origin += offset;
+			vs->instance_set_transform(instances[p_scenario][i], xform);
+		}
+
+		for (int i = 0; i < skeletons[p_scenario].size(); i++) {
+			for (int j = 0; j < SKELETON_BONES; j++) {
+				Transform bone;
+				bone.origin = Vector3(0, Math::sin(frame * 0.1 + i + j) * 2.0, 0);
+				vs->skeleton_bone_set_transform(skeletons[p_scenario][i], j, bone);
+			}
+		}
+	}
+
+	static Vector<ObjectID> _sorted(Vector<ObjectID> p_ids) {
+		p_ids.sort();
+		return p_ids;
+	}
+
+	void _check_culling() {
+		VisualServer *vs = VisualServer::get_singleton();
+		for (int i = 0; i < 8; i++) {
+			AABB aabb(Vector3(Math::random(-200, 200), Math::random(-200, 200), Math::random(-200, 200)), Vector3(40, 40, 40));
+			Vector<ObjectID> batched = _sorted(vs->instances_cull_aabb(aabb, scenarios[0]));
+			Vector<ObjectID> one_by_one = _sorted(vs->instances_cull_aabb(aabb, scenarios[1]));
+			cull_checks++;
+			if (batched.size() != one_by_one.size()) {
+				cull_mismatches++;
+				continue;
+			}
+			for (int j = 0; j < batched.size(); j++) {
+				if (batched[j] != one_by_one[j]) {
+					cull_mismatches++;
+					break;
+				}
+			}
+		}
+	}
+
+public:
+	virtual void input_event(const Ref<InputEvent> &p_event) {
+		if (p_event->is_pressed()) {
+			quit = true;
+		}
+	}
+
+	virtual void init() {
+		quit = false;
+		frame = 0;
+		usec[0] = usec[1] = 0;
+		cull_checks = 0;
+		cull_mismatches = 0;
+
+		if (OS::get_singleton()->get_render_thread_mode() == OS::RENDER_SEPARATE_THREAD) {
+			// update_dirty_instances() is called directly, it must run on this thread
+			ERR_PRINT("The instance update benchmark can't run with a separate rendering thread.");
+			quit = true;
+			return;
+		}
+
+		VisualServer *vs = VisualServer::get_singleton();
+		mesh = vs->get_test_cube();
+		skinned_mesh = _create_skinned_cube();
+
+		List<String> cmdline = OS::get_singleton()->get_cmdline_args();
+		int count = DEFAULT_INSTANCE_COUNT;
+		if (cmdline.size() > 0 && cmdline[cmdline.size() - 1].to_int()) {
+			count = cmdline[cmdline.size() - 1].to_int();
+		}
+
+		bases.resize(count);
+		for (int i = 0; i < count; i++) {
+			Transform base;
+			base.translate(Math::random(-200, 200), Math::random(-200, 200), Math::random(-200, 200));
+			base.rotate(Vector3(0, 1, 0), Math::randf() * Math_PI);
+			bases.write[i] = base;
+		}
+
+		for (int s = 0; s < 2; s++) {
+			scenarios[s] = vs->scenario_create();
+			instances[s].resize(count);
+			for (int i = 0; i < count; i++) {
+				bool skinned = i % SKINNED_EVERY == 0;
+				RID instance = vs->instance_create2(skinned ? skinned_mesh : mesh, scenarios[s]);
+				// culling reports attached object IDs, the same in both scenarios
+				vs->instance_attach_object_instance_id(instance, i + 1);
+				vs->instance_set_transform(instance, bases[i]);
+				if (skinned) {
+					RID skeleton = vs->skeleton_create();
+					vs->skeleton_allocate(skeleton, SKELETON_BONES);
+					vs->instance_attach_skeleton(instance, skeleton);
+					skeletons[s].push_back(skeleton);
+				}
+				instances[s].write[i] = instance;
+			}
+		}
+
+		VSG::scene->update_dirty_instances();
+		print_line("Moving " + itos(count) + " instances every frame, " + itos(skeletons[0].size()) + " of them skinned.");
+	}
+
+	virtual bool iteration(float p_time) {
+		if (quit) {
+			return true;
+		}
+
+		// the first scenario is updated batched, the second one by one
+		for (int s = 0; s < 2; s++) {
+			_move_instances(s);
+			VSG::scene->parallel_instance_update = s == 0;
+
+			uint64_t from = OS::get_singleton()->get_ticks_usec();
+			VSG::scene->update_dirty_instances();
+			usec[s] += OS::get_singleton()->get_ticks_usec() - from;
+		}
+
+		frame++;
+		if (frame % CHECK_FRAMES == 0) {
+			_check_culling();
+		}
+		if (frame % REPORT_FRAMES == 0) {
+			print_line("batched: " + rtos(usec[0] / (double)REPORT_FRAMES / 1000.0) + " ms/frame, one by one: " + rtos(usec[1] / (double)REPORT_FRAMES / 1000.0) + " ms/frame");
+			usec[0] = usec[1] = 0;
+		}
+
+		return frame >= REPORT_FRAMES * ROUNDS;
+	}
+
+	virtual bool idle(float p_time) {
+		return quit;
+	}
+
+	virtual void finish() {
+		if (!scenarios[0].is_valid()) {
+			return;
+		}
+
+		if (cull_mismatches) {
+			print_line("FAILED: " + itos(cull_mismatches) + " of " + itos(cull_checks) + " cull queries differ between the batched and the one by one update.");
+		} else {
+			print_line("PASS: " + itos(cull_checks) + " cull queries match between the batched and the one by one update.");
+		}
+
+		VisualServer *vs = VisualServer::get_singleton();
+		for (int s = 0; s < 2; s++) {
+			for (int i = 0; i < instances[s].size(); i++) {
+				vs->free(instances[s][i]);
+			}
+			for (int i = 0; i < skeletons[s].size(); i++) {
+				vs->free(skeletons[s][i]);
+			}
+			vs->free(scenarios[s]);
+		}
+		vs->free(skinned_mesh);
+		VSG::scene->parallel_instance_update = GLOBAL_GET("rendering/threads/parallel_instance_update");
+	}
+};
+
 MainLoop *test() {
 	return memnew(TestMainLoop);
 }
+
+MainLoop *test_instance_update() {
+	return memnew(TestInstanceUpdateLoop);
+}
 } // namespace TestRender
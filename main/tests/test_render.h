@@ -36,6 +36,7 @@
 namespace TestRender {
 
 MainLoop *test();
+MainLoop *test_instance_update();
 }
 
 #endif
@@ -0,0 +1,194 @@
+/*************************************************************************/
+/*  test_trace_profiler.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_trace_profiler.h"
+
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/safe_refcount.h"
+#include "core/trace_profiler.h"
+
+namespace TestTraceProfiler {
+
+enum {
+	RECORDING_THREADS = 4,
+};
+
+struct RecordingThreads {
+	Thread threads[RECORDING_THREADS];
+	SafeFlag stop;
+	SafeNumeric<uint32_t> recorded;
+
+	static void _record_loop(void *p_userdata) {
+		RecordingThreads *self = (RecordingThreads *)p_userdata;
+		uint64_t time = 0;
+		while (!self->stop.is_set()) {
+			// same as TraceProfilerScope, which may still record after the capture ended
+			if (TraceProfiler::is_capturing()) {
+				self->recorded.increment();
+			}
+			TraceProfiler::record("test", "event", time, time + 1);
+			time++;
+		}
+	}
+
+	void start() {
+		for (int i = 0; i < RECORDING_THREADS; i++) {
+			threads[i].start(_record_loop, this);
+		}
+	}
+
+	void finish() {
+		stop.set();
+		for (int i = 0; i < RECORDING_THREADS; i++) {
+			threads[i].wait_to_finish();
+		}
+	}
+};
+
+bool test_record_while_clearing() {
+	RecordingThreads recording;
+	recording.start();
+
+	bool pass = true;
+	uint64_t max_count = 0;
+	for (int i = 0; i < 200; i++) {
+		TraceProfiler::begin_capture();
+		OS::get_singleton()->delay_usec(50);
+		TraceProfiler::end_capture();
+
+		max_count = MAX(max_count, TraceProfiler::get_event_count());
+		TraceProfiler::clear();
+		// nothing may be written once clear() returned, even by scopes started while capturing
+		if (TraceProfiler::get_event_count() != 0) {
+			OS::get_singleton()->print("\tevents left after clear\n");
+			pass = false;
+		}
+	}
+
+	recording.finish();
+	TraceProfiler::cleanup();
+
+	if (max_count == 0 || recording.recorded.get() == 0) {
+		OS::get_singleton()->print("\tnothing was recorded\n");
+		pass = false;
+	}
+	return pass;
+}
+
+bool test_cleanup_with_running_threads() {
+	RecordingThreads recording;
+	recording.start();
+
+	bool pass = true;
+	for (int i = 0; i < 50; i++) {
+		TraceProfiler::begin_capture();
+		OS::get_singleton()->delay_usec(50);
+		// ends the capture itself, the threads keep their buffers
+		TraceProfiler::cleanup();
+		if (TraceProfiler::get_event_count() != 0) {
+			OS::get_singleton()->print("\tevents left after cleanup\n");
+			pass = false;
+		}
+	}
+
+	// the buffers are still usable after a cleanup
+	TraceProfiler::begin_capture();
+	OS::get_singleton()->delay_usec(1000);
+	TraceProfiler::end_capture();
+	if (TraceProfiler::get_event_count() == 0) {
+		OS::get_singleton()->print("\tnothing recorded after cleanup\n");
+		pass = false;
+	}
+
+	recording.finish();
+	// exited threads' buffers are freed now
+	TraceProfiler::cleanup();
+	return pass;
+}
+
+bool test_max_events_per_thread() {
+	const uint32_t prev_max = TraceProfiler::get_max_events_per_thread();
+	TraceProfiler::set_max_events_per_thread(100);
+
+	TraceProfiler::begin_capture();
+	for (int i = 0; i < 150; i++) {
+		TraceProfiler::record("test", "event", i, i + 1);
+	}
+	TraceProfiler::end_capture();
+
+	bool pass = TraceProfiler::get_event_count() == 100 && TraceProfiler::get_dropped_event_count() == 50;
+
+	TraceProfiler::clear();
+	pass = pass && TraceProfiler::get_event_count() == 0 && TraceProfiler::get_dropped_event_count() == 0;
+
+	TraceProfiler::set_max_events_per_thread(prev_max);
+	TraceProfiler::cleanup();
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_record_while_clearing,
+	test_cleanup_with_running_threads,
+	test_max_events_per_thread,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestTraceProfiler
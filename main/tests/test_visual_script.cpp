@@ -0,0 +1,274 @@
+/*************************************************************************/
+/*  main/tests/test_visual_script.cpp                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_visual_script.h"
+
+#include "core/os/os.h"
+
+#include "modules/modules_enabled.gen.h" // For gdscript, visual_script.
+#ifdef MODULE_VISUAL_SCRIPT_ENABLED
+
+#include "modules/visual_script/visual_script.h"
+#include "modules/visual_script/visual_script_flow_control.h"
+#include "modules/visual_script/visual_script_nodes.h"
+
+#ifdef MODULE_GDSCRIPT_ENABLED
+#include "modules/gdscript/gdscript.h"
+#endif
+
+namespace TestVisualScript {
+
+Ref<VisualScriptOperator> make_operator(Variant::Operator p_op) {
+	Ref<VisualScriptOperator> op;
+	op.instance();
+	op->set_operator(p_op);
+	return op;
+}
+
+// func sum(n):
+//     for i in n:
+//         total = total + i * 2
+//     return total
+Ref<VisualScript> make_sum_script() {
+	Ref<VisualScript> vs;
+	vs.instance();
+	vs->set_instance_base_type("Reference");
+	vs->add_variable("total", 0);
+	vs->add_function("sum");
+
+	Ref<VisualScriptFunction> func;
+	func.instance();
+	func->add_argument(Variant::INT, "n");
+	vs->add_node("sum", 0, func);
+
+	Ref<VisualScriptIterator> iterator;
+	iterator.instance();
+	vs->add_node("sum", 1, iterator);
+
+	Ref<VisualScriptVariableSet> set_total;
+	set_total.instance();
+	set_total->set_variable("total");
+	vs->add_node("sum", 2, set_total);
+
+	vs->add_node("sum", 3, make_operator(Variant::OP_ADD));
+
+	Ref<VisualScriptVariableGet> get_total;
+	get_total.instance();
+	get_total->set_variable("total");
+	vs->add_node("sum", 4, get_total);
+
+	Ref<VisualScriptOperator> mul = make_operator(Variant::OP_MULTIPLY);
+	vs->add_node("sum", 5, mul);
+	mul->set_default_input_value(1, 2);
+
+	Ref<VisualScriptReturn> ret;
+	ret.instance();
+	ret->set_enable_return_value(true);
+	vs->add_node("sum", 6, ret);
+
+	Ref<VisualScriptVariableGet> get_result;
+	get_result.instance();
+	get_result->set_variable("total");
+	vs->add_node("sum", 7, get_result);
+
+	vs->sequence_connect("sum", 0, 0, 1);
+	vs->sequence_connect("sum", 1, 0, 2); // each
+	vs->sequence_connect("sum", 1, 1, 6); // exit
+
+	vs->data_connect("sum", 0, 0, 1, 0);
+	vs->data_connect("sum", 1, 0, 5, 0);
+	vs->data_connect("sum", 4, 0, 3, 0);
+	vs->data_connect("sum", 5, 0, 3, 1);
+	vs->data_connect("sum", 3, 0, 2, 0);
+	vs->data_connect("sum", 7, 0, 6, 0);
+
+	return vs;
+}
+
+// Both operands of the multiplication read the same sum node. The stack-less
+// variant runs without a flow stack.
+// func square_sum(a, b):
+//     var s = a + b
+//     return s * s
+Ref<VisualScript> make_square_sum_script(bool p_stack_less) {
+	Ref<VisualScript> vs;
+	vs.instance();
+	vs->set_instance_base_type("Reference");
+	vs->add_function("square_sum");
+
+	Ref<VisualScriptFunction> func;
+	func.instance();
+	func->add_argument(Variant::INT, "a");
+	func->add_argument(Variant::INT, "b");
+	func->set_stack_less(p_stack_less);
+	vs->add_node("square_sum", 0, func);
+
+	vs->add_node("square_sum", 1, make_operator(Variant::OP_ADD));
+	vs->add_node("square_sum", 2, make_operator(Variant::OP_MULTIPLY));
+
+	Ref<VisualScriptReturn> ret;
+	ret.instance();
+	ret->set_enable_return_value(true);
+	vs->add_node("square_sum", 3, ret);
+
+	vs->sequence_connect("square_sum", 0, 0, 3);
+
+	vs->data_connect("square_sum", 0, 0, 1, 0);
+	vs->data_connect("square_sum", 0, 1, 1, 1);
+	vs->data_connect("square_sum", 1, 0, 2, 0);
+	vs->data_connect("square_sum", 1, 0, 2, 1);
+	vs->data_connect("square_sum", 2, 0, 3, 0);
+
+	return vs;
+}
+
+Ref<Reference> instance_script(const Ref<Script> &p_script) {
+	Ref<Reference> obj;
+	obj.instance();
+	obj->set_script(p_script.get_ref_ptr());
+	return obj;
+}
+
+bool test_loop() {
+	Ref<Reference> obj = instance_script(make_sum_script());
+
+	bool ok = obj->call("sum", 10) == Variant(90);
+	ok = ok && obj->call("sum", 10) == Variant(180); // Keeps adding to the member.
+
+	obj->set("total", 0);
+	ok = ok && obj->call("sum", 0) == Variant(0);
+	ok = ok && obj->call("sum", 1000) == Variant(999000);
+
+	if (!ok) {
+		OS::get_singleton()->print("\tIterator loop returned %s\n", String(obj->get("total")).utf8().get_data());
+	}
+	return ok;
+}
+
+bool test_shared_dependency() {
+	bool ok = true;
+	for (int i = 0; i < 2; i++) {
+		Ref<Reference> obj = instance_script(make_square_sum_script(i == 1));
+		Variant result = obj->call("square_sum", 2, 3);
+		if (result != Variant(25)) {
+			OS::get_singleton()->print("\t%s function returned %s instead of 25\n", i == 1 ? "Stack-less" : "Regular", String(result).utf8().get_data());
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+void benchmark() {
+	OS *os = OS::get_singleton();
+	const int count = 1000000;
+
+	Ref<Reference> vs_obj = instance_script(make_sum_script());
+	uint64_t t = os->get_ticks_usec();
+	Variant vs_result = vs_obj->call("sum", count);
+	uint64_t vs_time = os->get_ticks_usec() - t;
+
+	os->print("\nSumming a loop of %d iterations:\n", count);
+	os->print("\tVisualScript %8d us (%s)\n", (int)vs_time, String(vs_result).utf8().get_data());
+
+#ifdef MODULE_GDSCRIPT_ENABLED
+	Ref<GDScript> gds;
+	gds.instance();
+	gds->set_source_code(
+			"extends Reference\n"
+			"var total = 0\n"
+			"func sum(n):\n"
+			"\tfor i in n:\n"
+			"\t\ttotal = total + i * 2\n"
+			"\treturn total\n");
+	if (gds->reload() != OK) {
+		os->print("\tCould not compile the GDScript version.\n");
+		return;
+	}
+
+	Ref<Reference> gd_obj = instance_script(gds);
+	t = os->get_ticks_usec();
+	Variant gd_result = gd_obj->call("sum", count);
+	uint64_t gd_time = os->get_ticks_usec() - t;
+
+	os->print("\tGDScript     %8d us (%s), VisualScript takes %.2fx as long\n", (int)gd_time, String(gd_result).utf8().get_data(), vs_time / (double)MAX(gd_time, (uint64_t)1));
+#endif
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_loop,
+	test_shared_dependency,
+	nullptr
+
+};
+
+MainLoop *test() {
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	benchmark();
+
+	return nullptr;
+}
+} // namespace TestVisualScript
+
+#else
+
+namespace TestVisualScript {
+
+MainLoop *test() {
+	ERR_PRINT("The VisualScript module is disabled, therefore VisualScript tests cannot be used.");
+	return nullptr;
+}
+} // namespace TestVisualScript
+
+#endif
@@ -0,0 +1,340 @@
+/*************************************************************************/
+/*  test_worker_thread_pool.cpp                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_worker_thread_pool.h"
+
+#include "core/class_db.h"
+#include "core/os/os.h"
+#include "core/os/worker_thread_pool.h"
+
+namespace TestWorkerThreadPool {
+
+enum {
+	ELEMENTS = 100000,
+	NESTED_ELEMENTS = 64,
+	CHAIN_JOBS = 16,
+	GROUP_ELEMENTS = 1000,
+};
+
+struct IndexCounter {
+	LocalVector<SafeNumeric<uint32_t>> hits;
+	SafeNumeric<uint64_t> total;
+
+	void process(uint32_t p_index, uint32_t p_weight) {
+		hits[p_index].increment();
+		total.add(p_weight);
+	}
+
+	// Every element runs a parallel_for of its own, from whichever thread picked it up.
+	void process_nested(uint32_t p_index, IndexCounter *p_inner) {
+		WorkerThreadPool::get_singleton()->parallel_for(NESTED_ELEMENTS, p_inner, &IndexCounter::process_inner, p_index);
+		hits[p_index].increment();
+	}
+
+	void process_inner(uint32_t p_index, uint32_t p_outer) {
+		hits[p_outer * NESTED_ELEMENTS + p_index].increment();
+	}
+
+	bool check(uint32_t p_elements) const {
+		for (uint32_t i = 0; i < p_elements; i++) {
+			if (hits[i].get() != 1) {
+				OS::get_singleton()->print("\tElement %i ran %i times\n", i, hits[i].get());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	explicit IndexCounter(uint32_t p_elements) {
+		hits.resize(p_elements);
+	}
+};
+
+bool test_parallel_for() {
+	OS::get_singleton()->print("\n\nTest 1: parallel_for\n");
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+	OS::get_singleton()->print("\tWorker threads: %i\n", pool->get_thread_count());
+
+	IndexCounter counter(ELEMENTS);
+	pool->parallel_for(ELEMENTS, &counter, &IndexCounter::process, 3u);
+	if (!counter.check(ELEMENTS) || counter.total.get() != 3u * ELEMENTS) {
+		return false;
+	}
+
+	// A single job runs everything on the calling thread.
+	IndexCounter single(ELEMENTS);
+	pool->parallel_for(ELEMENTS, &single, &IndexCounter::process, 1u, 1);
+	if (!single.check(ELEMENTS)) {
+		return false;
+	}
+
+	// Nothing to do must return right away.
+	pool->parallel_for(0, &single, &IndexCounter::process, 1u);
+
+	IndexCounter outer(NESTED_ELEMENTS);
+	IndexCounter inner(NESTED_ELEMENTS * NESTED_ELEMENTS);
+	pool->parallel_for(NESTED_ELEMENTS, &outer, &IndexCounter::process_nested, &inner);
+	return outer.check(NESTED_ELEMENTS) && inner.check(NESTED_ELEMENTS * NESTED_ELEMENTS);
+}
+
+struct ChainData {
+	SafeNumeric<uint32_t> first_done;
+	SafeNumeric<uint32_t> second_done;
+	uint32_t first_seen_by_second = 0;
+	uint32_t second_seen_by_third = 0;
+
+	static void first(void *p_data) {
+		// Slow enough that the dependents are queued (and waited on) long before it finishes.
+		OS::get_singleton()->delay_usec(1000);
+		((ChainData *)p_data)->first_done.increment();
+	}
+
+	static void second(void *p_data) {
+		ChainData *data = (ChainData *)p_data;
+		data->first_seen_by_second = data->first_done.get();
+		data->second_done.increment();
+	}
+
+	static void third(void *p_data) {
+		ChainData *data = (ChainData *)p_data;
+		data->second_seen_by_third = data->second_done.get();
+	}
+};
+
+bool test_dependencies() {
+	OS::get_singleton()->print("\n\nTest 2: Counters and dependencies\n");
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+
+	// Waiting on a counter without jobs returns right away.
+	WorkerThreadPool::Counter empty;
+	pool->wait(&empty);
+
+	ChainData data;
+	WorkerThreadPool::Counter first;
+	WorkerThreadPool::Counter second;
+	WorkerThreadPool::Counter third;
+	for (int i = 0; i < CHAIN_JOBS; i++) {
+		pool->push_job(&ChainData::first, &data, &first);
+	}
+	pool->push_job(&ChainData::second, &data, &second, &first);
+	pool->push_job(&ChainData::third, &data, &third, &second);
+
+	pool->wait(&third);
+
+	if (!first.is_done() || !second.is_done() || !third.is_done()) {
+		OS::get_singleton()->print("\tWaited counter is done, but its dependencies are not\n");
+		return false;
+	}
+	if (data.first_seen_by_second != CHAIN_JOBS || data.second_seen_by_third != 1) {
+		OS::get_singleton()->print("\tDependent job ran early: %i of %i, %i of 1\n", data.first_seen_by_second, CHAIN_JOBS, data.second_seen_by_third);
+		return false;
+	}
+
+	// A dependency that already completed does not hold the job back.
+	uint32_t before = data.second_done.get();
+	pool->push_job(&ChainData::second, &data, &second, &first);
+	pool->wait(&second);
+	return data.second_done.get() == before + 1;
+}
+
+struct BlockingData {
+	WorkerThreadPool::Counter slow;
+	WorkerThreadPool::Counter released;
+	SafeFlag slow_done;
+	SafeFlag released_ran;
+	bool released_saw_slow = false;
+	bool waiter_saw_released = false;
+
+	static void slow_job(void *p_data) {
+		OS::get_singleton()->delay_usec(100000);
+		((BlockingData *)p_data)->slow_done.set();
+	}
+
+	static void released_job(void *p_data) {
+		BlockingData *data = (BlockingData *)p_data;
+		data->released_saw_slow = data->slow_done.is_set();
+		data->released_ran.set();
+	}
+
+	// Waits from inside the pool on a job that only gets queued once slow_job completes.
+	static void waiting_job(void *p_data) {
+		BlockingData *data = (BlockingData *)p_data;
+		WorkerThreadPool::get_singleton()->wait(&data->released);
+		data->waiter_saw_released = data->released_ran.is_set();
+	}
+};
+
+bool test_blocking_wait() {
+	OS::get_singleton()->print("\n\nTest 3: Waiting longer than the spin\n");
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+
+	BlockingData data;
+	WorkerThreadPool::Counter waiting;
+	pool->push_job(&BlockingData::slow_job, &data, &data.slow);
+	pool->push_job(&BlockingData::released_job, &data, &data.released, &data.slow);
+	pool->push_job(&BlockingData::waiting_job, &data, &waiting);
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	pool->wait(&waiting);
+	uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - begin;
+	OS::get_singleton()->print("\tWaited %i ms\n", int(elapsed / 1000));
+
+	// The waiting job may finish last, but everything it waited for must be done by then.
+	pool->wait(&data.released);
+	return data.slow_done.is_set() && data.released_saw_slow && data.waiter_saw_released;
+}
+
+class WorkerTaskTarget : public Object {
+	GDCLASS(WorkerTaskTarget, Object);
+
+protected:
+	static void _bind_methods() {
+		ClassDB::bind_method(D_METHOD("task"), &WorkerTaskTarget::task);
+		ClassDB::bind_method(D_METHOD("task_with_userdata", "userdata"), &WorkerTaskTarget::task_with_userdata);
+		ClassDB::bind_method(D_METHOD("group_task", "index"), &WorkerTaskTarget::group_task);
+		ClassDB::bind_method(D_METHOD("group_task_with_userdata", "index", "userdata"), &WorkerTaskTarget::group_task_with_userdata);
+	}
+
+public:
+	SafeNumeric<uint32_t> task_calls;
+	SafeNumeric<uint32_t> userdata_total;
+	LocalVector<SafeNumeric<uint32_t>> group_hits;
+
+	void task() {
+		task_calls.increment();
+	}
+	void task_with_userdata(int p_userdata) {
+		task_calls.increment();
+		userdata_total.add(p_userdata);
+	}
+	void group_task(int p_index) {
+		group_hits[p_index].increment();
+	}
+	void group_task_with_userdata(int p_index, int p_userdata) {
+		group_hits[p_index].increment();
+		userdata_total.add(p_userdata);
+	}
+
+	bool check_group(uint32_t p_expected) const {
+		for (uint32_t i = 0; i < group_hits.size(); i++) {
+			if (group_hits[i].get() != p_expected) {
+				OS::get_singleton()->print("\tGroup element %i ran %i times\n", i, group_hits[i].get());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	WorkerTaskTarget() {
+		group_hits.resize(GROUP_ELEMENTS);
+	}
+};
+
+bool test_script_tasks() {
+	OS::get_singleton()->print("\n\nTest 4: Script tasks\n");
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+	WorkerTaskTarget *target = memnew(WorkerTaskTarget);
+	bool pass = true;
+
+	WorkerThreadPool::TaskID task = pool->add_task(target, "task");
+	WorkerThreadPool::TaskID task_with_userdata = pool->add_task(target, "task_with_userdata", 5);
+	// Completion can be polled until the task is waited on.
+	while (!pool->is_task_completed(task)) {
+		OS::get_singleton()->delay_usec(100);
+	}
+	pool->wait_for_task_completion(task);
+	pool->wait_for_task_completion(task_with_userdata);
+	if (target->task_calls.get() != 2 || target->userdata_total.get() != 5) {
+		OS::get_singleton()->print("\tTasks ran %i times with userdata total %i\n", target->task_calls.get(), target->userdata_total.get());
+		pass = false;
+	}
+
+	WorkerThreadPool::TaskID group = pool->add_group_task(target, "group_task", GROUP_ELEMENTS);
+	pool->wait_for_task_completion(group);
+	pass = target->check_group(1) && pass;
+
+	target->userdata_total.set(0);
+	group = pool->add_group_task(target, "group_task_with_userdata", GROUP_ELEMENTS, 2);
+	pool->wait_for_task_completion(group);
+	pass = target->check_group(2) && pass;
+	if (target->userdata_total.get() != 2 * GROUP_ELEMENTS) {
+		OS::get_singleton()->print("\tGroup userdata total %i, expected %i\n", target->userdata_total.get(), 2 * GROUP_ELEMENTS);
+		pass = false;
+	}
+
+	memdelete(target);
+	return pass;
+}
+
+typedef bool (*TestFunc)();
+
+TestFunc test_funcs[] = {
+
+	test_parallel_for,
+	test_dependencies,
+	test_blocking_wait,
+	test_script_tasks,
+	nullptr
+
+};
+
+MainLoop *test() {
+	ClassDB::register_class<WorkerTaskTarget>();
+
+	int count = 0;
+	int passed = 0;
+
+	while (true) {
+		if (!test_funcs[count]) {
+			break;
+		}
+		bool pass = test_funcs[count]();
+		if (pass) {
+			passed++;
+		}
+		OS::get_singleton()->print("\t%s\n", pass ? "PASS" : "FAILED");
+
+		count++;
+	}
+
+	OS::get_singleton()->print("\n\n\n");
+	OS::get_singleton()->print("*************\n");
+	OS::get_singleton()->print("***TOTALS!***\n");
+	OS::get_singleton()->print("*************\n");
+
+	OS::get_singleton()->print("Passed %i of %i tests\n", passed, count);
+
+	return nullptr;
+}
+} // namespace TestWorkerThreadPool
@@ -37,7 +37,9 @@
 #include "core/os/file_access.h"
 #include "core/os/os.h"
 #include "core/project_settings.h"
+#include "gdscript_bytecode.h"
 #include "gdscript_compiler.h"
+#include "gdscript_load_graph.h"
 
 ///////////////////////////
 
@@ -744,6 +746,30 @@ Error GDScript::load_byte_code(const String &p_path) {
 	ERR_FAIL_COND_V(bytecode.size() == 0, ERR_PARSE_ERROR);
 	path = p_path;
 
+	if (GDScriptBytecode::is_container(bytecode)) {
+		Vector<uint8_t> tokens;
+		Vector<uint8_t> compiled;
+		Error err = GDScriptBytecode::split_container(bytecode, tokens, compiled);
+		ERR_FAIL_COND_V(err != OK, err);
+
+		// Compiled code has no debugger information, compile from tokens when debugging.
+		if (compiled.size() && !ScriptDebugger::get_singleton()) {
+			err = GDScriptBytecode::deserialize(this, compiled);
+			if (err == OK) {
+				valid = true;
+
+				for (Map<StringName, Ref<GDScript>>::Element *E = subclasses.front(); E; E = E->next()) {
+					_set_subclass_path(E->get(), path);
+				}
+
+				return OK;
+			}
+			print_verbose("GDScript: Can't use the compiled code in '" + p_path + "', compiling it again.");
+		}
+
+		bytecode = tokens;
+	}
+
 	String basedir = path;
 
 	if (basedir == "") {
@@ -937,6 +963,8 @@ void GDScript::_save_orphaned_subclasses() {
 GDScript::~GDScript() {
 	_clear_pending_func_states();
 
+	GDScriptFunction::invalidate_inline_caches();
+
 	for (Map<StringName, GDScriptFunction *>::Element *E = member_functions.front(); E; E = E->next()) {
 		memdelete(E->get());
 	}
@@ -1298,6 +1326,8 @@ MultiplayerAPI::RPCMode GDScriptInstance::get_rset_mode(const StringName &p_vari
 void GDScriptInstance::reload_members() {
 #ifdef DEBUG_ENABLED
 
+	GDScriptFunction::invalidate_inline_caches();
+
 	members.resize(script->member_indices.size()); //resize
 
 	Vector<Variant> new_members;
@@ -1416,6 +1446,17 @@ void GDScriptLanguage::init() {
 	for (List<Engine::Singleton>::Element *E = singletons.front(); E; E = E->next()) {
 		_add_global(E->get().name, E->get().ptr);
 	}
+
+#ifdef DEBUG_ENABLED
+	List<String> args = OS::get_singleton()->get_cmdline_args();
+	for (List<String>::Element *E = args.front(); E; E = E->next()) {
+		if (E->get() == "--profile-gdscript" && E->next()) {
+			sample_output_path = E->next()->get();
+			sampler.start(GLOBAL_GET("debug/gdscript/profiler/sampling_interval_usec"), _debug_max_call_stack ? _debug_max_call_stack : (int)GLOBAL_GET("debug/settings/gdscript/max_call_stack"));
+			break;
+		}
+	}
+#endif
 }
 
 String GDScriptLanguage::get_type() const {
@@ -1429,10 +1470,29 @@ Error GDScriptLanguage::execute_file(const String &p_path) {
 	return OK;
 }
 void GDScriptLanguage::finish() {
+#ifdef DEBUG_ENABLED
+	if (sample_output_path != String()) {
+		sampler.stop();
+		Error err = sampler.save_folded_stacks(sample_output_path);
+		if (err == OK) {
+			print_line(vformat("Saved %d GDScript samples to: %s", sampler.get_sample_count(), sample_output_path));
+		}
+		sample_output_path = String();
+	}
+#endif
 }
 
 void GDScriptLanguage::profiling_start() {
 #ifdef DEBUG_ENABLED
+	profiling_sampled = GLOBAL_GET("debug/gdscript/profiler/sampling");
+	if (profiling_sampled) {
+		// A --profile-gdscript session is already sampling, share it rather than clearing it.
+		if (!sampler.is_running()) {
+			sampler.start(GLOBAL_GET("debug/gdscript/profiler/sampling_interval_usec"), _debug_max_call_stack ? _debug_max_call_stack : (int)GLOBAL_GET("debug/settings/gdscript/max_call_stack"));
+		}
+		return;
+	}
+
 	lock.lock();
 
 	SelfList<GDScriptFunction> *elem = function_list.first();
@@ -1456,6 +1516,11 @@ void GDScriptLanguage::profiling_start() {
 
 void GDScriptLanguage::profiling_stop() {
 #ifdef DEBUG_ENABLED
+	// The sampled data stays available, the debugger asks for the totals after stopping.
+	if (profiling_sampled && sample_output_path == String()) {
+		sampler.stop();
+	}
+
 	lock.lock();
 	profiling = false;
 	lock.unlock();
@@ -1465,6 +1530,10 @@ void GDScriptLanguage::profiling_stop() {
 int GDScriptLanguage::profiling_get_accumulated_data(ProfilingInfo *p_info_arr, int p_info_max) {
 	int current = 0;
 #ifdef DEBUG_ENABLED
+	if (profiling_sampled) {
+		return sampler.get_accumulated_data(p_info_arr, p_info_max);
+	}
+
 	lock.lock();
 
 	SelfList<GDScriptFunction> *elem = function_list.first();
@@ -1490,6 +1559,10 @@ int GDScriptLanguage::profiling_get_frame_data(ProfilingInfo *p_info_arr, int p_
 	int current = 0;
 
 #ifdef DEBUG_ENABLED
+	if (profiling_sampled) {
+		return sampler.get_frame_data(p_info_arr, p_info_max);
+	}
+
 	lock.lock();
 
 	SelfList<GDScriptFunction> *elem = function_list.first();
@@ -1513,6 +1586,75 @@ int GDScriptLanguage::profiling_get_frame_data(ProfilingInfo *p_info_arr, int p_
 	return current;
 }
 
+int GDScriptLanguage::_get_frame_class(uint32_t p_size) {
+	if (p_size <= (1 << FRAME_POOL_MIN_SHIFT)) {
+		return 0;
+	}
+	return get_shift_from_power_of_2(next_power_of_2(p_size)) - FRAME_POOL_MIN_SHIFT;
+}
+
+uint8_t *GDScriptLanguage::_alloc_frame(uint32_t p_size) {
+	int size_class = _get_frame_class(p_size);
+	if (size_class >= FRAME_POOL_CLASSES) {
+		return (uint8_t *)memalloc(p_size);
+	}
+
+	FramePool &pool = frame_pools[size_class];
+	if (pool.free_list) {
+		uint8_t *frame = pool.free_list;
+		pool.free_list = *(uint8_t **)frame;
+		pool.free_count--;
+		return frame;
+	}
+
+	return (uint8_t *)memalloc(1 << (size_class + FRAME_POOL_MIN_SHIFT));
+}
+
+void GDScriptLanguage::_free_frame(uint8_t *p_frame, uint32_t p_size) {
+	int size_class = _get_frame_class(p_size);
+	if (size_class >= FRAME_POOL_CLASSES || frame_pools[size_class].free_count >= FRAME_POOL_MAX_FREE) {
+		memfree(p_frame);
+		return;
+	}
+
+	FramePool &pool = frame_pools[size_class];
+	*(uint8_t **)p_frame = pool.free_list;
+	pool.free_list = p_frame;
+	pool.free_count++;
+}
+
+void GDScriptLanguage::inline_cache_get_stats(uint64_t &r_hits, uint64_t &r_misses) {
+	r_hits = 0;
+	r_misses = 0;
+#ifdef DEBUG_ENABLED
+	lock.lock();
+
+	SelfList<GDScriptFunction> *elem = function_list.first();
+	while (elem) {
+		r_hits += elem->self()->inline_cache_hits;
+		r_misses += elem->self()->inline_cache_misses;
+		elem = elem->next();
+	}
+
+	lock.unlock();
+#endif
+}
+
+void GDScriptLanguage::inline_cache_reset_stats() {
+#ifdef DEBUG_ENABLED
+	lock.lock();
+
+	SelfList<GDScriptFunction> *elem = function_list.first();
+	while (elem) {
+		elem->self()->inline_cache_hits = 0;
+		elem->self()->inline_cache_misses = 0;
+		elem = elem->next();
+	}
+
+	lock.unlock();
+#endif
+}
+
 struct GDScriptDepSort {
 	//must support sorting so inheritance works properly (parent must be reloaded first)
 	bool operator()(const Ref<GDScript> &A, const Ref<GDScript> &B) const {
@@ -1691,6 +1833,18 @@ void GDScriptLanguage::frame() {
 	calls = 0;
 
 #ifdef DEBUG_ENABLED
+	if (sampler.is_running()) {
+		sampler.frame();
+
+		// Folded stacks of the frame for the debugger, the profiler data above only has per function times.
+		if (profiling_sampled && ScriptDebugger::get_singleton() && ScriptDebugger::get_singleton()->is_profiling()) {
+			Array msg;
+			msg.push_back(sampler.get_interval_usec());
+			msg.push_back(sampler.get_frame_stacks());
+			ScriptDebugger::get_singleton()->send_message("gdscript_samples", msg);
+		}
+	}
+
 	if (profiling) {
 		lock.lock();
 
@@ -2081,12 +2235,15 @@ GDScriptLanguage::GDScriptLanguage() {
 	_debug_parse_err_file = "";
 
 	profiling = false;
+	profiling_sampled = false;
 	script_frame_time = 0;
 
 	_debug_call_stack_pos = 0;
 	int dmcs = GLOBAL_DEF("debug/settings/gdscript/max_call_stack", 1024);
 	ProjectSettings::get_singleton()->set_custom_property_info("debug/settings/gdscript/max_call_stack", PropertyInfo(Variant::INT, "debug/settings/gdscript/max_call_stack", PROPERTY_HINT_RANGE, "1024,4096,1,or_greater")); //minimum is 1024
 
+	GDScriptLoadGraph::set_enabled(GLOBAL_DEF("gdscript/loading/parallel_dependency_loading", true));
+
 	if (ScriptDebugger::get_singleton()) {
 		//debugging enabled!
 
@@ -2103,6 +2260,9 @@ GDScriptLanguage::GDScriptLanguage() {
 	GLOBAL_DEF("debug/gdscript/warnings/treat_warnings_as_errors", false);
 	GLOBAL_DEF("debug/gdscript/warnings/exclude_addons", true);
 	GLOBAL_DEF("debug/gdscript/completion/autocomplete_setters_and_getters", false);
+	GLOBAL_DEF("debug/gdscript/profiler/sampling", false);
+	GLOBAL_DEF("debug/gdscript/profiler/sampling_interval_usec", 1000);
+	ProjectSettings::get_singleton()->set_custom_property_info("debug/gdscript/profiler/sampling_interval_usec", PropertyInfo(Variant::INT, "debug/gdscript/profiler/sampling_interval_usec", PROPERTY_HINT_RANGE, "100,100000,1,or_greater"));
 	for (int i = 0; i < (int)GDScriptWarning::WARNING_MAX; i++) {
 		String warning = GDScriptWarning::get_name_from_code((GDScriptWarning::Code)i).to_lower();
 		bool default_enabled = !warning.begins_with("unsafe_") && i != GDScriptWarning::UNUSED_CLASS_VARIABLE;
@@ -2141,6 +2301,15 @@ GDScriptLanguage::~GDScriptLanguage() {
 		script->unreference();
 	}
 
+	for (int i = 0; i < FRAME_POOL_CLASSES; i++) {
+		while (frame_pools[i].free_list) {
+			uint8_t *frame = frame_pools[i].free_list;
+			frame_pools[i].free_list = *(uint8_t **)frame;
+			memfree(frame);
+		}
+		frame_pools[i].free_count = 0;
+	}
+
 	singleton = nullptr;
 }
 
@@ -2173,9 +2342,13 @@ RES ResourceFormatLoaderGDScript::load(const String &p_path, const String &p_ori
 
 	Ref<GDScript> scriptres(script);
 
+	// Holds the dependencies loaded on worker threads until the script is compiled.
+	GDScriptLoadGraph load_graph;
+
 	if (p_path.ends_with(".gde") || p_path.ends_with(".gdc")) {
 		script->set_script_path(p_original_path); // script needs this.
 		script->set_path(p_original_path, true);
+		load_graph.load_dependencies(p_original_path);
 		Error err = script->load_byte_code(p_path);
 		ERR_FAIL_COND_V_MSG(err != OK, RES(), "Cannot load byte code from file '" + p_path + "'.");
 
@@ -2186,6 +2359,7 @@ RES ResourceFormatLoaderGDScript::load(const String &p_path, const String &p_ori
 		script->set_script_path(p_original_path); // script needs this.
 		script->set_path(p_original_path, true);
 
+		load_graph.load_dependencies(p_original_path);
 		script->reload();
 	}
 	if (r_error) {
@@ -35,6 +35,7 @@
 #include "core/io/resource_saver.h"
 #include "core/script_language.h"
 #include "gdscript_function.h"
+#include "gdscript_sampler.h"
 
 class GDScriptNativeClass : public Reference {
 	GDCLASS(GDScriptNativeClass, Reference);
@@ -68,6 +69,7 @@ class GDScript : public Script {
 	friend class GDScriptInstance;
 	friend class GDScriptFunction;
 	friend class GDScriptCompiler;
+	friend class GDScriptBytecode;
 	friend class GDScriptFunctions;
 	friend class GDScriptLanguage;
 
@@ -352,6 +354,25 @@ class GDScriptLanguage : public ScriptLanguage {
 
 	Mutex lock;
 
+	// Stack frames of yielded functions, recycled per power of two size class
+	// so that yield doesn't reach the heap in steady state. Guarded by lock.
+	enum {
+		FRAME_POOL_MIN_SHIFT = 6, // 64 bytes.
+		FRAME_POOL_CLASSES = 8, // Up to 8 KiB, bigger frames aren't pooled.
+		FRAME_POOL_MAX_FREE = 4096, // Per class.
+	};
+
+	struct FramePool {
+		uint8_t *free_list = nullptr;
+		uint32_t free_count = 0;
+	};
+
+	FramePool frame_pools[FRAME_POOL_CLASSES];
+
+	static int _get_frame_class(uint32_t p_size);
+	uint8_t *_alloc_frame(uint32_t p_size);
+	void _free_frame(uint8_t *p_frame, uint32_t p_size);
+
 	friend class GDScript;
 
 	SelfList<GDScript>::List script_list;
@@ -361,6 +382,10 @@ class GDScriptLanguage : public ScriptLanguage {
 	bool profiling;
 	uint64_t script_frame_time;
 
+	GDScriptSampler sampler;
+	bool profiling_sampled; // The debugger's profiler gets its data from the sampler instead of per call timings.
+	String sample_output_path; // Set by --profile-gdscript, samples are saved there on exit.
+
 	Map<String, ObjectID> orphan_subclasses;
 
 public:
@@ -507,6 +532,10 @@ public:
 	virtual int profiling_get_accumulated_data(ProfilingInfo *p_info_arr, int p_info_max);
 	virtual int profiling_get_frame_data(ProfilingInfo *p_info_arr, int p_info_max);
 
+	// Inline cache hits and misses of named member and method accesses, summed over all functions (debug builds only).
+	void inline_cache_get_stats(uint64_t &r_hits, uint64_t &r_misses);
+	void inline_cache_reset_stats();
+
 	/* LOADER FUNCTIONS */
 
 	virtual void get_recognized_extensions(List<String> *p_extensions) const;
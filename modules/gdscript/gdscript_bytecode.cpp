@@ -0,0 +1,1189 @@
+/*************************************************************************/
+/*  gdscript_bytecode.cpp                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_bytecode.h"
+
+#include "core/io/marshalls.h"
+#include "core/io/resource_loader.h"
+#include "core/version.h"
+#include "core/version_hash.gen.h"
+#include "gdscript_functions.h"
+
+// Container version, only changes when the layout of the container itself does.
+#define BYTECODE_CONTAINER_VERSION 1
+// Payload version, bump whenever the way scripts are saved changes.
+#define BYTECODE_FORMAT_VERSION 3
+
+class GDScriptBytecode::Writer {
+public:
+	Vector<uint8_t> data;
+
+	void put_u32(uint32_t p_value) {
+		int pos = data.size();
+		data.resize(pos + 4);
+		encode_uint32(p_value, data.ptrw() + pos);
+	}
+
+	void put_string(const String &p_string) {
+		CharString cs = p_string.utf8();
+		put_u32(cs.length());
+		int pos = data.size();
+		data.resize(pos + cs.length());
+		for (int i = 0; i < cs.length(); i++) {
+			data.write[pos + i] = cs[i];
+		}
+	}
+
+	Error put_variant(const Variant &p_value) {
+		int len;
+		Error err = encode_variant(p_value, nullptr, len, false);
+		if (err != OK) {
+			return err;
+		}
+		int pos = data.size();
+		data.resize(pos + len);
+		return encode_variant(p_value, data.ptrw() + pos, len, false);
+	}
+};
+
+class GDScriptBytecode::Reader {
+	const uint8_t *ptr;
+	int size;
+	int pos;
+
+public:
+	bool failed;
+
+	int get_available() const { return size - pos; }
+
+	uint32_t get_u32() {
+		if (failed || get_available() < 4) {
+			failed = true;
+			return 0;
+		}
+		uint32_t value = decode_uint32(ptr + pos);
+		pos += 4;
+		return value;
+	}
+
+	String get_string() {
+		uint32_t len = get_u32();
+		if (failed || len > (uint32_t)get_available()) {
+			failed = true;
+			return String();
+		}
+		String string;
+		string.parse_utf8((const char *)ptr + pos, len);
+		pos += len;
+		return string;
+	}
+
+	Variant get_variant() {
+		if (failed) {
+			return Variant();
+		}
+		Variant value;
+		int len;
+		if (decode_variant(value, ptr + pos, get_available(), &len, false) != OK) {
+			failed = true;
+			return Variant();
+		}
+		pos += len;
+		return value;
+	}
+
+	Reader(const uint8_t *p_ptr, int p_size) {
+		ptr = p_ptr;
+		size = p_size;
+		pos = 0;
+		failed = false;
+	}
+};
+
+struct GDScriptBytecode::SaveState {
+	const GDScript *root;
+	String path;
+	Map<int, StringName> global_names;
+};
+
+struct GDScriptBytecode::LoadState {
+	GDScript *root;
+};
+
+// Returns the size of the instruction at p_ip and the offsets of its address
+// operands, or -1 if the instruction can't be walked.
+int GDScriptBytecode::_get_opcode_size(const Vector<int> &p_code, int p_ip, Vector<int> *r_addresses) {
+	const int *code = p_code.ptr() + p_ip;
+	int available = p_code.size() - p_ip;
+	int size = -1;
+	int argc = 0;
+
+	r_addresses->clear();
+
+	switch (code[0]) {
+		case GDScriptFunction::OPCODE_OPERATOR:
+		case GDScriptFunction::OPCODE_OPERATOR_INT:
+		case GDScriptFunction::OPCODE_OPERATOR_REAL:
+		case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+		case GDScriptFunction::OPCODE_OPERATOR_VECTOR3: {
+			size = 5;
+			r_addresses->push_back(2);
+			r_addresses->push_back(3);
+			r_addresses->push_back(4);
+		} break;
+		case GDScriptFunction::OPCODE_EXTENDS_TEST:
+		case GDScriptFunction::OPCODE_SET:
+		case GDScriptFunction::OPCODE_GET:
+		case GDScriptFunction::OPCODE_SET_ARRAY_INDEX:
+		case GDScriptFunction::OPCODE_GET_ARRAY_INDEX:
+		case GDScriptFunction::OPCODE_ASSIGN_TYPED_NATIVE:
+		case GDScriptFunction::OPCODE_ASSIGN_TYPED_SCRIPT:
+		case GDScriptFunction::OPCODE_CAST_TO_NATIVE:
+		case GDScriptFunction::OPCODE_CAST_TO_SCRIPT: {
+			size = 4;
+			r_addresses->push_back(1);
+			r_addresses->push_back(2);
+			r_addresses->push_back(3);
+		} break;
+		case GDScriptFunction::OPCODE_IS_BUILTIN: {
+			size = 4;
+			r_addresses->push_back(1);
+			r_addresses->push_back(3);
+		} break;
+		case GDScriptFunction::OPCODE_SET_NAMED:
+		case GDScriptFunction::OPCODE_GET_NAMED: {
+			// [op, inline cache, base, name, value/dst]
+			size = 5;
+			r_addresses->push_back(2);
+			r_addresses->push_back(4);
+		} break;
+		case GDScriptFunction::OPCODE_SET_VECTOR_COMPONENT:
+		case GDScriptFunction::OPCODE_GET_VECTOR_COMPONENT: {
+			size = 5;
+			r_addresses->push_back(2);
+			r_addresses->push_back(4);
+		} break;
+		case GDScriptFunction::OPCODE_SET_MEMBER:
+		case GDScriptFunction::OPCODE_GET_MEMBER: {
+			size = 3;
+			r_addresses->push_back(2);
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN:
+		case GDScriptFunction::OPCODE_YIELD_SIGNAL:
+		case GDScriptFunction::OPCODE_ASSERT: {
+			size = 3;
+			r_addresses->push_back(1);
+			r_addresses->push_back(2);
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_TRUE:
+		case GDScriptFunction::OPCODE_ASSIGN_FALSE:
+		case GDScriptFunction::OPCODE_YIELD_RESUME:
+		case GDScriptFunction::OPCODE_RETURN: {
+			size = 2;
+			r_addresses->push_back(1);
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN:
+		case GDScriptFunction::OPCODE_CAST_TO_BUILTIN: {
+			size = 4;
+			r_addresses->push_back(2);
+			r_addresses->push_back(3);
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT:
+		case GDScriptFunction::OPCODE_CALL_BUILT_IN:
+		case GDScriptFunction::OPCODE_CALL_SELF_BASE: {
+			// [op, type/function/name, argc, args..., dst]
+			if (available < 3) {
+				return -1;
+			}
+			argc = code[2];
+			size = 4 + argc;
+			for (int i = 0; i <= argc; i++) {
+				r_addresses->push_back(3 + i);
+			}
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT_ARRAY:
+		case GDScriptFunction::OPCODE_CONSTRUCT_DICTIONARY: {
+			// [op, argc, elements..., dst], dictionaries store key/value pairs.
+			if (available < 2) {
+				return -1;
+			}
+			argc = code[1];
+			if (code[0] == GDScriptFunction::OPCODE_CONSTRUCT_DICTIONARY) {
+				argc *= 2;
+			}
+			size = 3 + argc;
+			for (int i = 0; i <= argc; i++) {
+				r_addresses->push_back(2 + i);
+			}
+		} break;
+		case GDScriptFunction::OPCODE_CALL:
+		case GDScriptFunction::OPCODE_CALL_RETURN: {
+			// [op, inline cache, argc, base, name, args..., dst]
+			if (available < 3) {
+				return -1;
+			}
+			argc = code[2];
+			size = 6 + argc;
+			r_addresses->push_back(3);
+			for (int i = 0; i <= argc; i++) {
+				r_addresses->push_back(5 + i);
+			}
+		} break;
+		case GDScriptFunction::OPCODE_JUMP_IF:
+		case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
+			size = 3;
+			r_addresses->push_back(1);
+		} break;
+		case GDScriptFunction::OPCODE_ITERATE_BEGIN:
+		case GDScriptFunction::OPCODE_ITERATE:
+		case GDScriptFunction::OPCODE_ITERATE_ARRAY_BEGIN:
+		case GDScriptFunction::OPCODE_ITERATE_ARRAY: {
+			size = 5;
+			r_addresses->push_back(1);
+			r_addresses->push_back(2);
+			r_addresses->push_back(4);
+		} break;
+		case GDScriptFunction::OPCODE_ITERATE_RANGE_BEGIN:
+		case GDScriptFunction::OPCODE_ITERATE_RANGE: {
+			size = 6;
+			r_addresses->push_back(1);
+			r_addresses->push_back(2);
+			r_addresses->push_back(3);
+			r_addresses->push_back(5);
+		} break;
+		case GDScriptFunction::OPCODE_JUMP:
+		case GDScriptFunction::OPCODE_LINE: {
+			size = 2;
+		} break;
+		case GDScriptFunction::OPCODE_YIELD:
+		case GDScriptFunction::OPCODE_JUMP_TO_DEF_ARGUMENT:
+		case GDScriptFunction::OPCODE_BREAKPOINT:
+		case GDScriptFunction::OPCODE_END: {
+			size = 1;
+		} break;
+		default: {
+			// OPCODE_CALL_SELF is never emitted.
+			return -1;
+		}
+	}
+
+	if (argc < 0 || size > available) {
+		return -1;
+	}
+
+	return size;
+}
+
+/* SAVING */
+
+// Built-in resources (saved inside a scene) can't be loaded by path.
+static bool _is_file_path(const String &p_path) {
+	return !p_path.empty() && p_path.find("::") == -1;
+}
+
+Error GDScriptBytecode::_save_object(SaveState &p_state, Writer &w, const Object *p_object) {
+	if (!p_object) {
+		w.put_u32(REF_NULL);
+		return OK;
+	}
+
+	const GDScriptNativeClass *native = Object::cast_to<GDScriptNativeClass>(p_object);
+	if (native) {
+		w.put_u32(REF_NATIVE);
+		w.put_string(native->get_name());
+		return OK;
+	}
+
+	const GDScript *script = Object::cast_to<GDScript>(p_object);
+	if (script) {
+		// Inner classes are saved as the path to their outermost class, and
+		// the chain of class names leading to them.
+		Vector<StringName> chain;
+		const GDScript *top = script;
+		while (top->_owner) {
+			chain.push_back(top->name);
+			top = top->_owner;
+		}
+
+		if (top == p_state.root || (p_state.path != String() && top->get_path() == p_state.path)) {
+			w.put_u32(REF_LOCAL);
+		} else {
+			String path = top->get_path();
+			if (!_is_file_path(path)) {
+				return ERR_UNAVAILABLE;
+			}
+			w.put_u32(REF_EXTERNAL);
+			w.put_string(path);
+		}
+
+		w.put_u32(chain.size());
+		for (int i = chain.size() - 1; i >= 0; i--) {
+			w.put_string(chain[i]);
+		}
+		return OK;
+	}
+
+	const Resource *resource = Object::cast_to<Resource>(p_object);
+	if (resource && _is_file_path(resource->get_path())) {
+		w.put_u32(REF_RESOURCE);
+		w.put_string(resource->get_path());
+		return OK;
+	}
+
+	// Built-in resources and plain objects can't be referenced from another file.
+	return ERR_UNAVAILABLE;
+}
+
+Error GDScriptBytecode::_save_value(SaveState &p_state, Writer &w, const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::OBJECT: {
+			w.put_u32(VALUE_OBJECT);
+			return _save_object(p_state, w, p_value.operator Object *());
+		} break;
+		case Variant::ARRAY: {
+			Array array = p_value;
+			w.put_u32(VALUE_ARRAY);
+			w.put_u32(array.size());
+			for (int i = 0; i < array.size(); i++) {
+				Error err = _save_value(p_state, w, array[i]);
+				if (err != OK) {
+					return err;
+				}
+			}
+		} break;
+		case Variant::DICTIONARY: {
+			Dictionary dictionary = p_value;
+			List<Variant> keys;
+			dictionary.get_key_list(&keys);
+			w.put_u32(VALUE_DICTIONARY);
+			w.put_u32(keys.size());
+			for (List<Variant>::Element *E = keys.front(); E; E = E->next()) {
+				Error err = _save_value(p_state, w, E->get());
+				if (err == OK) {
+					err = _save_value(p_state, w, dictionary[E->get()]);
+				}
+				if (err != OK) {
+					return err;
+				}
+			}
+		} break;
+		default: {
+			w.put_u32(VALUE_PLAIN);
+			return w.put_variant(p_value);
+		}
+	}
+
+	return OK;
+}
+
+Error GDScriptBytecode::_save_datatype(SaveState &p_state, Writer &w, const GDScriptDataType &p_type) {
+	w.put_u32(p_type.has_type);
+	w.put_u32(p_type.kind);
+	w.put_u32(p_type.builtin_type);
+	w.put_string(p_type.native_type);
+	if (p_type.kind == GDScriptDataType::SCRIPT || p_type.kind == GDScriptDataType::GDSCRIPT) {
+		return _save_object(p_state, w, p_type.script_type);
+	}
+	return OK;
+}
+
+Error GDScriptBytecode::_save_function(SaveState &p_state, Writer &w, const GDScriptFunction *p_function) {
+	w.put_string(p_function->name);
+	w.put_u32(p_function->_static);
+	w.put_u32(p_function->rpc_mode);
+	w.put_u32(p_function->_argument_count);
+	w.put_u32(p_function->_stack_size);
+	w.put_u32(p_function->_call_size);
+	w.put_u32(p_function->_inline_cache_count);
+	w.put_u32(p_function->_initial_line);
+
+	w.put_u32(p_function->argument_types.size());
+	for (int i = 0; i < p_function->argument_types.size(); i++) {
+		Error err = _save_datatype(p_state, w, p_function->argument_types[i]);
+		if (err != OK) {
+			return err;
+		}
+	}
+	Error err = _save_datatype(p_state, w, p_function->return_type);
+	if (err != OK) {
+		return err;
+	}
+
+#ifdef TOOLS_ENABLED
+	w.put_u32(p_function->arg_names.size());
+	for (int i = 0; i < p_function->arg_names.size(); i++) {
+		w.put_string(p_function->arg_names[i]);
+	}
+#else
+	w.put_u32(0);
+#endif
+
+	w.put_u32(p_function->constants.size());
+	for (int i = 0; i < p_function->constants.size(); i++) {
+		err = _save_value(p_state, w, p_function->constants[i]);
+		if (err != OK) {
+			return err;
+		}
+	}
+
+	w.put_u32(p_function->global_names.size());
+	for (int i = 0; i < p_function->global_names.size(); i++) {
+		w.put_string(p_function->global_names[i]);
+	}
+
+	w.put_u32(p_function->default_arguments.size());
+	for (int i = 0; i < p_function->default_arguments.size(); i++) {
+		w.put_u32(p_function->default_arguments[i]);
+	}
+
+	// Indices into the global array depend on what was registered when the
+	// script was compiled (autoloads are named globals in the editor), so
+	// global operands are saved by name and resolved again when loading.
+	Vector<int> code = p_function->code;
+	Vector<StringName> globals;
+	Vector<int> addresses;
+
+	for (int ip = 0; ip < code.size();) {
+		int size = _get_opcode_size(code, ip, &addresses);
+		if (size <= 0) {
+			return ERR_INVALID_DATA;
+		}
+
+		for (int i = 0; i < addresses.size(); i++) {
+			int address = code[ip + addresses[i]];
+			int index = address & GDScriptFunction::ADDR_MASK;
+			StringName global_name;
+
+			switch ((address & GDScriptFunction::ADDR_TYPE_MASK) >> GDScriptFunction::ADDR_BITS) {
+				case GDScriptFunction::ADDR_TYPE_GLOBAL: {
+					if (!p_state.global_names.has(index)) {
+						return ERR_INVALID_DATA;
+					}
+					global_name = p_state.global_names[index];
+				} break;
+#ifdef TOOLS_ENABLED
+				case GDScriptFunction::ADDR_TYPE_NAMED_GLOBAL: {
+					if (index >= p_function->named_globals.size()) {
+						return ERR_INVALID_DATA;
+					}
+					global_name = p_function->named_globals[index];
+				} break;
+#endif
+				default: {
+					continue;
+				}
+			}
+
+			int global = globals.find(global_name);
+			if (global == -1) {
+				global = globals.size();
+				globals.push_back(global_name);
+			}
+			code.write[ip + addresses[i]] = global | (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS);
+		}
+
+		ip += size;
+	}
+
+	w.put_u32(globals.size());
+	for (int i = 0; i < globals.size(); i++) {
+		w.put_string(globals[i]);
+	}
+
+	w.put_u32(code.size());
+	for (int i = 0; i < code.size(); i++) {
+		w.put_u32(code[i]);
+	}
+
+	return OK;
+}
+
+void GDScriptBytecode::_save_class_tree(Writer &w, const GDScript *p_script) {
+	w.put_u32(p_script->subclasses.size());
+	for (const Map<StringName, Ref<GDScript>>::Element *E = p_script->subclasses.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		_save_class_tree(w, E->get().ptr());
+	}
+}
+
+Error GDScriptBytecode::_save_class(SaveState &p_state, Writer &w, const GDScript *p_script) {
+	w.put_u32(p_script->tool);
+	w.put_string(p_script->name);
+
+	Error err = _save_object(p_state, w, p_script->native.is_valid() ? (Object *)p_script->native.ptr() : (Object *)p_script->base.ptr());
+	if (err != OK) {
+		return err;
+	}
+
+	// The member layout includes the base class members, which have to match
+	// the base script found at load time.
+	w.put_u32(p_script->base.is_valid() ? p_script->base->member_indices.size() : 0);
+	w.put_u32(p_script->member_indices.size());
+	for (const Map<StringName, GDScript::MemberInfo>::Element *E = p_script->member_indices.front(); E; E = E->next()) {
+		const GDScript::MemberInfo &info = E->get();
+		w.put_string(E->key());
+		w.put_u32(info.index);
+		w.put_string(info.setter);
+		w.put_string(info.getter);
+		w.put_u32(info.rpc_mode);
+		err = _save_datatype(p_state, w, info.data_type);
+		if (err != OK) {
+			return err;
+		}
+	}
+
+	w.put_u32(p_script->member_info.size());
+	for (const Map<StringName, PropertyInfo>::Element *E = p_script->member_info.front(); E; E = E->next()) {
+		const PropertyInfo &info = E->get();
+		w.put_string(E->key());
+		w.put_u32(info.type);
+		w.put_string(info.class_name);
+		w.put_u32(info.hint);
+		w.put_string(info.hint_string);
+		w.put_u32(info.usage);
+	}
+
+	// Subclasses are also constants, those are added back when loading.
+	int constant_count = 0;
+	for (const Map<StringName, Variant>::Element *E = p_script->constants.front(); E; E = E->next()) {
+		if (!p_script->subclasses.has(E->key())) {
+			constant_count++;
+		}
+	}
+	w.put_u32(constant_count);
+	for (const Map<StringName, Variant>::Element *E = p_script->constants.front(); E; E = E->next()) {
+		if (p_script->subclasses.has(E->key())) {
+			continue;
+		}
+		w.put_string(E->key());
+		err = _save_value(p_state, w, E->get());
+		if (err != OK) {
+			return err;
+		}
+	}
+
+	w.put_u32(p_script->_signals.size());
+	for (const Map<StringName, Vector<StringName>>::Element *E = p_script->_signals.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		w.put_u32(E->get().size());
+		for (int i = 0; i < E->get().size(); i++) {
+			w.put_string(E->get()[i]);
+		}
+	}
+
+	w.put_u32(p_script->member_functions.size());
+	for (const Map<StringName, GDScriptFunction *>::Element *E = p_script->member_functions.front(); E; E = E->next()) {
+		err = _save_function(p_state, w, E->get());
+		if (err != OK) {
+			return err;
+		}
+	}
+
+	// Map order depends on StringName addresses, so names are saved again to
+	// match the classes created from the tree.
+	for (const Map<StringName, Ref<GDScript>>::Element *E = p_script->subclasses.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		err = _save_class(p_state, w, E->get().ptr());
+		if (err != OK) {
+			return err;
+		}
+	}
+
+	return OK;
+}
+
+/* LOADING */
+
+Error GDScriptBytecode::_load_object(LoadState &p_state, Reader &r, Variant &r_object) {
+	uint32_t ref = r.get_u32();
+
+	switch (ref) {
+		case REF_NULL: {
+			r_object = Variant((Object *)nullptr);
+		} break;
+		case REF_NATIVE: {
+			StringName name = r.get_string();
+			const Map<StringName, int> &global_map = GDScriptLanguage::get_singleton()->get_global_map();
+			if (!global_map.has(name)) {
+				return ERR_CANT_RESOLVE;
+			}
+			Ref<GDScriptNativeClass> native = GDScriptLanguage::get_singleton()->get_global_array()[global_map[name]];
+			if (native.is_null()) {
+				return ERR_CANT_RESOLVE;
+			}
+			r_object = native;
+		} break;
+		case REF_LOCAL:
+		case REF_EXTERNAL: {
+			Ref<GDScript> script;
+			if (ref == REF_LOCAL) {
+				script = Ref<GDScript>(p_state.root);
+			} else {
+				script = ResourceLoader::load(r.get_string());
+			}
+			if (script.is_null()) {
+				return ERR_CANT_RESOLVE;
+			}
+
+			int depth = r.get_u32();
+			for (int i = 0; i < depth && !r.failed; i++) {
+				StringName name = r.get_string();
+				if (!script->subclasses.has(name)) {
+					return ERR_CANT_RESOLVE;
+				}
+				script = script->subclasses[name];
+			}
+			r_object = script;
+		} break;
+		case REF_RESOURCE: {
+			RES resource = ResourceLoader::load(r.get_string());
+			if (resource.is_null()) {
+				return ERR_CANT_RESOLVE;
+			}
+			r_object = resource;
+		} break;
+		default: {
+			return ERR_FILE_CORRUPT;
+		}
+	}
+
+	return r.failed ? ERR_FILE_CORRUPT : OK;
+}
+
+Error GDScriptBytecode::_load_value(LoadState &p_state, Reader &r, Variant &r_value, int p_depth) {
+	ERR_FAIL_COND_V(p_depth > Variant::MAX_RECURSION_DEPTH, ERR_OUT_OF_MEMORY);
+
+	switch (r.get_u32()) {
+		case VALUE_PLAIN: {
+			r_value = r.get_variant();
+		} break;
+		case VALUE_OBJECT: {
+			return _load_object(p_state, r, r_value);
+		} break;
+		case VALUE_ARRAY: {
+			uint32_t size = r.get_u32();
+			if (size > (uint32_t)r.get_available()) {
+				return ERR_FILE_CORRUPT;
+			}
+			Array array;
+			array.resize(size);
+			for (uint32_t i = 0; i < size; i++) {
+				Error err = _load_value(p_state, r, array[i], p_depth + 1);
+				if (err != OK) {
+					return err;
+				}
+			}
+			r_value = array;
+		} break;
+		case VALUE_DICTIONARY: {
+			uint32_t size = r.get_u32();
+			if (size > (uint32_t)r.get_available()) {
+				return ERR_FILE_CORRUPT;
+			}
+			Dictionary dictionary;
+			for (uint32_t i = 0; i < size; i++) {
+				Variant key;
+				Variant value;
+				Error err = _load_value(p_state, r, key, p_depth + 1);
+				if (err == OK) {
+					err = _load_value(p_state, r, value, p_depth + 1);
+				}
+				if (err != OK) {
+					return err;
+				}
+				dictionary[key] = value;
+			}
+			r_value = dictionary;
+		} break;
+		default: {
+			return ERR_FILE_CORRUPT;
+		}
+	}
+
+	return r.failed ? ERR_FILE_CORRUPT : OK;
+}
+
+Error GDScriptBytecode::_load_datatype(LoadState &p_state, Reader &r, const GDScript *p_owner, GDScriptDataType &r_type) {
+	r_type = GDScriptDataType();
+	r_type.has_type = r.get_u32();
+	uint32_t kind = r.get_u32();
+	uint32_t builtin_type = r.get_u32();
+	r_type.native_type = r.get_string();
+
+	if (kind > GDScriptDataType::GDSCRIPT || builtin_type >= Variant::VARIANT_MAX) {
+		return ERR_FILE_CORRUPT;
+	}
+	r_type.kind = (GDScriptDataType::Kind)kind;
+	r_type.builtin_type = (Variant::Type)builtin_type;
+
+	if (r_type.kind == GDScriptDataType::SCRIPT || r_type.kind == GDScriptDataType::GDSCRIPT) {
+		Variant object;
+		Error err = _load_object(p_state, r, object);
+		if (err != OK) {
+			return err;
+		}
+		Ref<Script> script = object;
+		if (script.is_null()) {
+			return ERR_CANT_RESOLVE;
+		}
+		r_type.script_type = script.ptr();
+		// Same as the compiler, don't hold a reference to the owner itself.
+		if (r_type.script_type != p_owner) {
+			r_type.script_type_ref = script;
+		}
+	}
+
+	return r.failed ? ERR_FILE_CORRUPT : OK;
+}
+
+Error GDScriptBytecode::_load_function(LoadState &p_state, Reader &r, GDScript *p_script, GDScriptFunction *p_function) {
+	p_function->name = r.get_string();
+	p_function->_static = r.get_u32();
+	p_function->rpc_mode = (MultiplayerAPI::RPCMode)r.get_u32();
+	p_function->_argument_count = r.get_u32();
+	p_function->_stack_size = r.get_u32();
+	p_function->_call_size = r.get_u32();
+	uint32_t inline_cache_count = r.get_u32();
+	p_function->_initial_line = r.get_u32();
+
+	uint32_t count = r.get_u32();
+	if (r.failed || count > (uint32_t)r.get_available()) {
+		return ERR_FILE_CORRUPT;
+	}
+	p_function->argument_types.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		Error err = _load_datatype(p_state, r, p_script, p_function->argument_types.write[i]);
+		if (err != OK) {
+			return err;
+		}
+	}
+	Error err = _load_datatype(p_state, r, p_script, p_function->return_type);
+	if (err != OK) {
+		return err;
+	}
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName arg_name = r.get_string();
+#ifdef TOOLS_ENABLED
+		p_function->arg_names.push_back(arg_name);
+#endif
+	}
+
+	count = r.get_u32();
+	if (r.failed || count > (uint32_t)r.get_available()) {
+		return ERR_FILE_CORRUPT;
+	}
+	p_function->constants.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		err = _load_value(p_state, r, p_function->constants.write[i]);
+		if (err != OK) {
+			return err;
+		}
+	}
+	p_function->_constant_count = p_function->constants.size();
+	p_function->_constants_ptr = p_function->constants.size() ? p_function->constants.ptrw() : nullptr;
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		p_function->global_names.push_back(r.get_string());
+	}
+	p_function->_global_names_count = p_function->global_names.size();
+	p_function->_global_names_ptr = p_function->global_names.size() ? p_function->global_names.ptr() : nullptr;
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		p_function->default_arguments.push_back(r.get_u32());
+	}
+	p_function->_default_arg_count = p_function->default_arguments.size() ? p_function->default_arguments.size() - 1 : 0;
+	p_function->_default_arg_ptr = p_function->default_arguments.size() ? p_function->default_arguments.ptr() : nullptr;
+
+	// Resolve the saved global names against what is registered now.
+	const Map<StringName, int> &global_map = GDScriptLanguage::get_singleton()->get_global_map();
+	Vector<int> globals;
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName global_name = r.get_string();
+		const Map<StringName, int>::Element *E = global_map.find(global_name);
+		if (E) {
+			globals.push_back(E->get() | (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS));
+			continue;
+		}
+#ifdef TOOLS_ENABLED
+		if (GDScriptLanguage::get_singleton()->get_named_globals_map().has(global_name)) {
+			globals.push_back(p_function->named_globals.size() | (GDScriptFunction::ADDR_TYPE_NAMED_GLOBAL << GDScriptFunction::ADDR_BITS));
+			p_function->named_globals.push_back(global_name);
+			continue;
+		}
+#endif
+		return ERR_CANT_RESOLVE;
+	}
+#ifdef TOOLS_ENABLED
+	p_function->_named_globals_count = p_function->named_globals.size();
+	p_function->_named_globals_ptr = p_function->named_globals.size() ? p_function->named_globals.ptr() : nullptr;
+#endif
+
+	count = r.get_u32();
+	if (r.failed || count > (uint32_t)r.get_available() / 4) {
+		return ERR_FILE_CORRUPT;
+	}
+	Vector<int> code;
+	code.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		code.write[i] = r.get_u32();
+	}
+
+	Vector<int> addresses;
+	for (int ip = 0; ip < code.size();) {
+		int size = _get_opcode_size(code, ip, &addresses);
+		if (size <= 0) {
+			return ERR_FILE_CORRUPT;
+		}
+
+		for (int i = 0; i < addresses.size(); i++) {
+			int address = code[ip + addresses[i]];
+			if (((address & GDScriptFunction::ADDR_TYPE_MASK) >> GDScriptFunction::ADDR_BITS) != GDScriptFunction::ADDR_TYPE_GLOBAL) {
+				continue;
+			}
+			int global = address & GDScriptFunction::ADDR_MASK;
+			if (global >= globals.size()) {
+				return ERR_FILE_CORRUPT;
+			}
+			code.write[ip + addresses[i]] = globals[global];
+		}
+
+		ip += size;
+	}
+
+	p_function->code = code;
+	p_function->_code_size = p_function->code.size();
+	p_function->_code_ptr = p_function->code.size() ? p_function->code.ptr() : nullptr;
+
+	// Every cache belongs to an instruction, anything more is corrupt.
+	if (inline_cache_count > (uint32_t)code.size()) {
+		return ERR_FILE_CORRUPT;
+	}
+	p_function->_set_inline_cache_count(inline_cache_count);
+
+	p_function->_script = p_script;
+	p_function->source = p_state.root->get_path();
+#ifdef DEBUG_ENABLED
+	p_function->func_cname = (String(p_function->source) + " - " + String(p_function->name)).utf8();
+	p_function->_func_cname = p_function->func_cname.get_data();
+#endif
+
+	return r.failed ? ERR_FILE_CORRUPT : OK;
+}
+
+Error GDScriptBytecode::_load_class_tree(Reader &r, GDScript *p_script) {
+	p_script->subclasses.clear();
+
+	uint32_t count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName name = r.get_string();
+
+		Ref<GDScript> subclass;
+		subclass.instance();
+		subclass->_owner = p_script;
+		subclass->fully_qualified_name = p_script->fully_qualified_name + "::" + name;
+		p_script->subclasses.insert(name, subclass);
+
+		Error err = _load_class_tree(r, subclass.ptr());
+		if (err != OK) {
+			return err;
+		}
+	}
+
+	return r.failed ? ERR_FILE_CORRUPT : OK;
+}
+
+Error GDScriptBytecode::_load_class(LoadState &p_state, Reader &r, GDScript *p_script) {
+	p_script->tool = r.get_u32();
+	p_script->name = r.get_string();
+
+	Variant base;
+	Error err = _load_object(p_state, r, base);
+	if (err != OK) {
+		return err;
+	}
+	p_script->native = base;
+	p_script->base = base;
+	p_script->_base = p_script->base.ptr();
+	if (p_script->native.is_null() && p_script->base.is_null()) {
+		return ERR_CANT_RESOLVE;
+	}
+
+	uint32_t base_member_count = r.get_u32();
+	uint32_t count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName name = r.get_string();
+		GDScript::MemberInfo info;
+		info.index = r.get_u32();
+		info.setter = r.get_string();
+		info.getter = r.get_string();
+		info.rpc_mode = (MultiplayerAPI::RPCMode)r.get_u32();
+		err = _load_datatype(p_state, r, p_script, info.data_type);
+		if (err != OK) {
+			return err;
+		}
+		p_script->member_indices[name] = info;
+	}
+
+	// A base from another file may have changed since the export, local
+	// bases come from this same payload and can't go out of sync.
+	const GDScript *base_top = p_script->_base;
+	while (base_top && base_top->_owner) {
+		base_top = base_top->_owner;
+	}
+	if (base_top && base_top != p_state.root) {
+		if ((uint32_t)p_script->_base->member_indices.size() != base_member_count) {
+			return ERR_FILE_UNRECOGNIZED;
+		}
+		for (const Map<StringName, GDScript::MemberInfo>::Element *E = p_script->_base->member_indices.front(); E; E = E->next()) {
+			const Map<StringName, GDScript::MemberInfo>::Element *F = p_script->member_indices.find(E->key());
+			if (!F || F->get().index != E->get().index) {
+				return ERR_FILE_UNRECOGNIZED;
+			}
+		}
+	}
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName name = r.get_string();
+		PropertyInfo info;
+		info.name = name;
+		info.type = (Variant::Type)r.get_u32();
+		info.class_name = r.get_string();
+		info.hint = (PropertyHint)r.get_u32();
+		info.hint_string = r.get_string();
+		info.usage = r.get_u32();
+		p_script->member_info[name] = info;
+		p_script->members.insert(name);
+	}
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName name = r.get_string();
+		Variant value;
+		err = _load_value(p_state, r, value);
+		if (err != OK) {
+			return err;
+		}
+		p_script->constants[name] = value;
+	}
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		StringName name = r.get_string();
+		Vector<StringName> arguments;
+		uint32_t argument_count = r.get_u32();
+		for (uint32_t j = 0; j < argument_count && !r.failed; j++) {
+			arguments.push_back(r.get_string());
+		}
+		p_script->_signals[name] = arguments;
+	}
+
+	count = r.get_u32();
+	for (uint32_t i = 0; i < count && !r.failed; i++) {
+		GDScriptFunction *function = memnew(GDScriptFunction);
+		err = _load_function(p_state, r, p_script, function);
+		if (err != OK) {
+			memdelete(function);
+			return err;
+		}
+		if (p_script->member_functions.has(function->name)) {
+			memdelete(p_script->member_functions[function->name]);
+		}
+		p_script->member_functions[function->name] = function;
+	}
+
+	const Map<StringName, GDScriptFunction *>::Element *initializer = p_script->member_functions.find("_init");
+	p_script->initializer = initializer ? initializer->get() : nullptr;
+
+	for (int i = 0; i < p_script->subclasses.size() && !r.failed; i++) {
+		StringName name = r.get_string();
+		Map<StringName, Ref<GDScript>>::Element *E = p_script->subclasses.find(name);
+		if (!E) {
+			return ERR_FILE_CORRUPT;
+		}
+		err = _load_class(p_state, r, E->get().ptr());
+		if (err != OK) {
+			return err;
+		}
+		p_script->constants.insert(name, E->get());
+	}
+
+	if (r.failed) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	p_script->valid = true;
+	return OK;
+}
+
+void GDScriptBytecode::_clear_class(GDScript *p_script) {
+	for (Map<StringName, Ref<GDScript>>::Element *E = p_script->subclasses.front(); E; E = E->next()) {
+		_clear_class(E->get().ptr());
+	}
+	for (Map<StringName, GDScriptFunction *>::Element *E = p_script->member_functions.front(); E; E = E->next()) {
+		memdelete(E->get());
+	}
+
+	p_script->native = Ref<GDScriptNativeClass>();
+	p_script->base = Ref<GDScript>();
+	p_script->_base = nullptr;
+	p_script->members.clear();
+	p_script->constants.clear();
+	p_script->member_functions.clear();
+	p_script->member_indices.clear();
+	p_script->member_info.clear();
+	p_script->_signals.clear();
+	p_script->subclasses.clear();
+	p_script->initializer = nullptr;
+	p_script->valid = false;
+}
+
+/* PUBLIC API */
+
+bool GDScriptBytecode::is_container(const Vector<uint8_t> &p_buffer) {
+	return p_buffer.size() >= 8 && p_buffer[0] == 'G' && p_buffer[1] == 'D' && p_buffer[2] == 'B' && p_buffer[3] == 'C';
+}
+
+Vector<uint8_t> GDScriptBytecode::make_container(const Vector<uint8_t> &p_tokens, const Vector<uint8_t> &p_compiled) {
+	Writer w;
+	w.put_u32(0);
+	w.data.write[0] = 'G';
+	w.data.write[1] = 'D';
+	w.data.write[2] = 'B';
+	w.data.write[3] = 'C';
+	w.put_u32(BYTECODE_CONTAINER_VERSION);
+
+	w.put_u32(p_tokens.size());
+	int pos = w.data.size();
+	w.data.resize(pos + p_tokens.size());
+	memcpy(w.data.ptrw() + pos, p_tokens.ptr(), p_tokens.size());
+
+	w.put_u32(p_compiled.size());
+	pos = w.data.size();
+	w.data.resize(pos + p_compiled.size());
+	memcpy(w.data.ptrw() + pos, p_compiled.ptr(), p_compiled.size());
+
+	return w.data;
+}
+
+Error GDScriptBytecode::split_container(const Vector<uint8_t> &p_buffer, Vector<uint8_t> &r_tokens, Vector<uint8_t> &r_compiled) {
+	ERR_FAIL_COND_V(!is_container(p_buffer), ERR_INVALID_DATA);
+
+	const uint8_t *buf = p_buffer.ptr();
+	int len = p_buffer.size();
+	ERR_FAIL_COND_V_MSG(decode_uint32(&buf[4]) > BYTECODE_CONTAINER_VERSION, ERR_INVALID_DATA, "Compiled script is too recent! Please use a newer engine version.");
+
+	int pos = 8;
+	for (int i = 0; i < 2; i++) {
+		ERR_FAIL_COND_V(len - pos < 4, ERR_FILE_CORRUPT);
+		uint32_t size = decode_uint32(&buf[pos]);
+		pos += 4;
+		ERR_FAIL_COND_V(size > (uint32_t)(len - pos), ERR_FILE_CORRUPT);
+
+		Vector<uint8_t> &section = i == 0 ? r_tokens : r_compiled;
+		section.resize(size);
+		memcpy(section.ptrw(), &buf[pos], size);
+		pos += size;
+	}
+
+	return OK;
+}
+
+Error GDScriptBytecode::serialize(const GDScript *p_script, const String &p_path, Vector<uint8_t> &r_compiled) {
+	ERR_FAIL_COND_V(!p_script->valid, ERR_INVALID_PARAMETER);
+
+	SaveState state;
+	state.root = p_script;
+	state.path = p_path;
+	const Map<StringName, int> &global_map = GDScriptLanguage::get_singleton()->get_global_map();
+	for (const Map<StringName, int>::Element *E = global_map.front(); E; E = E->next()) {
+		state.global_names[E->get()] = E->key();
+	}
+
+	// Anything the compiled code depends on that can change between builds
+	// is part of the header, a mismatch means loading from tokens instead.
+	Writer w;
+	w.put_u32(BYTECODE_FORMAT_VERSION);
+	w.put_string(VERSION_FULL_BUILD);
+	w.put_string(VERSION_HASH);
+	w.put_u32(GDScriptFunction::OPCODE_END);
+	w.put_u32(GDScriptFunctions::FUNC_MAX);
+	w.put_u32(Variant::VARIANT_MAX);
+	w.put_u32(Variant::OP_MAX);
+	w.put_u32(sizeof(real_t));
+
+	_save_class_tree(w, p_script);
+	Error err = _save_class(state, w, p_script);
+	if (err != OK) {
+		return err;
+	}
+
+	r_compiled = w.data;
+	return OK;
+}
+
+Error GDScriptBytecode::deserialize(GDScript *p_script, const Vector<uint8_t> &p_compiled) {
+	Reader r(p_compiled.ptr(), p_compiled.size());
+
+	if (r.get_u32() != BYTECODE_FORMAT_VERSION ||
+			r.get_string() != VERSION_FULL_BUILD ||
+			r.get_string() != VERSION_HASH ||
+			r.get_u32() != GDScriptFunction::OPCODE_END ||
+			r.get_u32() != GDScriptFunctions::FUNC_MAX ||
+			r.get_u32() != Variant::VARIANT_MAX ||
+			r.get_u32() != Variant::OP_MAX ||
+			r.get_u32() != sizeof(real_t)) {
+		return ERR_FILE_UNRECOGNIZED;
+	}
+
+	LoadState state;
+	state.root = p_script;
+
+	p_script->valid = false;
+	p_script->_owner = nullptr;
+	p_script->fully_qualified_name = p_script->path;
+
+	GDScriptFunction::invalidate_inline_caches();
+
+	Error err = _load_class_tree(r, p_script);
+	if (err == OK) {
+		err = _load_class(state, r, p_script);
+	}
+	if (err != OK) {
+		_clear_class(p_script);
+	}
+
+	return err;
+}
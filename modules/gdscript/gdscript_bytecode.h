@@ -0,0 +1,90 @@
+/*************************************************************************/
+/*  gdscript_bytecode.h                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_BYTECODE_H
+#define GDSCRIPT_BYTECODE_H
+
+#include "gdscript.h"
+
+// Compiled form of a GDScript, saved at export time so exported games can
+// skip the parser and compiler. The exported file is a container holding the
+// token stream as well as the compiled payload: the payload is only used when
+// it was produced by this exact engine build, otherwise the tokens are
+// parsed and compiled as usual.
+class GDScriptBytecode {
+	class Writer;
+	class Reader;
+	struct SaveState;
+	struct LoadState;
+
+	enum ScriptRef {
+		REF_NULL,
+		REF_NATIVE,
+		REF_LOCAL,
+		REF_EXTERNAL,
+		REF_RESOURCE,
+	};
+
+	enum ValueKind {
+		VALUE_PLAIN,
+		VALUE_OBJECT,
+		VALUE_ARRAY,
+		VALUE_DICTIONARY,
+	};
+
+	static int _get_opcode_size(const Vector<int> &p_code, int p_ip, Vector<int> *r_addresses);
+
+	static Error _save_object(SaveState &p_state, Writer &w, const Object *p_object);
+	static Error _save_value(SaveState &p_state, Writer &w, const Variant &p_value);
+	static Error _save_datatype(SaveState &p_state, Writer &w, const GDScriptDataType &p_type);
+	static Error _save_function(SaveState &p_state, Writer &w, const GDScriptFunction *p_function);
+	static void _save_class_tree(Writer &w, const GDScript *p_script);
+	static Error _save_class(SaveState &p_state, Writer &w, const GDScript *p_script);
+
+	static Error _load_object(LoadState &p_state, Reader &r, Variant &r_object);
+	static Error _load_value(LoadState &p_state, Reader &r, Variant &r_value, int p_depth = 0);
+	static Error _load_datatype(LoadState &p_state, Reader &r, const GDScript *p_owner, GDScriptDataType &r_type);
+	static Error _load_function(LoadState &p_state, Reader &r, GDScript *p_script, GDScriptFunction *p_function);
+	static Error _load_class_tree(Reader &r, GDScript *p_script);
+	static Error _load_class(LoadState &p_state, Reader &r, GDScript *p_script);
+	static void _clear_class(GDScript *p_script);
+
+public:
+	static bool is_container(const Vector<uint8_t> &p_buffer);
+	static Vector<uint8_t> make_container(const Vector<uint8_t> &p_tokens, const Vector<uint8_t> &p_compiled);
+	static Error split_container(const Vector<uint8_t> &p_buffer, Vector<uint8_t> &r_tokens, Vector<uint8_t> &r_compiled);
+
+	// p_path is the path the script will be loaded from, so references to it
+	// (e.g. preloading itself) are saved as local references.
+	static Error serialize(const GDScript *p_script, const String &p_path, Vector<uint8_t> &r_compiled);
+	static Error deserialize(GDScript *p_script, const Vector<uint8_t> &p_compiled);
+};
+
+#endif // GDSCRIPT_BYTECODE_H
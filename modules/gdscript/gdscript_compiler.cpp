@@ -30,6 +30,7 @@
 
 #include "gdscript_compiler.h"
 
+#include "core/core_string_names.h"
 #include "gdscript.h"
 
 bool GDScriptCompiler::_is_class_member_property(CodeGen &codegen, const StringName &p_name) {
@@ -82,7 +83,7 @@ bool GDScriptCompiler::_create_unary_operator(CodeGen &codegen, const GDScriptPa
 		return false;
 	}
 
-	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
+	codegen.opcodes.push_back(_get_operator_opcode(op, on->arguments[0], on->arguments[0])); // perform operator
 	codegen.opcodes.push_back(op); //which operator
 	codegen.opcodes.push_back(src_address_a); // argument 1
 	codegen.opcodes.push_back(src_address_a); // argument 2 (repeated)
@@ -106,13 +107,236 @@ bool GDScriptCompiler::_create_binary_operator(CodeGen &codegen, const GDScriptP
 		return false;
 	}
 
-	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
+	codegen.opcodes.push_back(_get_operator_opcode(op, on->arguments[0], on->arguments[1])); // perform operator
 	codegen.opcodes.push_back(op); //which operator
 	codegen.opcodes.push_back(src_address_a); // argument 1
 	codegen.opcodes.push_back(src_address_b); // argument 2 (unary only takes one parameter)
 	return true;
 }
 
+// Operators the typed opcodes implement inline, see GDScriptFunction::call().
+static bool _is_typed_operator(Variant::Type p_type, Variant::Operator p_op) {
+	switch (p_op) {
+		case Variant::OP_ADD:
+		case Variant::OP_SUBTRACT:
+		case Variant::OP_MULTIPLY:
+		case Variant::OP_DIVIDE:
+		case Variant::OP_NEGATE:
+		case Variant::OP_EQUAL:
+		case Variant::OP_NOT_EQUAL:
+			return true;
+		case Variant::OP_LESS:
+		case Variant::OP_LESS_EQUAL:
+		case Variant::OP_GREATER:
+		case Variant::OP_GREATER_EQUAL:
+			return p_type == Variant::INT || p_type == Variant::REAL;
+		case Variant::OP_MODULE:
+		case Variant::OP_BIT_AND:
+		case Variant::OP_BIT_OR:
+		case Variant::OP_BIT_XOR:
+			return p_type == Variant::INT;
+		default:
+			return false;
+	}
+}
+
+GDScriptFunction::Opcode GDScriptCompiler::_get_operator_opcode(Variant::Operator p_op, const GDScriptParser::Node *p_a, const GDScriptParser::Node *p_b) const {
+	// The parser inferred types are only a hint, the typed opcodes check the
+	// actual operand types and fall back to Variant::evaluate() if they differ.
+	if (!typed_opcodes_enabled) {
+		return GDScriptFunction::OPCODE_OPERATOR;
+	}
+
+	GDScriptParser::DataType a = p_a->get_datatype();
+	GDScriptParser::DataType b = p_b->get_datatype();
+	if (!a.has_type || !b.has_type || a.is_meta_type || b.is_meta_type || a.kind != GDScriptParser::DataType::BUILTIN || b.kind != GDScriptParser::DataType::BUILTIN) {
+		return GDScriptFunction::OPCODE_OPERATOR;
+	}
+
+	bool b_num = b.builtin_type == Variant::INT || b.builtin_type == Variant::REAL;
+
+	switch (a.builtin_type) {
+		case Variant::INT: {
+			if (b.builtin_type == Variant::INT && _is_typed_operator(Variant::INT, p_op)) {
+				return GDScriptFunction::OPCODE_OPERATOR_INT;
+			}
+			if (b.builtin_type == Variant::REAL && _is_typed_operator(Variant::REAL, p_op)) {
+				return GDScriptFunction::OPCODE_OPERATOR_REAL;
+			}
+		} break;
+		case Variant::REAL: {
+			if (b_num && _is_typed_operator(Variant::REAL, p_op)) {
+				return GDScriptFunction::OPCODE_OPERATOR_REAL;
+			}
+		} break;
+		case Variant::VECTOR2:
+		case Variant::VECTOR3: {
+			bool vector_op = b.builtin_type == a.builtin_type && _is_typed_operator(a.builtin_type, p_op);
+			bool scalar_op = b_num && (p_op == Variant::OP_MULTIPLY || p_op == Variant::OP_DIVIDE);
+			if (vector_op || scalar_op) {
+				return a.builtin_type == Variant::VECTOR2 ? GDScriptFunction::OPCODE_OPERATOR_VECTOR2 : GDScriptFunction::OPCODE_OPERATOR_VECTOR3;
+			}
+		} break;
+		default: {
+		}
+	}
+
+	return GDScriptFunction::OPCODE_OPERATOR;
+}
+
+int GDScriptCompiler::_get_vector_component(const GDScriptParser::Node *p_base, const StringName &p_name) const {
+	if (!typed_opcodes_enabled) {
+		return -1;
+	}
+
+	GDScriptParser::DataType base = p_base->get_datatype();
+	if (!base.has_type || base.is_meta_type || base.kind != GDScriptParser::DataType::BUILTIN) {
+		return -1;
+	}
+	if (base.builtin_type != Variant::VECTOR2 && base.builtin_type != Variant::VECTOR3) {
+		return -1;
+	}
+
+	if (p_name == CoreStringNames::get_singleton()->x) {
+		return 0;
+	}
+	if (p_name == CoreStringNames::get_singleton()->y) {
+		return 1;
+	}
+	if (p_name == CoreStringNames::get_singleton()->z && base.builtin_type == Variant::VECTOR3) {
+		return 2;
+	}
+	return -1;
+}
+
+bool GDScriptCompiler::_is_typed_array(const GDScriptParser::Node *p_base) const {
+	if (!typed_opcodes_enabled) {
+		return false;
+	}
+
+	GDScriptParser::DataType base = p_base->get_datatype();
+	if (!base.has_type || base.is_meta_type || base.kind != GDScriptParser::DataType::BUILTIN) {
+		return false;
+	}
+
+	// Packed arrays of scalars and vectors store their elements unboxed, the
+	// typed opcodes read and write them without a Variant round trip.
+	switch (base.builtin_type) {
+		case Variant::ARRAY:
+		case Variant::POOL_BYTE_ARRAY:
+		case Variant::POOL_INT_ARRAY:
+		case Variant::POOL_REAL_ARRAY:
+		case Variant::POOL_VECTOR2_ARRAY:
+		case Variant::POOL_VECTOR3_ARRAY:
+		case Variant::POOL_COLOR_ARRAY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool GDScriptCompiler::_get_class_constant(CodeGen &codegen, const StringName &p_name, Variant &r_value) const {
+	GDScript *owner = codegen.script;
+	while (owner) {
+		GDScript *scr = owner;
+		GDScriptNativeClass *nc = nullptr;
+		while (scr) {
+			const Map<StringName, Variant>::Element *E = scr->constants.find(p_name);
+			if (E) {
+				r_value = E->get();
+				return true;
+			}
+			if (scr->native.is_valid()) {
+				nc = scr->native.ptr();
+			}
+			scr = scr->_base;
+		}
+
+		// the native class of this owner shadows constants of the outer classes
+		if (nc) {
+			bool success = false;
+			int constant = ClassDB::get_integer_constant(nc->get_name(), p_name, &success);
+			if (success) {
+				r_value = constant;
+				return true;
+			}
+		}
+
+		owner = owner->_owner;
+	}
+	return false;
+}
+
+bool GDScriptCompiler::_get_constant_expression(CodeGen &codegen, const GDScriptParser::Node *p_expression, Variant &r_value) {
+	switch (p_expression->type) {
+		case GDScriptParser::Node::TYPE_CONSTANT: {
+			r_value = static_cast<const GDScriptParser::ConstantNode *>(p_expression)->value;
+			return true;
+		}
+		case GDScriptParser::Node::TYPE_IDENTIFIER: {
+			// Same lookup order as _parse_expression(), anything that can shadow a class constant comes first.
+			StringName identifier = static_cast<const GDScriptParser::IdentifierNode *>(p_expression)->name;
+			if (codegen.stack_identifiers.has(identifier) || _is_class_member_property(codegen, identifier)) {
+				return false;
+			}
+			if ((!codegen.function_node || !codegen.function_node->_static) && codegen.script->member_indices.has(identifier)) {
+				return false;
+			}
+			return _get_class_constant(codegen, identifier, r_value);
+		}
+		case GDScriptParser::Node::TYPE_OPERATOR: {
+			const GDScriptParser::OperatorNode *on = static_cast<const GDScriptParser::OperatorNode *>(p_expression);
+			if (on->op != GDScriptParser::OperatorNode::OP_NOT || on->arguments.size() != 1) {
+				return false;
+			}
+			if (!_get_constant_expression(codegen, on->arguments[0], r_value)) {
+				return false;
+			}
+			r_value = !r_value.booleanize();
+			return true;
+		}
+		default: {
+			return false;
+		}
+	}
+}
+
+bool GDScriptCompiler::_is_retargetable(const GDScriptParser::OperatorNode *p_operator) const {
+	// These opcodes read all their operands before writing the destination,
+	// so the destination may be one of the operands.
+	switch (p_operator->op) {
+		case GDScriptParser::OperatorNode::OP_CALL:
+			// Only regular calls, built-in functions write their result while reading the arguments.
+			return p_operator->arguments[0]->type != GDScriptParser::Node::TYPE_TYPE && p_operator->arguments[0]->type != GDScriptParser::Node::TYPE_BUILT_IN_FUNCTION;
+		case GDScriptParser::OperatorNode::OP_INDEX:
+		case GDScriptParser::OperatorNode::OP_INDEX_NAMED:
+		case GDScriptParser::OperatorNode::OP_NEG:
+		case GDScriptParser::OperatorNode::OP_POS:
+		case GDScriptParser::OperatorNode::OP_NOT:
+		case GDScriptParser::OperatorNode::OP_BIT_INVERT:
+		case GDScriptParser::OperatorNode::OP_IN:
+		case GDScriptParser::OperatorNode::OP_EQUAL:
+		case GDScriptParser::OperatorNode::OP_NOT_EQUAL:
+		case GDScriptParser::OperatorNode::OP_LESS:
+		case GDScriptParser::OperatorNode::OP_LESS_EQUAL:
+		case GDScriptParser::OperatorNode::OP_GREATER:
+		case GDScriptParser::OperatorNode::OP_GREATER_EQUAL:
+		case GDScriptParser::OperatorNode::OP_ADD:
+		case GDScriptParser::OperatorNode::OP_SUB:
+		case GDScriptParser::OperatorNode::OP_MUL:
+		case GDScriptParser::OperatorNode::OP_DIV:
+		case GDScriptParser::OperatorNode::OP_MOD:
+		case GDScriptParser::OperatorNode::OP_SHIFT_LEFT:
+		case GDScriptParser::OperatorNode::OP_SHIFT_RIGHT:
+		case GDScriptParser::OperatorNode::OP_BIT_AND:
+		case GDScriptParser::OperatorNode::OP_BIT_OR:
+		case GDScriptParser::OperatorNode::OP_BIT_XOR:
+			return true;
+		default:
+			return false;
+	}
+}
+
 GDScriptDataType GDScriptCompiler::_gdtype_from_datatype(const GDScriptParser::DataType &p_datatype, GDScript *p_owner) const {
 	if (!p_datatype.has_type) {
 		return GDScriptDataType();
@@ -238,6 +462,7 @@ int GDScriptCompiler::_parse_assign_right_expression(CodeGen &codegen, const GDS
 	int dst_addr = (p_stack_level) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
 	codegen.opcodes.push_back(dst_addr); // append the stack level as destination address of the opcode
 	codegen.alloc_stack(p_stack_level);
+	codegen.retarget_pos = codegen.opcodes.size() - 1;
 	return dst_addr;
 }
 
@@ -290,6 +515,12 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 				GDScriptNativeClass *nc = nullptr;
 				while (scr) {
 					if (scr->constants.has(identifier)) {
+						if (optimizations_enabled && scr->constants[identifier].get_type() != Variant::OBJECT) {
+							// Constants never change, copy them to the local table instead of looking them up by name on every access.
+							// Objects are left out, a script holding its own preload would never be freed.
+							int idx = codegen.get_constant_pos(scr->constants[identifier]);
+							return idx | (GDScriptFunction::ADDR_TYPE_LOCAL_CONSTANT << GDScriptFunction::ADDR_BITS);
+						}
 						//int idx=scr->constants[identifier];
 						int idx = codegen.get_name_map_pos(identifier);
 						return idx | (GDScriptFunction::ADDR_TYPE_CLASS_CONSTANT << GDScriptFunction::ADDR_BITS); //argument (stack root)
@@ -669,6 +900,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 						}
 
 						codegen.opcodes.push_back(p_root ? GDScriptFunction::OPCODE_CALL : GDScriptFunction::OPCODE_CALL_RETURN); // perform operator
+						codegen.opcodes.push_back(codegen.alloc_inline_cache());
 						codegen.opcodes.push_back(on->arguments.size() - 2);
 						codegen.alloc_call(on->arguments.size() - 2);
 						for (int i = 0; i < arguments.size(); i++) {
@@ -761,7 +993,22 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 						}
 					}
 
-					codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : GDScriptFunction::OPCODE_GET); // perform operator
+					int component = -1;
+					if (on->op == GDScriptParser::OperatorNode::OP_INDEX_NAMED && p_index_addr == 0) {
+						component = _get_vector_component(on->arguments[0], static_cast<GDScriptParser::IdentifierNode *>(on->arguments[1])->name);
+					}
+
+					if (component >= 0) {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_VECTOR_COMPONENT); // typed base, read the component directly
+						codegen.opcodes.push_back(component);
+					} else if (named) {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_NAMED); // perform operator
+						codegen.opcodes.push_back(codegen.alloc_inline_cache());
+					} else if (_is_typed_array(on->arguments[0])) {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_ARRAY_INDEX); // typed base, read the element directly
+					} else {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET); // perform operator
+					}
 					codegen.opcodes.push_back(from); // argument 1
 					codegen.opcodes.push_back(index); // argument 2 (unary only takes one parameter)
 
@@ -1103,7 +1350,15 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 								return key_idx;
 							}
 
-							codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : GDScriptFunction::OPCODE_GET);
+							bool typed_array = !named && _is_typed_array(E->get()->arguments[0]);
+							if (typed_array) {
+								codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_ARRAY_INDEX);
+							} else {
+								codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : GDScriptFunction::OPCODE_GET);
+							}
+							if (named) {
+								codegen.opcodes.push_back(codegen.alloc_inline_cache());
+							}
 							codegen.opcodes.push_back(prev_pos);
 							codegen.opcodes.push_back(key_idx);
 							slevel++;
@@ -1117,7 +1372,12 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							setchain.push_back(dst_pos);
 							setchain.push_back(key_idx);
 							setchain.push_back(prev_pos);
-							setchain.push_back(named ? GDScriptFunction::OPCODE_SET_NAMED : GDScriptFunction::OPCODE_SET);
+							if (named) {
+								setchain.push_back(codegen.alloc_inline_cache());
+								setchain.push_back(GDScriptFunction::OPCODE_SET_NAMED);
+							} else {
+								setchain.push_back(typed_array ? GDScriptFunction::OPCODE_SET_ARRAY_INDEX : GDScriptFunction::OPCODE_SET);
+							}
 
 							prev_pos = dst_pos;
 						}
@@ -1149,7 +1409,18 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							return set_value;
 						}
 
-						codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_SET_NAMED : GDScriptFunction::OPCODE_SET);
+						int component = named ? _get_vector_component(op->arguments[0], static_cast<const GDScriptParser::IdentifierNode *>(op->arguments[1])->name) : -1;
+						if (component >= 0) {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET_VECTOR_COMPONENT);
+							codegen.opcodes.push_back(component);
+						} else if (named) {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET_NAMED);
+							codegen.opcodes.push_back(codegen.alloc_inline_cache());
+						} else if (_is_typed_array(op->arguments[0])) {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET_ARRAY_INDEX);
+						} else {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET);
+						}
 						codegen.opcodes.push_back(prev_pos);
 						codegen.opcodes.push_back(set_index);
 						codegen.opcodes.push_back(set_value);
@@ -1242,6 +1513,10 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 									codegen.opcodes.push_back(src_address_b); // argument 2 (unary only takes one parameter)
 								}
 							}
+						} else if (optimizations_enabled && codegen.retarget_pos >= 0 && codegen.retarget_pos == codegen.opcodes.size() - 1 && codegen.opcodes[codegen.retarget_pos] == src_address_b && (dst_address_a & GDScriptFunction::ADDR_TYPE_MASK) >> GDScriptFunction::ADDR_BITS == GDScriptFunction::ADDR_TYPE_STACK_VARIABLE) {
+							// The right side ended in a temporary, make it write to the local variable instead.
+							codegen.opcodes.write[codegen.retarget_pos] = dst_address_a;
+							codegen.retarget_pos = -1;
 						} else {
 							// Either untyped assignment or already type-checked by the parser
 							codegen.opcodes.push_back(GDScriptFunction::OPCODE_ASSIGN); // perform operator
@@ -1305,6 +1580,9 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 			int dst_addr = (p_stack_level) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
 			codegen.opcodes.push_back(dst_addr); // append the stack level as destination address of the opcode
 			codegen.alloc_stack(p_stack_level);
+			if (_is_retargetable(on)) {
+				codegen.retarget_pos = codegen.opcodes.size() - 1;
+			}
 			return dst_addr;
 		} break;
 		//TYPE_TYPE,
@@ -1314,6 +1592,146 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 	}
 }
 
+bool GDScriptCompiler::_is_range_for(const GDScriptParser::ControlFlowNode *p_cf) const {
+	if (!typed_opcodes_enabled) {
+		return false;
+	}
+
+	// The parser rewrites range() into an int or vector container and types
+	// the iterator as int, other containers never get a typed iterator.
+	GDScriptParser::DataType iter_type = p_cf->arguments[0]->get_datatype();
+	if (!iter_type.has_type || iter_type.kind != GDScriptParser::DataType::BUILTIN || iter_type.builtin_type != Variant::INT) {
+		return false;
+	}
+
+	const GDScriptParser::Node *container = p_cf->arguments[1];
+	if (container->type == GDScriptParser::Node::TYPE_CONSTANT) {
+		Variant::Type type = static_cast<const GDScriptParser::ConstantNode *>(container)->value.get_type();
+		return type == Variant::INT || type == Variant::VECTOR2 || type == Variant::VECTOR3;
+	}
+
+	if (container->type != GDScriptParser::Node::TYPE_OPERATOR) {
+		return false;
+	}
+	const GDScriptParser::OperatorNode *on = static_cast<const GDScriptParser::OperatorNode *>(container);
+	if (on->op != GDScriptParser::OperatorNode::OP_CALL || on->arguments[0]->type != GDScriptParser::Node::TYPE_TYPE) {
+		return false;
+	}
+
+	switch (static_cast<const GDScriptParser::TypeNode *>(on->arguments[0])->vtype) {
+		case Variant::INT:
+			return on->arguments.size() == 2;
+		case Variant::VECTOR2:
+			return on->arguments.size() == 3;
+		case Variant::VECTOR3:
+			return on->arguments.size() == 4;
+		default:
+			return false;
+	}
+}
+
+Error GDScriptCompiler::_parse_range_for(CodeGen &codegen, const GDScriptParser::ControlFlowNode *p_cf, int p_stack_level) {
+	// from, to and step, either as an expression or as a constant.
+	const GDScriptParser::Node *bound_nodes[3] = { nullptr, nullptr, nullptr };
+	int64_t bound_constants[3] = { 0, 0, 1 };
+
+	const GDScriptParser::Node *container = p_cf->arguments[1];
+	if (container->type == GDScriptParser::Node::TYPE_CONSTANT) {
+		const Variant &value = static_cast<const GDScriptParser::ConstantNode *>(container)->value;
+		switch (value.get_type()) {
+			case Variant::INT: {
+				bound_constants[1] = (int64_t)value;
+			} break;
+			case Variant::VECTOR2: {
+				Vector2 v = value;
+				bound_constants[0] = (int64_t)v.x;
+				bound_constants[1] = (int64_t)v.y;
+			} break;
+			case Variant::VECTOR3: {
+				Vector3 v = value;
+				bound_constants[0] = (int64_t)v.x;
+				bound_constants[1] = (int64_t)v.y;
+				bound_constants[2] = (int64_t)v.z;
+			} break;
+			default: {
+				ERR_FAIL_V(ERR_BUG);
+			}
+		}
+	} else {
+		const GDScriptParser::OperatorNode *on = static_cast<const GDScriptParser::OperatorNode *>(container);
+		if (on->arguments.size() == 2) {
+			bound_nodes[1] = on->arguments[1];
+		} else {
+			for (int i = 1; i < on->arguments.size(); i++) {
+				bound_nodes[i - 1] = on->arguments[i];
+			}
+		}
+	}
+
+	int slevel = p_stack_level;
+	int iter_stack_pos = slevel;
+	int iterator_pos = (slevel++) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
+	int counter_pos = (slevel++) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
+	int to_pos = (slevel++) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
+	int step_pos = (slevel++) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
+	codegen.alloc_stack(slevel);
+
+	// Copy the bounds to slots the loop body can't touch, ITERATE_RANGE_BEGIN turns them into ints.
+	int bound_pos[3] = { counter_pos, to_pos, step_pos };
+	for (int i = 0; i < 3; i++) {
+		int src;
+		if (bound_nodes[i]) {
+			src = _parse_expression(codegen, bound_nodes[i], slevel);
+			if (src < 0) {
+				return ERR_COMPILATION_FAILED;
+			}
+		} else {
+			src = codegen.get_constant_pos(bound_constants[i]) | (GDScriptFunction::ADDR_TYPE_LOCAL_CONSTANT << GDScriptFunction::ADDR_BITS);
+		}
+		codegen.opcodes.push_back(GDScriptFunction::OPCODE_ASSIGN);
+		codegen.opcodes.push_back(bound_pos[i]);
+		codegen.opcodes.push_back(src);
+	}
+
+	codegen.push_stack_identifiers();
+	codegen.add_stack_identifier(static_cast<const GDScriptParser::IdentifierNode *>(p_cf->arguments[0])->name, iter_stack_pos);
+
+	//begin loop
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_ITERATE_RANGE_BEGIN);
+	codegen.opcodes.push_back(counter_pos);
+	codegen.opcodes.push_back(to_pos);
+	codegen.opcodes.push_back(step_pos);
+	codegen.opcodes.push_back(codegen.opcodes.size() + 4);
+	codegen.opcodes.push_back(iterator_pos);
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP); //skip code for next
+	codegen.opcodes.push_back(codegen.opcodes.size() + 9);
+	//break loop
+	int break_pos = codegen.opcodes.size();
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP); //skip code for next
+	codegen.opcodes.push_back(0); //skip code for next
+	//next loop
+	int continue_pos = codegen.opcodes.size();
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_ITERATE_RANGE);
+	codegen.opcodes.push_back(counter_pos);
+	codegen.opcodes.push_back(to_pos);
+	codegen.opcodes.push_back(step_pos);
+	codegen.opcodes.push_back(break_pos);
+	codegen.opcodes.push_back(iterator_pos);
+
+	Error err = _parse_block(codegen, p_cf->body, slevel, break_pos, continue_pos);
+	if (err) {
+		return err;
+	}
+
+	codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP);
+	codegen.opcodes.push_back(continue_pos);
+	codegen.opcodes.write[break_pos + 1] = codegen.opcodes.size();
+
+	codegen.pop_stack_identifiers();
+
+	return OK;
+}
+
 Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::BlockNode *p_block, int p_stack_level, int p_break_addr, int p_continue_addr) {
 	codegen.push_stack_identifiers();
 	int new_identifiers = 0;
@@ -1325,10 +1743,12 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 		switch (s->type) {
 			case GDScriptParser::Node::TYPE_NEWLINE: {
 #ifdef DEBUG_ENABLED
-				const GDScriptParser::NewLineNode *nl = static_cast<const GDScriptParser::NewLineNode *>(s);
-				codegen.opcodes.push_back(GDScriptFunction::OPCODE_LINE);
-				codegen.opcodes.push_back(nl->line);
-				codegen.current_line = nl->line;
+				if (debug_opcodes_enabled) {
+					const GDScriptParser::NewLineNode *nl = static_cast<const GDScriptParser::NewLineNode *>(s);
+					codegen.opcodes.push_back(GDScriptFunction::OPCODE_LINE);
+					codegen.opcodes.push_back(nl->line);
+					codegen.current_line = nl->line;
+				}
 #endif
 			} break;
 			case GDScriptParser::Node::TYPE_CONTROL_FLOW: {
@@ -1410,6 +1830,19 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 					} break;
 
 					case GDScriptParser::ControlFlowNode::CF_IF: {
+						Variant condition;
+						if (optimizations_enabled && _get_constant_expression(codegen, cf->arguments[0], condition)) {
+							// Only the branch that can run is compiled, without any jumps.
+							const GDScriptParser::BlockNode *branch = condition.booleanize() ? cf->body : cf->body_else;
+							if (branch) {
+								Error err = _parse_block(codegen, branch, p_stack_level, p_break_addr, p_continue_addr);
+								if (err) {
+									return err;
+								}
+							}
+							break;
+						}
+
 						int ret2 = _parse_expression(codegen, cf->arguments[0], p_stack_level, false);
 						if (ret2 < 0) {
 							return ERR_PARSE_ERROR;
@@ -1448,6 +1881,14 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 
 					} break;
 					case GDScriptParser::ControlFlowNode::CF_FOR: {
+						if (_is_range_for(cf)) {
+							Error err = _parse_range_for(codegen, cf, p_stack_level);
+							if (err) {
+								return err;
+							}
+							break;
+						}
+
 						int slevel = p_stack_level;
 						int iter_stack_pos = slevel;
 						int iterator_pos = (slevel++) | (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS);
@@ -1468,8 +1909,10 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						codegen.opcodes.push_back(container_pos);
 						codegen.opcodes.push_back(ret2);
 
+						bool typed_array = _is_typed_array(cf->arguments[1]);
+
 						//begin loop
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_ITERATE_BEGIN);
+						codegen.opcodes.push_back(typed_array ? GDScriptFunction::OPCODE_ITERATE_ARRAY_BEGIN : GDScriptFunction::OPCODE_ITERATE_BEGIN);
 						codegen.opcodes.push_back(counter_pos);
 						codegen.opcodes.push_back(container_pos);
 						codegen.opcodes.push_back(codegen.opcodes.size() + 4);
@@ -1482,7 +1925,7 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						codegen.opcodes.push_back(0); //skip code for next
 						//next loop
 						int continue_pos = codegen.opcodes.size();
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_ITERATE);
+						codegen.opcodes.push_back(typed_array ? GDScriptFunction::OPCODE_ITERATE_ARRAY : GDScriptFunction::OPCODE_ITERATE);
 						codegen.opcodes.push_back(counter_pos);
 						codegen.opcodes.push_back(container_pos);
 						codegen.opcodes.push_back(break_pos);
@@ -1501,6 +1944,12 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 
 					} break;
 					case GDScriptParser::ControlFlowNode::CF_WHILE: {
+						Variant condition;
+						bool constant_condition = optimizations_enabled && _get_constant_expression(codegen, cf->arguments[0], condition);
+						if (constant_condition && !condition.booleanize()) {
+							break; // Never runs.
+						}
+
 						codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP);
 						codegen.opcodes.push_back(codegen.opcodes.size() + 3);
 						int break_addr = codegen.opcodes.size();
@@ -1508,13 +1957,15 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						codegen.opcodes.push_back(0);
 						int continue_addr = codegen.opcodes.size();
 
-						int ret2 = _parse_expression(codegen, cf->arguments[0], p_stack_level, false);
-						if (ret2 < 0) {
-							return ERR_PARSE_ERROR;
+						if (!constant_condition) {
+							int ret2 = _parse_expression(codegen, cf->arguments[0], p_stack_level, false);
+							if (ret2 < 0) {
+								return ERR_PARSE_ERROR;
+							}
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP_IF_NOT);
+							codegen.opcodes.push_back(ret2);
+							codegen.opcodes.push_back(break_addr);
 						}
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_JUMP_IF_NOT);
-						codegen.opcodes.push_back(ret2);
-						codegen.opcodes.push_back(break_addr);
 						Error err = _parse_block(codegen, cf->body, p_stack_level, break_addr, continue_addr);
 						if (err) {
 							return err;
@@ -1565,6 +2016,10 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 			} break;
 			case GDScriptParser::Node::TYPE_ASSERT: {
 #ifdef DEBUG_ENABLED
+				if (!debug_opcodes_enabled) {
+					break;
+				}
+
 				// try subblocks
 
 				const GDScriptParser::AssertNode *as = static_cast<const GDScriptParser::AssertNode *>(s);
@@ -1590,7 +2045,9 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 			case GDScriptParser::Node::TYPE_BREAKPOINT: {
 #ifdef DEBUG_ENABLED
 				// try subblocks
-				codegen.opcodes.push_back(GDScriptFunction::OPCODE_BREAKPOINT);
+				if (debug_opcodes_enabled) {
+					codegen.opcodes.push_back(GDScriptFunction::OPCODE_BREAKPOINT);
+				}
 #endif
 			} break;
 			case GDScriptParser::Node::TYPE_LOCAL_VAR: {
@@ -1616,6 +2073,13 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 				}
 			} break;
 		}
+
+		if (optimizations_enabled && s->type == GDScriptParser::Node::TYPE_CONTROL_FLOW) {
+			GDScriptParser::ControlFlowNode::CFType cf_type = static_cast<const GDScriptParser::ControlFlowNode *>(s)->cf_type;
+			if (cf_type == GDScriptParser::ControlFlowNode::CF_RETURN || cf_type == GDScriptParser::ControlFlowNode::CF_BREAK || cf_type == GDScriptParser::ControlFlowNode::CF_CONTINUE) {
+				break; // The rest of the block can't be reached.
+			}
+		}
 	}
 	codegen.pop_stack_identifiers();
 	return OK;
@@ -1631,6 +2095,8 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 	codegen.stack_max = 0;
 	codegen.current_line = 0;
 	codegen.call_max = 0;
+	codegen.inline_cache_count = 0;
+	codegen.retarget_pos = -1;
 	codegen.debug_stack = ScriptDebugger::get_singleton() != nullptr;
 	Vector<StringName> argnames;
 
@@ -1809,6 +2275,7 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 	gdfunc->_argument_count = p_func ? p_func->arguments.size() : 0;
 	gdfunc->_stack_size = codegen.stack_max;
 	gdfunc->_call_size = codegen.call_max;
+	gdfunc->_set_inline_cache_count(codegen.inline_cache_count);
 	gdfunc->name = func_name;
 #ifdef DEBUG_ENABLED
 	if (ScriptDebugger::get_singleton()) {
@@ -2200,6 +2667,9 @@ Error GDScriptCompiler::compile(const GDScriptParser *p_parser, GDScript *p_scri
 
 	source = p_script->get_path();
 
+	// Members and functions of the script are about to be replaced.
+	GDScriptFunction::invalidate_inline_caches();
+
 	// The best fully qualified name for a base level script is its file path
 	p_script->fully_qualified_name = p_script->path;
 
@@ -2232,5 +2702,36 @@ int GDScriptCompiler::get_error_column() const {
 	return err_column;
 }
 
+void GDScriptCompiler::set_typed_opcodes_enabled(bool p_enabled) {
+	typed_opcodes_enabled = p_enabled;
+}
+
+bool GDScriptCompiler::is_typed_opcodes_enabled() const {
+	return typed_opcodes_enabled;
+}
+
+void GDScriptCompiler::set_debug_opcodes_enabled(bool p_enabled) {
+	debug_opcodes_enabled = p_enabled;
+}
+
+bool GDScriptCompiler::is_debug_opcodes_enabled() const {
+	return debug_opcodes_enabled;
+}
+
+void GDScriptCompiler::set_optimizations_enabled(bool p_enabled) {
+	optimizations_enabled = p_enabled;
+}
+
+bool GDScriptCompiler::is_optimizations_enabled() const {
+	return optimizations_enabled;
+}
+
 GDScriptCompiler::GDScriptCompiler() {
+	typed_opcodes_enabled = true;
+	debug_opcodes_enabled = true;
+#ifdef DEBUG_ENABLED
+	optimizations_enabled = false;
+#else
+	optimizations_enabled = true;
+#endif
 }
@@ -129,10 +129,15 @@ class GDScriptCompiler {
 				call_max = p_params;
 			}
 		}
+		int alloc_inline_cache() {
+			return inline_cache_count++;
+		}
 
 		int current_line;
 		int stack_max;
 		int call_max;
+		int inline_cache_count;
+		int retarget_pos; // Destination operand of the last opcode, if it can be made to write elsewhere, -1 otherwise.
 	};
 
 	bool _is_class_member_property(CodeGen &codegen, const StringName &p_name);
@@ -142,11 +147,19 @@ class GDScriptCompiler {
 
 	bool _create_unary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level);
 	bool _create_binary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level, bool p_initializer = false, int p_index_addr = 0);
+	GDScriptFunction::Opcode _get_operator_opcode(Variant::Operator p_op, const GDScriptParser::Node *p_a, const GDScriptParser::Node *p_b) const;
+	int _get_vector_component(const GDScriptParser::Node *p_base, const StringName &p_name) const;
+	bool _is_typed_array(const GDScriptParser::Node *p_base) const;
+	bool _get_class_constant(CodeGen &codegen, const StringName &p_name, Variant &r_value) const;
+	bool _get_constant_expression(CodeGen &codegen, const GDScriptParser::Node *p_expression, Variant &r_value);
+	bool _is_retargetable(const GDScriptParser::OperatorNode *p_operator) const;
 
 	GDScriptDataType _gdtype_from_datatype(const GDScriptParser::DataType &p_datatype, GDScript *p_owner = nullptr) const;
 
 	int _parse_assign_right_expression(CodeGen &codegen, const GDScriptParser::OperatorNode *p_expression, int p_stack_level, int p_index_addr = 0);
 	int _parse_expression(CodeGen &codegen, const GDScriptParser::Node *p_expression, int p_stack_level, bool p_root = false, bool p_initializer = false, int p_index_addr = 0);
+	bool _is_range_for(const GDScriptParser::ControlFlowNode *p_cf) const;
+	Error _parse_range_for(CodeGen &codegen, const GDScriptParser::ControlFlowNode *p_cf, int p_stack_level);
 	Error _parse_block(CodeGen &codegen, const GDScriptParser::BlockNode *p_block, int p_stack_level = 0, int p_break_addr = -1, int p_continue_addr = -1);
 	Error _parse_function(GDScript *p_script, const GDScriptParser::ClassNode *p_class, const GDScriptParser::FunctionNode *p_func, bool p_for_ready = false);
 	Error _parse_class_level(GDScript *p_script, const GDScriptParser::ClassNode *p_class, bool p_keep_state);
@@ -156,6 +169,9 @@ class GDScriptCompiler {
 	int err_column;
 	StringName source;
 	String error;
+	bool typed_opcodes_enabled;
+	bool debug_opcodes_enabled;
+	bool optimizations_enabled;
 
 public:
 	Error compile(const GDScriptParser *p_parser, GDScript *p_script, bool p_keep_state = false);
@@ -164,6 +180,24 @@ public:
 	int get_error_line() const;
 	int get_error_column() const;
 
+	// Typed opcodes are on by default, turning them off is only useful to
+	// compare against the generic Variant paths.
+	void set_typed_opcodes_enabled(bool p_enabled);
+	bool is_typed_opcodes_enabled() const;
+
+	// Line, assert and breakpoint opcodes are only emitted in debug builds.
+	// Turning them off makes a debug build emit the same code a release
+	// build would, which is what gets precompiled for release exports.
+	void set_debug_opcodes_enabled(bool p_enabled);
+	bool is_debug_opcodes_enabled() const;
+
+	// Drops branches and statements that can't run, reads class constants
+	// from the function's own constant table and writes results straight
+	// into local variables. On in release builds and for release exports,
+	// off otherwise so the debugger sees every line.
+	void set_optimizations_enabled(bool p_enabled);
+	bool is_optimizations_enabled() const;
+
 	GDScriptCompiler();
 };
 
@@ -30,7 +30,9 @@
 
 #include "gdscript_function.h"
 
+#include "core/core_string_names.h"
 #include "core/os/os.h"
+#include "core/variant_internal.h"
 #include "gdscript.h"
 #include "gdscript_functions.h"
 
@@ -154,6 +156,148 @@ static String _get_var_type(const Variant *p_var) {
 }
 #endif // DEBUG_ENABLED
 
+// Loop bounds of a compiled range(), numbers are used as is and anything else
+// converts the same way it did when range() was rewritten into a vector.
+static _FORCE_INLINE_ int64_t _get_range_bound(const Variant *p_var) {
+	if (p_var->get_type() == Variant::INT) {
+		return VariantInternal::get_int(p_var);
+	}
+	return (int64_t)p_var->operator double();
+}
+
+// Number of elements of an Array or a packed scalar/vector array, -1 for any
+// other type. These are the containers the ARRAY_INDEX opcodes read directly.
+static _FORCE_INLINE_ int _get_array_size(const Variant *p_array) {
+	switch (p_array->get_type()) {
+		case Variant::ARRAY:
+			return VariantInternal::get_array(p_array)->size();
+		case Variant::POOL_BYTE_ARRAY:
+			return VariantInternal::get_pool_array<uint8_t>(p_array)->size();
+		case Variant::POOL_INT_ARRAY:
+			return VariantInternal::get_pool_array<int>(p_array)->size();
+		case Variant::POOL_REAL_ARRAY:
+			return VariantInternal::get_pool_array<real_t>(p_array)->size();
+		case Variant::POOL_VECTOR2_ARRAY:
+			return VariantInternal::get_pool_array<Vector2>(p_array)->size();
+		case Variant::POOL_VECTOR3_ARRAY:
+			return VariantInternal::get_pool_array<Vector3>(p_array)->size();
+		case Variant::POOL_COLOR_ARRAY:
+			return VariantInternal::get_pool_array<Color>(p_array)->size();
+		default:
+			return -1;
+	}
+}
+
+// Element p_index of a packed array. The read lock is released before the
+// caller writes the result, which may be the slot holding the array.
+template <class T>
+static _FORCE_INLINE_ T _get_pool_element(const Variant *p_array, int p_index) {
+	return VariantInternal::get_pool_array<T>(p_array)->read()[p_index];
+}
+
+// Reads an element the way Variant::get() does, negative indices count from
+// the end. Returns false if the container or the index don't fit, the caller
+// then takes the generic path, which also reports the error.
+static _FORCE_INLINE_ bool _get_array_element(const Variant *p_array, int64_t p_index, Variant *r_dst) {
+	int size = _get_array_size(p_array);
+	if (p_index < 0) {
+		p_index += size;
+	}
+	if (unlikely(p_index < 0 || p_index >= size)) {
+		return false;
+	}
+	int index = p_index;
+
+	switch (p_array->get_type()) {
+		case Variant::ARRAY: {
+			Variant value = VariantInternal::get_array(p_array)->get(index);
+			*r_dst = value;
+		} break;
+		case Variant::POOL_BYTE_ARRAY: {
+			VariantInternal::set_int(r_dst, _get_pool_element<uint8_t>(p_array, index));
+		} break;
+		case Variant::POOL_INT_ARRAY: {
+			VariantInternal::set_int(r_dst, _get_pool_element<int>(p_array, index));
+		} break;
+		case Variant::POOL_REAL_ARRAY: {
+			VariantInternal::set_real(r_dst, _get_pool_element<real_t>(p_array, index));
+		} break;
+		case Variant::POOL_VECTOR2_ARRAY: {
+			VariantInternal::set_vector2(r_dst, _get_pool_element<Vector2>(p_array, index));
+		} break;
+		case Variant::POOL_VECTOR3_ARRAY: {
+			VariantInternal::set_vector3(r_dst, _get_pool_element<Vector3>(p_array, index));
+		} break;
+		case Variant::POOL_COLOR_ARRAY: {
+			VariantInternal::set_color(r_dst, _get_pool_element<Color>(p_array, index));
+		} break;
+		default: {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Writes an element the way Variant::set() does when the value already has the
+// element type, without converting it through Variant. Returns false otherwise.
+static _FORCE_INLINE_ bool _set_array_element(Variant *p_array, int64_t p_index, const Variant *p_value) {
+	int size = _get_array_size(p_array);
+	if (p_index < 0) {
+		p_index += size;
+	}
+	if (unlikely(p_index < 0 || p_index >= size)) {
+		return false;
+	}
+	int index = p_index;
+	Variant::Type value_type = p_value->get_type();
+
+	switch (p_array->get_type()) {
+		case Variant::ARRAY: {
+			VariantInternal::get_array(p_array)->set(index, *p_value);
+		} break;
+		case Variant::POOL_BYTE_ARRAY: {
+			if (value_type != Variant::INT) {
+				return false;
+			}
+			VariantInternal::get_pool_array<uint8_t>(p_array)->write()[index] = VariantInternal::get_int(p_value);
+		} break;
+		case Variant::POOL_INT_ARRAY: {
+			if (value_type != Variant::INT) {
+				return false;
+			}
+			VariantInternal::get_pool_array<int>(p_array)->write()[index] = VariantInternal::get_int(p_value);
+		} break;
+		case Variant::POOL_REAL_ARRAY: {
+			if (value_type != Variant::REAL && value_type != Variant::INT) {
+				return false;
+			}
+			VariantInternal::get_pool_array<real_t>(p_array)->write()[index] = VariantInternal::get_number(p_value);
+		} break;
+		case Variant::POOL_VECTOR2_ARRAY: {
+			if (value_type != Variant::VECTOR2) {
+				return false;
+			}
+			VariantInternal::get_pool_array<Vector2>(p_array)->write()[index] = *VariantInternal::get_vector2(p_value);
+		} break;
+		case Variant::POOL_VECTOR3_ARRAY: {
+			if (value_type != Variant::VECTOR3) {
+				return false;
+			}
+			VariantInternal::get_pool_array<Vector3>(p_array)->write()[index] = *VariantInternal::get_vector3(p_value);
+		} break;
+		case Variant::POOL_COLOR_ARRAY: {
+			if (value_type != Variant::COLOR) {
+				return false;
+			}
+			VariantInternal::get_pool_array<Color>(p_array)->write()[index] = *VariantInternal::get_color(p_value);
+		} break;
+		default: {
+			return false;
+		}
+	}
+	return true;
+}
+
 String GDScriptFunction::_get_call_error(const Variant::CallError &p_err, const String &p_where, const Variant **argptrs) const {
 	String err_text;
 
@@ -183,16 +327,338 @@ String GDScriptFunction::_get_call_error(const Variant::CallError &p_err, const
 	return err_text;
 }
 
+SafeNumeric<uint32_t> GDScriptFunction::inline_cache_version(1);
+
+// Native targets also depend on the methods bound in ClassDB. Both counters
+// only grow, so their sum changes whenever either of them does.
+uint32_t GDScriptFunction::_get_inline_cache_version() {
+	return inline_cache_version.get() + ClassDB::method_cache_version.get();
+}
+
+// Objects using other script languages, or placeholder instances, can't be cached.
+bool GDScriptFunction::_get_inline_cache_receiver(Object *p_object, GDScriptInstance *&r_instance, const void *&r_script) {
+	ScriptInstance *instance = p_object->get_script_instance();
+	if (!instance) {
+		r_instance = nullptr;
+		r_script = nullptr;
+		return true;
+	}
+	if (instance->is_placeholder() || instance->get_language() != GDScriptLanguage::get_singleton()) {
+		return false;
+	}
+	r_instance = static_cast<GDScriptInstance *>(instance);
+	r_script = r_instance->script.ptr();
+	return true;
+}
+
+bool GDScriptFunction::_find_inline_cache(const InlineCache &p_cache, const void *p_script, const void *p_native, uint32_t p_version, InlineCacheTarget &r_target) {
+	for (int i = 0; i < INLINE_CACHE_SIZE; i++) {
+		const InlineCacheEntry &entry = p_cache.entries[i];
+		uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+		if (sequence == 0) {
+			return false; // Entries never become empty again, so the rest are empty too.
+		}
+		if (sequence & 1) {
+			continue;
+		}
+
+		r_target = entry.target;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+			continue;
+		}
+
+		if (r_target.script == p_script && r_target.native == p_native && r_target.version == p_version) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Looks up what Object::get(), Object::set() or Object::call() would end up
+// using for this name. Only cases that can be repeated without the lookup are
+// accepted, anything else (setget, _get()/_set(), constants...) stays on the
+// slow path.
+bool GDScriptFunction::_resolve_inline_cache(InlineCacheOp p_op, Object *p_object, GDScriptInstance *p_instance, const StringName &p_name, InlineCacheTarget &r_target) {
+#ifdef TOOLS_ENABLED
+	if (p_op == INLINE_CACHE_OP_SET) {
+		return false; // Object::set() also flags the object as edited.
+	}
+#endif
+
+	if (p_instance) {
+		const GDScript *script = p_instance->script.ptr();
+
+		if (p_op == INLINE_CACHE_OP_CALL) {
+			for (const GDScript *sptr = script; sptr; sptr = sptr->_base) {
+				const Map<StringName, GDScriptFunction *>::Element *E = sptr->member_functions.find(p_name);
+				if (E) {
+					r_target.kind = INLINE_CACHE_SCRIPT_METHOD;
+					r_target.index = -1;
+					r_target.function = E->get();
+					return true;
+				}
+			}
+		} else {
+			const Map<StringName, GDScript::MemberInfo>::Element *E = script->member_indices.find(p_name);
+			if (E) {
+				if (p_op == INLINE_CACHE_OP_GET ? E->get().getter : E->get().setter) {
+					return false;
+				}
+				r_target.kind = INLINE_CACHE_SCRIPT_MEMBER;
+				r_target.index = E->get().index;
+				r_target.member_type = &E->get().data_type;
+				return true;
+			}
+
+			const StringName &handler = p_op == INLINE_CACHE_OP_GET ? GDScriptLanguage::get_singleton()->strings._get : GDScriptLanguage::get_singleton()->strings._set;
+			for (const GDScript *sptr = script; sptr; sptr = sptr->_base) {
+				if (sptr->member_functions.has(handler)) {
+					return false;
+				}
+				if (p_op == INLINE_CACHE_OP_GET && sptr->constants.has(p_name)) {
+					return false;
+				}
+			}
+		}
+	}
+
+	const StringName &class_name = p_object->get_class_name();
+
+	if (p_op == INLINE_CACHE_OP_CALL) {
+		if (p_name == CoreStringNames::get_singleton()->_free) {
+			return false;
+		}
+		// These override Object::call() to look up their own methods first.
+		if (Object::cast_to<Script>(p_object) || ClassDB::is_parent_class(class_name, "JavaClass") || ClassDB::is_parent_class(class_name, "JavaObject") || ClassDB::is_parent_class(class_name, "JNISingleton")) {
+			return false;
+		}
+
+		MethodBind *method = ClassDB::get_method(class_name, p_name);
+		if (!method) {
+			return false;
+		}
+		r_target.kind = INLINE_CACHE_NATIVE_METHOD;
+		r_target.index = -1;
+		r_target.method = method;
+		return true;
+	}
+
+	bool valid = false;
+	int index = ClassDB::get_property_index(class_name, p_name, &valid);
+	if (!valid) {
+		return false;
+	}
+	bool is_constant = false;
+	ClassDB::get_integer_constant(class_name, p_name, &is_constant);
+	if (is_constant) {
+		return false;
+	}
+
+	StringName accessor = p_op == INLINE_CACHE_OP_GET ? ClassDB::get_property_getter(class_name, p_name) : ClassDB::get_property_setter(class_name, p_name);
+	if (accessor == StringName()) {
+		return false;
+	}
+	// Indexed accessors are called through Object::call(), where a script function would win.
+	for (const GDScript *sptr = p_instance ? p_instance->script.ptr() : nullptr; sptr; sptr = sptr->_base) {
+		if (sptr->member_functions.has(accessor)) {
+			return false;
+		}
+	}
+
+	MethodBind *method = ClassDB::get_method(class_name, accessor);
+	if (!method) {
+		return false;
+	}
+	r_target.kind = INLINE_CACHE_NATIVE_PROPERTY;
+	r_target.index = index;
+	r_target.method = method;
+	return true;
+}
+
+void GDScriptFunction::_update_inline_cache(InlineCache &p_cache, InlineCacheOp p_op, Object *p_object, GDScriptInstance *p_instance, const StringName &p_name, uint32_t p_version) {
+	InlineCacheTarget target;
+	if (!_resolve_inline_cache(p_op, p_object, p_instance, p_name, target)) {
+		return;
+	}
+	target.version = p_version;
+	target.script = p_instance ? p_instance->script.ptr() : nullptr;
+	target.native = p_object->get_class_name().data_unique_pointer();
+
+	// Take the first empty or outdated entry. When all of them are in use the
+	// site is megamorphic, and new receiver types are left uncached.
+	for (int i = 0; i < INLINE_CACHE_SIZE; i++) {
+		InlineCacheEntry &entry = p_cache.entries[i];
+		uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			continue;
+		}
+		if (sequence != 0 && entry.target.version == p_version) {
+			continue;
+		}
+		if (entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+			std::atomic_thread_fence(std::memory_order_release);
+			entry.target = target;
+			entry.sequence.store(sequence + 2, std::memory_order_release);
+			return;
+		}
+	}
+}
+
+// The fast paths return false when the access has to go through Variant.
+bool GDScriptFunction::_inline_cache_get(InlineCache &p_cache, const Variant *p_base, const StringName &p_name, Variant &r_ret) {
+	if (p_base->get_type() != Variant::OBJECT) {
+		return false;
+	}
+	Object *obj = p_base->operator Object *();
+	GDScriptInstance *instance;
+	const void *script;
+	if (!obj || !_get_inline_cache_receiver(obj, instance, script)) {
+		return false;
+	}
+
+	const void *native = obj->get_class_name().data_unique_pointer();
+	uint32_t version = _get_inline_cache_version();
+	InlineCacheTarget target;
+	if (!_find_inline_cache(p_cache, script, native, version, target)) {
+#ifdef DEBUG_ENABLED
+		inline_cache_misses++;
+#endif
+		_update_inline_cache(p_cache, INLINE_CACHE_OP_GET, obj, instance, p_name, version);
+		return false;
+	}
+
+	if (target.kind == INLINE_CACHE_SCRIPT_MEMBER) {
+		r_ret = instance->members[target.index];
+	} else {
+		Variant::CallError ce;
+		if (target.index >= 0) {
+			Variant index = target.index;
+			const Variant *args[1] = { &index };
+			r_ret = target.method->call(obj, args, 1, ce);
+		} else {
+			r_ret = target.method->call(obj, nullptr, 0, ce);
+		}
+	}
+#ifdef DEBUG_ENABLED
+	inline_cache_hits++;
+#endif
+	return true;
+}
+
+bool GDScriptFunction::_inline_cache_set(InlineCache &p_cache, const Variant *p_base, const StringName &p_name, const Variant *p_value, bool &r_valid) {
+	if (p_base->get_type() != Variant::OBJECT) {
+		return false;
+	}
+	Object *obj = p_base->operator Object *();
+	GDScriptInstance *instance;
+	const void *script;
+	if (!obj || !_get_inline_cache_receiver(obj, instance, script)) {
+		return false;
+	}
+
+	const void *native = obj->get_class_name().data_unique_pointer();
+	uint32_t version = _get_inline_cache_version();
+	InlineCacheTarget target;
+	if (!_find_inline_cache(p_cache, script, native, version, target)) {
+#ifdef DEBUG_ENABLED
+		inline_cache_misses++;
+#endif
+		_update_inline_cache(p_cache, INLINE_CACHE_OP_SET, obj, instance, p_name, version);
+		return false;
+	}
+
+	if (target.kind == INLINE_CACHE_SCRIPT_MEMBER) {
+		if (!target.member_type->is_type(*p_value)) {
+			return false; // Needs a conversion.
+		}
+		instance->members.write[target.index] = *p_value;
+		r_valid = true;
+	} else {
+		Variant::CallError ce;
+		if (target.index >= 0) {
+			Variant index = target.index;
+			const Variant *args[2] = { &index, p_value };
+			target.method->call(obj, args, 2, ce);
+		} else {
+			target.method->call(obj, &p_value, 1, ce);
+		}
+		r_valid = ce.error == Variant::CallError::CALL_OK;
+	}
+#ifdef DEBUG_ENABLED
+	inline_cache_hits++;
+#endif
+	return true;
+}
+
+bool GDScriptFunction::_inline_cache_call(InlineCache &p_cache, const Variant *p_base, const StringName &p_name, const Variant **p_args, int p_argcount, Variant *r_ret, Variant::CallError &r_err) {
+	if (p_base->get_type() != Variant::OBJECT) {
+		return false;
+	}
+	Object *obj = p_base->operator Object *();
+	GDScriptInstance *instance;
+	const void *script;
+	if (!obj || !_get_inline_cache_receiver(obj, instance, script)) {
+		return false;
+	}
+
+	const void *native = obj->get_class_name().data_unique_pointer();
+	uint32_t version = _get_inline_cache_version();
+	InlineCacheTarget target;
+	if (!_find_inline_cache(p_cache, script, native, version, target)) {
+#ifdef DEBUG_ENABLED
+		inline_cache_misses++;
+#endif
+		_update_inline_cache(p_cache, INLINE_CACHE_OP_CALL, obj, instance, p_name, version);
+		return false;
+	}
+#ifdef DEBUG_ENABLED
+	inline_cache_hits++;
+	_ObjectDebugLock debug_lock(obj);
+#endif
+
+	Variant ret;
+	r_err.error = Variant::CallError::CALL_OK;
+	if (target.kind == INLINE_CACHE_SCRIPT_METHOD) {
+		ret = target.function->call(instance, p_args, p_argcount, r_err);
+	} else {
+		ret = target.method->call(obj, p_args, p_argcount, r_err);
+	}
+	if (r_err.error == Variant::CallError::CALL_OK && r_ret) {
+		*r_ret = ret;
+	}
+	return true;
+}
+
+void GDScriptFunction::_set_inline_cache_count(int p_count) {
+	if (_inline_caches) {
+		memdelete_arr(_inline_caches);
+		_inline_caches = nullptr;
+	}
+	_inline_cache_count = p_count;
+	if (p_count > 0) {
+		_inline_caches = memnew_arr(InlineCache, p_count);
+	}
+}
+
 #if defined(__GNUC__)
 #define OPCODES_TABLE                         \
 	static const void *switch_table_ops[] = { \
 		&&OPCODE_OPERATOR,                    \
+		&&OPCODE_OPERATOR_INT,                \
+		&&OPCODE_OPERATOR_REAL,               \
+		&&OPCODE_OPERATOR_VECTOR2,            \
+		&&OPCODE_OPERATOR_VECTOR3,            \
 		&&OPCODE_EXTENDS_TEST,                \
 		&&OPCODE_IS_BUILTIN,                  \
 		&&OPCODE_SET,                         \
 		&&OPCODE_GET,                         \
+		&&OPCODE_SET_ARRAY_INDEX,             \
+		&&OPCODE_GET_ARRAY_INDEX,             \
 		&&OPCODE_SET_NAMED,                   \
 		&&OPCODE_GET_NAMED,                   \
+		&&OPCODE_SET_VECTOR_COMPONENT,        \
+		&&OPCODE_GET_VECTOR_COMPONENT,        \
 		&&OPCODE_SET_MEMBER,                  \
 		&&OPCODE_GET_MEMBER,                  \
 		&&OPCODE_ASSIGN,                      \
@@ -222,6 +688,10 @@ String GDScriptFunction::_get_call_error(const Variant::CallError &p_err, const
 		&&OPCODE_RETURN,                      \
 		&&OPCODE_ITERATE_BEGIN,               \
 		&&OPCODE_ITERATE,                     \
+		&&OPCODE_ITERATE_ARRAY_BEGIN,         \
+		&&OPCODE_ITERATE_ARRAY,               \
+		&&OPCODE_ITERATE_RANGE_BEGIN,         \
+		&&OPCODE_ITERATE_RANGE,               \
 		&&OPCODE_ASSERT,                      \
 		&&OPCODE_BREAKPOINT,                  \
 		&&OPCODE_LINE,                        \
@@ -274,17 +744,18 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 #endif
 
 	uint32_t alloca_size = 0;
+	bool stack_moved = false;
 	GDScript *script;
 	int ip = 0;
 	int line = _initial_line;
 
 	if (p_state) {
 		//use existing (supplied) state (yielded)
-		stack = (Variant *)p_state->stack.ptr();
-		call_args = (Variant **)&p_state->stack.ptr()[sizeof(Variant) * p_state->stack_size]; //ptr() to avoid bounds check
+		stack = (Variant *)p_state->stack;
+		call_args = p_state->stack ? (Variant **)&p_state->stack[sizeof(Variant) * p_state->stack_size] : nullptr;
 		line = p_state->line;
 		ip = p_state->ip;
-		alloca_size = p_state->stack.size();
+		alloca_size = p_state->alloca_size;
 		script = p_state->script;
 		p_instance = p_state->instance;
 		defarg = p_state->defarg;
@@ -377,6 +848,9 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 		GDScriptLanguage::get_singleton()->enter_function(p_instance, this, stack, &ip, &line);
 	}
 
+	GDScriptSampler *sampler = GDScriptSampler::get_active();
+	int sample_slot = sampler ? sampler->enter(this) : -1;
+
 #define GD_ERR_BREAK(m_cond)                                                                                           \
 	{                                                                                                                  \
 		if (unlikely(m_cond)) {                                                                                        \
@@ -403,6 +877,34 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 #endif
 
+// Generic operator path, also taken by the typed operator opcodes when the
+// operands don't have the types the compiler inferred.
+#ifdef DEBUG_ENABLED
+#define EVALUATE_OPERATOR(m_op, m_a, m_b, m_dst)                                                                                                                                                               \
+	{                                                                                                                                                                                                          \
+		bool valid;                                                                                                                                                                                            \
+		Variant ret;                                                                                                                                                                                           \
+		Variant::evaluate(m_op, *m_a, *m_b, ret, valid);                                                                                                                                                       \
+		if (!valid) {                                                                                                                                                                                          \
+			if (ret.get_type() == Variant::STRING) {                                                                                                                                                           \
+				/* return a string when invalid with the error */                                                                                                                                              \
+				err_text = ret;                                                                                                                                                                                \
+				err_text += " in operator '" + Variant::get_operator_name(m_op) + "'.";                                                                                                                        \
+			} else {                                                                                                                                                                                           \
+				err_text = "Invalid operands '" + Variant::get_type_name(m_a->get_type()) + "' and '" + Variant::get_type_name(m_b->get_type()) + "' in operator '" + Variant::get_operator_name(m_op) + "'."; \
+			}                                                                                                                                                                                                  \
+			OPCODE_BREAK;                                                                                                                                                                                      \
+		}                                                                                                                                                                                                      \
+		*m_dst = ret;                                                                                                                                                                                          \
+	}
+#else
+#define EVALUATE_OPERATOR(m_op, m_a, m_b, m_dst)            \
+	{                                                       \
+		bool valid;                                         \
+		Variant::evaluate(m_op, *m_a, *m_b, *m_dst, valid); \
+	}
+#endif
+
 #ifdef DEBUG_ENABLED
 
 	uint64_t function_start_time = 0;
@@ -425,11 +927,245 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 	OPCODE_WHILE(true) {
 #endif
 
-		OPCODE_SWITCH(_code_ptr[ip]) {
-			OPCODE(OPCODE_OPERATOR) {
+		OPCODE_SWITCH(_code_ptr[ip]) {
+			OPCODE(OPCODE_OPERATOR) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_INT) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(a->get_type() == Variant::INT && b->get_type() == Variant::INT)) {
+					int64_t va = VariantInternal::get_int(a);
+					int64_t vb = VariantInternal::get_int(b);
+					bool done = true;
+
+					switch (op) {
+						case Variant::OP_ADD:
+							VariantInternal::set_int(dst, va + vb);
+							break;
+						case Variant::OP_SUBTRACT:
+							VariantInternal::set_int(dst, va - vb);
+							break;
+						case Variant::OP_MULTIPLY:
+							VariantInternal::set_int(dst, va * vb);
+							break;
+						case Variant::OP_DIVIDE: {
+							// Division by zero goes through the generic path, which reports it.
+							if (vb != 0) {
+								VariantInternal::set_int(dst, va / vb);
+							} else {
+								done = false;
+							}
+						} break;
+						case Variant::OP_MODULE: {
+							if (vb != 0) {
+								VariantInternal::set_int(dst, va % vb);
+							} else {
+								done = false;
+							}
+						} break;
+						case Variant::OP_NEGATE:
+							VariantInternal::set_int(dst, -va);
+							break;
+						case Variant::OP_BIT_AND:
+							VariantInternal::set_int(dst, va & vb);
+							break;
+						case Variant::OP_BIT_OR:
+							VariantInternal::set_int(dst, va | vb);
+							break;
+						case Variant::OP_BIT_XOR:
+							VariantInternal::set_int(dst, va ^ vb);
+							break;
+						case Variant::OP_EQUAL:
+							VariantInternal::set_bool(dst, va == vb);
+							break;
+						case Variant::OP_NOT_EQUAL:
+							VariantInternal::set_bool(dst, va != vb);
+							break;
+						case Variant::OP_LESS:
+							VariantInternal::set_bool(dst, va < vb);
+							break;
+						case Variant::OP_LESS_EQUAL:
+							VariantInternal::set_bool(dst, va <= vb);
+							break;
+						case Variant::OP_GREATER:
+							VariantInternal::set_bool(dst, va > vb);
+							break;
+						case Variant::OP_GREATER_EQUAL:
+							VariantInternal::set_bool(dst, va >= vb);
+							break;
+						default:
+							done = false;
+					}
+
+					if (likely(done)) {
+						ip += 5;
+						DISPATCH_OPCODE;
+					}
+				}
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_REAL) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				// At least one side must be a float, int with int keeps integer semantics.
+				if (likely(a->is_num() && b->is_num() && (a->get_type() == Variant::REAL || b->get_type() == Variant::REAL))) {
+					double va = VariantInternal::get_number(a);
+					double vb = VariantInternal::get_number(b);
+					bool done = true;
+
+					switch (op) {
+						case Variant::OP_ADD:
+							VariantInternal::set_real(dst, va + vb);
+							break;
+						case Variant::OP_SUBTRACT:
+							VariantInternal::set_real(dst, va - vb);
+							break;
+						case Variant::OP_MULTIPLY:
+							VariantInternal::set_real(dst, va * vb);
+							break;
+						case Variant::OP_DIVIDE: {
+							if (vb != 0) {
+								VariantInternal::set_real(dst, va / vb);
+							} else {
+								done = false;
+							}
+						} break;
+						case Variant::OP_NEGATE:
+							VariantInternal::set_real(dst, -va);
+							break;
+						case Variant::OP_EQUAL:
+							VariantInternal::set_bool(dst, va == vb);
+							break;
+						case Variant::OP_NOT_EQUAL:
+							VariantInternal::set_bool(dst, va != vb);
+							break;
+						case Variant::OP_LESS:
+							VariantInternal::set_bool(dst, va < vb);
+							break;
+						case Variant::OP_LESS_EQUAL:
+							VariantInternal::set_bool(dst, va <= vb);
+							break;
+						case Variant::OP_GREATER:
+							VariantInternal::set_bool(dst, va > vb);
+							break;
+						case Variant::OP_GREATER_EQUAL:
+							VariantInternal::set_bool(dst, va >= vb);
+							break;
+						default:
+							done = false;
+					}
+
+					if (likely(done)) {
+						ip += 5;
+						DISPATCH_OPCODE;
+					}
+				}
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_VECTOR2) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(a->get_type() == Variant::VECTOR2 && (b->get_type() == Variant::VECTOR2 || b->is_num()))) {
+					Vector2 va = *VariantInternal::get_vector2(a);
+					bool done = true;
+
+					if (b->get_type() == Variant::VECTOR2) {
+						Vector2 vb = *VariantInternal::get_vector2(b);
+						switch (op) {
+							case Variant::OP_ADD:
+								VariantInternal::set_vector2(dst, va + vb);
+								break;
+							case Variant::OP_SUBTRACT:
+								VariantInternal::set_vector2(dst, va - vb);
+								break;
+							case Variant::OP_MULTIPLY:
+								VariantInternal::set_vector2(dst, va * vb);
+								break;
+							case Variant::OP_DIVIDE:
+								VariantInternal::set_vector2(dst, va / vb);
+								break;
+							case Variant::OP_NEGATE:
+								VariantInternal::set_vector2(dst, -va);
+								break;
+							case Variant::OP_EQUAL:
+								VariantInternal::set_bool(dst, va == vb);
+								break;
+							case Variant::OP_NOT_EQUAL:
+								VariantInternal::set_bool(dst, va != vb);
+								break;
+							default:
+								done = false;
+						}
+					} else {
+						real_t vb = VariantInternal::get_number(b);
+						switch (op) {
+							case Variant::OP_MULTIPLY:
+								VariantInternal::set_vector2(dst, va * vb);
+								break;
+							case Variant::OP_DIVIDE:
+								VariantInternal::set_vector2(dst, va / vb);
+								break;
+							default:
+								done = false;
+						}
+					}
+
+					if (likely(done)) {
+						ip += 5;
+						DISPATCH_OPCODE;
+					}
+				}
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_VECTOR3) {
 				CHECK_SPACE(5);
 
-				bool valid;
 				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
 				GD_ERR_BREAK(op >= Variant::OP_MAX);
 
@@ -437,26 +1173,58 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				GET_VARIANT_PTR(b, 3);
 				GET_VARIANT_PTR(dst, 4);
 
-#ifdef DEBUG_ENABLED
+				if (likely(a->get_type() == Variant::VECTOR3 && (b->get_type() == Variant::VECTOR3 || b->is_num()))) {
+					Vector3 va = *VariantInternal::get_vector3(a);
+					bool done = true;
 
-				Variant ret;
-				Variant::evaluate(op, *a, *b, ret, valid);
-#else
-				Variant::evaluate(op, *a, *b, *dst, valid);
-#endif
-#ifdef DEBUG_ENABLED
-				if (!valid) {
-					if (ret.get_type() == Variant::STRING) {
-						//return a string when invalid with the error
-						err_text = ret;
-						err_text += " in operator '" + Variant::get_operator_name(op) + "'.";
+					if (b->get_type() == Variant::VECTOR3) {
+						Vector3 vb = *VariantInternal::get_vector3(b);
+						switch (op) {
+							case Variant::OP_ADD:
+								VariantInternal::set_vector3(dst, va + vb);
+								break;
+							case Variant::OP_SUBTRACT:
+								VariantInternal::set_vector3(dst, va - vb);
+								break;
+							case Variant::OP_MULTIPLY:
+								VariantInternal::set_vector3(dst, va * vb);
+								break;
+							case Variant::OP_DIVIDE:
+								VariantInternal::set_vector3(dst, va / vb);
+								break;
+							case Variant::OP_NEGATE:
+								VariantInternal::set_vector3(dst, -va);
+								break;
+							case Variant::OP_EQUAL:
+								VariantInternal::set_bool(dst, va == vb);
+								break;
+							case Variant::OP_NOT_EQUAL:
+								VariantInternal::set_bool(dst, va != vb);
+								break;
+							default:
+								done = false;
+						}
 					} else {
-						err_text = "Invalid operands '" + Variant::get_type_name(a->get_type()) + "' and '" + Variant::get_type_name(b->get_type()) + "' in operator '" + Variant::get_operator_name(op) + "'.";
+						real_t vb = VariantInternal::get_number(b);
+						switch (op) {
+							case Variant::OP_MULTIPLY:
+								VariantInternal::set_vector3(dst, va * vb);
+								break;
+							case Variant::OP_DIVIDE:
+								VariantInternal::set_vector3(dst, va / vb);
+								break;
+							default:
+								done = false;
+						}
+					}
+
+					if (likely(done)) {
+						ip += 5;
+						DISPATCH_OPCODE;
 					}
-					OPCODE_BREAK;
 				}
-				*dst = ret;
-#endif
+
+				EVALUATE_OPERATOR(op, a, b, dst);
 				ip += 5;
 			}
 			DISPATCH_OPCODE;
@@ -598,19 +1366,86 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
-			OPCODE(OPCODE_SET_NAMED) {
+			OPCODE(OPCODE_SET_ARRAY_INDEX) {
 				CHECK_SPACE(3);
 
 				GET_VARIANT_PTR(dst, 1);
+				GET_VARIANT_PTR(index, 2);
 				GET_VARIANT_PTR(value, 3);
 
-				int indexname = _code_ptr[ip + 2];
+				if (likely(index->get_type() == Variant::INT && _set_array_element(dst, VariantInternal::get_int(index), value))) {
+					ip += 4;
+					DISPATCH_OPCODE;
+				}
+
+				bool valid;
+				dst->set(*index, *value, &valid);
+
+#ifdef DEBUG_ENABLED
+				if (!valid) {
+					String v = index->operator String();
+					if (v != "") {
+						v = "'" + v + "'";
+					} else {
+						v = "of type '" + _get_var_type(index) + "'";
+					}
+					err_text = "Invalid set index " + v + " (on base: '" + _get_var_type(dst) + "') with value of type '" + _get_var_type(value) + "'";
+					OPCODE_BREAK;
+				}
+#endif
+				ip += 4;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_GET_ARRAY_INDEX) {
+				CHECK_SPACE(3);
+
+				GET_VARIANT_PTR(src, 1);
+				GET_VARIANT_PTR(index, 2);
+				GET_VARIANT_PTR(dst, 3);
+
+				if (likely(index->get_type() == Variant::INT && _get_array_element(src, VariantInternal::get_int(index), dst))) {
+					ip += 4;
+					DISPATCH_OPCODE;
+				}
+
+				bool valid;
+				Variant ret = src->get(*index, &valid);
+#ifdef DEBUG_ENABLED
+				if (!valid) {
+					String v = index->operator String();
+					if (v != "") {
+						v = "'" + v + "'";
+					} else {
+						v = "of type '" + _get_var_type(index) + "'";
+					}
+					err_text = "Invalid get index " + v + " (on base: '" + _get_var_type(src) + "').";
+					OPCODE_BREAK;
+				}
+#endif
+				*dst = ret;
+				ip += 4;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_SET_NAMED) {
+				CHECK_SPACE(5);
+
+				int cache = _code_ptr[ip + 1];
+				GD_ERR_BREAK(cache < 0 || cache >= _inline_cache_count);
+
+				GET_VARIANT_PTR(dst, 2);
+				GET_VARIANT_PTR(value, 4);
+
+				int indexname = _code_ptr[ip + 3];
 
 				GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
 				const StringName *index = &_global_names_ptr[indexname];
 
 				bool valid;
-				dst->set_named(*index, *value, &valid);
+				if (!_inline_cache_set(_inline_caches[cache], dst, *index, value, valid)) {
+					dst->set_named(*index, *value, &valid);
+				}
 
 #ifdef DEBUG_ENABLED
 				if (!valid) {
@@ -619,25 +1454,36 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 					OPCODE_BREAK;
 				}
 #endif
-				ip += 4;
+				ip += 5;
 			}
 			DISPATCH_OPCODE;
 
 			OPCODE(OPCODE_GET_NAMED) {
-				CHECK_SPACE(4);
+				CHECK_SPACE(5);
 
-				GET_VARIANT_PTR(src, 1);
-				GET_VARIANT_PTR(dst, 3);
+				int cache = _code_ptr[ip + 1];
+				GD_ERR_BREAK(cache < 0 || cache >= _inline_cache_count);
 
-				int indexname = _code_ptr[ip + 2];
+				GET_VARIANT_PTR(src, 2);
+				GET_VARIANT_PTR(dst, 4);
+
+				int indexname = _code_ptr[ip + 3];
 
 				GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
 				const StringName *index = &_global_names_ptr[indexname];
 
+				// src and dst can be the same stack position, and src may hold the only reference to the object.
+				Variant ret;
+				if (_inline_cache_get(_inline_caches[cache], src, *index, ret)) {
+					*dst = ret;
+					ip += 5;
+					DISPATCH_OPCODE;
+				}
+
 				bool valid;
 #ifdef DEBUG_ENABLED
 				//allow better error message in cases where src and dst are the same stack position
-				Variant ret = src->get_named(*index, &valid);
+				ret = src->get_named(*index, &valid);
 
 #else
 				*dst = src->get_named(*index, &valid);
@@ -653,7 +1499,78 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				}
 				*dst = ret;
 #endif
-				ip += 4;
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_SET_VECTOR_COMPONENT) {
+				CHECK_SPACE(5);
+
+				int component = _code_ptr[ip + 1];
+				GD_ERR_BREAK(component < 0 || component > 2);
+
+				GET_VARIANT_PTR(dst, 2);
+				GET_VARIANT_PTR(value, 4);
+
+				if (likely(value->is_num())) {
+					if (dst->get_type() == Variant::VECTOR2 && component < 2) {
+						(*VariantInternal::get_vector2(dst))[component] = VariantInternal::get_number(value);
+						ip += 5;
+						DISPATCH_OPCODE;
+					}
+					if (dst->get_type() == Variant::VECTOR3) {
+						(*VariantInternal::get_vector3(dst))[component] = VariantInternal::get_number(value);
+						ip += 5;
+						DISPATCH_OPCODE;
+					}
+				}
+
+				int indexname = _code_ptr[ip + 3];
+				GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
+				const StringName *index = &_global_names_ptr[indexname];
+
+				bool valid;
+				dst->set_named(*index, *value, &valid);
+
+#ifdef DEBUG_ENABLED
+				if (!valid) {
+					err_text = "Invalid set index '" + String(*index) + "' (on base: '" + _get_var_type(dst) + "') with value of type '" + _get_var_type(value) + "'.";
+					OPCODE_BREAK;
+				}
+#endif
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_GET_VECTOR_COMPONENT) {
+				CHECK_SPACE(5);
+
+				int component = _code_ptr[ip + 1];
+				GD_ERR_BREAK(component < 0 || component > 2);
+
+				GET_VARIANT_PTR(src, 2);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(src->get_type() == Variant::VECTOR2 && component < 2)) {
+					VariantInternal::set_real(dst, (*VariantInternal::get_vector2(src))[component]);
+				} else if (likely(src->get_type() == Variant::VECTOR3)) {
+					VariantInternal::set_real(dst, (*VariantInternal::get_vector3(src))[component]);
+				} else {
+					int indexname = _code_ptr[ip + 3];
+					GD_ERR_BREAK(indexname < 0 || indexname >= _global_names_count);
+					const StringName *index = &_global_names_ptr[indexname];
+
+					bool valid;
+					Variant ret = src->get_named(*index, &valid);
+#ifdef DEBUG_ENABLED
+					if (!valid) {
+						err_text = "Invalid get index '" + index->operator String() + "' (on base: '" + _get_var_type(src) + "').";
+						OPCODE_BREAK;
+					}
+#endif
+					*dst = ret;
+				}
+				ip += 5;
 			}
 			DISPATCH_OPCODE;
 
@@ -1014,18 +1931,21 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 			OPCODE(OPCODE_CALL_RETURN)
 			OPCODE(OPCODE_CALL) {
-				CHECK_SPACE(4);
+				CHECK_SPACE(5);
 				bool call_ret = _code_ptr[ip] == OPCODE_CALL_RETURN;
 
-				int argc = _code_ptr[ip + 1];
-				GET_VARIANT_PTR(base, 2);
-				int nameg = _code_ptr[ip + 3];
+				int cache = _code_ptr[ip + 1];
+				GD_ERR_BREAK(cache < 0 || cache >= _inline_cache_count);
+
+				int argc = _code_ptr[ip + 2];
+				GET_VARIANT_PTR(base, 3);
+				int nameg = _code_ptr[ip + 4];
 
 				GD_ERR_BREAK(nameg < 0 || nameg >= _global_names_count);
 				const StringName *methodname = &_global_names_ptr[nameg];
 
 				GD_ERR_BREAK(argc < 0);
-				ip += 4;
+				ip += 5;
 				CHECK_SPACE(argc + 1);
 				Variant **argptrs = call_args;
 
@@ -1041,15 +1961,27 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 					call_time = OS::get_singleton()->get_ticks_usec();
 				}
 
+				if (sample_slot >= 0) {
+					sampler->set_native_method(sample_slot, *base, methodname);
+				}
+
 #endif
 				Variant::CallError err;
 				if (call_ret) {
 					GET_VARIANT_PTR(ret, argc);
-					base->call_ptr(*methodname, (const Variant **)argptrs, argc, ret, err);
+					if (!_inline_cache_call(_inline_caches[cache], base, *methodname, (const Variant **)argptrs, argc, ret, err)) {
+						base->call_ptr(*methodname, (const Variant **)argptrs, argc, ret, err);
+					}
 				} else {
-					base->call_ptr(*methodname, (const Variant **)argptrs, argc, nullptr, err);
+					if (!_inline_cache_call(_inline_caches[cache], base, *methodname, (const Variant **)argptrs, argc, nullptr, err)) {
+						base->call_ptr(*methodname, (const Variant **)argptrs, argc, nullptr, err);
+					}
 				}
 #ifdef DEBUG_ENABLED
+				if (sample_slot >= 0) {
+					sampler->clear_native(sample_slot);
+				}
+
 				if (GDScriptLanguage::get_singleton()->profiling) {
 					function_call_time += OS::get_singleton()->get_ticks_usec() - call_time;
 				}
@@ -1113,9 +2045,19 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 				Variant::CallError err;
 
+#ifdef DEBUG_ENABLED
+				if (sample_slot >= 0) {
+					sampler->set_native_function(sample_slot, GDScriptFunctions::get_func_name(func));
+				}
+#endif
+
 				GDScriptFunctions::call(func, (const Variant **)argptrs, argc, *dst, err);
 
 #ifdef DEBUG_ENABLED
+				if (sample_slot >= 0) {
+					sampler->clear_native(sample_slot);
+				}
+
 				if (err.error != Variant::CallError::CALL_OK) {
 					String methodstr = GDScriptFunctions::get_func_name(func);
 					if (dst->get_type() == Variant::STRING) {
@@ -1218,11 +2160,6 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				Ref<GDScriptFunctionState> gdfs = memnew(GDScriptFunctionState);
 				gdfs->function = this;
 
-				gdfs->state.stack.resize(alloca_size);
-				//copy variant stack
-				for (int i = 0; i < _stack_size; i++) {
-					memnew_placement(&gdfs->state.stack.write[sizeof(Variant) * i], Variant(stack[i]));
-				}
 				gdfs->state.stack_size = _stack_size;
 				gdfs->state.self = self;
 				gdfs->state.alloca_size = alloca_size;
@@ -1231,6 +2168,19 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				gdfs->state.script = _script;
 				GDScriptLanguage::singleton->lock.lock();
 
+				// The stack is moved, not copied, and this call won't destroy it on exit.
+				if (p_state) {
+					// Yielding again after a resume, hand the frame over as is.
+					gdfs->state.stack = p_state->stack;
+					p_state->stack = nullptr;
+					p_state->stack_size = 0;
+				} else if (alloca_size) {
+					// Variants don't point into themselves, so they can be relocated bitwise.
+					gdfs->state.stack = GDScriptLanguage::singleton->_alloc_frame(alloca_size);
+					memcpy(gdfs->state.stack, (const void *)stack, sizeof(Variant) * _stack_size);
+				}
+				stack_moved = true;
+
 				_script->pending_func_states.add(&gdfs->scripts_list);
 				if (p_instance) {
 					gdfs->state.instance = p_instance;
@@ -1436,6 +2386,148 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_ITERATE_ARRAY_BEGIN) {
+				CHECK_SPACE(8); // space for this and a regular iterate
+
+				GET_VARIANT_PTR(counter, 1);
+				GET_VARIANT_PTR(container, 2);
+
+				// The counter is the element index, as it is for iter_init() on arrays,
+				// so the loop can switch to the generic path at any step.
+				int size = _get_array_size(container);
+				bool valid = true;
+				bool has_next = size >= 0 ? size > 0 : container->iter_init(*counter, valid);
+#ifdef DEBUG_ENABLED
+				if (!valid) {
+					err_text = "Unable to iterate on object of type '" + Variant::get_type_name(container->get_type()) + "'.";
+					OPCODE_BREAK;
+				}
+#endif
+				if (!has_next) {
+					int jumpto = _code_ptr[ip + 3];
+					GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+					ip = jumpto;
+					DISPATCH_OPCODE;
+				}
+
+				GET_VARIANT_PTR(iterator, 4);
+				if (size >= 0) {
+					VariantInternal::set_int(counter, 0);
+					_get_array_element(container, 0, iterator);
+				} else {
+					*iterator = container->iter_get(*counter, valid);
+#ifdef DEBUG_ENABLED
+					if (!valid) {
+						err_text = "Unable to obtain iterator object of type '" + Variant::get_type_name(container->get_type()) + "'.";
+						OPCODE_BREAK;
+					}
+#endif
+				}
+				ip += 5; // skip the array iterate, which is always next
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_ITERATE_ARRAY) {
+				CHECK_SPACE(4);
+
+				GET_VARIANT_PTR(counter, 1);
+				GET_VARIANT_PTR(container, 2);
+
+				int size = counter->get_type() == Variant::INT ? _get_array_size(container) : -1;
+				if (likely(size >= 0)) {
+					int64_t idx = VariantInternal::get_int(counter) + 1;
+					if (idx >= size) {
+						int jumpto = _code_ptr[ip + 3];
+						GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+						ip = jumpto;
+					} else {
+						GET_VARIANT_PTR(iterator, 4);
+						VariantInternal::set_int(counter, idx);
+						_get_array_element(container, idx, iterator);
+						ip += 5; // loop again
+					}
+					DISPATCH_OPCODE;
+				}
+
+				bool valid;
+				if (!container->iter_next(*counter, valid)) {
+#ifdef DEBUG_ENABLED
+					if (!valid) {
+						err_text = "Unable to iterate on object of type '" + Variant::get_type_name(container->get_type()) + "' (type changed since first iteration?).";
+						OPCODE_BREAK;
+					}
+#endif
+					int jumpto = _code_ptr[ip + 3];
+					GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+					ip = jumpto;
+				} else {
+					GET_VARIANT_PTR(iterator, 4);
+
+					*iterator = container->iter_get(*counter, valid);
+#ifdef DEBUG_ENABLED
+					if (!valid) {
+						err_text = "Unable to obtain iterator object of type '" + Variant::get_type_name(container->get_type()) + "' (but was obtained on first iteration?).";
+						OPCODE_BREAK;
+					}
+#endif
+					ip += 5; // loop again
+				}
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_ITERATE_RANGE_BEGIN) {
+				CHECK_SPACE(6);
+
+				GET_VARIANT_PTR(counter, 1);
+				GET_VARIANT_PTR(to, 2);
+				GET_VARIANT_PTR(step, 3);
+
+				// The bounds were copied to private stack slots, normalize them to
+				// integers once so the loop itself only does integer math.
+				int64_t from_i = _get_range_bound(counter);
+				int64_t to_i = _get_range_bound(to);
+				int64_t step_i = _get_range_bound(step);
+				VariantInternal::set_int(counter, from_i);
+				VariantInternal::set_int(to, to_i);
+				VariantInternal::set_int(step, step_i);
+
+				if (from_i < to_i ? step_i <= 0 : (from_i == to_i || step_i >= 0)) {
+					int jumpto = _code_ptr[ip + 4];
+					GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+					ip = jumpto;
+				} else {
+					GET_VARIANT_PTR(iterator, 5);
+					VariantInternal::set_int(iterator, from_i);
+					ip += 6; // skip the range iterate, which is always next
+				}
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_ITERATE_RANGE) {
+				CHECK_SPACE(6);
+
+				GET_VARIANT_PTR(counter, 1);
+				GET_VARIANT_PTR(to, 2);
+				GET_VARIANT_PTR(step, 3);
+				GD_ERR_BREAK(counter->get_type() != Variant::INT || to->get_type() != Variant::INT || step->get_type() != Variant::INT);
+
+				int64_t step_i = VariantInternal::get_int(step);
+				int64_t idx = VariantInternal::get_int(counter) + step_i;
+				int64_t to_i = VariantInternal::get_int(to);
+
+				if (step_i > 0 ? idx >= to_i : idx <= to_i) {
+					int jumpto = _code_ptr[ip + 4];
+					GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+					ip = jumpto;
+				} else {
+					GET_VARIANT_PTR(iterator, 5);
+					VariantInternal::set_int(counter, idx);
+					VariantInternal::set_int(iterator, idx);
+					ip += 6; // loop again
+				}
+			}
+			DISPATCH_OPCODE;
+
 			OPCODE(OPCODE_ASSERT) {
 				CHECK_SPACE(3);
 
@@ -1556,6 +2648,10 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 	OPCODES_OUT
 #ifdef DEBUG_ENABLED
+	if (sample_slot >= 0) {
+		sampler->exit(sample_slot);
+	}
+
 	if (GDScriptLanguage::get_singleton()->profiling) {
 		uint64_t time_taken = OS::get_singleton()->get_ticks_usec() - function_start_time;
 		profile.total_time += time_taken;
@@ -1575,7 +2671,7 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 		}
 #endif
 
-		if (_stack_size) {
+		if (_stack_size && !stack_moved) {
 			//free stack
 			for (int i = 0; i < _stack_size; i++) {
 				stack[i].~Variant();
@@ -1698,6 +2794,8 @@ GDScriptFunction::GDScriptFunction() :
 		function_list(this) {
 	_stack_size = 0;
 	_call_size = 0;
+	_inline_caches = nullptr;
+	_inline_cache_count = 0;
 	rpc_mode = MultiplayerAPI::RPC_MODE_DISABLED;
 	name = "<anonymous>";
 #ifdef DEBUG_ENABLED
@@ -1717,11 +2815,20 @@ GDScriptFunction::GDScriptFunction() :
 	profile.last_frame_self_time = 0;
 	profile.last_frame_total_time = 0;
 
+	inline_cache_hits = 0;
+	inline_cache_misses = 0;
+
 #endif
 }
 
 GDScriptFunction::~GDScriptFunction() {
+	if (_inline_caches) {
+		memdelete_arr(_inline_caches);
+	}
 #ifdef DEBUG_ENABLED
+	// Samples taken while this function ran are resolved before it goes away.
+	GDScriptLanguage::get_singleton()->sampler.function_freed(this);
+
 	GDScriptLanguage::get_singleton()->lock.lock();
 	GDScriptLanguage::get_singleton()->function_list.remove(&function_list);
 	GDScriptLanguage::get_singleton()->lock.unlock();
@@ -1847,7 +2954,7 @@ Variant GDScriptFunctionState::resume(const Variant &p_arg) {
 
 void GDScriptFunctionState::_clear_stack() {
 	if (state.stack_size) {
-		Variant *stack = (Variant *)state.stack.ptr();
+		Variant *stack = (Variant *)state.stack;
 		for (int i = 0; i < state.stack_size; i++) {
 			stack[i].~Variant();
 		}
@@ -1867,11 +2974,17 @@ GDScriptFunctionState::GDScriptFunctionState() :
 		scripts_list(this),
 		instances_list(this) {
 	function = nullptr;
+	state.stack = nullptr;
+	state.stack_size = 0;
+	state.alloca_size = 0;
 }
 
 GDScriptFunctionState::~GDScriptFunctionState() {
 	_clear_stack();
 	GDScriptLanguage::singleton->lock.lock();
+	if (state.stack) {
+		GDScriptLanguage::singleton->_free_frame(state.stack, state.alloca_size);
+	}
 	scripts_list.remove_from_list();
 	instances_list.remove_from_list();
 	GDScriptLanguage::singleton->lock.unlock();
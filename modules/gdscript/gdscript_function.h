@@ -39,12 +39,14 @@
 #include "core/string_name.h"
 #include "core/variant.h"
 
+#include <atomic>
+
 class GDScriptInstance;
 class GDScript;
 
 struct GDScriptDataType {
 	bool has_type;
-	enum {
+	enum Kind {
 		UNINITIALIZED,
 		BUILTIN,
 		NATIVE,
@@ -160,12 +162,20 @@ class GDScriptFunction {
 public:
 	enum Opcode {
 		OPCODE_OPERATOR,
+		OPCODE_OPERATOR_INT, // same layout as OPCODE_OPERATOR, operands statically typed
+		OPCODE_OPERATOR_REAL,
+		OPCODE_OPERATOR_VECTOR2,
+		OPCODE_OPERATOR_VECTOR3,
 		OPCODE_EXTENDS_TEST,
 		OPCODE_IS_BUILTIN,
 		OPCODE_SET,
 		OPCODE_GET,
+		OPCODE_SET_ARRAY_INDEX, // same layout as OPCODE_SET/GET, base statically typed as an array
+		OPCODE_GET_ARRAY_INDEX,
 		OPCODE_SET_NAMED,
 		OPCODE_GET_NAMED,
+		OPCODE_SET_VECTOR_COMPONENT,
+		OPCODE_GET_VECTOR_COMPONENT,
 		OPCODE_SET_MEMBER,
 		OPCODE_GET_MEMBER,
 		OPCODE_ASSIGN,
@@ -195,6 +205,10 @@ public:
 		OPCODE_RETURN,
 		OPCODE_ITERATE_BEGIN,
 		OPCODE_ITERATE,
+		OPCODE_ITERATE_ARRAY_BEGIN, // same layout as OPCODE_ITERATE_BEGIN/ITERATE
+		OPCODE_ITERATE_ARRAY,
+		OPCODE_ITERATE_RANGE_BEGIN,
+		OPCODE_ITERATE_RANGE,
 		OPCODE_ASSERT,
 		OPCODE_BREAKPOINT,
 		OPCODE_LINE,
@@ -225,7 +239,57 @@ public:
 	};
 
 private:
+	// Inline caches remember what OPCODE_GET_NAMED, OPCODE_SET_NAMED and OPCODE_CALL resolved to for
+	// a receiver type (its GDScript and native class), so later accesses skip the name lookups.
+	enum {
+		INLINE_CACHE_SIZE = 4 // Receiver types remembered per call site, sites seeing more stay on the slow path.
+	};
+
+	enum InlineCacheOp {
+		INLINE_CACHE_OP_GET,
+		INLINE_CACHE_OP_SET,
+		INLINE_CACHE_OP_CALL,
+	};
+
+	enum InlineCacheKind {
+		INLINE_CACHE_SCRIPT_MEMBER,
+		INLINE_CACHE_SCRIPT_METHOD,
+		INLINE_CACHE_NATIVE_PROPERTY,
+		INLINE_CACHE_NATIVE_METHOD,
+	};
+
+	struct InlineCacheTarget {
+		uint32_t version;
+		const void *script;
+		const void *native;
+		InlineCacheKind kind;
+		int index; // Member index, or the index passed to an indexed property getter/setter (-1 if none).
+		union {
+			const GDScriptDataType *member_type;
+			GDScriptFunction *function;
+			MethodBind *method;
+		};
+	};
+
+	// Entries are shared by all threads running the function. They are written under a sequence
+	// lock, and readers only use their copy of an entry if the sequence didn't change meanwhile.
+	struct InlineCacheEntry {
+		std::atomic<uint32_t> sequence; // 0 while empty, odd while being written.
+		InlineCacheTarget target;
+
+		InlineCacheEntry() {
+			sequence.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	struct InlineCache {
+		InlineCacheEntry entries[INLINE_CACHE_SIZE];
+	};
+
+	static SafeNumeric<uint32_t> inline_cache_version;
+
 	friend class GDScriptCompiler;
+	friend class GDScriptBytecode;
 
 	StringName source;
 
@@ -242,6 +306,8 @@ private:
 	int _default_arg_count;
 	const int *_code_ptr;
 	int _code_size;
+	InlineCache *_inline_caches;
+	int _inline_cache_count;
 	int _argument_count;
 	int _stack_size;
 	int _call_size;
@@ -271,7 +337,18 @@ private:
 	_FORCE_INLINE_ Variant *_get_variant(int p_address, GDScriptInstance *p_instance, GDScript *p_script, Variant &self, Variant &static_ref, Variant *p_stack, String &r_error) const;
 	_FORCE_INLINE_ String _get_call_error(const Variant::CallError &p_err, const String &p_where, const Variant **argptrs) const;
 
+	void _set_inline_cache_count(int p_count);
+	_FORCE_INLINE_ static uint32_t _get_inline_cache_version();
+	_FORCE_INLINE_ static bool _get_inline_cache_receiver(Object *p_object, GDScriptInstance *&r_instance, const void *&r_script);
+	_FORCE_INLINE_ static bool _find_inline_cache(const InlineCache &p_cache, const void *p_script, const void *p_native, uint32_t p_version, InlineCacheTarget &r_target);
+	static bool _resolve_inline_cache(InlineCacheOp p_op, Object *p_object, GDScriptInstance *p_instance, const StringName &p_name, InlineCacheTarget &r_target);
+	static void _update_inline_cache(InlineCache &p_cache, InlineCacheOp p_op, Object *p_object, GDScriptInstance *p_instance, const StringName &p_name, uint32_t p_version);
+	_FORCE_INLINE_ bool _inline_cache_get(InlineCache &p_cache, const Variant *p_base, const StringName &p_name, Variant &r_ret);
+	_FORCE_INLINE_ bool _inline_cache_set(InlineCache &p_cache, const Variant *p_base, const StringName &p_name, const Variant *p_value, bool &r_valid);
+	_FORCE_INLINE_ bool _inline_cache_call(InlineCache &p_cache, const Variant *p_base, const StringName &p_name, const Variant **p_args, int p_argcount, Variant *r_ret, Variant::CallError &r_err);
+
 	friend class GDScriptLanguage;
+	friend class GDScriptSampler;
 
 	SelfList<GDScriptFunction> function_list;
 #ifdef DEBUG_ENABLED
@@ -291,6 +368,9 @@ private:
 		uint64_t last_frame_total_time;
 	} profile;
 
+	uint64_t inline_cache_hits;
+	uint64_t inline_cache_misses;
+
 #endif
 
 public:
@@ -301,7 +381,7 @@ public:
 		StringName function_name;
 		String script_path;
 #endif
-		Vector<uint8_t> stack;
+		uint8_t *stack; // Pooled frame holding the Variant stack and call_args, alloca_size bytes.
 		int stack_size;
 		Variant self;
 		uint32_t alloca_size;
@@ -347,6 +427,10 @@ public:
 	Variant call(GDScriptInstance *p_instance, const Variant **p_args, int p_argcount, Variant::CallError &r_err, CallState *p_state = nullptr);
 
 	_FORCE_INLINE_ MultiplayerAPI::RPCMode get_rpc_mode() const { return rpc_mode; }
+
+	// Call when script layouts change (compiled, reloaded or freed), drops every inline cache entry.
+	static void invalidate_inline_caches() { inline_cache_version.increment(); }
+
 	GDScriptFunction();
 	~GDScriptFunction();
 };
@@ -0,0 +1,290 @@
+/*************************************************************************/
+/*  gdscript_load_graph.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_load_graph.h"
+
+#include "core/io/resource_loader.h"
+#include "core/os/file_access.h"
+#include "core/project_settings.h"
+#include "core/script_language.h"
+#include "gdscript_bytecode.h"
+#include "gdscript_tokenizer.h"
+
+bool GDScriptLoadGraph::enabled = true;
+SafeNumeric<uint32_t> GDScriptLoadGraph::active;
+
+void GDScriptLoadGraph::_find_autoloads() {
+	// The parser loads autoloads named in the code while compiling, they must be
+	// in the graph so two jobs never load the same one.
+	List<PropertyInfo> props;
+	ProjectSettings::get_singleton()->get_property_list(&props);
+	for (List<PropertyInfo>::Element *E = props.front(); E; E = E->next()) {
+		const String &name = E->get().name;
+		if (!name.begins_with("autoload/")) {
+			continue;
+		}
+		String path = ProjectSettings::get_singleton()->get(name);
+		if (path.begins_with("*")) {
+			path = path.right(1);
+		}
+		if (!path.begins_with("res://")) {
+			path = "res://" + path;
+		}
+		autoload_paths[name.get_slice("/", 1)] = path;
+	}
+}
+
+uint32_t GDScriptLoadGraph::_add_node(const String &p_path) {
+	const uint32_t *index = node_map.getptr(p_path);
+	if (index) {
+		return *index;
+	}
+
+	Node *node = memnew(Node);
+	node->graph = this;
+	node->path = p_path;
+	nodes.push_back(node);
+	node_map[p_path] = nodes.size() - 1;
+	return nodes.size() - 1;
+}
+
+void GDScriptLoadGraph::_scan_node(uint32_t p_index, Node **p_nodes) {
+	Node *node = p_nodes[p_index];
+	String base_dir = node->path.get_base_dir();
+	String file_path = ResourceLoader::path_remap(node->path);
+
+	GDScriptTokenizerText tokenizer_text;
+	GDScriptTokenizerBuffer tokenizer_buffer;
+	GDScriptTokenizer *tokenizer = nullptr;
+
+	if (file_path.ends_with(".gd")) {
+		Error err;
+		String source = FileAccess::get_file_as_string(file_path, &err);
+		if (err != OK) {
+			return;
+		}
+		tokenizer_text.set_code(source);
+		tokenizer = &tokenizer_text;
+	} else if (file_path.ends_with(".gdc")) {
+		Vector<uint8_t> buffer = FileAccess::get_file_as_array(file_path);
+		if (GDScriptBytecode::is_container(buffer)) {
+			Vector<uint8_t> tokens;
+			Vector<uint8_t> compiled;
+			if (GDScriptBytecode::split_container(buffer, tokens, compiled) != OK) {
+				return;
+			}
+			buffer = tokens;
+		}
+		if (buffer.empty() || tokenizer_buffer.set_code_buffer(buffer) != OK) {
+			return;
+		}
+		tokenizer = &tokenizer_buffer;
+	} else {
+		return; // Encrypted scripts are only read by their own load.
+	}
+
+	while (true) {
+		GDScriptTokenizer::Token token = tokenizer->get_token();
+		if (token == GDScriptTokenizer::TK_EOF) {
+			break;
+		}
+
+		switch (token) {
+			case GDScriptTokenizer::TK_ERROR: {
+				return; // Leave it to the parser to report.
+			}
+			case GDScriptTokenizer::TK_PR_PRELOAD: {
+				if (tokenizer->get_token(1) != GDScriptTokenizer::TK_PARENTHESIS_OPEN || tokenizer->get_token(2) != GDScriptTokenizer::TK_CONSTANT || tokenizer->get_token_constant(2).get_type() != Variant::STRING) {
+					return; // Preloading a named constant, only the parser can resolve it.
+				}
+				String path = tokenizer->get_token_constant(2);
+				if (!path.is_abs_path() && base_dir != "") {
+					path = base_dir.plus_file(path);
+				}
+				node->scanned_paths.push_back(path.replace("///", "//").simplify_path());
+			} break;
+			case GDScriptTokenizer::TK_PR_EXTENDS: {
+				if (tokenizer->get_token(1) == GDScriptTokenizer::TK_CONSTANT && tokenizer->get_token_constant(1).get_type() == Variant::STRING) {
+					String path = tokenizer->get_token_constant(1);
+					if (path.is_rel_path()) {
+						path = base_dir.plus_file(path).simplify_path();
+					}
+					node->scanned_paths.push_back(path);
+				}
+			} break;
+			case GDScriptTokenizer::TK_IDENTIFIER: {
+				StringName identifier = tokenizer->get_token_identifier();
+				const String *autoload_path = autoload_paths.getptr(identifier);
+				if (ScriptServer::is_global_class(identifier)) {
+					node->scanned_paths.push_back(ScriptServer::get_global_class_path(identifier));
+				} else if (autoload_path) {
+					node->scanned_paths.push_back(*autoload_path);
+				}
+			} break;
+			default: {
+			}
+		}
+
+		tokenizer->advance();
+	}
+
+	node->scanned = true;
+}
+
+void GDScriptLoadGraph::_scan() {
+	uint32_t from = 0;
+
+	// Breadth first, every level of the graph is scanned in parallel.
+	while (from < nodes.size()) {
+		uint32_t to = nodes.size();
+		WorkerThreadPool::get_singleton()->parallel_for(to - from, this, &GDScriptLoadGraph::_scan_node, nodes.ptr() + from);
+
+		for (uint32_t i = from; i < to; i++) {
+			Node *node = nodes[i];
+			for (int j = 0; j < node->scanned_paths.size(); j++) {
+				const String &path = node->scanned_paths[j];
+				if (path == node->path) {
+					continue;
+				}
+				// The requesting script is cached before it compiles, keep the
+				// scripts using it waiting so cycles still load serially.
+				if (path != nodes[0]->path && ResourceCache::has(path)) {
+					continue;
+				}
+
+				if (!path.ends_with(".gd")) {
+					if (resource_paths.find(path) == -1) {
+						resource_paths.push_back(path);
+					}
+					continue;
+				}
+
+				uint32_t index = _add_node(path);
+				if (node->dependencies.find(index) == -1) {
+					node->dependencies.push_back(index);
+					nodes[index]->dependents.push_back(i);
+				}
+			}
+			node->scanned_paths.clear();
+		}
+
+		from = to;
+	}
+}
+
+void GDScriptLoadGraph::_load_node_job(void *p_node) {
+	Node *node = (Node *)p_node;
+	GDScriptLoadGraph *graph = node->graph;
+
+	node->resource = ResourceLoader::load(node->path);
+	if (node->resource.is_null()) {
+		return; // Scripts depending on it load serially and report the error.
+	}
+
+	for (uint32_t i = 0; i < node->dependents.size(); i++) {
+		Node *dependent = graph->nodes[node->dependents[i]];
+		if (dependent->pending.decrement() == 0 && dependent->scanned) {
+			WorkerThreadPool::get_singleton()->push_job(&GDScriptLoadGraph::_load_node_job, dependent, &graph->counter);
+		}
+	}
+}
+
+void GDScriptLoadGraph::_load() {
+	// Other resources may use any script, so they are loaded from this thread
+	// beforehand and only scripts are ever loaded concurrently.
+	for (int i = 0; i < resource_paths.size(); i++) {
+		RES resource = ResourceLoader::load(resource_paths[i]);
+		if (resource.is_valid()) {
+			resources.push_back(resource);
+		}
+	}
+
+	LocalVector<bool> cached;
+	cached.resize(nodes.size());
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		cached[i] = ResourceCache::has(nodes[i]->path);
+	}
+
+	LocalVector<Node *> ready;
+
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		Node *node = nodes[i];
+		if (i == 0 || cached[i]) {
+			// Never queued, no matter how many of its dependencies finish.
+			node->pending.set(UINT32_MAX);
+			continue;
+		}
+
+		uint32_t pending = 0;
+		for (uint32_t j = 0; j < node->dependencies.size(); j++) {
+			if (!cached[node->dependencies[j]]) {
+				pending++;
+			}
+		}
+		node->pending.set(pending);
+
+		if (pending == 0 && node->scanned) {
+			ready.push_back(node);
+		}
+	}
+
+	for (uint32_t i = 0; i < ready.size(); i++) {
+		WorkerThreadPool::get_singleton()->push_job(&GDScriptLoadGraph::_load_node_job, ready[i], &counter);
+	}
+	WorkerThreadPool::get_singleton()->wait(&counter);
+}
+
+void GDScriptLoadGraph::load_dependencies(const String &p_path) {
+	if (!enabled || ScriptDebugger::get_singleton()) {
+		return; // The debugger expects parse errors to come from the thread loading the script.
+	}
+	if (!WorkerThreadPool::get_singleton() || WorkerThreadPool::get_singleton()->get_thread_count() == 0) {
+		return;
+	}
+	if (active.postincrement() != 0) {
+		active.decrement();
+		return;
+	}
+
+	_find_autoloads();
+	_add_node(p_path);
+	_scan();
+	if (nodes.size() > 1) {
+		_load();
+	}
+
+	active.decrement();
+}
+
+GDScriptLoadGraph::~GDScriptLoadGraph() {
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		memdelete(nodes[i]);
+	}
+}
@@ -0,0 +1,91 @@
+/*************************************************************************/
+/*  gdscript_load_graph.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_LOAD_GRAPH_H
+#define GDSCRIPT_LOAD_GRAPH_H
+
+#include "core/hash_map.h"
+#include "core/local_vector.h"
+#include "core/os/worker_thread_pool.h"
+#include "core/resource.h"
+
+// Loads the scripts a script depends on (base classes, preloads, and global
+// classes and autoloads it names) on the WorkerThreadPool before that script is compiled.
+// The sources are scanned for dependencies in parallel first, then every
+// script is parsed and compiled as a job once all its own dependencies are
+// cached, so independent branches of the graph compile at the same time.
+// Scripts whose dependencies can't be fully known from their tokens, and any
+// script depending on them or on a cycle, are left to the regular serial load
+// of the script that requested them.
+class GDScriptLoadGraph {
+	struct Node {
+		GDScriptLoadGraph *graph = nullptr;
+		String path;
+		RES resource;
+		Vector<String> scanned_paths; // Everything it loads while compiling, filled by the scan.
+		bool scanned = false; // All dependencies are known.
+		LocalVector<uint32_t> dependencies;
+		LocalVector<uint32_t> dependents;
+		SafeNumeric<uint32_t> pending; // Dependencies not loaded yet.
+	};
+
+	static bool enabled;
+	static SafeNumeric<uint32_t> active;
+
+	LocalVector<Node *> nodes; // The first one is the script requesting the load.
+	HashMap<String, uint32_t> node_map;
+	HashMap<StringName, String> autoload_paths; // By singleton name, only read once the scan starts.
+	Vector<String> resource_paths;
+	Vector<RES> resources;
+	WorkerThreadPool::Counter counter;
+
+	void _find_autoloads();
+	uint32_t _add_node(const String &p_path);
+	void _scan_node(uint32_t p_index, Node **p_nodes);
+	static void _load_node_job(void *p_node);
+
+	void _scan();
+	void _load();
+
+public:
+	static void set_enabled(bool p_enabled) { enabled = p_enabled; }
+	static bool is_enabled() { return enabled; }
+
+	// Loads the dependencies of the script at p_path, which is about to be
+	// compiled by the calling thread. They are kept referenced until the graph
+	// is destroyed, so it must outlive that compilation. Does nothing when
+	// called while another graph is loading, so scripts loaded from its jobs
+	// load serially.
+	void load_dependencies(const String &p_path);
+
+	~GDScriptLoadGraph();
+};
+
+#endif // GDSCRIPT_LOAD_GRAPH_H
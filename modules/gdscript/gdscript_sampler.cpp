@@ -0,0 +1,370 @@
+/*************************************************************************/
+/*  modules/gdscript/gdscript_sampler.cpp                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_sampler.h"
+
+#include "core/class_db.h"
+#include "core/os/file_access.h"
+#include "core/os/os.h"
+#include "gdscript_function.h"
+
+GDScriptSampler *GDScriptSampler::active = nullptr;
+
+void GDScriptSampler::_thread_func(void *p_sampler) {
+	GDScriptSampler *sampler = (GDScriptSampler *)p_sampler;
+	while (!sampler->exit_thread.is_set()) {
+		OS::get_singleton()->delay_usec(sampler->interval_usec);
+		sampler->_take_sample();
+	}
+}
+
+void GDScriptSampler::_take_sample() {
+	MutexLock lock(mutex);
+
+	if (sample_frames.size() >= MAX_PENDING_FRAMES) {
+		dropped_count++;
+		return;
+	}
+
+	// Retry a few times if the main thread was pushing or popping a frame, it
+	// only takes a handful of instructions.
+	for (int attempt = 0; attempt < 8; attempt++) {
+		uint32_t v = version.load(std::memory_order_acquire);
+		if (v & 1) {
+			continue;
+		}
+
+		int count = depth;
+		if (count < 0 || count > max_depth) {
+			continue;
+		}
+
+		uint32_t first = sample_frames.size();
+		sample_frames.resize(first + count);
+		if (count) {
+			memcpy(&sample_frames[first], frames, sizeof(Frame) * count);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (version.load(std::memory_order_relaxed) != v) {
+			sample_frames.resize(first);
+			continue;
+		}
+
+		Sample sample;
+		sample.first = first;
+		sample.count = count;
+		samples.push_back(sample);
+		sample_count++;
+		return;
+	}
+
+	dropped_count++;
+}
+
+const GDScriptSampler::FunctionInfo &GDScriptSampler::_get_function_info(const GDScriptFunction *p_function) {
+	uint64_t key = (uint64_t)p_function;
+	FunctionInfo *info = function_info.getptr(key);
+	if (info) {
+		return *info;
+	}
+
+	FunctionInfo new_info;
+	new_info.label = String(p_function->get_source()) + ":" + p_function->get_name();
+#ifdef DEBUG_ENABLED
+	new_info.signature = p_function->profile.signature;
+#else
+	new_info.signature = new_info.label;
+#endif
+	function_info.set(key, new_info);
+	return *function_info.getptr(key);
+}
+
+MethodBind *GDScriptSampler::_get_native_bind(const Variant &p_base, const StringName &p_method) {
+	if (p_base.get_type() != Variant::OBJECT || p_base.is_invalid_object()) {
+		return nullptr;
+	}
+	Object *obj = p_base;
+	return obj ? ClassDB::get_method(obj->get_class_name(), p_method) : nullptr;
+}
+
+String GDScriptSampler::_get_native_label(const Frame &p_frame, bool &r_bound) {
+	r_bound = true;
+	if (p_frame.native_function) {
+		return String("@GDScript.") + p_frame.native_function;
+	}
+	if (p_frame.native_bind) {
+		return String(p_frame.native_bind->get_instance_class()) + "." + p_frame.native_bind->get_name();
+	}
+
+	// Not a bound method, most likely a script method called on the object.
+	// The receiver may be freed by now, so only its type is known.
+	r_bound = p_frame.native_type != Variant::OBJECT;
+	return Variant::get_type_name(p_frame.native_type) + "." + *p_frame.native_method;
+}
+
+void GDScriptSampler::_flush() {
+	LocalVector<Stats *> seen;
+
+	for (uint32_t i = 0; i < samples.size(); i++) {
+		const Sample &sample = samples[i];
+		const Frame *sample_frames_ptr = sample_frames.ptr() + sample.first;
+
+		String stack;
+		if (sample.count == 0) {
+			stack = "(engine)";
+		}
+
+		seen.clear();
+		for (uint32_t j = 0; j < sample.count; j++) {
+			const Frame &frame = sample_frames_ptr[j];
+			const FunctionInfo &info = _get_function_info(frame.function);
+			if (j > 0) {
+				stack += ";";
+			}
+			stack += info.label;
+
+			Stats *stats = function_stats.getptr(info.signature);
+			if (!stats) {
+				function_stats.set(info.signature, Stats());
+				stats = function_stats.getptr(info.signature);
+			}
+
+			// Recursive functions count once per sample towards their total time.
+			if (seen.find(stats) == -1) {
+				seen.push_back(stats);
+				stats->total += interval_usec;
+				stats->frame_total += interval_usec;
+			}
+
+			bool top = j == sample.count - 1;
+			if (frame.native_method || frame.native_function) {
+				// Native calls that end up running script only show as the script
+				// frame above them, unless they are bound methods (like emit_signal).
+				bool bound;
+				String native = _get_native_label(frame, bound);
+				if (bound || top) {
+					stack += ";" + native;
+				}
+			} else if (top) {
+				stats->self += interval_usec;
+				stats->frame_self += interval_usec;
+			}
+		}
+
+		uint64_t *count = stacks.getptr(stack);
+		if (count) {
+			(*count)++;
+		} else {
+			stacks.set(stack, 1);
+		}
+
+		count = frame_stacks.getptr(stack);
+		if (count) {
+			(*count)++;
+		} else {
+			frame_stacks.set(stack, 1);
+		}
+	}
+
+	samples.clear();
+	sample_frames.clear();
+}
+
+void GDScriptSampler::start(uint32_t p_interval_usec, int p_max_depth) {
+	stop();
+
+	if (p_max_depth > max_depth) {
+		// Nothing writes the stack while stopped, except popping back to slot 0.
+		if (frames) {
+			memdelete_arr(frames);
+		}
+		frames = memnew_arr(Frame, p_max_depth);
+		max_depth = p_max_depth;
+	}
+	depth = 0;
+	interval_usec = MAX(p_interval_usec, 10u);
+
+	{
+		MutexLock lock(mutex);
+		samples.clear();
+		sample_frames.clear();
+		sample_count = 0;
+		dropped_count = 0;
+		function_info.clear();
+		function_stats.clear();
+		stacks.clear();
+		frame_stacks.clear();
+		last_frame_stacks.clear();
+	}
+
+	exit_thread.clear();
+	active = this;
+	thread.start(_thread_func, this);
+}
+
+void GDScriptSampler::stop() {
+	if (!is_running()) {
+		return;
+	}
+
+	active = nullptr;
+	exit_thread.set();
+	thread.wait_to_finish();
+
+	MutexLock lock(mutex);
+	_flush();
+	// Function addresses can be reused once nothing tracks when they are freed.
+	function_info.clear();
+}
+
+void GDScriptSampler::flush() {
+	MutexLock lock(mutex);
+	_flush();
+}
+
+void GDScriptSampler::function_freed(const GDScriptFunction *p_function) {
+	MutexLock lock(mutex);
+	if (samples.size()) {
+		_flush();
+	}
+	function_info.erase((uint64_t)p_function);
+}
+
+void GDScriptSampler::frame() {
+	MutexLock lock(mutex);
+	_flush();
+
+	last_frame_stacks.clear();
+	const String *stack = nullptr;
+	while ((stack = frame_stacks.next(stack))) {
+		last_frame_stacks.push_back(*stack);
+		last_frame_stacks.push_back(frame_stacks[*stack]);
+	}
+	frame_stacks.clear();
+
+	const StringName *signature = nullptr;
+	while ((signature = function_stats.next(signature))) {
+		Stats &stats = function_stats[*signature];
+		stats.last_frame_self = stats.frame_self;
+		stats.last_frame_total = stats.frame_total;
+		stats.frame_self = 0;
+		stats.frame_total = 0;
+	}
+}
+
+int GDScriptSampler::get_accumulated_data(ScriptLanguage::ProfilingInfo *p_info_arr, int p_info_max) {
+	MutexLock lock(mutex);
+
+	int current = 0;
+	const StringName *signature = nullptr;
+	while ((signature = function_stats.next(signature)) && current < p_info_max) {
+		const Stats &stats = function_stats[*signature];
+		p_info_arr[current].signature = *signature;
+		p_info_arr[current].call_count = 0; // Unknown when sampling.
+		p_info_arr[current].self_time = stats.self;
+		p_info_arr[current].total_time = stats.total;
+		current++;
+	}
+	return current;
+}
+
+int GDScriptSampler::get_frame_data(ScriptLanguage::ProfilingInfo *p_info_arr, int p_info_max) {
+	MutexLock lock(mutex);
+
+	int current = 0;
+	const StringName *signature = nullptr;
+	while ((signature = function_stats.next(signature)) && current < p_info_max) {
+		const Stats &stats = function_stats[*signature];
+		if (stats.last_frame_total == 0) {
+			continue;
+		}
+		p_info_arr[current].signature = *signature;
+		p_info_arr[current].call_count = 0;
+		p_info_arr[current].self_time = stats.last_frame_self;
+		p_info_arr[current].total_time = stats.last_frame_total;
+		current++;
+	}
+	return current;
+}
+
+Array GDScriptSampler::get_frame_stacks() {
+	MutexLock lock(mutex);
+	return last_frame_stacks.duplicate();
+}
+
+uint64_t GDScriptSampler::get_sample_count() {
+	MutexLock lock(mutex);
+	return sample_count;
+}
+
+uint64_t GDScriptSampler::get_dropped_count() {
+	MutexLock lock(mutex);
+	return dropped_count;
+}
+
+Error GDScriptSampler::save_folded_stacks(const String &p_path) {
+	Error err;
+	FileAccess *f = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(!f, err, "Can't open GDScript sample file for writing: " + p_path + ".");
+
+	MutexLock lock(mutex);
+	_flush();
+
+	Vector<String> lines;
+	const String *stack = nullptr;
+	while ((stack = stacks.next(stack))) {
+		lines.push_back(*stack + " " + itos(stacks[*stack]));
+	}
+	lines.sort();
+
+	for (int i = 0; i < lines.size(); i++) {
+		f->store_line(lines[i]);
+	}
+
+	if (dropped_count > 0) {
+		WARN_PRINT(vformat("Dropped %d GDScript samples, the main thread was busy updating its call stack or samples weren't flushed in time.", dropped_count));
+	}
+
+	f->close();
+	memdelete(f);
+	return OK;
+}
+
+GDScriptSampler::GDScriptSampler() {
+	version.store(0);
+}
+
+GDScriptSampler::~GDScriptSampler() {
+	stop();
+	if (frames) {
+		memdelete_arr(frames);
+	}
+}
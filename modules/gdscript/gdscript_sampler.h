@@ -0,0 +1,223 @@
+/*************************************************************************/
+/*  modules/gdscript/gdscript_sampler.h                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_SAMPLER_H
+#define GDSCRIPT_SAMPLER_H
+
+#include "core/hash_map.h"
+#include "core/local_vector.h"
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "core/safe_refcount.h"
+#include "core/script_language.h"
+
+#include <atomic>
+
+class GDScriptFunction;
+class MethodBind;
+
+// Sampling profiler for GDScript. While it runs, the main thread keeps a shadow
+// copy of its script call stack, along with the native call each function is
+// waiting on, and a background thread copies that stack at a fixed interval.
+// The copies are resolved to names on the main thread and aggregated as folded
+// stacks ("caller;callee count" lines), the input of flame graph tools.
+// Script calls made from other threads aren't sampled.
+class GDScriptSampler {
+public:
+	struct Frame {
+		const GDScriptFunction *function;
+		// The native call the function is waiting on, if any.
+		// Bound methods are resolved when the call is made, as the receiver may be freed by the time the sample is flushed.
+		MethodBind *native_bind;
+		const StringName *native_method;
+		const char *native_function; // Built-in GDScript function, like load().
+		Variant::Type native_type;
+	};
+
+private:
+	enum {
+		MAX_PENDING_FRAMES = 1 << 20, // Frames of samples not flushed yet, past that samples are dropped.
+	};
+
+	struct Sample {
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct FunctionInfo {
+		String label;
+		StringName signature;
+	};
+
+	struct Stats {
+		uint64_t self = 0;
+		uint64_t total = 0;
+		uint64_t frame_self = 0;
+		uint64_t frame_total = 0;
+		uint64_t last_frame_self = 0;
+		uint64_t last_frame_total = 0;
+	};
+
+	static GDScriptSampler *active;
+
+	// Shadow stack, written by the main thread only. version is odd while it is
+	// being written, the sampling thread discards copies that overlap a write.
+	Frame *frames = nullptr;
+	int max_depth = 0;
+	int depth = 0;
+	std::atomic<uint32_t> version;
+
+	Thread thread;
+	SafeFlag exit_thread;
+	uint32_t interval_usec = 1000;
+
+	// Guards everything below. The sampling thread holds it while copying the
+	// stack, so a function can't be freed between being sampled and flushed.
+	Mutex mutex;
+	LocalVector<Frame> sample_frames;
+	LocalVector<Sample> samples;
+	uint64_t sample_count = 0;
+	uint64_t dropped_count = 0;
+
+	HashMap<uint64_t, FunctionInfo> function_info; // By function address, entries are erased when the function is freed.
+	HashMap<StringName, Stats> function_stats; // By signature.
+	HashMap<String, uint64_t> stacks;
+	HashMap<String, uint64_t> frame_stacks;
+	Array last_frame_stacks;
+
+	_FORCE_INLINE_ void _begin_write() {
+		version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	_FORCE_INLINE_ void _end_write() {
+		version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	static void _thread_func(void *p_sampler);
+	void _take_sample();
+	const FunctionInfo &_get_function_info(const GDScriptFunction *p_function);
+	static MethodBind *_get_native_bind(const Variant &p_base, const StringName &p_method);
+	static String _get_native_label(const Frame &p_frame, bool &r_bound);
+	void _flush();
+
+public:
+	// Non-null while sampling. The interpreter checks this on every call.
+	_FORCE_INLINE_ static GDScriptSampler *get_active() { return active; }
+
+	// Called by the interpreter when p_function starts running. Returns the stack
+	// slot to pass to the other calls, or -1 if this call isn't sampled.
+	_FORCE_INLINE_ int enter(const GDScriptFunction *p_function) {
+		if (Thread::get_caller_id() != Thread::get_main_id() || depth >= max_depth) {
+			return -1;
+		}
+		_begin_write();
+		Frame &frame = frames[depth];
+		frame.function = p_function;
+		frame.native_bind = nullptr;
+		frame.native_method = nullptr;
+		frame.native_function = nullptr;
+		int slot = depth++;
+		_end_write();
+		return slot;
+	}
+
+	// Pops the slot and anything left above it. A slot pushed before a restart
+	// doesn't touch the stack of the new session.
+	_FORCE_INLINE_ void exit(int p_slot) {
+		if (p_slot > depth) {
+			return;
+		}
+		_begin_write();
+		depth = p_slot;
+		_end_write();
+	}
+
+	_FORCE_INLINE_ void set_native_method(int p_slot, const Variant &p_base, const StringName *p_method) {
+		if (p_slot >= depth) {
+			return;
+		}
+		MethodBind *bind = _get_native_bind(p_base, *p_method);
+		_begin_write();
+		Frame &frame = frames[p_slot];
+		frame.native_bind = bind;
+		frame.native_method = p_method;
+		frame.native_type = p_base.get_type();
+		_end_write();
+	}
+
+	_FORCE_INLINE_ void set_native_function(int p_slot, const char *p_function) {
+		if (p_slot >= depth) {
+			return;
+		}
+		_begin_write();
+		frames[p_slot].native_function = p_function;
+		_end_write();
+	}
+
+	_FORCE_INLINE_ void clear_native(int p_slot) {
+		if (p_slot >= depth) {
+			return;
+		}
+		_begin_write();
+		Frame &frame = frames[p_slot];
+		frame.native_bind = nullptr;
+		frame.native_method = nullptr;
+		frame.native_function = nullptr;
+		_end_write();
+	}
+
+	// Starting clears what a previous session collected. Must be called from the main thread.
+	void start(uint32_t p_interval_usec, int p_max_depth);
+	void stop();
+	bool is_running() const { return active == this; }
+	uint32_t get_interval_usec() const { return interval_usec; }
+
+	// Resolves the pending samples. Called every frame, and before a function is freed.
+	void flush();
+	void function_freed(const GDScriptFunction *p_function);
+	// Flushes and starts a new frame, the previous one is what the get_frame_*() functions return.
+	void frame();
+
+	int get_accumulated_data(ScriptLanguage::ProfilingInfo *p_info_arr, int p_info_max);
+	int get_frame_data(ScriptLanguage::ProfilingInfo *p_info_arr, int p_info_max);
+	// Folded stacks of the last frame, as [stack, samples, stack, samples, ...].
+	Array get_frame_stacks();
+
+	uint64_t get_sample_count();
+	uint64_t get_dropped_count();
+	// Writes the folded stacks of the whole session, one "frame;frame;frame samples" line per stack.
+	Error save_folded_stacks(const String &p_path);
+
+	GDScriptSampler();
+	~GDScriptSampler();
+};
+
+#endif // GDSCRIPT_SAMPLER_H
@@ -35,6 +35,9 @@
 #include "core/os/dir_access.h"
 #include "core/os/file_access.h"
 #include "gdscript.h"
+#include "gdscript_bytecode.h"
+#include "gdscript_compiler.h"
+#include "gdscript_parser.h"
 #include "gdscript_tokenizer.h"
 
 GDScriptLanguage *script_language_gd = nullptr;
@@ -56,7 +59,36 @@ Ref<ResourceFormatSaverGDScript> resource_saver_gd;
 class EditorExportGDScript : public EditorExportPlugin {
 	GDCLASS(EditorExportGDScript, EditorExportPlugin);
 
+	bool debug;
+
+	Error _precompile(const String &p_source, const String &p_path, Vector<uint8_t> &r_compiled) {
+		// Compile a separate copy, the one loaded in the editor may be out of
+		// date, and release exports want optimized code without debug opcodes.
+		Ref<GDScript> script;
+		script.instance();
+
+		GDScriptParser parser;
+		Error err = parser.parse(p_source, p_path.get_base_dir(), false, p_path);
+		if (err != OK) {
+			return err;
+		}
+
+		GDScriptCompiler compiler;
+		compiler.set_debug_opcodes_enabled(debug);
+		compiler.set_optimizations_enabled(!debug);
+		err = compiler.compile(&parser, script.ptr());
+		if (err != OK) {
+			return err;
+		}
+
+		return GDScriptBytecode::serialize(script.ptr(), p_path, r_compiled);
+	}
+
 public:
+	virtual void _export_begin(const Set<String> &p_features, bool p_debug, const String &p_path, int p_flags) {
+		debug = p_debug;
+	}
+
 	virtual void _export_file(const String &p_path, const String &p_type, const Set<String> &p_features) {
 		int script_mode = EditorExportPreset::MODE_SCRIPT_COMPILED;
 		String script_key;
@@ -82,6 +114,15 @@ public:
 		file = GDScriptTokenizerBuffer::parse_code_string(txt);
 
 		if (!file.empty()) {
+			// The tokens stay in the file, they are used when the compiled
+			// code can't be (different engine build, or running with a debugger).
+			Vector<uint8_t> compiled;
+			if (_precompile(txt, p_path, compiled) == OK) {
+				file = GDScriptBytecode::make_container(file, compiled);
+			} else {
+				WARN_PRINT("Couldn't precompile '" + p_path + "', it will be compiled when loaded.");
+			}
+
 			if (script_mode == EditorExportPreset::MODE_SCRIPT_ENCRYPTED) {
 				String tmp_path = EditorSettings::get_singleton()->get_cache_dir().plus_file("script.gde");
 				FileAccess *fa = FileAccess::open(tmp_path, FileAccess::WRITE);
@@ -131,6 +172,10 @@ public:
 			}
 		}
 	}
+
+	EditorExportGDScript() {
+		debug = true;
+	}
 };
 
 static void _editor_init() {
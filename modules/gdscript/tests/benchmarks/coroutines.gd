@@ -0,0 +1,68 @@
+extends Reference
+
+# Many coroutines yielding and resuming at once. Each yield takes a stack frame
+# from the GDScriptFunctionState frame pool. Yields on signals, timers included,
+# are one-shot connections, resumed in the order the signal calls its targets.
+
+const COROUTINES = 10000
+const ROUNDS = 10
+
+var resumed = 0
+
+
+class Emitter:
+	signal tick
+
+
+func _wait_resume(rounds):
+	for i in range(rounds):
+		yield()
+		resumed += 1
+
+
+func _wait_signal(emitter, rounds):
+	for i in range(rounds):
+		yield(emitter, "tick")
+		resumed += 1
+
+
+func _wait_timer(tree, rounds):
+	for i in range(rounds):
+		yield(tree.create_timer(0.0), "timeout")
+		resumed += 1
+
+
+func bench_yield_resume():
+	resumed = 0
+	var states = []
+	for i in range(COROUTINES):
+		states.append(_wait_resume(ROUNDS))
+	for r in range(ROUNDS):
+		for i in range(COROUTINES):
+			states[i] = states[i].resume()
+	return resumed
+
+
+func bench_yield_signal():
+	resumed = 0
+	var emitter = Emitter.new()
+	for i in range(COROUTINES):
+		_wait_signal(emitter, ROUNDS)
+	for r in range(ROUNDS):
+		emitter.emit_signal("tick")
+	return resumed
+
+
+func bench_yield_timer():
+	resumed = 0
+	var tree = SceneTree.new()
+	tree.init()
+	for i in range(COROUTINES):
+		_wait_timer(tree, ROUNDS)
+	# Timers created while timers are processed wait for the next frame, so
+	# every idle() resumes each coroutine once.
+	for r in range(ROUNDS):
+		tree.idle(0.016)
+	tree.finish()
+	tree.free()
+	return resumed
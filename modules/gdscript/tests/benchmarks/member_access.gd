@@ -0,0 +1,66 @@
+extends Reference
+
+# Named member, property and method access on other objects, which goes
+# through the inline caches of OPCODE_GET_NAMED, OPCODE_SET_NAMED and OPCODE_CALL.
+
+
+class Item:
+	var value = 0
+	var weight = 1.0
+
+	func get_total():
+		return value * weight
+
+
+class HeavyItem extends Item:
+	func get_total():
+		return value * weight * 2.0
+
+
+func bench_script_members():
+	var item = Item.new()
+	var total = 0
+	for i in range(200000):
+		item.value = i
+		total += item.value
+	return total
+
+
+func bench_script_methods():
+	var item = Item.new()
+	item.weight = 0.5
+	var total = 0.0
+	for i in range(200000):
+		item.value = i
+		total += item.get_total()
+	return total
+
+
+func bench_polymorphic_methods():
+	var items = [Item.new(), HeavyItem.new()]
+	var total = 0.0
+	for i in range(200000):
+		var item = items[i % 2]
+		item.value = i
+		total += item.get_total()
+	return total
+
+
+func bench_native_properties():
+	var res = Resource.new()
+	var total = 0
+	for i in range(200000):
+		res.resource_local_to_scene = i % 3 == 0
+		if res.resource_local_to_scene:
+			total += 1
+	return total
+
+
+func bench_native_methods():
+	var res = Resource.new()
+	var total = 0
+	for i in range(200000):
+		if res.is_local_to_scene():
+			total += 1
+		res.set_local_to_scene(i % 2 == 0)
+	return total
@@ -0,0 +1,73 @@
+# Integer and float loops of the kind AI and procedural generation code runs.
+#
+# Run with: godot --test gd_benchmark modules/gdscript/tests/benchmarks/numeric_loops.gd
+#
+# Every bench_*() function is compiled and timed twice, with the generic
+# Variant opcodes and with the typed ones, and both results must match.
+extends Reference
+
+const COUNT = 1000000
+
+
+func bench_int_arithmetic():
+	var total: int = 0
+	for i in range(COUNT):
+		total += i * 3 - (i % 7)
+	return total
+
+
+func bench_int_compare():
+	var below: int = 0
+	var limit: int = COUNT / 3
+	for i in range(COUNT):
+		if i < limit or i >= limit * 2:
+			below += 1
+	return below
+
+
+func bench_float_arithmetic():
+	var position: float = 0.0
+	var velocity: float = 1.0
+	var delta: float = 1.0 / 60.0
+	for i in range(COUNT):
+		velocity -= position * 0.5 * delta
+		position += velocity * delta
+	return position
+
+
+func bench_mixed_int_float():
+	var sum: float = 0.0
+	for i in range(1, COUNT):
+		sum += 1.0 / i
+	return sum
+
+
+func bench_nested_ranges():
+	var cells: int = 0
+	for x in range(1000):
+		for y in range(0, 2000, 2):
+			if (x ^ y) & 1 == 0:
+				cells += 1
+	return cells
+
+
+func bench_range_with_step():
+	var total: int = 0
+	var n: int = COUNT * 4
+	for i in range(n, 0, -4):
+		total += i
+	return total
+
+
+func bench_sieve():
+	var n: int = 200000
+	var composite = []
+	composite.resize(n)
+	var primes: int = 0
+	for i in range(2, n):
+		if composite[i]:
+			continue
+		primes += 1
+		for j in range(i * 2, n, i):
+			composite[j] = true
+	return primes
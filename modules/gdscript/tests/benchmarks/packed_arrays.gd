@@ -0,0 +1,70 @@
+# Simulation style loops over packed arrays, the unboxed storage for scalars
+# and vectors, plus the same indexing on a plain Array.
+#
+# Run with: godot --test gd_benchmark modules/gdscript/tests/benchmarks/packed_arrays.gd
+#
+# Every bench_*() function is compiled and timed twice, with the generic
+# Variant opcodes and with the typed ones, and both results must match.
+extends Reference
+
+const COUNT = 200000
+const STEPS = 5
+
+
+func bench_int_array_fill_sum():
+	var values := PoolIntArray()
+	values.resize(COUNT)
+	for i in range(COUNT):
+		values[i] = i * 3
+	var sum: int = 0
+	for v in values:
+		sum += v
+	return sum
+
+
+func bench_real_array_integrate():
+	var position := PoolRealArray()
+	var velocity := PoolRealArray()
+	position.resize(COUNT)
+	velocity.resize(COUNT)
+	for i in range(COUNT):
+		position[i] = 0.0
+		velocity[i] = i % 7
+	var delta: float = 1.0 / 60.0
+	for s in range(STEPS):
+		for i in range(COUNT):
+			velocity[i] -= 9.8 * delta
+			position[i] += velocity[i] * delta
+	return position[COUNT - 1]
+
+
+func bench_vector3_array_particles():
+	var position := PoolVector3Array()
+	var velocity := PoolVector3Array()
+	position.resize(COUNT)
+	velocity.resize(COUNT)
+	for i in range(COUNT):
+		position[i] = Vector3()
+		velocity[i] = Vector3(i % 3, 10, i % 5)
+	var gravity := Vector3(0, -9.8, 0)
+	var delta: float = 1.0 / 60.0
+	for s in range(STEPS):
+		for i in range(COUNT):
+			velocity[i] += gravity * delta
+			position[i] += velocity[i] * delta
+			if position[i].y < 0.0:
+				position[i].y = 0.0
+	var sum := Vector3()
+	for p in position:
+		sum += p
+	return sum
+
+
+func bench_array_index():
+	var values: Array = []
+	values.resize(COUNT)
+	for i in range(COUNT):
+		values[i] = i
+	for i in range(1, COUNT):
+		values[i] = values[i] + values[i - 1]
+	return values[COUNT - 1]
@@ -0,0 +1,49 @@
+# Vector2 and Vector3 math as used by steering and noise based generation.
+#
+# Run with: godot --test gd_benchmark modules/gdscript/tests/benchmarks/vector_math.gd
+#
+# Every bench_*() function is compiled and timed twice, with the generic
+# Variant opcodes and with the typed ones, and both results must match.
+extends Reference
+
+const COUNT = 500000
+
+
+func bench_vector2_steering():
+	var position := Vector2(0, 0)
+	var velocity := Vector2(1, 0)
+	var target := Vector2(100, 50)
+	var max_speed: float = 4.0
+	for i in range(COUNT):
+		var desired: Vector2 = (target - position) * 0.1
+		velocity += (desired - velocity) * 0.05
+		position += velocity / max_speed
+		if position.x > 200.0:
+			position.x = -200.0
+	return position
+
+
+func bench_vector2_components():
+	var p := Vector2(1, 2)
+	var sum: float = 0.0
+	for i in range(COUNT):
+		p.x = p.y * 0.5 + i
+		p.y = p.x * 0.25
+		sum += p.x - p.y
+	return sum
+
+
+func bench_vector3_integrate():
+	var position := Vector3()
+	var velocity := Vector3(0, 10, 0)
+	var gravity := Vector3(0, -9.8, 0)
+	var delta: float = 1.0 / 60.0
+	var bounces: int = 0
+	for i in range(COUNT):
+		velocity += gravity * delta
+		position += velocity * delta
+		if position.y < 0.0:
+			position.y = -position.y
+			velocity.y = -velocity.y * 0.9
+			bounces += 1
+	return bounces
@@ -1381,55 +1381,40 @@ bool VisualScriptInstance::has_method(const StringName &p_method) const {
 //#define VSDEBUG(m_text) print_line(m_text)
 #define VSDEBUG(m_text)
 
-void VisualScriptInstance::_dependency_step(VisualScriptNodeInstance *node, int p_pass, int *pass_stack, const Variant **input_args, Variant **output_args, Variant *variant_stack, Variant::CallError &r_error, String &error_str, VisualScriptNodeInstance **r_error_node) {
-	ERR_FAIL_COND(node->pass_idx == -1);
-
-	if (pass_stack[node->pass_idx] == p_pass) {
-		return;
-	}
-
-	pass_stack[node->pass_idx] = p_pass;
-
-	if (!node->dependencies.empty()) {
-		int dc = node->dependencies.size();
-		VisualScriptNodeInstance **deps = node->dependencies.ptrw();
-
-		for (int i = 0; i < dc; i++) {
-			_dependency_step(deps[i], p_pass, pass_stack, input_args, output_args, variant_stack, r_error, error_str, r_error_node);
-			if (r_error.error != Variant::CallError::CALL_OK) {
-				return;
-			}
+void VisualScriptInstance::_flatten_dependencies(VisualScriptNodeInstance *p_root, VisualScriptNodeInstance *p_node, LocalVector<VisualScriptNodeInstance *> &r_visited) {
+	// Post-order walk of the data dependencies, so every node steps after the nodes it reads from.
+	// Each node is visited once, even when several inputs (or a cycle) lead to it.
+	for (int i = 0; i < p_node->dependencies.size(); i++) {
+		VisualScriptNodeInstance *dep = p_node->dependencies[i];
+		if (r_visited.find(dep) != -1) {
+			continue;
 		}
+		r_visited.push_back(dep);
+		_flatten_dependencies(p_root, dep, r_visited);
+		p_root->dependency_steps.push_back(dep);
 	}
+}
 
-	for (int i = 0; i < node->input_port_count; i++) {
-		int index = node->input_ports[i] & VisualScriptNodeInstance::INPUT_MASK;
+_FORCE_INLINE_ void VisualScriptInstance::_setup_ports(VisualScriptNodeInstance *p_node, const Variant **r_input_args, Variant **r_output_args, Variant *p_variant_stack) {
+	for (int i = 0; i < p_node->input_port_count; i++) {
+		int index = p_node->input_ports[i] & VisualScriptNodeInstance::INPUT_MASK;
 
-		if (node->input_ports[i] & VisualScriptNodeInstance::INPUT_DEFAULT_VALUE_BIT) {
+		if (p_node->input_ports[i] & VisualScriptNodeInstance::INPUT_DEFAULT_VALUE_BIT) {
 			//is a default value (unassigned input port)
-			input_args[i] = &default_values[index];
+			r_input_args[i] = &default_values[index];
 		} else {
 			//regular temporary in stack
-			input_args[i] = &variant_stack[index];
+			r_input_args[i] = &p_variant_stack[index];
 		}
 	}
-	for (int i = 0; i < node->output_port_count; i++) {
-		output_args[i] = &variant_stack[node->output_ports[i]];
-	}
 
-	Variant *working_mem = node->working_mem_idx >= 0 ? &variant_stack[node->working_mem_idx] : (Variant *)nullptr;
-
-	node->step(input_args, output_args, VisualScriptNodeInstance::START_MODE_BEGIN_SEQUENCE, working_mem, r_error, error_str);
-	//ignore return
-	if (r_error.error != Variant::CallError::CALL_OK) {
-		*r_error_node = node;
+	for (int i = 0; i < p_node->output_port_count; i++) {
+		r_output_args[i] = &p_variant_stack[p_node->output_ports[i]];
 	}
 }
 
-Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p_stack, int p_stack_size, VisualScriptNodeInstance *p_node, int p_flow_stack_pos, int p_pass, bool p_resuming_yield, Variant::CallError &r_error) {
-	Map<StringName, Function>::Element *F = functions.find(p_method);
-	ERR_FAIL_COND_V(!F, Variant());
-	Function *f = &F->get();
+Variant VisualScriptInstance::_call_internal(const StringName &p_method, Function *p_function, void *p_stack, int p_stack_size, VisualScriptNodeInstance *p_node, int p_flow_stack_pos, bool p_resuming_yield, Variant::CallError &r_error) {
+	Function *f = p_function;
 
 	//this call goes separate, so it can e yielded and suspended
 	Variant *variant_stack = (Variant *)p_stack;
@@ -1438,7 +1423,7 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 	Variant **output_args = (Variant **)(input_args + max_input_args);
 	int flow_max = f->flow_stack_size;
 	int *flow_stack = flow_max ? (int *)(output_args + max_output_args) : (int *)nullptr;
-	int *pass_stack = flow_stack ? (int *)(flow_stack + flow_max) : (int *)nullptr;
+	VisualScriptNodeInstance *const *nodes = f->nodes.ptr();
 
 	String error_str;
 
@@ -1457,7 +1442,6 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 #endif
 
 	while (true) {
-		p_pass++; //increment pass
 		current_node_id = node->get_id();
 
 		VSDEBUG("==========AT NODE: " + itos(current_node_id) + " base: " + node->get_base_node()->get_class_name());
@@ -1474,53 +1458,36 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 			for (int i = 0; i < f->argument_count; i++) {
 				input_args[i] = &variant_stack[i];
 			}
+
+			for (int i = 0; i < node->output_port_count; i++) {
+				output_args[i] = &variant_stack[node->output_ports[i]];
+			}
 		} else {
-			//run dependencies first
+			//run dependencies first, they were flattened in create() so this is a plain loop
 
-			if (!node->dependencies.empty()) {
-				int dc = node->dependencies.size();
-				VisualScriptNodeInstance **deps = node->dependencies.ptrw();
+			uint32_t dc = node->dependency_steps.size();
+			for (uint32_t i = 0; i < dc; i++) {
+				VisualScriptNodeInstance *dep = node->dependency_steps[i];
 
-				for (int i = 0; i < dc; i++) {
-					_dependency_step(deps[i], p_pass, pass_stack, input_args, output_args, variant_stack, r_error, error_str, &node);
-					if (r_error.error != Variant::CallError::CALL_OK) {
-						error = true;
-						current_node_id = node->id;
-						break;
-					}
-				}
-			}
+				_setup_ports(dep, input_args, output_args, variant_stack);
+				Variant *dep_working_mem = dep->working_mem_idx >= 0 ? &variant_stack[dep->working_mem_idx] : (Variant *)nullptr;
 
-			if (!error) {
-				//setup input pointers normally
-				VSDEBUG("INPUT PORTS: " + itos(node->input_port_count));
-
-				for (int i = 0; i < node->input_port_count; i++) {
-					int index = node->input_ports[i] & VisualScriptNodeInstance::INPUT_MASK;
-
-					if (node->input_ports[i] & VisualScriptNodeInstance::INPUT_DEFAULT_VALUE_BIT) {
-						//is a default value (unassigned input port)
-						input_args[i] = &default_values[index];
-						VSDEBUG("\tPORT " + itos(i) + " DEFAULT VAL");
-					} else {
-						//regular temporary in stack
-						input_args[i] = &variant_stack[index];
-						VSDEBUG("PORT " + itos(i) + " AT STACK " + itos(index));
-					}
+				dep->step(input_args, output_args, VisualScriptNodeInstance::START_MODE_BEGIN_SEQUENCE, dep_working_mem, r_error, error_str);
+				//ignore return
+				if (r_error.error != Variant::CallError::CALL_OK) {
+					error = true;
+					node = dep;
+					current_node_id = node->id;
+					break;
 				}
 			}
-		}
-
-		if (error) {
-			break;
-		}
 
-		//setup output pointers
+			if (error) {
+				break;
+			}
 
-		VSDEBUG("OUTPUT PORTS: " + itos(node->output_port_count));
-		for (int i = 0; i < node->output_port_count; i++) {
-			output_args[i] = &variant_stack[node->output_ports[i]];
-			VSDEBUG("PORT " + itos(i) + " AT STACK " + itos(node->output_ports[i]));
+			VSDEBUG("INPUT PORTS: " + itos(node->input_port_count) + " OUTPUT PORTS: " + itos(node->output_port_count));
+			_setup_ports(node, input_args, output_args, variant_stack);
 		}
 
 		//do step
@@ -1575,7 +1542,6 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 				state->node = node;
 				state->flow_stack_pos = flow_stack_pos;
 				state->stack.resize(p_stack_size);
-				state->pass = p_pass;
 				memcpy(state->stack.ptrw(), p_stack, p_stack_size);
 				//step 2, run away, return directly
 				r_error.error = Variant::CallError::CALL_OK;
@@ -1655,7 +1621,7 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 
 		if (flow_stack) {
 			//update flow stack pos (may have changed)
-			flow_stack[flow_stack_pos] = current_node_id;
+			flow_stack[flow_stack_pos] = node->sequence_index;
 
 			//add stack push bit if requested
 			if (ret & VisualScriptNodeInstance::STEP_FLAG_PUSH_STACK_BIT) {
@@ -1672,7 +1638,7 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 
 				if (flow_stack_pos > 0) {
 					flow_stack_pos--;
-					node = instances[flow_stack[flow_stack_pos] & VisualScriptNodeInstance::FLOW_STACK_MASK];
+					node = nodes[flow_stack[flow_stack_pos] & VisualScriptNodeInstance::FLOW_STACK_MASK];
 					VSDEBUG("NEXT IS GO BACK");
 				} else {
 					VSDEBUG("NEXT IS GO BACK, BUT NO NEXT SO EXIT");
@@ -1688,9 +1654,9 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 					bool found = false;
 
 					for (int i = flow_stack_pos; i >= 0; i--) {
-						if ((flow_stack[i] & VisualScriptNodeInstance::FLOW_STACK_MASK) == next->get_id()) {
+						if ((flow_stack[i] & VisualScriptNodeInstance::FLOW_STACK_MASK) == next->sequence_index) {
 							flow_stack_pos = i; //roll back and remove bit
-							flow_stack[i] = next->get_id();
+							flow_stack[i] = next->sequence_index;
 							sequence_bits[next->sequence_index] = false;
 							found = true;
 						}
@@ -1718,7 +1684,7 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 					node = next;
 
 					flow_stack_pos++;
-					flow_stack[flow_stack_pos] = node->get_id();
+					flow_stack[flow_stack_pos] = node->sequence_index;
 
 					VSDEBUG("INCREASE FLOW STACK");
 				}
@@ -1731,7 +1697,7 @@ Variant VisualScriptInstance::_call_internal(const StringName &p_method, void *p
 				for (int i = flow_stack_pos; i >= 0; i--) {
 					VSDEBUG("FS " + itos(i) + " - " + itos(flow_stack[i]));
 					if (flow_stack[i] & VisualScriptNodeInstance::FLOW_STACK_PUSHED_BIT) {
-						node = instances[flow_stack[i] & VisualScriptNodeInstance::FLOW_STACK_MASK];
+						node = nodes[flow_stack[i] & VisualScriptNodeInstance::FLOW_STACK_MASK];
 						flow_stack_pos = i;
 						found = true;
 						break;
@@ -1821,7 +1787,6 @@ Variant VisualScriptInstance::call(const StringName &p_method, const Variant **p
 	total_stack_size += f->node_count * sizeof(bool);
 	total_stack_size += (max_input_args + max_output_args) * sizeof(Variant *); //arguments
 	total_stack_size += f->flow_stack_size * sizeof(int); //flow
-	total_stack_size += f->pass_stack_size * sizeof(int);
 
 	VSDEBUG("STACK SIZE: " + itos(total_stack_size));
 	VSDEBUG("STACK VARIANTS: : " + itos(f->max_stack));
@@ -1829,7 +1794,6 @@ Variant VisualScriptInstance::call(const StringName &p_method, const Variant **p
 	VSDEBUG("MAX INPUT: " + itos(max_input_args));
 	VSDEBUG("MAX OUTPUT: " + itos(max_output_args));
 	VSDEBUG("FLOW STACK SIZE: " + itos(f->flow_stack_size));
-	VSDEBUG("PASS STACK SIZE: " + itos(f->pass_stack_size));
 
 	void *stack = alloca(total_stack_size);
 
@@ -1839,14 +1803,11 @@ Variant VisualScriptInstance::call(const StringName &p_method, const Variant **p
 	Variant **output_args = (Variant **)(input_args + max_input_args);
 	int flow_max = f->flow_stack_size;
 	int *flow_stack = flow_max ? (int *)(output_args + max_output_args) : (int *)nullptr;
-	int *pass_stack = flow_stack ? (int *)(flow_stack + flow_max) : (int *)nullptr;
 
 	for (int i = 0; i < f->node_count; i++) {
 		sequence_bits[i] = false; //all starts as false
 	}
 
-	memset(pass_stack, 0, f->pass_stack_size * sizeof(int));
-
 	Map<int, VisualScriptNodeInstance *>::Element *E = instances.find(f->node);
 	if (!E) {
 		r_error.error = Variant::CallError::CALL_ERROR_INVALID_METHOD;
@@ -1857,7 +1818,7 @@ Variant VisualScriptInstance::call(const StringName &p_method, const Variant **p
 	VisualScriptNodeInstance *node = E->get();
 
 	if (flow_stack) {
-		flow_stack[0] = node->get_id();
+		flow_stack[0] = node->sequence_index;
 	}
 
 	VSDEBUG("ARGUMENTS: " + itos(f->argument_count) = " RECEIVED: " + itos(p_argcount));
@@ -1886,7 +1847,7 @@ Variant VisualScriptInstance::call(const StringName &p_method, const Variant **p
 		variant_stack[i] = *p_args[i];
 	}
 
-	return _call_internal(p_method, stack, total_stack_size, node, 0, 0, false, r_error);
+	return _call_internal(p_method, f, stack, total_stack_size, node, 0, false, r_error);
 }
 
 void VisualScriptInstance::notification(int p_notification) {
@@ -1990,7 +1951,6 @@ void VisualScriptInstance::create(const Ref<VisualScript> &p_script, Object *p_o
 		function.node = E->get().function_id;
 		function.max_stack = 0;
 		function.flow_stack_size = 0;
-		function.pass_stack_size = 0;
 		function.node_count = 0;
 
 		Map<StringName, int> local_var_indices;
@@ -2035,7 +1995,6 @@ void VisualScriptInstance::create(const Ref<VisualScript> &p_script, Object *p_o
 			instance->sequence_output_count = node->get_output_sequence_port_count();
 			instance->sequence_index = function.node_count++;
 			instance->sequence_outputs = nullptr;
-			instance->pass_idx = -1;
 
 			if (instance->input_port_count) {
 				instance->input_ports = memnew_arr(int, instance->input_port_count);
@@ -2088,6 +2047,7 @@ void VisualScriptInstance::create(const Ref<VisualScript> &p_script, Object *p_o
 			max_output_args = MAX(max_output_args, instance->output_port_count);
 
 			instances[F->key()] = instance;
+			function.nodes.push_back(instance);
 		}
 
 		function.trash_pos = function.max_stack++; //create pos for trash
@@ -2110,10 +2070,6 @@ void VisualScriptInstance::create(const Ref<VisualScript> &p_script, Object *p_o
 
 			if (from->get_sequence_output_count() == 0 && to->dependencies.find(from) == -1) {
 				//if the node we are reading from has no output sequence, we must call step() before reading from it.
-				if (from->pass_idx == -1) {
-					from->pass_idx = function.pass_stack_size;
-					function.pass_stack_size++;
-				}
 				to->dependencies.push_back(from);
 			}
 
@@ -2133,6 +2089,14 @@ void VisualScriptInstance::create(const Ref<VisualScript> &p_script, Object *p_o
 			from->sequence_outputs[sc.from_output] = to;
 		}
 
+		//flatten the dependencies of each node into the list of steps to run before it,
+		//so calling the function does not have to walk the data graph every time
+
+		for (uint32_t i = 0; i < function.nodes.size(); i++) {
+			LocalVector<VisualScriptNodeInstance *> visited;
+			_flatten_dependencies(function.nodes[i], function.nodes[i], visited);
+		}
+
 		//fourth pass:
 		// 1) unassigned input ports to default values
 		// 2) connect unassigned output ports to trash
@@ -2185,6 +2149,15 @@ VisualScriptInstance::~VisualScriptInstance() {
 
 /////////////////////
 
+Variant VisualScriptFunctionState::_resume(Variant::CallError &r_error) {
+	Map<StringName, VisualScriptInstance::Function>::Element *F = instance->functions.find(function);
+	ERR_FAIL_COND_V(!F, Variant());
+
+	Variant ret = instance->_call_internal(function, &F->get(), stack.ptrw(), stack.size(), node, flow_stack_pos, true, r_error);
+	function = StringName(); //invalidate
+	return ret;
+}
+
 Variant VisualScriptFunctionState::_signal_callback(const Variant **p_args, int p_argcount, Variant::CallError &r_error) {
 	ERR_FAIL_COND_V(function == StringName(), Variant());
 
@@ -2226,9 +2199,7 @@ Variant VisualScriptFunctionState::_signal_callback(const Variant **p_args, int
 
 	*working_mem = args; //arguments go to working mem.
 
-	Variant ret = instance->_call_internal(function, stack.ptrw(), stack.size(), node, flow_stack_pos, pass, true, r_error);
-	function = StringName(); //invalidate
-	return ret;
+	return _resume(r_error);
 }
 
 void VisualScriptFunctionState::connect_to_signal(Object *p_obj, const String &p_signal, Array p_binds) {
@@ -2261,9 +2232,7 @@ Variant VisualScriptFunctionState::resume(Array p_args) {
 
 	*working_mem = p_args; //arguments go to working mem.
 
-	Variant ret = instance->_call_internal(function, stack.ptrw(), stack.size(), node, flow_stack_pos, pass, true, r_error);
-	function = StringName(); //invalidate
-	return ret;
+	return _resume(r_error);
 }
 
 void VisualScriptFunctionState::_bind_methods() {
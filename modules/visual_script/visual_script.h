@@ -31,6 +31,7 @@
 #ifndef VISUAL_SCRIPT_H
 #define VISUAL_SCRIPT_H
 
+#include "core/local_vector.h"
 #include "core/os/thread.h"
 #include "core/script_language.h"
 
@@ -116,12 +117,12 @@ class VisualScriptNodeInstance {
 	VisualScriptNodeInstance **sequence_outputs;
 	int sequence_output_count;
 	Vector<VisualScriptNodeInstance *> dependencies;
+	LocalVector<VisualScriptNodeInstance *> dependency_steps; // all dependencies, flattened in the order they must step
 	int *input_ports;
 	int input_port_count;
 	int *output_ports;
 	int output_port_count;
 	int working_mem_idx;
-	int pass_idx;
 
 	VisualScriptNode *base;
 
@@ -376,9 +377,9 @@ class VisualScriptInstance : public ScriptInstance {
 		int max_stack;
 		int trash_pos;
 		int flow_stack_size;
-		int pass_stack_size;
 		int node_count;
 		int argument_count;
+		LocalVector<VisualScriptNodeInstance *> nodes; // indexed by sequence_index, which is what the flow stack stores
 	};
 
 	Map<StringName, Function> functions;
@@ -388,8 +389,9 @@ class VisualScriptInstance : public ScriptInstance {
 
 	StringName source;
 
-	void _dependency_step(VisualScriptNodeInstance *node, int p_pass, int *pass_stack, const Variant **input_args, Variant **output_args, Variant *variant_stack, Variant::CallError &r_error, String &error_str, VisualScriptNodeInstance **r_error_node);
-	Variant _call_internal(const StringName &p_method, void *p_stack, int p_stack_size, VisualScriptNodeInstance *p_node, int p_flow_stack_pos, int p_pass, bool p_resuming_yield, Variant::CallError &r_error);
+	static void _flatten_dependencies(VisualScriptNodeInstance *p_root, VisualScriptNodeInstance *p_node, LocalVector<VisualScriptNodeInstance *> &r_visited);
+	_FORCE_INLINE_ void _setup_ports(VisualScriptNodeInstance *p_node, const Variant **r_input_args, Variant **r_output_args, Variant *p_variant_stack);
+	Variant _call_internal(const StringName &p_method, Function *p_function, void *p_stack, int p_stack_size, VisualScriptNodeInstance *p_node, int p_flow_stack_pos, bool p_resuming_yield, Variant::CallError &r_error);
 
 	//Map<StringName,Function> functions;
 	friend class VisualScriptFunctionState; //for yield
@@ -455,8 +457,8 @@ class VisualScriptFunctionState : public Reference {
 	int variant_stack_size;
 	VisualScriptNodeInstance *node;
 	int flow_stack_pos;
-	int pass;
 
+	Variant _resume(Variant::CallError &r_error);
 	Variant _signal_callback(const Variant **p_args, int p_argcount, Variant::CallError &r_error);
 
 protected:
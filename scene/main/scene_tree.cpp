@@ -38,6 +38,7 @@
 #include "core/os/os.h"
 #include "core/print_string.h"
 #include "core/project_settings.h"
+#include "core/trace_profiler.h"
 #include "main/input_default.h"
 #include "node.h"
 #include "scene/debugger/script_debugger_remote.h"
@@ -474,6 +475,8 @@ void SceneTree::init() {
 }
 
 bool SceneTree::iteration(float p_time) {
+	TRACE_SCOPE("scene", "SceneTree::iteration");
+
 	root_lock++;
 
 	current_frame++;
@@ -512,6 +515,8 @@ void SceneTree::_update_font_oversampling(float p_ratio) {
 }
 
 bool SceneTree::idle(float p_time) {
+	TRACE_SCOPE("scene", "SceneTree::idle");
+
 	//print_line("ram: "+itos(OS::get_singleton()->get_static_memory_usage())+" sram: "+itos(OS::get_singleton()->get_dynamic_memory_usage()));
 	//print_line("node count: "+itos(get_node_count()));
 	//print_line("TEXTURE RAM: "+itos(VS::get_singleton()->get_render_info(VS::INFO_TEXTURE_MEM_USED)));
@@ -33,6 +33,7 @@
 #include "core/crypto/crypto_core.h"
 #include "core/local_vector.h"
 #include "core/math/convex_hull.h"
+#include "core/math/mesh_simplifier.h"
 #include "core/pair.h"
 #include "scene/resources/concave_polygon_shape.h"
 #include "scene/resources/convex_polygon_shape.h"
@@ -654,6 +655,22 @@ bool ArrayMesh::_set(const StringName &p_name, const Variant &p_value) {
 		if (d.has("name")) {
 			surface_set_name(idx, d["name"]);
 		}
+		if (d.has("lods")) {
+			// pairs of error and index array
+			Array lod_data = d["lods"];
+			ERR_FAIL_COND_V(lod_data.size() % 2 != 0, false);
+			int index_size = VS::get_singleton()->mesh_surface_get_array_len(mesh, idx) < (1 << 16) ? 2 : 4;
+
+			Vector<VS::SurfaceLOD> lods;
+			for (int i = 0; i < lod_data.size(); i += 2) {
+				VS::SurfaceLOD lod;
+				lod.error = lod_data[i];
+				lod.index_array = lod_data[i + 1];
+				lod.index_count = lod.index_array.size() / index_size;
+				lods.push_back(lod);
+			}
+			VS::get_singleton()->mesh_surface_set_lods(mesh, idx, lods);
+		}
 
 		return true;
 	}
@@ -725,6 +742,16 @@ bool ArrayMesh::_get(const StringName &p_name, Variant &r_ret) const {
 
 	d["blend_shape_data"] = md;
 
+	Vector<VS::SurfaceLOD> lods = VS::get_singleton()->mesh_surface_get_lods(mesh, idx);
+	if (lods.size()) {
+		Array lod_data;
+		for (int i = 0; i < lods.size(); i++) {
+			lod_data.push_back(lods[i].error);
+			lod_data.push_back(lods[i].index_array);
+		}
+		d["lods"] = lod_data;
+	}
+
 	Ref<Material> m = surface_get_material(idx);
 	if (m.is_valid()) {
 		d["material"] = m;
@@ -1043,6 +1070,69 @@ void ArrayMesh::regen_normalmaps() {
 	}
 }
 
+void ArrayMesh::generate_lods() {
+	for (int i = 0; i < surfaces.size(); i++) {
+		if (surface_get_primitive_type(i) != PRIMITIVE_TRIANGLES || !(surface_get_format(i) & ARRAY_FORMAT_INDEX) || surfaces[i].is_2d) {
+			continue;
+		}
+
+		Array arrays = surface_get_arrays(i);
+		PoolVector<Vector3> vertices = arrays[ARRAY_VERTEX];
+		PoolVector<int> indices = arrays[ARRAY_INDEX];
+		int index_size = vertices.size() < (1 << 16) ? 2 : 4;
+
+		// anything coarser than this is not worth keeping, it would pop when switching
+		real_t max_error = surfaces[i].aabb.get_longest_axis_size() * 0.1;
+
+		Vector<VS::SurfaceLOD> lods;
+		PoolVector<int> current = indices;
+		while (current.size() >= 6 * 3) {
+			real_t error = 0;
+			PoolVector<int> simplified = MeshSimplifier::simplify(vertices, indices, current.size() / 2, max_error, &error);
+			if (simplified.size() == 0 || simplified.size() > current.size() * 4 / 5) {
+				break; // stalled on locked borders and seams, or hit the error limit
+			}
+
+			VS::SurfaceLOD lod;
+			lod.error = error;
+			lod.index_count = simplified.size();
+			lod.index_array.resize(simplified.size() * index_size);
+			{
+				PoolVector<int>::Read r = simplified.read();
+				PoolVector<uint8_t>::Write w = lod.index_array.write();
+				for (int j = 0; j < simplified.size(); j++) {
+					if (index_size == 2) {
+						uint16_t v = r[j];
+						memcpy(&w[j * 2], &v, 2);
+					} else {
+						uint32_t v = r[j];
+						memcpy(&w[j * 4], &v, 4);
+					}
+				}
+			}
+			lods.push_back(lod);
+			current = simplified;
+		}
+
+		VS::get_singleton()->mesh_surface_set_lods(mesh, i, lods);
+	}
+
+	emit_changed();
+}
+
+void ArrayMesh::clear_lods() {
+	for (int i = 0; i < surfaces.size(); i++) {
+		VS::get_singleton()->mesh_surface_set_lods(mesh, i, Vector<VS::SurfaceLOD>());
+	}
+
+	emit_changed();
+}
+
+int ArrayMesh::surface_get_lod_count(int p_idx) const {
+	ERR_FAIL_INDEX_V(p_idx, surfaces.size(), 0);
+	return VS::get_singleton()->mesh_surface_get_lods(mesh, p_idx).size();
+}
+
 //dirty hack
 bool (*array_mesh_lightmap_unwrap_callback)(float p_texel_size, const float *p_vertices, const float *p_normals, int p_vertex_count, const int *p_indices, const int *p_face_materials, int p_index_count, float **r_uv, int **r_vertex, int *r_vertex_count, int **r_index, int *r_index_count, int *r_size_hint_x, int *r_size_hint_y) = nullptr;
 
@@ -1401,6 +1491,9 @@ void ArrayMesh::_bind_methods() {
 	ClassDB::set_method_flags(get_class_static(), _scs_create("regen_normalmaps"), METHOD_FLAGS_DEFAULT | METHOD_FLAG_EDITOR);
 	ClassDB::bind_method(D_METHOD("lightmap_unwrap", "transform", "texel_size"), &ArrayMesh::lightmap_unwrap);
 	ClassDB::set_method_flags(get_class_static(), _scs_create("lightmap_unwrap"), METHOD_FLAGS_DEFAULT | METHOD_FLAG_EDITOR);
+	ClassDB::bind_method(D_METHOD("generate_lods"), &ArrayMesh::generate_lods);
+	ClassDB::bind_method(D_METHOD("clear_lods"), &ArrayMesh::clear_lods);
+	ClassDB::bind_method(D_METHOD("surface_get_lod_count", "surf_idx"), &ArrayMesh::surface_get_lod_count);
 	ClassDB::bind_method(D_METHOD("get_faces"), &ArrayMesh::get_faces);
 	ClassDB::bind_method(D_METHOD("generate_triangle_mesh"), &ArrayMesh::generate_triangle_mesh);
 
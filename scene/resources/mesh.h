@@ -233,6 +233,10 @@ public:
 
 	void regen_normalmaps();
 
+	void generate_lods();
+	void clear_lods();
+	int surface_get_lod_count(int p_idx) const;
+
 	Error lightmap_unwrap(const Transform &p_base_transform = Transform(), float p_texel_size = 0.05);
 	Error lightmap_unwrap_cached(int *&r_cache_data, unsigned int &r_cache_size, bool &r_used_cache, const Transform &p_base_transform = Transform(), float p_texel_size = 0.05);
 
@@ -34,6 +34,7 @@
 #include "core/os/file_access.h"
 #include "core/os/os.h"
 #include "core/project_settings.h"
+#include "core/trace_profiler.h"
 #include "scene/resources/audio_stream_sample.h"
 #include "servers/audio/audio_driver_dummy.h"
 #include "servers/audio/effects/audio_effect_compressor.h"
@@ -295,6 +296,8 @@ void AudioServer::_driver_process(int p_frames, int32_t *p_buffer) {
 }
 
 void AudioServer::_mix_step() {
+	TRACE_SCOPE("audio", "AudioServer::_mix_step");
+
 	bool solo_mode = false;
 
 	for (int i = 0; i < buses.size(); i++) {
@@ -36,6 +36,7 @@
 #include "core/os/os.h"
 #include "core/project_settings.h"
 #include "core/script_language.h"
+#include "core/trace_profiler.h"
 #include "joints/cone_twist_joint_sw.h"
 #include "joints/generic_6dof_joint_sw.h"
 #include "joints/hinge_joint_sw.h"
@@ -1296,6 +1297,7 @@ void PhysicsServerSW::init() {
 
 void PhysicsServerSW::step(real_t p_step) {
 #ifndef _3D_DISABLED
+	TRACE_SCOPE("physics", "PhysicsServerSW::step");
 
 	if (!active) {
 		return;
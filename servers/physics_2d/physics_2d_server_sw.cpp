@@ -36,6 +36,7 @@
 #include "core/os/os.h"
 #include "core/project_settings.h"
 #include "core/script_language.h"
+#include "core/trace_profiler.h"
 
 #define FLUSH_QUERY_CHECK(m_object) \
 	ERR_FAIL_COND_MSG(m_object->get_space() && flushing_queries, "Can't change this state while flushing queries. Use call_deferred() or set_deferred() to change monitoring state instead.");
@@ -1212,6 +1213,8 @@ void Physics2DServerSW::init() {
 };
 
 void Physics2DServerSW::step(real_t p_step) {
+	TRACE_SCOPE("physics", "Physics2DServerSW::step");
+
 	if (!active) {
 		return;
 	}
@@ -213,6 +213,9 @@ public:
 		return _tracer.occlusion_cull(*this, p_point, p_convex, p_result_array, p_num_results);
 	}
 
+	// when false, occlusion_cull() leaves the results untouched
+	bool is_occlusion_culling_active() const { return _occluder_pool.active_size() && use_occlusion_culling; }
+
 	bool is_active() const { return _active && _loaded; }
 
 	VSStatic &get_static(int p_id) { return _statics[p_id]; }
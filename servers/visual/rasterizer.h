@@ -113,6 +113,7 @@ public:
 		bool redraw_if_visible : 4;
 
 		float depth; //used for sorting
+		float lod_max_error; //largest mesh LOD error allowed, in mesh units, negative draws full detail
 
 		SelfList<InstanceBase> dependency_item;
 
@@ -132,6 +133,7 @@ public:
 			visible = true;
 			depth_layer = 0;
 			layer_mask = 1;
+			lod_max_error = -1;
 			baked_light = false;
 			redraw_if_visible = false;
 			lightmap_capture = nullptr;
@@ -305,6 +307,9 @@ public:
 	virtual Vector<PoolVector<uint8_t>> mesh_surface_get_blend_shapes(RID p_mesh, int p_surface) const = 0;
 	virtual Vector<AABB> mesh_surface_get_skeleton_aabb(RID p_mesh, int p_surface) const = 0;
 
+	virtual void mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<VS::SurfaceLOD> &p_lods) = 0;
+	virtual Vector<VS::SurfaceLOD> mesh_surface_get_lods(RID p_mesh, int p_surface) const = 0;
+
 	virtual void mesh_remove_surface(RID p_mesh, int p_index) = 0;
 	virtual int mesh_get_surface_count(RID p_mesh) const = 0;
 
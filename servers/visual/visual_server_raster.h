@@ -237,6 +237,9 @@ public:
 	BIND2RC(Vector<PoolVector<uint8_t>>, mesh_surface_get_blend_shapes, RID, int)
 	BIND2RC(Vector<AABB>, mesh_surface_get_skeleton_aabb, RID, int)
 
+	BIND3(mesh_surface_set_lods, RID, int, const Vector<SurfaceLOD> &)
+	BIND2RC(Vector<SurfaceLOD>, mesh_surface_get_lods, RID, int)
+
 	BIND2(mesh_remove_surface, RID, int)
 	BIND1RC(int, mesh_get_surface_count, RID)
 
@@ -31,6 +31,8 @@
 #include "visual_server_scene.h"
 
 #include "core/os/os.h"
+#include "core/os/worker_thread_pool.h"
+#include "core/trace_profiler.h"
 #include "visual_server_globals.h"
 #include "visual_server_raster.h"
 
@@ -120,6 +122,14 @@ void VisualServerScene::SpatialPartitioningScene_BVH::move(SpatialPartitionID p_
 	_bvh.move(p_handle - 1, p_aabb);
 }
 
+void VisualServerScene::SpatialPartitioningScene_BVH::move_batch(const SpatialPartitionID *p_handles, const AABB *p_aabbs, int p_count) {
+	_move_handles.resize(p_count);
+	for (int i = 0; i < p_count; i++) {
+		_move_handles[i] = p_handles[i] - 1;
+	}
+	_bvh.move_batch(_move_handles.ptr(), p_aabbs, p_count);
+}
+
 void VisualServerScene::SpatialPartitioningScene_BVH::activate(SpatialPartitionID p_handle, const AABB &p_aabb) {
 	// be very careful here, we are deferring the collision check, expecting a set_pairable to be called
 	// immediately after.
@@ -151,6 +161,10 @@ int VisualServerScene::SpatialPartitioningScene_BVH::cull_convex(const Vector<Pl
 	return _bvh.cull_convex(p_convex, p_result_array, p_result_max, p_mask);
 }
 
+int VisualServerScene::SpatialPartitioningScene_BVH::cull_convex_concurrent(const Vector<Plane> &p_convex, Instance **p_result_array, int p_result_max, uint32_t p_mask) {
+	return _bvh.cull_convex_concurrent(p_convex, p_result_array, p_result_max, p_mask);
+}
+
 int VisualServerScene::SpatialPartitioningScene_BVH::cull_aabb(const AABB &p_aabb, Instance **p_result_array, int p_result_max, int *p_subindex_array, uint32_t p_mask) {
 	return _bvh.cull_aabb(p_aabb, p_result_array, p_result_max, p_subindex_array, p_mask);
 }
@@ -211,8 +225,21 @@ void VisualServerScene::SpatialPartitioningScene_Octree::set_balance(float p_bal
 
 /* SCENARIO API */
 
+// Size of one probe in a reflection atlas. The rasterizer rounds the subdivision
+// up to a square grid with a power of 2 side, do the same here.
+static int _get_reflection_probe_resolution(int p_atlas_size, int p_subdiv) {
+	int subdiv = next_power_of_2(p_subdiv);
+	if (subdiv & 0xaaaaaaaa) {
+		subdiv <<= 1;
+	}
+	subdiv = int(Math::sqrt((float)subdiv));
+	return subdiv > 0 ? p_atlas_size / subdiv : p_atlas_size;
+}
+
 VisualServerScene::Scenario::Scenario() {
 	debug = VS::SCENARIO_DEBUG_DISABLED;
+	// scenarios of viewports with their own world never get an atlas size, use the defaults
+	reflection_probe_resolution = _get_reflection_probe_resolution(GLOBAL_GET("rendering/quality/reflections/atlas_size"), GLOBAL_GET("rendering/quality/reflections/atlas_subdiv"));
 
 	bool use_bvh_or_octree = GLOBAL_GET("rendering/quality/spatial_partitioning/use_bvh");
 
@@ -403,6 +430,7 @@ void VisualServerScene::scenario_set_reflection_atlas_size(RID p_scenario, int p
 	ERR_FAIL_COND(!scenario);
 	VSG::scene_render->reflection_atlas_set_size(scenario->reflection_atlas, p_size);
 	VSG::scene_render->reflection_atlas_set_subdivision(scenario->reflection_atlas, p_subdiv);
+	scenario->reflection_probe_resolution = _get_reflection_probe_resolution(p_size, p_subdiv);
 }
 
 /* INSTANCING API */
@@ -1528,6 +1556,22 @@ void VisualServerScene::instance_geometry_set_as_instance_lod(RID p_instance, RI
 }
 
 void VisualServerScene::_update_instance(Instance *p_instance) {
+	if (!_update_instance_base(p_instance)) {
+		return;
+	}
+
+	_update_instance_bounds(p_instance);
+
+	if (!p_instance->scenario) {
+		return;
+	}
+
+	_update_instance_spatial(p_instance);
+}
+
+// Lets whatever depends on the instance know it changed, returns false when it has nothing
+// to place in the scenario.
+bool VisualServerScene::_update_instance_base(Instance *p_instance) {
 	p_instance->version++;
 
 	if (p_instance->base_type == VS::INSTANCE_LIGHT) {
@@ -1556,7 +1600,7 @@ void VisualServerScene::_update_instance(Instance *p_instance) {
 	}
 
 	if (p_instance->aabb.has_no_surface()) {
-		return;
+		return false;
 	}
 
 	if ((1 << p_instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) {
@@ -1580,17 +1624,18 @@ void VisualServerScene::_update_instance(Instance *p_instance) {
 		}
 	}
 
-	p_instance->mirror = p_instance->transform.basis.determinant() < 0.0;
-
-	AABB new_aabb;
+	return true;
+}
 
-	new_aabb = p_instance->transform.xform(p_instance->aabb);
+// Only touches the instance itself, so it can run on several instances at once.
+void VisualServerScene::_update_instance_bounds(Instance *p_instance) {
+	p_instance->mirror = p_instance->transform.basis.determinant() < 0.0;
 
-	p_instance->transformed_aabb = new_aabb;
+	p_instance->transformed_aabb = p_instance->transform.xform(p_instance->aabb);
+}
 
-	if (!p_instance->scenario) {
-		return;
-	}
+void VisualServerScene::_update_instance_spatial(Instance *p_instance) {
+	const AABB &new_aabb = p_instance->transformed_aabb;
 
 	if (p_instance->spatial_partition_id == 0) {
 		uint32_t base_type = 1 << p_instance->base_type;
@@ -1934,14 +1979,38 @@ void VisualServerScene::_update_instance_lightmap_captures(Instance *p_instance)
 	p_instance->lightmap_capture_data.write[0].a = interior ? 0.0f : 1.0f;
 }
 
-bool VisualServerScene::_light_instance_update_shadow(Instance *p_instance, const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, RID p_shadow_atlas, Scenario *p_scenario) {
+VisualServerScene::ShadowCullPass &VisualServerScene::_add_shadow_cull_pass(ShadowCullPass::Type p_type, Instance *p_light, int p_pass) {
+	// passes are reused from frame to frame, so their result lists keep their memory
+	if (shadow_cull_pass_count == shadow_cull_passes.size()) {
+		shadow_cull_passes.resize(shadow_cull_pass_count + 1);
+	}
+
+	ShadowCullPass &pass = shadow_cull_passes[shadow_cull_pass_count++];
+	pass.type = p_type;
+	pass.light = p_light;
+	pass.pass = p_pass;
+	pass.from_point = false;
+	pass.restore_paraboloid = false;
+	pass.far = 0;
+	pass.split = 0;
+	pass.bias_scale = 1.0;
+	pass.found_items = false;
+	pass.animated_material_found = false;
+	pass.concurrent = false;
+	pass.result.clear();
+
+	pass.light_transform = p_light->transform;
+	pass.light_transform.orthonormalize(); //scale does not count on lights
+
+	return pass;
+}
+
+void VisualServerScene::_light_instance_add_shadow_passes(Instance *p_instance, const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, const ShadowCullPass *p_range) {
 	InstanceLightData *light = static_cast<InstanceLightData *>(p_instance->base_data);
 
 	Transform light_transform = p_instance->transform;
 	light_transform.orthonormalize(); //scale does not count on lights
 
-	bool animated_material_found = false;
-
 	switch (VSG::storage->light_get_type(p_instance->base)) {
 		case VS::LIGHT_DIRECTIONAL: {
 			float max_distance = p_cam_projection.get_z_far();
@@ -1954,45 +2023,10 @@ bool VisualServerScene::_light_instance_update_shadow(Instance *p_instance, cons
 
 			VS::LightDirectionalShadowDepthRangeMode depth_range_mode = VSG::storage->light_directional_get_shadow_depth_range_mode(p_instance->base);
 
-			if (depth_range_mode == VS::LIGHT_DIRECTIONAL_SHADOW_DEPTH_RANGE_OPTIMIZED) {
-				//optimize min/max
-				Vector<Plane> planes = p_cam_projection.get_projection_planes(p_cam_transform);
-				int cull_count = p_scenario->sps->cull_convex(planes, instance_shadow_cull_result, MAX_INSTANCE_CULL, VS::INSTANCE_GEOMETRY_MASK);
-				Plane base(p_cam_transform.origin, -p_cam_transform.basis.get_axis(2));
-				//check distance max and min
-
-				bool found_items = false;
-				float z_max = -1e20;
-				float z_min = 1e20;
-
-				for (int i = 0; i < cull_count; i++) {
-					Instance *instance = instance_shadow_cull_result[i];
-					if (!instance->visible || !((1 << instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) || !static_cast<InstanceGeometryData *>(instance->base_data)->can_cast_shadows) {
-						continue;
-					}
-
-					if (static_cast<InstanceGeometryData *>(instance->base_data)->material_is_animated) {
-						animated_material_found = true;
-					}
-
-					float max, min;
-					instance->transformed_aabb.project_range_in_plane(base, min, max);
-
-					if (max > z_max) {
-						z_max = max;
-					}
-
-					if (min < z_min) {
-						z_min = min;
-					}
-
-					found_items = true;
-				}
-
-				if (found_items) {
-					min_distance = MAX(min_distance, z_min);
-					max_distance = MIN(max_distance, z_max);
-				}
+			if (p_range && p_range->found_items) {
+				//optimize min/max, the range pass was culled with the camera frustum
+				min_distance = MAX(min_distance, p_range->z_min);
+				max_distance = MIN(max_distance, p_range->z_max);
 			}
 
 			float range = max_distance - min_distance;
@@ -2148,58 +2182,32 @@ bool VisualServerScene::_light_instance_update_shadow(Instance *p_instance, cons
 
 				//now that we now all ranges, we can proceed to make the light frustum planes, for culling octree
 
-				Vector<Plane> light_frustum_planes;
-				light_frustum_planes.resize(6);
+				ShadowCullPass &pass = _add_shadow_cull_pass(ShadowCullPass::TYPE_DIRECTIONAL_SPLIT, p_instance, i);
+
+				pass.planes.resize(6);
 
 				//right/left
-				light_frustum_planes.write[0] = Plane(x_vec, x_max);
-				light_frustum_planes.write[1] = Plane(-x_vec, -x_min);
+				pass.planes.write[0] = Plane(x_vec, x_max);
+				pass.planes.write[1] = Plane(-x_vec, -x_min);
 				//top/bottom
-				light_frustum_planes.write[2] = Plane(y_vec, y_max);
-				light_frustum_planes.write[3] = Plane(-y_vec, -y_min);
+				pass.planes.write[2] = Plane(y_vec, y_max);
+				pass.planes.write[3] = Plane(-y_vec, -y_min);
 				//near/far
-				light_frustum_planes.write[4] = Plane(z_vec, z_max + 1e6);
-				light_frustum_planes.write[5] = Plane(-z_vec, -z_min); // z_min is ok, since casters further than far-light plane are not needed
-
-				int cull_count = p_scenario->sps->cull_convex(light_frustum_planes, instance_shadow_cull_result, MAX_INSTANCE_CULL, VS::INSTANCE_GEOMETRY_MASK);
-
-				// a pre pass will need to be needed to determine the actual z-near to be used
-
-				Plane near_plane(light_transform.origin, -light_transform.basis.get_axis(2));
-
-				for (int j = 0; j < cull_count; j++) {
-					float min, max;
-					Instance *instance = instance_shadow_cull_result[j];
-					if (!instance->visible || !((1 << instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) || !static_cast<InstanceGeometryData *>(instance->base_data)->can_cast_shadows) {
-						cull_count--;
-						SWAP(instance_shadow_cull_result[j], instance_shadow_cull_result[cull_count]);
-						j--;
-						continue;
-					}
-
-					instance->transformed_aabb.project_range_in_plane(Plane(z_vec, 0), min, max);
-					instance->depth = near_plane.distance_to(instance->transform.origin);
-					instance->depth_layer = 0;
-					if (max > z_max) {
-						z_max = max;
-					}
-				}
-
-				{
-					CameraMatrix ortho_camera;
-					real_t half_x = (x_max_cam - x_min_cam) * 0.5;
-					real_t half_y = (y_max_cam - y_min_cam) * 0.5;
-
-					ortho_camera.set_orthogonal(-half_x, half_x, -half_y, half_y, 0, (z_max - z_min_cam));
-
-					Transform ortho_transform;
-					ortho_transform.basis = transform.basis;
-					ortho_transform.origin = x_vec * (x_min_cam + half_x) + y_vec * (y_min_cam + half_y) + z_vec * z_max;
-
-					VSG::scene_render->light_instance_set_shadow_transform(light->instance, ortho_camera, ortho_transform, 0, distances[i + 1], i, bias_scale);
-				}
-
-				VSG::scene_render->render_shadow(light->instance, p_shadow_atlas, i, (RasterizerScene::InstanceBase **)instance_shadow_cull_result, cull_count);
+				pass.planes.write[4] = Plane(z_vec, z_max + 1e6);
+				pass.planes.write[5] = Plane(-z_vec, -z_min); // z_min is ok, since casters further than far-light plane are not needed
+
+				// the culled casters push z_max further, the ortho camera is set up when rendering
+				pass.near_plane = Plane(light_transform.origin, -light_transform.basis.get_axis(2));
+				pass.transform = transform;
+				pass.split = distances[i + 1];
+				pass.bias_scale = bias_scale;
+				pass.x_min_cam = x_min_cam;
+				pass.x_max_cam = x_max_cam;
+				pass.y_min_cam = y_min_cam;
+				pass.y_max_cam = y_max_cam;
+				pass.z_min_cam = z_min_cam;
+				pass.z_min = z_min;
+				pass.z_max = z_max;
 			}
 
 		} break;
@@ -2213,36 +2221,20 @@ bool VisualServerScene::_light_instance_update_shadow(Instance *p_instance, cons
 					float radius = VSG::storage->light_get_param(p_instance->base, VS::LIGHT_PARAM_RANGE);
 
 					float z = i == 0 ? -1 : 1;
-					Vector<Plane> planes;
-					planes.resize(6);
-					planes.write[0] = light_transform.xform(Plane(Vector3(0, 0, z), radius));
-					planes.write[1] = light_transform.xform(Plane(Vector3(1, 0, z).normalized(), radius));
-					planes.write[2] = light_transform.xform(Plane(Vector3(-1, 0, z).normalized(), radius));
-					planes.write[3] = light_transform.xform(Plane(Vector3(0, 1, z).normalized(), radius));
-					planes.write[4] = light_transform.xform(Plane(Vector3(0, -1, z).normalized(), radius));
-					planes.write[5] = light_transform.xform(Plane(Vector3(0, 0, -z), 0));
-
-					int cull_count = p_scenario->sps->cull_convex(planes, instance_shadow_cull_result, MAX_INSTANCE_CULL, VS::INSTANCE_GEOMETRY_MASK);
-					Plane near_plane(light_transform.origin, light_transform.basis.get_axis(2) * z);
-
-					for (int j = 0; j < cull_count; j++) {
-						Instance *instance = instance_shadow_cull_result[j];
-						if (!instance->visible || !((1 << instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) || !static_cast<InstanceGeometryData *>(instance->base_data)->can_cast_shadows) {
-							cull_count--;
-							SWAP(instance_shadow_cull_result[j], instance_shadow_cull_result[cull_count]);
-							j--;
-						} else {
-							if (static_cast<InstanceGeometryData *>(instance->base_data)->material_is_animated) {
-								animated_material_found = true;
-							}
 
-							instance->depth = near_plane.distance_to(instance->transform.origin);
-							instance->depth_layer = 0;
-						}
-					}
-
-					VSG::scene_render->light_instance_set_shadow_transform(light->instance, CameraMatrix(), light_transform, radius, 0, i);
-					VSG::scene_render->render_shadow(light->instance, p_shadow_atlas, i, (RasterizerScene::InstanceBase **)instance_shadow_cull_result, cull_count);
+					ShadowCullPass &pass = _add_shadow_cull_pass(ShadowCullPass::TYPE_POSITIONAL, p_instance, i);
+					pass.planes.resize(6);
+					pass.planes.write[0] = light_transform.xform(Plane(Vector3(0, 0, z), radius));
+					pass.planes.write[1] = light_transform.xform(Plane(Vector3(1, 0, z).normalized(), radius));
+					pass.planes.write[2] = light_transform.xform(Plane(Vector3(-1, 0, z).normalized(), radius));
+					pass.planes.write[3] = light_transform.xform(Plane(Vector3(0, 1, z).normalized(), radius));
+					pass.planes.write[4] = light_transform.xform(Plane(Vector3(0, -1, z).normalized(), radius));
+					pass.planes.write[5] = light_transform.xform(Plane(Vector3(0, 0, -z), 0));
+
+					pass.near_plane = Plane(light_transform.origin, light_transform.basis.get_axis(2) * z);
+					pass.projection = CameraMatrix();
+					pass.transform = light_transform;
+					pass.far = radius;
 				}
 			} else { //shadow cube
 
@@ -2272,32 +2264,17 @@ bool VisualServerScene::_light_instance_update_shadow(Instance *p_instance, cons
 
 					Transform xform = light_transform * Transform().looking_at(view_normals[i], view_up[i]);
 
-					Vector<Plane> planes = cm.get_projection_planes(xform);
-
-					int cull_count = _cull_convex_from_point(p_scenario, light_transform.origin, planes, instance_shadow_cull_result, MAX_INSTANCE_CULL, light->previous_room_id_hint, VS::INSTANCE_GEOMETRY_MASK);
-
-					Plane near_plane(xform.origin, -xform.basis.get_axis(2));
-					for (int j = 0; j < cull_count; j++) {
-						Instance *instance = instance_shadow_cull_result[j];
-						if (!instance->visible || !((1 << instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) || !static_cast<InstanceGeometryData *>(instance->base_data)->can_cast_shadows) {
-							cull_count--;
-							SWAP(instance_shadow_cull_result[j], instance_shadow_cull_result[cull_count]);
-							j--;
-						} else {
-							if (static_cast<InstanceGeometryData *>(instance->base_data)->material_is_animated) {
-								animated_material_found = true;
-							}
-							instance->depth = near_plane.distance_to(instance->transform.origin);
-							instance->depth_layer = 0;
-						}
-					}
+					ShadowCullPass &pass = _add_shadow_cull_pass(ShadowCullPass::TYPE_POSITIONAL, p_instance, i);
+					pass.planes = cm.get_projection_planes(xform);
+					pass.from_point = true;
+					pass.near_plane = Plane(xform.origin, -xform.basis.get_axis(2));
+					pass.projection = cm;
+					pass.transform = xform;
+					pass.far = radius;
 
-					VSG::scene_render->light_instance_set_shadow_transform(light->instance, cm, xform, radius, 0, i);
-					VSG::scene_render->render_shadow(light->instance, p_shadow_atlas, i, (RasterizerScene::InstanceBase **)instance_shadow_cull_result, cull_count);
+					//restore the regular DP matrix after the last face
+					pass.restore_paraboloid = i == 5;
 				}
-
-				//restore the regular DP matrix
-				VSG::scene_render->light_instance_set_shadow_transform(light->instance, CameraMatrix(), light_transform, radius, 0, 0);
 			}
 
 		} break;
@@ -2308,32 +2285,158 @@ bool VisualServerScene::_light_instance_update_shadow(Instance *p_instance, cons
 			CameraMatrix cm;
 			cm.set_perspective(angle * 2.0, 1.0, 0.01, radius);
 
-			Vector<Plane> planes = cm.get_projection_planes(light_transform);
-			int cull_count = _cull_convex_from_point(p_scenario, light_transform.origin, planes, instance_shadow_cull_result, MAX_INSTANCE_CULL, light->previous_room_id_hint, VS::INSTANCE_GEOMETRY_MASK);
+			ShadowCullPass &pass = _add_shadow_cull_pass(ShadowCullPass::TYPE_POSITIONAL, p_instance, 0);
+			pass.planes = cm.get_projection_planes(light_transform);
+			pass.from_point = true;
+			pass.near_plane = Plane(light_transform.origin, -light_transform.basis.get_axis(2));
+			pass.projection = cm;
+			pass.transform = light_transform;
+			pass.far = radius;
 
-			Plane near_plane(light_transform.origin, -light_transform.basis.get_axis(2));
-			for (int j = 0; j < cull_count; j++) {
-				Instance *instance = instance_shadow_cull_result[j];
-				if (!instance->visible || !((1 << instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) || !static_cast<InstanceGeometryData *>(instance->base_data)->can_cast_shadows) {
-					cull_count--;
-					SWAP(instance_shadow_cull_result[j], instance_shadow_cull_result[cull_count]);
-					j--;
-				} else {
-					if (static_cast<InstanceGeometryData *>(instance->base_data)->material_is_animated) {
-						animated_material_found = true;
-					}
-					instance->depth = near_plane.distance_to(instance->transform.origin);
-					instance->depth_layer = 0;
+		} break;
+	}
+}
+
+void VisualServerScene::_cull_shadow_pass(ShadowCullPass &p_pass) {
+	// per thread scratch, the passes only keep the casters
+	static thread_local LocalVector<Instance *> cull_result;
+	if (cull_result.size() < MAX_INSTANCE_CULL) {
+		cull_result.resize(MAX_INSTANCE_CULL);
+	}
+
+	int cull_count;
+	if (p_pass.concurrent) {
+		cull_count = p_pass.light->scenario->sps->cull_convex_concurrent(p_pass.planes, cull_result.ptr(), MAX_INSTANCE_CULL, VS::INSTANCE_GEOMETRY_MASK);
+	} else if (p_pass.from_point) {
+		InstanceLightData *light = static_cast<InstanceLightData *>(p_pass.light->base_data);
+		cull_count = _cull_convex_from_point(p_pass.light->scenario, p_pass.light_transform.origin, p_pass.planes, cull_result.ptr(), MAX_INSTANCE_CULL, light->previous_room_id_hint, VS::INSTANCE_GEOMETRY_MASK);
+	} else {
+		cull_count = p_pass.light->scenario->sps->cull_convex(p_pass.planes, cull_result.ptr(), MAX_INSTANCE_CULL, VS::INSTANCE_GEOMETRY_MASK);
+	}
+
+	// only read the instances here, this can run on several threads at once
+	Vector3 z_vec = p_pass.light_transform.basis.get_axis(Vector3::AXIS_Z).normalized();
+
+	for (int i = 0; i < cull_count; i++) {
+		Instance *instance = cull_result[i];
+		if (!instance->visible || !((1 << instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) || !static_cast<InstanceGeometryData *>(instance->base_data)->can_cast_shadows) {
+			continue;
+		}
+
+		if (static_cast<InstanceGeometryData *>(instance->base_data)->material_is_animated) {
+			p_pass.animated_material_found = true;
+		}
+
+		switch (p_pass.type) {
+			case ShadowCullPass::TYPE_DIRECTIONAL_RANGE: {
+				//check distance max and min
+				float max, min;
+				instance->transformed_aabb.project_range_in_plane(p_pass.near_plane, min, max);
+
+				if (!p_pass.found_items || max > p_pass.z_max) {
+					p_pass.z_max = max;
 				}
-			}
 
-			VSG::scene_render->light_instance_set_shadow_transform(light->instance, cm, light_transform, radius, 0, 0);
-			VSG::scene_render->render_shadow(light->instance, p_shadow_atlas, 0, (RasterizerScene::InstanceBase **)instance_shadow_cull_result, cull_count);
+				if (!p_pass.found_items || min < p_pass.z_min) {
+					p_pass.z_min = min;
+				}
 
-		} break;
+				p_pass.found_items = true;
+			} break;
+			case ShadowCullPass::TYPE_DIRECTIONAL_SPLIT: {
+				// a pre pass will need to be needed to determine the actual z-near to be used
+				float max, min;
+				instance->transformed_aabb.project_range_in_plane(Plane(z_vec, 0), min, max);
+				if (max > p_pass.z_max) {
+					p_pass.z_max = max;
+				}
+				p_pass.result.push_back(instance);
+			} break;
+			case ShadowCullPass::TYPE_POSITIONAL: {
+				p_pass.result.push_back(instance);
+			} break;
+		}
+	}
+}
+
+void VisualServerScene::_cull_shadow_pass_job(uint32_t p_index, ShadowCullPass *p_passes) {
+	if (p_passes[p_index].concurrent) {
+		_cull_shadow_pass(p_passes[p_index]);
+	}
+}
+
+void VisualServerScene::_cull_shadow_passes(Scenario *p_scenario, uint32_t p_from, uint32_t p_to) {
+	if (p_from == p_to) {
+		return;
+	}
+
+	// The portal renderer and occlusion culling keep their own scratch state, passes that
+	// go through them are culled here on the render thread.
+	bool portals = p_scenario->_portal_renderer.is_active() || p_scenario->_portal_renderer.is_occlusion_culling_active();
+	bool concurrent = parallel_culling && p_scenario->sps->supports_concurrent_cull();
+
+	uint32_t concurrent_count = 0;
+	for (uint32_t i = p_from; i < p_to; i++) {
+		ShadowCullPass &pass = shadow_cull_passes[i];
+		pass.concurrent = concurrent && !(pass.from_point && portals);
+		if (pass.concurrent) {
+			concurrent_count++;
+		} else {
+			_cull_shadow_pass(pass);
+		}
 	}
 
-	return animated_material_found;
+	if (concurrent_count == 1) {
+		// not worth waking the pool up
+		for (uint32_t i = p_from; i < p_to; i++) {
+			_cull_shadow_pass_job(i - p_from, &shadow_cull_passes[p_from]);
+		}
+	} else if (concurrent_count) {
+		TRACE_SCOPE("rendering", "cull_shadow_passes");
+		WorkerThreadPool::get_singleton()->parallel_for(p_to - p_from, this, &VisualServerScene::_cull_shadow_pass_job, &shadow_cull_passes[p_from]);
+	}
+}
+
+void VisualServerScene::_render_shadow_pass(ShadowCullPass &p_pass, RID p_shadow_atlas) {
+	InstanceLightData *light = static_cast<InstanceLightData *>(p_pass.light->base_data);
+
+	// several passes can share instances, so depth is only written right before each one renders
+	for (uint32_t i = 0; i < p_pass.result.size(); i++) {
+		Instance *instance = p_pass.result[i];
+		instance->depth = p_pass.near_plane.distance_to(instance->transform.origin);
+		instance->depth_layer = 0;
+
+		// casters out of view still need a LOD for the camera
+		if (instance->base_type == VS::INSTANCE_MESH) {
+			_update_instance_lod(instance);
+		}
+	}
+
+	if (p_pass.type == ShadowCullPass::TYPE_DIRECTIONAL_SPLIT) {
+		Vector3 x_vec = p_pass.transform.basis.get_axis(Vector3::AXIS_X).normalized();
+		Vector3 y_vec = p_pass.transform.basis.get_axis(Vector3::AXIS_Y).normalized();
+		Vector3 z_vec = p_pass.transform.basis.get_axis(Vector3::AXIS_Z).normalized();
+
+		CameraMatrix ortho_camera;
+		real_t half_x = (p_pass.x_max_cam - p_pass.x_min_cam) * 0.5;
+		real_t half_y = (p_pass.y_max_cam - p_pass.y_min_cam) * 0.5;
+
+		ortho_camera.set_orthogonal(-half_x, half_x, -half_y, half_y, 0, (p_pass.z_max - p_pass.z_min_cam));
+
+		Transform ortho_transform;
+		ortho_transform.basis = p_pass.transform.basis;
+		ortho_transform.origin = x_vec * (p_pass.x_min_cam + half_x) + y_vec * (p_pass.y_min_cam + half_y) + z_vec * p_pass.z_max;
+
+		VSG::scene_render->light_instance_set_shadow_transform(light->instance, ortho_camera, ortho_transform, 0, p_pass.split, p_pass.pass, p_pass.bias_scale);
+	} else {
+		VSG::scene_render->light_instance_set_shadow_transform(light->instance, p_pass.projection, p_pass.transform, p_pass.far, 0, p_pass.pass);
+	}
+
+	VSG::scene_render->render_shadow(light->instance, p_shadow_atlas, p_pass.pass, (RasterizerScene::InstanceBase **)p_pass.result.ptr(), p_pass.result.size());
+
+	if (p_pass.restore_paraboloid) {
+		VSG::scene_render->light_instance_set_shadow_transform(light->instance, CameraMatrix(), p_pass.light_transform, p_pass.far, 0, 0);
+	}
 }
 
 void VisualServerScene::render_camera(RID p_camera, RID p_scenario, Size2 p_viewport_size, RID p_shadow_atlas) {
@@ -2379,7 +2482,7 @@ void VisualServerScene::render_camera(RID p_camera, RID p_scenario, Size2 p_view
 		} break;
 	}
 
-	_prepare_scene(camera->transform, camera_matrix, ortho, camera->env, camera->visible_layers, p_scenario, p_shadow_atlas, RID(), camera->previous_room_id_hint);
+	_prepare_scene(camera->transform, camera_matrix, ortho, p_viewport_size.height, camera->env, camera->visible_layers, p_scenario, p_shadow_atlas, RID(), camera->previous_room_id_hint);
 	_render_scene(camera->transform, camera_matrix, 0, ortho, camera->env, p_scenario, p_shadow_atlas, RID(), -1);
 #endif
 }
@@ -2458,17 +2561,54 @@ void VisualServerScene::render_camera(Ref<ARVRInterface> &p_interface, ARVRInter
 		mono_transform *= apply_z_shift;
 
 		// now prepare our scene with our adjusted transform projection matrix
-		_prepare_scene(mono_transform, combined_matrix, false, camera->env, camera->visible_layers, p_scenario, p_shadow_atlas, RID(), camera->previous_room_id_hint);
+		_prepare_scene(mono_transform, combined_matrix, false, p_viewport_size.height, camera->env, camera->visible_layers, p_scenario, p_shadow_atlas, RID(), camera->previous_room_id_hint);
 	} else if (p_eye == ARVRInterface::EYE_MONO) {
 		// For mono render, prepare as per usual
-		_prepare_scene(cam_transform, camera_matrix, false, camera->env, camera->visible_layers, p_scenario, p_shadow_atlas, RID(), camera->previous_room_id_hint);
+		_prepare_scene(cam_transform, camera_matrix, false, p_viewport_size.height, camera->env, camera->visible_layers, p_scenario, p_shadow_atlas, RID(), camera->previous_room_id_hint);
 	}
 
 	// And render our scene...
 	_render_scene(cam_transform, camera_matrix, p_eye, false, camera->env, p_scenario, p_shadow_atlas, RID(), -1);
 };
 
-void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, RID p_force_environment, uint32_t p_visible_layers, RID p_scenario, RID p_shadow_atlas, RID p_reflection_probe, int32_t &r_previous_room_id_hint) {
+void VisualServerScene::_setup_mesh_lod(const Transform &p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, float p_viewport_height) {
+	mesh_lod_camera_position = p_cam_transform.origin;
+	mesh_lod_orthogonal = p_cam_orthogonal;
+	mesh_lod_error_scale = -1;
+
+	real_t y_scale = Math::abs(p_cam_projection.matrix[1][1]);
+	if (mesh_lod_threshold > 0 && p_viewport_height > 0 && y_scale > 0) {
+		// the view is 2 / y_scale high, at a distance of 1 for perspective projections
+		mesh_lod_error_scale = 2.0 * mesh_lod_threshold / (y_scale * p_viewport_height);
+	}
+}
+
+void VisualServerScene::_update_instance_lod(Instance *p_instance) const {
+	if (mesh_lod_error_scale < 0) {
+		p_instance->lod_max_error = -1;
+		return;
+	}
+
+	real_t max_error = mesh_lod_error_scale;
+
+	if (!mesh_lod_orthogonal) {
+		// distance to the closest point of the bounds, so full detail once the camera is inside
+		const AABB &aabb = p_instance->transformed_aabb;
+		Vector3 closest;
+		for (int i = 0; i < 3; i++) {
+			closest[i] = CLAMP(mesh_lod_camera_position[i], aabb.position[i], aabb.position[i] + aabb.size[i]);
+		}
+		max_error *= mesh_lod_camera_position.distance_to(closest);
+	}
+
+	// LOD errors are in mesh units, a scaled up instance shows them bigger
+	const Basis &basis = p_instance->transform.basis;
+	real_t scale_squared = MAX(basis.get_axis(0).length_squared(), MAX(basis.get_axis(1).length_squared(), basis.get_axis(2).length_squared()));
+
+	p_instance->lod_max_error = scale_squared > 0 ? max_error / Math::sqrt(scale_squared) : -1;
+}
+
+void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, float p_viewport_height, RID p_force_environment, uint32_t p_visible_layers, RID p_scenario, RID p_shadow_atlas, RID p_reflection_probe, int32_t &r_previous_room_id_hint) {
 	// Note, in stereo rendering:
 	// - p_cam_transform will be a transform in the middle of our two eyes
 	// - p_cam_projection is a wider frustrum that encompasses both eyes
@@ -2480,6 +2620,8 @@ void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const Ca
 
 	VSG::scene_render->set_scene_pass(render_pass);
 
+	_setup_mesh_lod(p_cam_transform, p_cam_projection, p_cam_orthogonal, p_viewport_height);
+
 	//rasterizer->set_camera(camera->transform, camera_matrix,ortho);
 
 	Vector<Plane> planes = p_cam_projection.get_projection_planes(p_cam_transform);
@@ -2571,6 +2713,10 @@ void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const Ca
 				VisualServerRaster::redraw_request();
 			}
 
+			if (ins->base_type == VS::INSTANCE_MESH) {
+				_update_instance_lod(ins);
+			}
+
 			if (ins->base_type == VS::INSTANCE_PARTICLES) {
 				//particles visible? process them
 				if (VSG::storage->particles_is_inactive(ins->base)) {
@@ -2641,6 +2787,7 @@ void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const Ca
 
 	RID *directional_light_ptr = &light_instance_cull_result[light_cull_count];
 	directional_light_count = 0;
+	uint32_t directional_range_pass_count = 0;
 
 	// directional lights
 	{
@@ -2671,8 +2818,29 @@ void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const Ca
 
 		VSG::scene_render->set_directional_shadow_count(directional_shadow_count);
 
+		// The optimized depth range needs the casters in view before the splits can be placed,
+		// so those lights get a first batch of culling with the camera frustum.
+		shadow_cull_pass_count = 0;
+		int *range_passes = (int *)alloca(sizeof(int) * MAX(directional_shadow_count, 1));
+
+		for (int i = 0; i < directional_shadow_count; i++) {
+			range_passes[i] = -1;
+			if (VSG::storage->light_directional_get_shadow_depth_range_mode(lights_with_shadow[i]->base) == VS::LIGHT_DIRECTIONAL_SHADOW_DEPTH_RANGE_OPTIMIZED) {
+				range_passes[i] = shadow_cull_pass_count;
+				ShadowCullPass &pass = _add_shadow_cull_pass(ShadowCullPass::TYPE_DIRECTIONAL_RANGE, lights_with_shadow[i], 0);
+				pass.planes = planes;
+				pass.near_plane = Plane(p_cam_transform.origin, -p_cam_transform.basis.get_axis(2));
+				pass.z_min = 1e20;
+				pass.z_max = -1e20;
+			}
+		}
+
+		_cull_shadow_passes(scenario, 0, shadow_cull_pass_count);
+		directional_range_pass_count = shadow_cull_pass_count;
+
 		for (int i = 0; i < directional_shadow_count; i++) {
-			_light_instance_update_shadow(lights_with_shadow[i], p_cam_transform, p_cam_projection, p_cam_orthogonal, p_shadow_atlas, scenario);
+			const ShadowCullPass *range = range_passes[i] >= 0 ? &shadow_cull_passes[range_passes[i]] : nullptr;
+			_light_instance_add_shadow_passes(lights_with_shadow[i], p_cam_transform, p_cam_projection, p_cam_orthogonal, range);
 		}
 	}
 
@@ -2768,7 +2936,25 @@ void VisualServerScene::_prepare_scene(const Transform p_cam_transform, const Ca
 
 			if (redraw) {
 				//must redraw!
-				light->shadow_dirty = _light_instance_update_shadow(ins, p_cam_transform, p_cam_projection, p_cam_orthogonal, p_shadow_atlas, scenario);
+				_light_instance_add_shadow_passes(ins, p_cam_transform, p_cam_projection, p_cam_orthogonal, nullptr);
+			}
+		}
+	}
+
+	{ //cull and render shadow maps
+
+		// Atlas slots were all assigned above and never go to lights already drawn this pass,
+		// so every split and light can be culled in one batch before anything is rendered.
+		_cull_shadow_passes(scenario, directional_range_pass_count, shadow_cull_pass_count);
+
+		for (uint32_t i = directional_range_pass_count; i < shadow_cull_pass_count; i++) {
+			ShadowCullPass &pass = shadow_cull_passes[i];
+			_render_shadow_pass(pass, p_shadow_atlas);
+
+			if (pass.type == ShadowCullPass::TYPE_POSITIONAL) {
+				//lights with animated materials draw their shadow again next frame
+				InstanceLightData *light = static_cast<InstanceLightData *>(pass.light->base_data);
+				light->shadow_dirty = light->shadow_dirty || pass.animated_material_found;
 			}
 		}
 	}
@@ -2875,7 +3061,7 @@ bool VisualServerScene::_render_reflection_probe_step(Instance *p_instance, int
 			shadow_atlas = scenario->reflection_probe_shadow_atlas;
 		}
 
-		_prepare_scene(xform, cm, false, RID(), VSG::storage->reflection_probe_get_cull_mask(p_instance->base), p_instance->scenario->self, shadow_atlas, reflection_probe->instance, reflection_probe->previous_room_id_hint);
+		_prepare_scene(xform, cm, false, scenario->reflection_probe_resolution, RID(), VSG::storage->reflection_probe_get_cull_mask(p_instance->base), p_instance->scenario->self, shadow_atlas, reflection_probe->instance, reflection_probe->previous_room_id_hint);
 		_render_scene(xform, cm, 0, false, RID(), p_instance->scenario->self, shadow_atlas, reflection_probe->instance, p_step);
 
 	} else {
@@ -3851,152 +4037,156 @@ void VisualServerScene::render_probes() {
 	}
 }
 
-void VisualServerScene::_update_dirty_instance(Instance *p_instance) {
-	if (p_instance->update_aabb) {
-		_update_instance_aabb(p_instance);
-	}
+void VisualServerScene::_update_instance_materials(Instance *p_instance) {
+	if (p_instance->base_type == VS::INSTANCE_MESH) {
+		//remove materials no longer used and un-own them
 
-	if (p_instance->update_materials) {
-		if (p_instance->base_type == VS::INSTANCE_MESH) {
-			//remove materials no longer used and un-own them
-
-			int new_mat_count = VSG::storage->mesh_get_surface_count(p_instance->base);
-			for (int i = p_instance->materials.size() - 1; i >= new_mat_count; i--) {
-				if (p_instance->materials[i].is_valid()) {
-					VSG::storage->material_remove_instance_owner(p_instance->materials[i], p_instance);
-				}
+		int new_mat_count = VSG::storage->mesh_get_surface_count(p_instance->base);
+		for (int i = p_instance->materials.size() - 1; i >= new_mat_count; i--) {
+			if (p_instance->materials[i].is_valid()) {
+				VSG::storage->material_remove_instance_owner(p_instance->materials[i], p_instance);
 			}
-			p_instance->materials.resize(new_mat_count);
+		}
+		p_instance->materials.resize(new_mat_count);
 
-			int new_blend_shape_count = VSG::storage->mesh_get_blend_shape_count(p_instance->base);
-			if (new_blend_shape_count != p_instance->blend_values.size()) {
-				p_instance->blend_values.resize(new_blend_shape_count);
-				for (int i = 0; i < new_blend_shape_count; i++) {
-					p_instance->blend_values.write().ptr()[i] = 0;
-				}
+		int new_blend_shape_count = VSG::storage->mesh_get_blend_shape_count(p_instance->base);
+		if (new_blend_shape_count != p_instance->blend_values.size()) {
+			p_instance->blend_values.resize(new_blend_shape_count);
+			for (int i = 0; i < new_blend_shape_count; i++) {
+				p_instance->blend_values.write().ptr()[i] = 0;
 			}
 		}
+	}
 
-		if ((1 << p_instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) {
-			InstanceGeometryData *geom = static_cast<InstanceGeometryData *>(p_instance->base_data);
+	if ((1 << p_instance->base_type) & VS::INSTANCE_GEOMETRY_MASK) {
+		InstanceGeometryData *geom = static_cast<InstanceGeometryData *>(p_instance->base_data);
 
-			bool can_cast_shadows = true;
-			bool is_animated = false;
+		bool can_cast_shadows = true;
+		bool is_animated = false;
 
-			if (p_instance->cast_shadows == VS::SHADOW_CASTING_SETTING_OFF) {
-				can_cast_shadows = false;
-			} else if (p_instance->material_override.is_valid()) {
-				can_cast_shadows = VSG::storage->material_casts_shadows(p_instance->material_override);
-				is_animated = VSG::storage->material_is_animated(p_instance->material_override);
-			} else {
-				if (p_instance->base_type == VS::INSTANCE_MESH) {
-					RID mesh = p_instance->base;
+		if (p_instance->cast_shadows == VS::SHADOW_CASTING_SETTING_OFF) {
+			can_cast_shadows = false;
+		} else if (p_instance->material_override.is_valid()) {
+			can_cast_shadows = VSG::storage->material_casts_shadows(p_instance->material_override);
+			is_animated = VSG::storage->material_is_animated(p_instance->material_override);
+		} else {
+			if (p_instance->base_type == VS::INSTANCE_MESH) {
+				RID mesh = p_instance->base;
 
-					if (mesh.is_valid()) {
-						bool cast_shadows = false;
+				if (mesh.is_valid()) {
+					bool cast_shadows = false;
 
-						for (int i = 0; i < p_instance->materials.size(); i++) {
-							RID mat = p_instance->materials[i].is_valid() ? p_instance->materials[i] : VSG::storage->mesh_surface_get_material(mesh, i);
+					for (int i = 0; i < p_instance->materials.size(); i++) {
+						RID mat = p_instance->materials[i].is_valid() ? p_instance->materials[i] : VSG::storage->mesh_surface_get_material(mesh, i);
 
-							if (!mat.is_valid()) {
+						if (!mat.is_valid()) {
+							cast_shadows = true;
+						} else {
+							if (VSG::storage->material_casts_shadows(mat)) {
 								cast_shadows = true;
-							} else {
-								if (VSG::storage->material_casts_shadows(mat)) {
-									cast_shadows = true;
-								}
+							}
 
-								if (VSG::storage->material_is_animated(mat)) {
-									is_animated = true;
-								}
+							if (VSG::storage->material_is_animated(mat)) {
+								is_animated = true;
 							}
 						}
+					}
 
-						if (!cast_shadows) {
-							can_cast_shadows = false;
-						}
+					if (!cast_shadows) {
+						can_cast_shadows = false;
 					}
+				}
 
-				} else if (p_instance->base_type == VS::INSTANCE_MULTIMESH) {
-					RID mesh = VSG::storage->multimesh_get_mesh(p_instance->base);
-					if (mesh.is_valid()) {
-						bool cast_shadows = false;
+			} else if (p_instance->base_type == VS::INSTANCE_MULTIMESH) {
+				RID mesh = VSG::storage->multimesh_get_mesh(p_instance->base);
+				if (mesh.is_valid()) {
+					bool cast_shadows = false;
 
-						int sc = VSG::storage->mesh_get_surface_count(mesh);
-						for (int i = 0; i < sc; i++) {
-							RID mat = VSG::storage->mesh_surface_get_material(mesh, i);
+					int sc = VSG::storage->mesh_get_surface_count(mesh);
+					for (int i = 0; i < sc; i++) {
+						RID mat = VSG::storage->mesh_surface_get_material(mesh, i);
 
-							if (!mat.is_valid()) {
-								cast_shadows = true;
+						if (!mat.is_valid()) {
+							cast_shadows = true;
 
-							} else {
-								if (VSG::storage->material_casts_shadows(mat)) {
-									cast_shadows = true;
-								}
-								if (VSG::storage->material_is_animated(mat)) {
-									is_animated = true;
-								}
+						} else {
+							if (VSG::storage->material_casts_shadows(mat)) {
+								cast_shadows = true;
+							}
+							if (VSG::storage->material_is_animated(mat)) {
+								is_animated = true;
 							}
 						}
+					}
 
-						if (!cast_shadows) {
-							can_cast_shadows = false;
-						}
+					if (!cast_shadows) {
+						can_cast_shadows = false;
 					}
-				} else if (p_instance->base_type == VS::INSTANCE_IMMEDIATE) {
-					RID mat = VSG::storage->immediate_get_material(p_instance->base);
+				}
+			} else if (p_instance->base_type == VS::INSTANCE_IMMEDIATE) {
+				RID mat = VSG::storage->immediate_get_material(p_instance->base);
 
-					can_cast_shadows = !mat.is_valid() || VSG::storage->material_casts_shadows(mat);
+				can_cast_shadows = !mat.is_valid() || VSG::storage->material_casts_shadows(mat);
 
-					if (mat.is_valid() && VSG::storage->material_is_animated(mat)) {
-						is_animated = true;
-					}
-				} else if (p_instance->base_type == VS::INSTANCE_PARTICLES) {
-					bool cast_shadows = false;
+				if (mat.is_valid() && VSG::storage->material_is_animated(mat)) {
+					is_animated = true;
+				}
+			} else if (p_instance->base_type == VS::INSTANCE_PARTICLES) {
+				bool cast_shadows = false;
 
-					int dp = VSG::storage->particles_get_draw_passes(p_instance->base);
+				int dp = VSG::storage->particles_get_draw_passes(p_instance->base);
 
-					for (int i = 0; i < dp; i++) {
-						RID mesh = VSG::storage->particles_get_draw_pass_mesh(p_instance->base, i);
-						if (!mesh.is_valid()) {
-							continue;
-						}
+				for (int i = 0; i < dp; i++) {
+					RID mesh = VSG::storage->particles_get_draw_pass_mesh(p_instance->base, i);
+					if (!mesh.is_valid()) {
+						continue;
+					}
 
-						int sc = VSG::storage->mesh_get_surface_count(mesh);
-						for (int j = 0; j < sc; j++) {
-							RID mat = VSG::storage->mesh_surface_get_material(mesh, j);
+					int sc = VSG::storage->mesh_get_surface_count(mesh);
+					for (int j = 0; j < sc; j++) {
+						RID mat = VSG::storage->mesh_surface_get_material(mesh, j);
 
-							if (!mat.is_valid()) {
+						if (!mat.is_valid()) {
+							cast_shadows = true;
+						} else {
+							if (VSG::storage->material_casts_shadows(mat)) {
 								cast_shadows = true;
-							} else {
-								if (VSG::storage->material_casts_shadows(mat)) {
-									cast_shadows = true;
-								}
+							}
 
-								if (VSG::storage->material_is_animated(mat)) {
-									is_animated = true;
-								}
+							if (VSG::storage->material_is_animated(mat)) {
+								is_animated = true;
 							}
 						}
 					}
-
-					if (!cast_shadows) {
-						can_cast_shadows = false;
-					}
 				}
-			}
 
-			if (can_cast_shadows != geom->can_cast_shadows) {
-				//ability to cast shadows change, let lights now
-				for (List<Instance *>::Element *E = geom->lighting.front(); E; E = E->next()) {
-					InstanceLightData *light = static_cast<InstanceLightData *>(E->get()->base_data);
-					light->shadow_dirty = true;
+				if (!cast_shadows) {
+					can_cast_shadows = false;
 				}
+			}
+		}
 
-				geom->can_cast_shadows = can_cast_shadows;
+		if (can_cast_shadows != geom->can_cast_shadows) {
+			//ability to cast shadows change, let lights now
+			for (List<Instance *>::Element *E = geom->lighting.front(); E; E = E->next()) {
+				InstanceLightData *light = static_cast<InstanceLightData *>(E->get()->base_data);
+				light->shadow_dirty = true;
 			}
 
-			geom->material_is_animated = is_animated;
+			geom->can_cast_shadows = can_cast_shadows;
 		}
+
+		geom->material_is_animated = is_animated;
+	}
+}
+
+void VisualServerScene::_update_dirty_instance(Instance *p_instance) {
+	if (p_instance->update_aabb) {
+		_update_instance_aabb(p_instance);
+	}
+
+	if (p_instance->update_materials) {
+		_update_instance_materials(p_instance);
 	}
 
 	_instance_update_list.remove(&p_instance->update_item);
@@ -4007,6 +4197,101 @@ void VisualServerScene::_update_dirty_instance(Instance *p_instance) {
 	p_instance->update_materials = false;
 }
 
+void VisualServerScene::_update_dirty_instance_bounds(uint32_t p_index, Instance **p_instances) {
+	Instance *instance = p_instances[p_index];
+
+	if (instance->update_aabb) {
+		_update_instance_aabb(instance);
+		instance->update_aabb = false;
+	}
+
+	if (!instance->aabb.has_no_surface()) {
+		_update_instance_bounds(instance);
+	}
+}
+
+void VisualServerScene::_flush_instance_moves(Scenario *p_scenario) {
+	if (instance_move_handles.size()) {
+		p_scenario->sps->move_batch(instance_move_handles.ptr(), instance_move_aabbs.ptr(), instance_move_handles.size());
+	}
+
+	instance_move_handles.clear();
+	instance_move_aabbs.clear();
+}
+
+void VisualServerScene::_update_dirty_instance_batch() {
+	// Same as calling _update_dirty_instance() on each instance, but in steps, so the part
+	// that grows with the number of moving instances runs on the worker threads: fetching
+	// mesh bounds (which walks the bones of skinned meshes) and transforming them.
+	// Everything that touches other instances or the storage stays on this thread, and
+	// the instances that moved are handed to the spatial partitioning in one batch.
+	dirty_instance_batch.clear();
+	while (SelfList<Instance> *item = _instance_update_list.first()) {
+		_instance_update_list.remove(item);
+		dirty_instance_batch.push_back(item->self());
+	}
+
+	uint32_t count = dirty_instance_batch.size();
+
+	// The flags are cleared as each step is done, so anything queued again by the
+	// later steps (pairing, lightmap captures) is picked up by the next batch.
+	for (uint32_t i = 0; i < count; i++) {
+		Instance *instance = dirty_instance_batch[i];
+
+		// only mesh bounds are read without side effects, the others may update storage caches
+		if (instance->update_aabb && instance->base_type != VS::INSTANCE_MESH) {
+			_update_instance_aabb(instance);
+			instance->update_aabb = false;
+		}
+
+		if (instance->update_materials) {
+			_update_instance_materials(instance);
+			instance->update_materials = false;
+		}
+	}
+
+	if (count >= 128) {
+		TRACE_SCOPE("rendering", "update_dirty_instance_bounds");
+		WorkerThreadPool::get_singleton()->parallel_for(count, this, &VisualServerScene::_update_dirty_instance_bounds, dirty_instance_batch.ptr());
+	} else {
+		for (uint32_t i = 0; i < count; i++) {
+			_update_dirty_instance_bounds(i, dirty_instance_batch.ptr());
+		}
+	}
+
+	Scenario *move_scenario = nullptr;
+
+	for (uint32_t i = 0; i < count; i++) {
+		Instance *instance = dirty_instance_batch[i];
+
+		if (!_update_instance_base(instance) || !instance->scenario) {
+			continue;
+		}
+
+		if (instance->spatial_partition_id == 0) {
+			_update_instance_spatial(instance);
+			continue;
+		}
+
+		if (instance->scenario != move_scenario) {
+			if (move_scenario) {
+				_flush_instance_moves(move_scenario);
+			}
+			move_scenario = instance->scenario;
+		}
+
+		instance_move_handles.push_back(instance->spatial_partition_id);
+		instance_move_aabbs.push_back(instance->transformed_aabb);
+
+		// keep rooms and portals instance up to date if present
+		_rooms_instance_update(instance, instance->transformed_aabb);
+	}
+
+	if (move_scenario) {
+		_flush_instance_moves(move_scenario);
+	}
+}
+
 void VisualServerScene::update_dirty_instances() {
 	VSG::storage->update_dirty_resources();
 
@@ -4017,7 +4302,11 @@ void VisualServerScene::update_dirty_instances() {
 	}
 
 	while (_instance_update_list.first()) {
-		_update_dirty_instance(_instance_update_list.first()->self());
+		if (parallel_instance_update) {
+			_update_dirty_instance_batch();
+		} else {
+			_update_dirty_instance(_instance_update_list.first()->self());
+		}
 	}
 
 	if (scenario) {
@@ -4099,6 +4388,19 @@ VisualServerScene::VisualServerScene() {
 	GLOBAL_DEF("rendering/quality/spatial_partitioning/bvh_collision_margin", 0.1);
 	ProjectSettings::get_singleton()->set_custom_property_info("rendering/quality/spatial_partitioning/bvh_collision_margin", PropertyInfo(Variant::REAL, "rendering/quality/spatial_partitioning/bvh_collision_margin", PROPERTY_HINT_RANGE, "0.0,2.0,0.01"));
 
+	shadow_cull_pass_count = 0;
+	parallel_culling = GLOBAL_DEF("rendering/threads/parallel_culling", true);
+	parallel_instance_update = GLOBAL_DEF("rendering/threads/parallel_instance_update", true);
+
+	// also defined by SceneTree, which sets them on the root viewport's scenario
+	GLOBAL_DEF_RST("rendering/quality/reflections/atlas_size", 2048);
+	GLOBAL_DEF_RST("rendering/quality/reflections/atlas_subdiv", 8);
+
+	mesh_lod_threshold = GLOBAL_DEF("rendering/quality/mesh_lod/threshold_pixels", 1.0);
+	ProjectSettings::get_singleton()->set_custom_property_info("rendering/quality/mesh_lod/threshold_pixels", PropertyInfo(Variant::REAL, "rendering/quality/mesh_lod/threshold_pixels", PROPERTY_HINT_RANGE, "0,16,0.01"));
+	mesh_lod_error_scale = -1;
+	mesh_lod_orthogonal = false;
+
 	_visual_server_callbacks = nullptr;
 }
 
@@ -33,6 +33,7 @@
 
 #include "servers/visual/rasterizer.h"
 
+#include "core/local_vector.h"
 #include "core/math/bvh.h"
 #include "core/math/geometry.h"
 #include "core/math/octree.h"
@@ -117,6 +118,11 @@ public:
 		virtual SpatialPartitionID create(Instance *p_userdata, const AABB &p_aabb = AABB(), int p_subindex = 0, bool p_pairable = false, uint32_t p_pairable_type = 0, uint32_t pairable_mask = 1) = 0;
 		virtual void erase(SpatialPartitionID p_handle) = 0;
 		virtual void move(SpatialPartitionID p_handle, const AABB &p_aabb) = 0;
+		virtual void move_batch(const SpatialPartitionID *p_handles, const AABB *p_aabbs, int p_count) {
+			for (int i = 0; i < p_count; i++) {
+				move(p_handles[i], p_aabbs[i]);
+			}
+		}
 		virtual void activate(SpatialPartitionID p_handle, const AABB &p_aabb) {}
 		virtual void deactivate(SpatialPartitionID p_handle) {}
 		virtual void force_collision_check(SpatialPartitionID p_handle) {}
@@ -124,6 +130,10 @@ public:
 		virtual void update_collisions() {}
 		virtual void set_pairable(SpatialPartitionID p_handle, bool p_pairable, uint32_t p_pairable_type, uint32_t p_pairable_mask) = 0;
 		virtual int cull_convex(const Vector<Plane> &p_convex, Instance **p_result_array, int p_result_max, uint32_t p_mask = 0xFFFFFFFF) = 0;
+		// Can be called from several threads at once, as long as nothing is modified meanwhile.
+		// Only schemes that return true from supports_concurrent_cull() implement it.
+		virtual int cull_convex_concurrent(const Vector<Plane> &p_convex, Instance **p_result_array, int p_result_max, uint32_t p_mask = 0xFFFFFFFF) { return 0; }
+		virtual bool supports_concurrent_cull() const { return false; }
 		virtual int cull_aabb(const AABB &p_aabb, Instance **p_result_array, int p_result_max, int *p_subindex_array = nullptr, uint32_t p_mask = 0xFFFFFFFF) = 0;
 		virtual int cull_segment(const Vector3 &p_from, const Vector3 &p_to, Instance **p_result_array, int p_result_max, int *p_subindex_array = nullptr, uint32_t p_mask = 0xFFFFFFFF) = 0;
 
@@ -162,12 +172,14 @@ public:
 	class SpatialPartitioningScene_BVH : public SpatialPartitioningScene {
 		// Note that SpatialPartitionIDs are +1 based when stored in visual server, to enable 0 to indicate invalid ID.
 		BVH_Manager<Instance, true, 256> _bvh;
+		LocalVector<uint32_t, uint32_t, true> _move_handles;
 
 	public:
 		SpatialPartitioningScene_BVH();
 		SpatialPartitionID create(Instance *p_userdata, const AABB &p_aabb = AABB(), int p_subindex = 0, bool p_pairable = false, uint32_t p_pairable_type = 0, uint32_t p_pairable_mask = 1);
 		void erase(SpatialPartitionID p_handle);
 		void move(SpatialPartitionID p_handle, const AABB &p_aabb);
+		void move_batch(const SpatialPartitionID *p_handles, const AABB *p_aabbs, int p_count);
 		void activate(SpatialPartitionID p_handle, const AABB &p_aabb);
 		void deactivate(SpatialPartitionID p_handle);
 		void force_collision_check(SpatialPartitionID p_handle);
@@ -175,6 +187,8 @@ public:
 		void update_collisions();
 		void set_pairable(SpatialPartitionID p_handle, bool p_pairable, uint32_t p_pairable_type, uint32_t p_pairable_mask);
 		int cull_convex(const Vector<Plane> &p_convex, Instance **p_result_array, int p_result_max, uint32_t p_mask = 0xFFFFFFFF);
+		int cull_convex_concurrent(const Vector<Plane> &p_convex, Instance **p_result_array, int p_result_max, uint32_t p_mask = 0xFFFFFFFF);
+		bool supports_concurrent_cull() const { return true; }
 		int cull_aabb(const AABB &p_aabb, Instance **p_result_array, int p_result_max, int *p_subindex_array = nullptr, uint32_t p_mask = 0xFFFFFFFF);
 		int cull_segment(const Vector3 &p_from, const Vector3 &p_to, Instance **p_result_array, int p_result_max, int *p_subindex_array = nullptr, uint32_t p_mask = 0xFFFFFFFF);
 		void set_pair_callback(PairCallback p_callback, void *p_userdata);
@@ -196,6 +210,7 @@ public:
 		RID fallback_environment;
 		RID reflection_probe_shadow_atlas;
 		RID reflection_atlas;
+		int reflection_probe_resolution; // size of one probe in the atlas, for mesh LOD selection
 
 		SelfList<Instance>::List instances;
 
@@ -501,7 +516,6 @@ public:
 
 	int instance_cull_count;
 	Instance *instance_cull_result[MAX_INSTANCE_CULL];
-	Instance *instance_shadow_cull_result[MAX_INSTANCE_CULL]; //used for generating shadowmaps
 	Instance *light_cull_result[MAX_LIGHTS_CULLED];
 	RID light_instance_cull_result[MAX_LIGHTS_CULLED];
 	int light_cull_count;
@@ -695,13 +709,71 @@ public:
 	virtual void instance_geometry_set_as_instance_lod(RID p_instance, RID p_as_lod_of_instance);
 
 	_FORCE_INLINE_ void _update_instance(Instance *p_instance);
+	_FORCE_INLINE_ bool _update_instance_base(Instance *p_instance);
+	_FORCE_INLINE_ void _update_instance_bounds(Instance *p_instance);
+	_FORCE_INLINE_ void _update_instance_spatial(Instance *p_instance);
 	_FORCE_INLINE_ void _update_instance_aabb(Instance *p_instance);
+	_FORCE_INLINE_ void _update_instance_materials(Instance *p_instance);
 	_FORCE_INLINE_ void _update_dirty_instance(Instance *p_instance);
 	_FORCE_INLINE_ void _update_instance_lightmap_captures(Instance *p_instance);
 
-	_FORCE_INLINE_ bool _light_instance_update_shadow(Instance *p_instance, const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, RID p_shadow_atlas, Scenario *p_scenario);
+	// Shadow maps are updated in two steps: the passes of all the lights that need a redraw
+	// are set up and culled in parallel, then rendered in order on the render thread.
+	struct ShadowCullPass {
+		enum Type {
+			TYPE_DIRECTIONAL_RANGE, // depth range of the casters in view, the directional splits depend on it
+			TYPE_DIRECTIONAL_SPLIT,
+			TYPE_POSITIONAL,
+		};
+
+		Type type;
+		Instance *light;
+		int pass;
+		Vector<Plane> planes;
+		bool from_point; // culled through the portal renderer when it is active
+		Transform light_transform;
+		Plane near_plane; // caster depth is measured from it, the range pass measures along it
+
+		// shadow transform, directional splits build it after culling
+		CameraMatrix projection;
+		Transform transform;
+		float far;
+		float split;
+		float bias_scale;
+		bool restore_paraboloid; // last face of a cube map, the regular dual paraboloid transform is set back after it
+
+		// directional splits: light space bounds of the split, z_max grows to the furthest caster
+		float x_min_cam, x_max_cam, y_min_cam, y_max_cam, z_min_cam;
+		float z_min, z_max;
+
+		LocalVector<Instance *> result;
+		bool found_items;
+		bool animated_material_found;
+		bool concurrent;
+	};
+
+	LocalVector<ShadowCullPass> shadow_cull_passes;
+	uint32_t shadow_cull_pass_count;
+	bool parallel_culling;
+
+	ShadowCullPass &_add_shadow_cull_pass(ShadowCullPass::Type p_type, Instance *p_light, int p_pass);
+	void _light_instance_add_shadow_passes(Instance *p_instance, const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, const ShadowCullPass *p_range);
+	void _cull_shadow_pass(ShadowCullPass &p_pass);
+	void _cull_shadow_pass_job(uint32_t p_index, ShadowCullPass *p_passes);
+	void _cull_shadow_passes(Scenario *p_scenario, uint32_t p_from, uint32_t p_to);
+	void _render_shadow_pass(ShadowCullPass &p_pass, RID p_shadow_atlas);
+
+	// Mesh LODs are picked from how big their error would be on screen, for the
+	// camera of the scene being prepared. Shadow casters use the same camera.
+	float mesh_lod_threshold;
+	float mesh_lod_error_scale;
+	bool mesh_lod_orthogonal;
+	Vector3 mesh_lod_camera_position;
 
-	void _prepare_scene(const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, RID p_force_environment, uint32_t p_visible_layers, RID p_scenario, RID p_shadow_atlas, RID p_reflection_probe, int32_t &r_previous_room_id_hint);
+	void _setup_mesh_lod(const Transform &p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, float p_viewport_height);
+	void _update_instance_lod(Instance *p_instance) const;
+
+	void _prepare_scene(const Transform p_cam_transform, const CameraMatrix &p_cam_projection, bool p_cam_orthogonal, float p_viewport_height, RID p_force_environment, uint32_t p_visible_layers, RID p_scenario, RID p_shadow_atlas, RID p_reflection_probe, int32_t &r_previous_room_id_hint);
 	void _render_scene(const Transform p_cam_transform, const CameraMatrix &p_cam_projection, const int p_eye, bool p_cam_orthogonal, RID p_force_environment, RID p_scenario, RID p_shadow_atlas, RID p_reflection_probe, int p_reflection_probe_pass);
 	void render_empty_scene(RID p_scenario, RID p_shadow_atlas);
 
@@ -709,6 +781,17 @@ public:
 	void render_camera(Ref<ARVRInterface> &p_interface, ARVRInterface::Eyes p_eye, RID p_camera, RID p_scenario, Size2 p_viewport_size, RID p_shadow_atlas);
 	void update_dirty_instances();
 
+	// Dirty instances are updated in batches when parallel_instance_update is set,
+	// see _update_dirty_instance_batch().
+	LocalVector<Instance *> dirty_instance_batch;
+	LocalVector<SpatialPartitionID, uint32_t, true> instance_move_handles;
+	LocalVector<AABB> instance_move_aabbs;
+	bool parallel_instance_update;
+
+	void _update_dirty_instance_batch();
+	void _update_dirty_instance_bounds(uint32_t p_index, Instance **p_instances);
+	void _flush_instance_moves(Scenario *p_scenario);
+
 	//probes
 	struct GIProbeDataHeader {
 		uint32_t version;
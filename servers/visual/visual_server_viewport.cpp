@@ -78,6 +78,9 @@ void VisualServerViewport::_draw_3d(Viewport *p_viewport, ARVRInterface::Eyes p_
 }
 
 void VisualServerViewport::_draw_viewport(Viewport *p_viewport, ARVRInterface::Eyes p_eye) {
+	// canvas sorting scratch comes from the frame arena, this may run on the render thread
+	FrameAllocator::Scope frame_scope;
+
 	/* Camera should always be BEFORE any other 3D */
 
 	bool scenario_draw_canvas_bg = false; //draw canvas, or some layer of it, as BG for 3D instead of in front
@@ -109,7 +112,7 @@ void VisualServerViewport::_draw_viewport(Viewport *p_viewport, ARVRInterface::E
 	if (!p_viewport->hide_canvas) {
 		int i = 0;
 
-		Map<Viewport::CanvasKey, Viewport::CanvasData *> canvas_map;
+		Map<Viewport::CanvasKey, Viewport::CanvasData *, Comparator<Viewport::CanvasKey>, FrameAllocator> canvas_map;
 
 		Rect2 clip_rect(0, 0, p_viewport->size.x, p_viewport->size.y);
 		RasterizerCanvas::Light *lights = nullptr;
@@ -217,7 +220,7 @@ void VisualServerViewport::_draw_viewport(Viewport *p_viewport, ARVRInterface::E
 			scenario_draw_canvas_bg = false;
 		}
 
-		for (Map<Viewport::CanvasKey, Viewport::CanvasData *>::Element *E = canvas_map.front(); E; E = E->next()) {
+		for (Map<Viewport::CanvasKey, Viewport::CanvasData *, Comparator<Viewport::CanvasKey>, FrameAllocator>::Element *E = canvas_map.front(); E; E = E->next()) {
 			VisualServerCanvas::Canvas *canvas = static_cast<VisualServerCanvas::Canvas *>(E->get()->canvas);
 
 			Transform2D xform = _canvas_get_transform(p_viewport, canvas, E->get(), clip_rect.size);
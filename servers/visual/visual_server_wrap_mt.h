@@ -175,6 +175,9 @@ public:
 	FUNC2RC(Vector<PoolVector<uint8_t>>, mesh_surface_get_blend_shapes, RID, int)
 	FUNC2RC(Vector<AABB>, mesh_surface_get_skeleton_aabb, RID, int)
 
+	FUNC3(mesh_surface_set_lods, RID, int, const Vector<SurfaceLOD> &)
+	FUNC2RC(Vector<SurfaceLOD>, mesh_surface_get_lods, RID, int)
+
 	FUNC2(mesh_remove_surface, RID, int)
 	FUNC1RC(int, mesh_get_surface_count, RID)
 
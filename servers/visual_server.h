@@ -326,6 +326,19 @@ public:
 	virtual Vector<AABB> mesh_surface_get_skeleton_aabb(RID p_mesh, int p_surface) const = 0;
 	Array _mesh_surface_get_skeleton_aabb_bind(RID p_mesh, int p_surface) const;
 
+	// Reduced detail versions of a surface, as extra index arrays over the same
+	// vertices (same index format as the surface itself). Sorted from the least
+	// to the most simplified, error is the largest distance the LOD moves the
+	// surface, in mesh units.
+	struct SurfaceLOD {
+		float error;
+		int index_count;
+		PoolVector<uint8_t> index_array;
+	};
+
+	virtual void mesh_surface_set_lods(RID p_mesh, int p_surface, const Vector<SurfaceLOD> &p_lods) = 0;
+	virtual Vector<SurfaceLOD> mesh_surface_get_lods(RID p_mesh, int p_surface) const = 0;
+
 	virtual void mesh_remove_surface(RID p_mesh, int p_index) = 0;
 	virtual int mesh_get_surface_count(RID p_mesh) const = 0;
 